@@ -0,0 +1,1286 @@
+// Standalone driver for the gd-ffmpeg core library.
+//
+//   gdffmpeg_native test [--video-codec=mpeg4] [--audio-codec=libmp3lame]
+//   gdffmpeg_native bench [--codec=libx264] [--preset=veryfast] [--size=1280x720] [--frames=300]
+//
+// "test" runs in-memory round trips and exits non-zero on failure; "bench"
+// prints encode/decode throughput and the decoder's per-stage timings.
+
+#include "core/audio_decoder.h"
+#include "core/audio_encoder.h"
+#include "core/audio_transcoder.h"
+#include "core/batch_transcoder.h"
+#include "core/chunked_buffer.h"
+#include "core/concatenator.h"
+#include "core/movie_encoder.h"
+#include "core/packet_muxer.h"
+#include "core/pipeline_stats.h"
+#include "core/remuxer.h"
+#include "core/replay_buffer.h"
+#include "core/segmented_encoder.h"
+#include "core/smart_trimmer.h"
+#include "core/thread_budget.h"
+#include "core/trace.h"
+#include "core/video_decoder.h"
+#include "core/video_encoder.h"
+#include "core/video_transcoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+}
+
+using namespace gdffmpeg;
+
+namespace {
+
+struct Options {
+    std::string video_codec = "mpeg4";
+    std::string audio_codec = "libmp3lame";
+    std::string codec = "libx264";
+    std::string preset = "veryfast";
+    int width = 1280;
+    int height = 720;
+    int frames = 300;
+};
+
+class BufferSink : public OutputSink {
+public:
+    std::vector<uint8_t> bytes;
+
+    void write(const uint8_t *p_data, int p_size) override {
+        bytes.insert(bytes.end(), p_data, p_data + p_size);
+    }
+};
+
+double seconds_since(std::chrono::steady_clock::time_point p_start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - p_start).count();
+}
+
+// Moving diagonal gradient; smooth enough that lossy codecs stay close.
+void fill_test_frame(std::vector<uint8_t> &r_rgba, int p_width, int p_height, int p_index) {
+    r_rgba.resize(static_cast<size_t>(p_width) * p_height * 4);
+    for (int y = 0; y < p_height; y++) {
+        uint8_t *row = r_rgba.data() + static_cast<size_t>(y) * p_width * 4;
+        for (int x = 0; x < p_width; x++) {
+            row[x * 4 + 0] = static_cast<uint8_t>((x * 255) / p_width);
+            row[x * 4 + 1] = static_cast<uint8_t>((y * 255) / p_height);
+            row[x * 4 + 2] = static_cast<uint8_t>((p_index * 8) & 0xff);
+            row[x * 4 + 3] = 255;
+        }
+    }
+}
+
+bool encode_clip(VideoEncoder &p_encoder, BufferSink &p_sink, int p_width, int p_height, int p_frames, double *r_seconds) {
+    std::vector<uint8_t> rgba;
+    double encode_time = 0.0;
+    p_encoder.begin(std::string(), &p_sink);
+    for (int i = 0; i < p_frames; i++) {
+        fill_test_frame(rgba, p_width, p_height, i);
+        const auto start = std::chrono::steady_clock::now();
+        if (p_encoder.encode_frame(rgba.data(), static_cast<int>(rgba.size()), p_width, p_height, AV_PIX_FMT_RGBA) != 0) {
+            return false;
+        }
+        encode_time += seconds_since(start);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    p_encoder.finish();
+    encode_time += seconds_since(start);
+    p_encoder.reset();
+    if (r_seconds) {
+        *r_seconds = encode_time;
+    }
+    return !p_sink.bytes.empty();
+}
+
+int failures = 0;
+
+void check(bool p_condition, const char *p_what) {
+    std::printf("  [%s] %s\n", p_condition ? "ok" : "FAIL", p_what);
+    if (!p_condition) {
+        failures++;
+    }
+}
+
+// Writes p_frame_count frames of the test gradient with a 440 Hz tone
+// through MovieEncoder into p_path.
+void write_test_movie(const Options &p_options, const std::string &p_path, int p_width, int p_height, int p_fps, int p_frame_count, int p_sample_rate) {
+    MovieEncoder movie;
+    movie.get_video_config().codec_name = p_options.video_codec;
+    movie.get_video_config().rate_control_mode = "cbr";
+    movie.get_video_config().frame_rate = p_fps;
+    movie.get_audio_options().codec_name = p_options.audio_codec;
+    movie.get_audio_options().sample_rate = p_sample_rate;
+    movie.get_audio_options().channels = 2;
+    movie.get_audio_options().bit_rate = 128000;
+    check(movie.begin(p_path) == 0, "begin");
+
+    bool submitted = true;
+    for (int i = 0; i < p_frame_count; i++) {
+        std::vector<uint8_t> *rgba = new std::vector<uint8_t>();
+        fill_test_frame(*rgba, p_width, p_height, i);
+        EncoderFrame frame;
+        frame.data = rgba->data();
+        frame.size = static_cast<int>(rgba->size());
+        frame.width = p_width;
+        frame.height = p_height;
+        frame.format = AV_PIX_FMT_RGBA;
+        frame.release = [rgba]() {
+            delete rgba;
+        };
+
+        // Same block size as Godot's movie mode: mix_rate / p_fps per frame.
+        std::vector<float> pcm(static_cast<size_t>(p_sample_rate / p_fps) * 2);
+        for (size_t s = 0; s < pcm.size(); s++) {
+            pcm[s] = 0.5f * std::sin(2.0f * 3.14159265f * 440.0f * (i * (p_sample_rate / p_fps) + s / 2) / p_sample_rate);
+        }
+        submitted = movie.submit(std::move(frame), std::move(pcm)) && submitted;
+    }
+    check(submitted, "every frame is queued");
+    check(movie.finish() == 0, "finish");
+}
+
+void test_video_round_trip(const Options &p_options) {
+    std::printf("video round trip (%s)\n", p_options.video_codec.c_str());
+    if (!avcodec_find_encoder_by_name(p_options.video_codec.c_str())) {
+        std::printf("  [skip] encoder not available\n");
+        return;
+    }
+
+    const int width = 160;
+    const int height = 120;
+    const int frame_count = 30;
+
+    VideoEncoder encoder;
+    encoder.get_config().codec_name = p_options.video_codec;
+    encoder.get_config().rate_control_mode = "cbr";
+    encoder.get_config().bit_rate = 2000000;
+    encoder.get_config().muxer_name = "matroska";
+
+    int64_t packets = 0;
+    encoder.set_packet_sink([&packets](const AVPacket *) {
+        packets++;
+    });
+
+    BufferSink sink;
+    check(encode_clip(encoder, sink, width, height, frame_count, nullptr), "encode produces container bytes");
+    check(packets == frame_count, "one packet per frame reaches the packet sink");
+
+    VideoDecoder decoder;
+    check(decoder.open_memory(sink.bytes.data(), sink.bytes.size()) == 0, "decoder opens in-memory container");
+
+    std::vector<uint8_t> expected;
+    std::vector<uint8_t> pixels;
+    int decoded = 0;
+    double max_error = 0.0;
+    decoder.decode([&](const AVFrame *p_frame) {
+        int out_w = 0;
+        int out_h = 0;
+        decoder.get_output_size(p_frame, out_w, out_h);
+        pixels.resize(static_cast<size_t>(out_w) * out_h * 4);
+        if (decoder.convert(p_frame, pixels.data(), out_w * 4) != 0 || out_w != width || out_h != height) {
+            return;
+        }
+        fill_test_frame(expected, width, height, decoded);
+        double error = 0.0;
+        for (size_t i = 0; i < pixels.size(); i++) {
+            error += std::abs(static_cast<int>(pixels[i]) - static_cast<int>(expected[i]));
+        }
+        error /= static_cast<double>(pixels.size());
+        max_error = error > max_error ? error : max_error;
+        decoded++;
+    });
+
+    check(decoded == frame_count, "every frame decodes back");
+    check(max_error < 12.0, "mean absolute pixel error stays small");
+    std::printf("  frames=%d bytes=%zu max_mean_error=%.2f\n", decoded, sink.bytes.size(), max_error);
+}
+
+void test_audio_round_trip(const Options &p_options) {
+    std::printf("audio round trip (%s)\n", p_options.audio_codec.c_str());
+    if (!avcodec_find_encoder_by_name(p_options.audio_codec.c_str())) {
+        std::printf("  [skip] encoder not available\n");
+        return;
+    }
+
+    const int sample_rate = 44100;
+    const int channels = 2;
+    std::vector<float> pcm(static_cast<size_t>(sample_rate) * channels);
+    for (int i = 0; i < sample_rate; i++) {
+        const float value = 0.5f * std::sin(2.0f * 3.14159265f * 440.0f * i / sample_rate);
+        pcm[i * 2] = value;
+        pcm[i * 2 + 1] = value;
+    }
+
+    AudioEncoderOptions options;
+    options.codec_name = p_options.audio_codec;
+    options.sample_rate = sample_rate;
+    options.channels = channels;
+    options.bit_rate = 128000;
+
+    AudioEncoder encoder;
+    check(encoder.setup(options) == 0, "encoder setup");
+
+    std::vector<uint8_t> encoded;
+    const PacketSink append = [&encoded](const AVPacket *p_packet) {
+        encoded.insert(encoded.end(), p_packet->data, p_packet->data + p_packet->size);
+    };
+    check(encoder.encode(pcm.data(), static_cast<int64_t>(pcm.size()), append) == 0, "encode");
+    check(encoder.flush(append) == 0, "flush");
+
+    AudioDecoder decoder;
+    check(decoder.open_memory(encoded.data(), encoded.size()) == 0, "decoder opens raw stream from memory");
+
+    int64_t decoded = 0;
+    double energy = 0.0;
+    decoder.decode([&](const float *p_samples, int64_t p_count) {
+        for (int64_t i = 0; i < p_count; i++) {
+            energy += p_samples[i] * p_samples[i];
+        }
+        decoded += p_count;
+    });
+
+    const double rms = decoded > 0 ? std::sqrt(energy / decoded) : 0.0;
+    check(decoded >= static_cast<int64_t>(pcm.size()) * 9 / 10, "decoded length matches the input");
+    check(std::fabs(rms - 0.3536) < 0.05, "decoded level matches the input sine");
+    std::printf("  samples=%lld rms=%.4f\n", static_cast<long long>(decoded), rms);
+}
+
+// Three segments encoded concurrently must decode back as one continuous
+// stream with strictly increasing timestamps.
+void test_segmented_encode(const Options &p_options) {
+    std::printf("segmented encode (%s)\n", p_options.video_codec.c_str());
+    if (!avcodec_find_encoder_by_name(p_options.video_codec.c_str())) {
+        std::printf("  [skip] encoder not available\n");
+        return;
+    }
+
+    const int width = 160;
+    const int height = 120;
+    const int frame_count = 60;
+
+    std::vector<std::vector<uint8_t>> pixels(frame_count);
+    std::vector<EncoderFrame> frames(frame_count);
+    for (int i = 0; i < frame_count; i++) {
+        fill_test_frame(pixels[i], width, height, i);
+        frames[i].data = pixels[i].data();
+        frames[i].size = static_cast<int>(pixels[i].size());
+        frames[i].width = width;
+        frames[i].height = height;
+        frames[i].format = AV_PIX_FMT_RGBA;
+    }
+
+    SegmentedEncoder encoder;
+    encoder.get_config().codec_name = p_options.video_codec;
+    encoder.get_config().rate_control_mode = "cbr";
+    encoder.get_config().keyframe_interval = 10;
+    encoder.get_config().muxer_name = "matroska";
+    encoder.set_thread_count(3);
+
+    int64_t keyframes = 0;
+    encoder.set_packet_sink([&keyframes](const AVPacket *p_packet) {
+        keyframes += (p_packet->flags & AV_PKT_FLAG_KEY) ? 1 : 0;
+    });
+
+    BufferSink sink;
+    check(encoder.encode(frames, std::string(), &sink) == 0, "encode");
+    check(keyframes >= 3, "every segment starts on a keyframe");
+
+    VideoDecoder decoder;
+    check(decoder.open_memory(sink.bytes.data(), sink.bytes.size()) == 0, "decoder opens joined container");
+    int decoded = 0;
+    bool increasing = true;
+    int64_t last_pts = INT64_MIN;
+    decoder.decode([&](const AVFrame *p_frame) {
+        increasing = increasing && p_frame->pts > last_pts;
+        last_pts = p_frame->pts;
+        decoded++;
+    });
+    check(decoded == frame_count, "every frame decodes back");
+    check(increasing, "timestamps increase across segment joins");
+}
+
+// Packets handed straight from an encoder to a decoder, with no container.
+void test_packet_decode(const Options &p_options) {
+    std::printf("packet decode (%s)\n", p_options.video_codec.c_str());
+    if (!avcodec_find_encoder_by_name(p_options.video_codec.c_str())) {
+        std::printf("  [skip] encoder not available\n");
+        return;
+    }
+
+    const int width = 160;
+    const int height = 120;
+    const int frame_count = 20;
+
+    VideoEncoder encoder;
+    encoder.get_config().codec_name = p_options.video_codec;
+    std::vector<AVPacket *> packets;
+    encoder.set_packet_sink([&packets](const AVPacket *p_packet) {
+        packets.push_back(av_packet_clone(p_packet));
+    });
+
+    std::vector<uint8_t> rgba;
+    encoder.begin_packets(false);
+    for (int i = 0; i < frame_count; i++) {
+        fill_test_frame(rgba, width, height, i);
+        encoder.encode_frame(rgba.data(), static_cast<int>(rgba.size()), width, height, AV_PIX_FMT_RGBA);
+    }
+    encoder.finish();
+
+    AVCodecParameters *params = avcodec_parameters_alloc();
+    avcodec_parameters_from_context(params, encoder.get_codec_context());
+    encoder.reset();
+
+    // Decoded frames go straight back into a second encoder in their native
+    // format.
+    VideoEncoder reencoder;
+    reencoder.get_config().codec_name = p_options.video_codec;
+    int64_t reencoded = 0;
+    reencoder.set_packet_sink([&reencoded](const AVPacket *) {
+        reencoded++;
+    });
+    reencoder.begin_packets(false);
+
+    VideoDecoder decoder;
+    check(decoder.open_parameters(params) == 0, "decoder opens from codec parameters");
+    int decoded = 0;
+    bool passthrough_ok = true;
+    const FrameSink handle_frame = [&](const AVFrame *p_frame) {
+        decoded++;
+        passthrough_ok = passthrough_ok && reencoder.encode_avframe(p_frame) == 0;
+    };
+    for (AVPacket *packet : packets) {
+        decoder.decode_packet(packet, handle_frame);
+        av_packet_free(&packet);
+    }
+    decoder.decode_packet(nullptr, handle_frame);
+    reencoder.finish();
+    avcodec_parameters_free(&params);
+    check(decoded == frame_count, "every packet decodes back to a frame");
+    check(passthrough_ok && reencoded == frame_count, "decoded frames re-encode without conversion");
+}
+
+// Streams the audio track of p_input into a new container, once inline and
+// once with a decode thread and a FIFO smaller than a decoded frame.
+void test_audio_transcode(const Options &p_options, const std::string &p_input, int64_t p_source_samples) {
+    std::printf("audio transcode (%s)\n", p_options.audio_codec.c_str());
+    const std::string path = (std::filesystem::temp_directory_path() / "gdffmpeg_native_audio.mka").string();
+
+    for (int threaded = 0; threaded < 2; threaded++) {
+        AudioTranscoder transcoder;
+        transcoder.get_options().codec_name = p_options.audio_codec;
+        transcoder.set_threaded(threaded != 0);
+        transcoder.set_max_buffered_samples(256);
+        check(transcoder.transcode(p_input, path) == 0, threaded ? "threaded transcode" : "inline transcode");
+
+        AudioDecoder decoder;
+        check(decoder.open_file(path.c_str()) == 0, "output opens");
+        int64_t decoded = 0;
+        decoder.decode([&decoded](const float *, int64_t p_count) {
+            decoded += p_count;
+        });
+        check(decoded >= p_source_samples * 9 / 10, "output covers the source");
+        std::printf("  threaded=%d samples=%lld\n", threaded, static_cast<long long>(decoded));
+    }
+
+    AudioDecoder decoder;
+    check(decoder.open_file(p_input.c_str()) == 0, "input opens");
+    int chunks = 0;
+    check(decoder.decode([&](const float *, int64_t) {
+        chunks++;
+        decoder.stop();
+    }) == 0 && chunks == 1, "stop() ends decoding after the current frame");
+    std::filesystem::remove(path);
+}
+
+// Transcodes p_input (30 fps, one second) at half, double and its own frame
+// rate; frames are dropped or repeated so the duration stays the same.
+void test_video_transcode_rate(const Options &p_options, const std::string &p_input, int p_frame_count) {
+    std::printf("video transcode frame rate\n");
+    const std::string path = (std::filesystem::temp_directory_path() / "gdffmpeg_native_rate.mkv").string();
+    const int rates[] = { 15, 60, 0 };
+
+    for (int rate : rates) {
+        VideoTranscoder transcoder;
+        transcoder.get_config().codec_name = p_options.video_codec;
+        transcoder.get_config().rate_control_mode = "cbr";
+        transcoder.set_frame_rate(rate);
+        transcoder.set_threaded(rate != 60);
+        check(transcoder.transcode(p_input, path) == 0, "transcode");
+        const int expected = rate > 0 ? rate : p_frame_count;
+        check(transcoder.get_frames_transcoded() == expected, "one output frame per slot of the new rate");
+
+        VideoDecoder decoder;
+        check(decoder.open_file(path.c_str()) == 0, "output opens");
+        const double time_base = av_q2d(decoder.get_time_base());
+        int decoded = 0;
+        double first = -1.0;
+        double last = 0.0;
+        decoder.decode([&](const AVFrame *p_frame) {
+            const double t = static_cast<double>(p_frame->best_effort_timestamp) * time_base;
+            first = first < 0.0 ? t : first;
+            last = t;
+            decoded++;
+        });
+        const double duration = last - first + 1.0 / expected;
+        check(decoded == expected, "every output frame decodes back");
+        check(std::fabs(duration - 1.0) < 0.01, "output lasts as long as the input");
+        std::printf("  rate=%d frames=%d duration=%.3f\n", rate, decoded, duration);
+    }
+    std::filesystem::remove(path);
+}
+
+// Stream-copies p_input (one video and one audio stream) into MP4, and its
+// video stream alone into Matroska with a no-op bitstream filter.
+void test_remux(const std::string &p_input, int p_frame_count) {
+    std::printf("remux\n");
+    std::vector<StreamInfo> streams;
+    check(Remuxer::probe(p_input, streams) == 0 && streams.size() == 2, "probe lists both streams");
+
+    const std::string mp4_path = (std::filesystem::temp_directory_path() / "gdffmpeg_native_remux.mp4").string();
+    const std::string mkv_path = (std::filesystem::temp_directory_path() / "gdffmpeg_native_remux.mkv").string();
+
+    Remuxer remuxer;
+    check(remuxer.remux(p_input, mp4_path) == 0, "remux to mp4");
+    std::vector<StreamInfo> copied;
+    check(Remuxer::probe(mp4_path, copied) == 0 && copied.size() == 2, "mp4 keeps both streams");
+
+    int video_index = -1;
+    for (const StreamInfo &info : streams) {
+        if (info.type == AVMEDIA_TYPE_VIDEO) {
+            video_index = info.index;
+        }
+    }
+    remuxer.set_streams({ video_index });
+    remuxer.set_bitstream_filter(-1, "null");
+    check(remuxer.remux(mp4_path, mkv_path) == 0, "video-only remux through a bitstream filter");
+
+    VideoDecoder decoder;
+    check(decoder.open_file(mkv_path.c_str()) == 0, "remuxed video opens");
+    int decoded = 0;
+    decoder.decode([&decoded](const AVFrame *) {
+        decoded++;
+    });
+    check(decoded == p_frame_count, "every frame survives both copies");
+    std::printf("  packets=%lld frames=%d\n", static_cast<long long>(remuxer.get_packets_copied()), decoded);
+
+    std::filesystem::remove(mp4_path);
+    std::filesystem::remove(mkv_path);
+}
+
+// Cuts frames [6, 24) out of p_input (30 fps, keyframes every 12 frames).
+// H.264/HEVC sources re-encode the first partial GOP and copy the second;
+// other codecs cannot be spliced and re-encode the whole range.
+void test_smart_trim(const std::string &p_input) {
+    std::printf("smart trim\n");
+    const std::string path = (std::filesystem::temp_directory_path() / "gdffmpeg_native_trim.mkv").string();
+    std::vector<StreamInfo> streams;
+    Remuxer::probe(p_input, streams);
+    bool spliceable = false;
+    for (const StreamInfo &info : streams) {
+        spliceable = spliceable || (info.type == AVMEDIA_TYPE_VIDEO && (info.codec_name == "h264" || info.codec_name == "hevc"));
+    }
+
+    SmartTrimmer trimmer;
+    check(trimmer.trim(p_input, path, 0.2, 0.8) == 0, "trim");
+    check(trimmer.was_smart_rendered() == spliceable, "smart rendering only for H.264/HEVC");
+    if (spliceable) {
+        check(trimmer.get_frames_reencoded() > 0 && trimmer.get_frames_reencoded() < 18, "only the boundary GOP is re-encoded");
+        check(trimmer.get_packets_copied() > 0, "the inner GOP is copied");
+    } else {
+        check(trimmer.get_frames_reencoded() == 18, "the whole range is re-encoded");
+    }
+
+    VideoDecoder decoder;
+    check(decoder.open_file(path.c_str()) == 0, "trimmed file opens");
+    int decoded = 0;
+    decoder.decode([&decoded](const AVFrame *) {
+        decoded++;
+    });
+    check(decoded == 18, "trimmed range decodes frame for frame");
+    std::printf("  reencoded=%lld copied=%lld frames=%d\n", static_cast<long long>(trimmer.get_frames_reencoded()),
+            static_cast<long long>(trimmer.get_packets_copied()), decoded);
+
+    std::filesystem::remove(path);
+}
+
+// Joins p_input to itself, once by stream copy and once through the
+// parallel re-encode fallback.
+void test_concat(const Options &p_options, const std::string &p_input, int p_frame_count) {
+    std::printf("concat\n");
+    const std::string path = (std::filesystem::temp_directory_path() / "gdffmpeg_native_concat.mkv").string();
+    const std::vector<std::string> inputs = { p_input, p_input };
+    check(Concatenator::are_compatible(inputs), "identical clips are compatible");
+
+    for (int reencode = 0; reencode < 2; reencode++) {
+        Concatenator concatenator;
+        concatenator.get_video_config().codec_name = p_options.video_codec;
+        concatenator.get_video_config().rate_control_mode = "cbr";
+        concatenator.get_audio_options().codec_name = p_options.audio_codec;
+        concatenator.set_force_reencode(reencode != 0);
+        check(concatenator.concat(inputs, path) == 0, reencode ? "re-encoded concat" : "stream-copy concat");
+        check(concatenator.was_stream_copied() == (reencode == 0), "copy path taken only when allowed");
+
+        VideoDecoder decoder;
+        check(decoder.open_file(path.c_str()) == 0, "joined file opens");
+        int decoded = 0;
+        decoder.decode([&decoded](const AVFrame *) {
+            decoded++;
+        });
+        check(decoded == p_frame_count * 2, "both clips decode back");
+        std::printf("  reencode=%d frames=%d\n", reencode, decoded);
+    }
+
+    // A second clip at another size and twice the rate (one second, like
+    // p_input): the fallback must bring it to the first clip's size and
+    // rate, so the joined file has p_frame_count + 30 frames that decode
+    // cleanly under one codec header.
+    const std::string other = (std::filesystem::temp_directory_path() / "gdffmpeg_native_concat_60.mkv").string();
+    write_test_movie(p_options, other, 96, 72, 60, 60, 44100);
+    const std::vector<std::string> mixed = { p_input, other };
+    check(!Concatenator::are_compatible(mixed), "clips of different size and rate are not compatible");
+
+    Concatenator concatenator;
+    concatenator.get_video_config().codec_name = p_options.video_codec;
+    concatenator.get_video_config().rate_control_mode = "cbr";
+    concatenator.get_audio_options().codec_name = p_options.audio_codec;
+    check(concatenator.concat(mixed, path) == 0, "mixed clips are joined");
+    check(!concatenator.was_stream_copied(), "mixed clips are re-encoded");
+
+    VideoDecoder decoder;
+    check(decoder.open_file(path.c_str()) == 0, "joined mixed file opens");
+    int decoded = 0;
+    bool clean = true;
+    int width = 0;
+    int height = 0;
+    const int decode_result = decoder.decode([&](const AVFrame *p_frame) {
+        if (decoded++ == 0) {
+            width = p_frame->width;
+            height = p_frame->height;
+        }
+        clean = clean && p_frame->decode_error_flags == 0 && !(p_frame->flags & AV_FRAME_FLAG_CORRUPT) &&
+                p_frame->width == width && p_frame->height == height;
+    });
+    check(decode_result == 0 && clean, "every frame decodes without errors at one size");
+    check(decoded == p_frame_count + 30, "both clips decode back at the first clip's rate");
+    std::printf("  mixed frames=%d\n", decoded);
+    std::filesystem::remove(other);
+    std::filesystem::remove(path);
+}
+
+// Two video jobs, an audio job and one with a missing input on two workers.
+void test_batch_transcode(const Options &p_options, const std::string &p_input) {
+    std::printf("batch transcode\n");
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+    const std::vector<std::string> outputs = {
+        (dir / "gdffmpeg_native_batch_0.mkv").string(),
+        (dir / "gdffmpeg_native_batch_1.mkv").string(),
+        (dir / "gdffmpeg_native_batch_2.mka").string(),
+        (dir / "gdffmpeg_native_batch_3.mkv").string(),
+    };
+
+    BatchTranscoder batch;
+    for (int i = 0; i < 2; i++) {
+        TranscodeJob job;
+        job.kind = TranscodeJob::KIND_VIDEO;
+        job.input = p_input;
+        job.output = outputs[i];
+        job.video.codec_name = p_options.video_codec;
+        job.video.rate_control_mode = "cbr";
+        // The second job halves the rate; it must keep the duration.
+        job.frame_rate = i == 1 ? 15 : 0;
+        batch.add_job(job);
+    }
+    TranscodeJob audio;
+    audio.input = p_input;
+    audio.output = outputs[2];
+    audio.audio.codec_name = p_options.audio_codec;
+    batch.add_job(audio);
+    TranscodeJob missing;
+    missing.kind = TranscodeJob::KIND_VIDEO;
+    missing.input = (dir / "gdffmpeg_native_batch_missing.mkv").string();
+    missing.output = outputs[3];
+    batch.add_job(missing);
+
+    std::mutex mutex;
+    std::vector<int> errors(outputs.size(), 1000);
+    std::vector<double> progress(outputs.size(), 0.0);
+    int batch_failures = -1;
+    batch.set_job_progress_callback([&](int p_job, double p_progress) {
+        std::lock_guard<std::mutex> lock(mutex);
+        progress[p_job] = p_progress;
+    });
+    batch.set_job_finished_callback([&](int p_job, int p_error) {
+        std::lock_guard<std::mutex> lock(mutex);
+        errors[p_job] = p_error;
+    });
+    batch.set_batch_finished_callback([&](int p_failed) {
+        batch_failures = p_failed;
+    });
+    batch.set_worker_count(2);
+    check(batch.start() == 0, "start");
+    batch.wait();
+
+    check(errors[0] == 0 && errors[1] == 0 && errors[2] == 0, "valid jobs succeed");
+    check(errors[3] != 0, "missing input reports an error");
+    check(progress[0] == 1.0 && progress[2] == 1.0, "progress reaches 100%");
+    check(batch_failures == 1 && !batch.is_running(), "batch finishes with one failure");
+    std::printf("  errors=%d,%d,%d,%d\n", errors[0], errors[1], errors[2], errors[3]);
+
+    VideoDecoder decoder;
+    check(decoder.open_file(outputs[1].c_str()) == 0, "frame_rate job output opens");
+    int decoded = 0;
+    decoder.decode([&decoded](const AVFrame *) {
+        decoded++;
+    });
+    check(decoded == 15, "frame_rate job keeps the one-second duration");
+
+    // Cancelled as soon as the first job starts: it must stop inside the
+    // decode loop and the rest must be skipped.
+    BatchTranscoder cancelled;
+    for (int i = 0; i < 3; i++) {
+        TranscodeJob job;
+        job.kind = i == 2 ? TranscodeJob::KIND_AUDIO : TranscodeJob::KIND_VIDEO;
+        job.input = p_input;
+        job.output = outputs[i];
+        job.video.codec_name = p_options.video_codec;
+        job.audio.codec_name = p_options.audio_codec;
+        cancelled.add_job(job);
+    }
+    std::vector<int> cancel_errors(3, 1000);
+    cancelled.set_job_started_callback([&](int) {
+        cancelled.cancel();
+    });
+    cancelled.set_job_finished_callback([&](int p_job, int p_error) {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancel_errors[p_job] = p_error;
+    });
+    cancelled.set_worker_count(1);
+    check(cancelled.start() == 0, "start a batch to cancel");
+    cancelled.wait();
+    bool all_cancelled = true;
+    for (int error : cancel_errors) {
+        all_cancelled = all_cancelled && error == BatchTranscoder::ERR_CANCELLED;
+    }
+    check(all_cancelled, "running and queued jobs report ERR_CANCELLED");
+    check(cancelled.get_failed_count() == 3, "cancelled jobs count as failed");
+
+    for (const std::string &path : outputs) {
+        std::filesystem::remove(path);
+    }
+}
+
+// Three decoders sharing a four-thread budget through the shared pool; the
+// budget must be handed back when they close.
+void test_thread_budget(const std::string &p_input, int p_frame_count) {
+    std::printf("thread budget\n");
+    ThreadBudget::set_total_threads(4);
+    ThreadBudget::set_max_threads_per_context(2);
+    ThreadBudget::set_shared_pool_enabled(true);
+    ThreadBudget::set_enabled(true);
+
+    {
+        std::vector<std::unique_ptr<VideoDecoder>> decoders;
+        for (int i = 0; i < 3; i++) {
+            decoders.push_back(std::make_unique<VideoDecoder>());
+            check(decoders.back()->open_file(p_input.c_str()) == 0, "decoder opens under the budget");
+        }
+        check(ThreadBudget::get_budgeted_contexts() == 3, "every context is budgeted");
+        check(ThreadBudget::get_threads_in_use() == 5, "later contexts fall back to one thread");
+
+        bool all_decoded = true;
+        for (std::unique_ptr<VideoDecoder> &decoder : decoders) {
+            int decoded = 0;
+            decoder->decode([&decoded](const AVFrame *) {
+                decoded++;
+            });
+            all_decoded = all_decoded && decoded == p_frame_count;
+        }
+        check(all_decoded, "every decoder decodes the whole clip");
+    }
+    check(ThreadBudget::get_threads_in_use() == 0 && ThreadBudget::get_budgeted_contexts() == 0, "closing returns the threads");
+
+    // The mpeg4 encoder only slice-threads, so it runs on the pool: one
+    // worker (max_threads_per_context - 1) plus its own thread.
+    if (avcodec_find_encoder_by_name("mpeg4")) {
+        VideoEncoder encoder;
+        encoder.get_config().codec_name = "mpeg4";
+        encoder.get_config().rate_control_mode = "cbr";
+        int in_use = 0;
+        encoder.set_packet_sink([&in_use](const AVPacket *) {
+            in_use = std::max(in_use, ThreadBudget::get_threads_in_use());
+        });
+        BufferSink sink;
+        check(encode_clip(encoder, sink, 160, 120, 10, nullptr), "pooled encoder produces output");
+        check(in_use == 2, "pool workers are counted once");
+        check(ThreadBudget::get_threads_in_use() == 0, "the pool's threads are returned with the last context");
+    }
+
+    ThreadBudget::set_enabled(false);
+    ThreadBudget::set_shared_pool_enabled(false);
+    ThreadBudget::set_total_threads(0);
+    ThreadBudget::set_max_threads_per_context(0);
+}
+
+// Live output into a non-seekable sink: fragmented MP4 and live Matroska.
+// Fragments must reach the sink while encoding, and the bytes must decode.
+void test_live_output(const Options &p_options) {
+    std::printf("live output (%s)\n", p_options.video_codec.c_str());
+    if (!avcodec_find_encoder_by_name(p_options.video_codec.c_str())) {
+        std::printf("  [skip] encoder not available\n");
+        return;
+    }
+
+    const int width = 160;
+    const int height = 120;
+    const int frame_count = 60;
+    const char *const muxers[] = { "mp4", "matroska" };
+    for (const char *muxer : muxers) {
+        VideoEncoder encoder;
+        encoder.get_config().codec_name = p_options.video_codec;
+        encoder.get_config().rate_control_mode = "cbr";
+        encoder.get_config().muxer_name = muxer;
+        encoder.get_config().keyframe_interval = 15;
+        encoder.get_config().live_output = true;
+        encoder.get_config().fragment_duration_ms = 500;
+
+        BufferSink sink;
+        std::vector<uint8_t> rgba;
+        bool encoded = true;
+        encoder.begin(std::string(), &sink);
+        for (int i = 0; i < frame_count; i++) {
+            fill_test_frame(rgba, width, height, i);
+            encoded = encoder.encode_frame(rgba.data(), static_cast<int>(rgba.size()), width, height, AV_PIX_FMT_RGBA) == 0 && encoded;
+        }
+        const size_t bytes_before_finish = sink.bytes.size();
+        encoded = encoder.finish() == 0 && encoded;
+        encoder.reset();
+        check(encoded, "encode into a non-seekable sink");
+        check(bytes_before_finish > sink.bytes.size() / 2, "fragments arrive before the end");
+
+        VideoDecoder decoder;
+        check(decoder.open_memory(sink.bytes.data(), sink.bytes.size()) == 0, "live bytes open as a container");
+        int decoded = 0;
+        decoder.decode([&decoded](const AVFrame *) {
+            decoded++;
+        });
+        check(decoded == frame_count, "every frame decodes back");
+        std::printf("  %s bytes=%zu before_finish=%zu frames=%d\n", muxer, sink.bytes.size(), bytes_before_finish, decoded);
+    }
+}
+
+// HLS (MPEG-TS and fMP4 segments) and DASH written into a directory; the
+// HLS playlists are read back through FFmpeg's own demuxer.
+void test_segmented_output(const Options &p_options) {
+    std::printf("segmented output (%s)\n", p_options.video_codec.c_str());
+    if (!avcodec_find_encoder_by_name(p_options.video_codec.c_str())) {
+        std::printf("  [skip] encoder not available\n");
+        return;
+    }
+
+    const int width = 160;
+    const int height = 120;
+    const int frame_count = 90;
+    const char *const formats[] = { "hls", "hls_fmp4", "dash" };
+    for (const char *format : formats) {
+        const std::filesystem::path dir = std::filesystem::temp_directory_path() / (std::string("gdffmpeg_native_") + format);
+        std::filesystem::remove_all(dir);
+
+        StreamingOutputOptions options;
+        options.format = std::strcmp(format, "dash") == 0 ? StreamingOutputOptions::FORMAT_DASH : StreamingOutputOptions::FORMAT_HLS;
+        options.hls_segment_type = std::strcmp(format, "hls_fmp4") == 0 ? "fmp4" : "mpegts";
+        options.segment_seconds = 1.0;
+        options.playlist_size = 0;
+
+        VideoEncoder encoder;
+        encoder.get_config().codec_name = p_options.video_codec;
+        encoder.get_config().rate_control_mode = "cbr";
+        encoder.get_config().keyframe_interval = 60;
+        int files_written = 0;
+        encoder.set_file_written_callback([&files_written](const std::string &) {
+            files_written++;
+        });
+
+        std::vector<uint8_t> rgba;
+        bool encoded = true;
+        encoder.begin_segmented(dir.string(), options);
+        for (int i = 0; i < frame_count; i++) {
+            fill_test_frame(rgba, width, height, i);
+            encoded = encoder.encode_frame(rgba.data(), static_cast<int>(rgba.size()), width, height, AV_PIX_FMT_RGBA) == 0 && encoded;
+        }
+        encoded = encoder.finish() == 0 && encoded;
+        encoder.reset();
+        check(encoded, "segmented encode");
+
+        const std::string playlist = get_streaming_playlist_path(dir.string(), options);
+        int segments = 0;
+        for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(dir)) {
+            const std::string extension = entry.path().extension().string();
+            segments += extension == ".ts" || extension == ".m4s" ? 1 : 0;
+        }
+        check(std::filesystem::exists(playlist), "playlist is written");
+        check(segments >= 3, "one segment per second");
+        check(files_written > segments, "every segment and playlist update is reported");
+
+        if (options.format == StreamingOutputOptions::FORMAT_HLS) {
+            VideoDecoder decoder;
+            check(decoder.open_file(playlist.c_str()) == 0, "playlist opens");
+            int decoded = 0;
+            decoder.decode([&decoded](const AVFrame *) {
+                decoded++;
+            });
+            check(decoded == frame_count, "every frame plays back through the playlist");
+        }
+        std::printf("  %s segments=%d files_written=%d\n", format, segments, files_written);
+        std::filesystem::remove_all(dir);
+    }
+}
+
+// Five seconds encoded into a two-second replay window; the saved clip must
+// hold whole GOPs covering the window, and a byte cap must shrink it to the
+// newest GOP.
+void test_replay_buffer(const Options &p_options) {
+    std::printf("replay buffer (%s)\n", p_options.video_codec.c_str());
+    if (!avcodec_find_encoder_by_name(p_options.video_codec.c_str())) {
+        std::printf("  [skip] encoder not available\n");
+        return;
+    }
+
+    const int width = 160;
+    const int height = 120;
+    const int frame_count = 150;
+    const int gop = 15;
+    const std::string path = (std::filesystem::temp_directory_path() / "gdffmpeg_native_replay.mkv").string();
+
+    for (int capped = 0; capped < 2; capped++) {
+        VideoEncoder encoder;
+        encoder.get_config().codec_name = p_options.video_codec;
+        encoder.get_config().rate_control_mode = "cbr";
+        encoder.get_config().keyframe_interval = gop;
+        encoder.get_config().max_b_frames = 0;
+
+        ReplayBuffer replay;
+        replay.configure(2.0, capped ? 1 : 0);
+        encoder.set_packet_sink([&](const AVPacket *p_packet) {
+            if (!replay.has_stream()) {
+                replay.set_stream(encoder.get_codec_context());
+            }
+            replay.push(p_packet);
+        });
+
+        std::vector<uint8_t> rgba;
+        encoder.begin_packets(true);
+        for (int i = 0; i < frame_count; i++) {
+            fill_test_frame(rgba, width, height, i);
+            encoder.encode_frame(rgba.data(), static_cast<int>(rgba.size()), width, height, AV_PIX_FMT_RGBA);
+        }
+        encoder.finish();
+        encoder.reset();
+
+        const double seconds = replay.get_buffered_seconds();
+        check(replay.save(path) == 0, "save replay");
+        VideoDecoder decoder;
+        check(decoder.open_file(path.c_str()) == 0, "replay opens");
+        int decoded = 0;
+        decoder.decode([&decoded](const AVFrame *) {
+            decoded++;
+        });
+        if (capped) {
+            check(decoded == gop, "byte cap keeps only the newest GOP");
+        } else {
+            check(seconds >= 2.0 && seconds < 2.0 + gop / 30.0 + 0.01, "window covers the duration plus at most one GOP");
+            check(decoded % gop == 0 && decoded >= 60 && decoded < frame_count, "saved clip is whole GOPs from the end");
+        }
+        std::printf("  capped=%d seconds=%.2f bytes=%lld frames=%d\n", capped, seconds, static_cast<long long>(replay.get_buffered_bytes()), decoded);
+    }
+    std::filesystem::remove(path);
+}
+
+// Video and audio from two independent encoders muxed into one file. The
+// video runs ahead, so its first packets wait for the audio stream to be
+// described; both streams must decode back in full.
+void test_packet_muxer(const Options &p_options) {
+    std::printf("packet muxer (%s + %s)\n", p_options.video_codec.c_str(), p_options.audio_codec.c_str());
+    if (!avcodec_find_encoder_by_name(p_options.video_codec.c_str()) || !avcodec_find_encoder_by_name(p_options.audio_codec.c_str())) {
+        std::printf("  [skip] encoder not available\n");
+        return;
+    }
+
+    const int width = 160;
+    const int height = 120;
+    const int fps = 30;
+    const int frame_count = 30;
+    const int sample_rate = 44100;
+    const std::string path = (std::filesystem::temp_directory_path() / "gdffmpeg_native_packet_muxer.mkv").string();
+
+    PacketMuxer muxer;
+    check(muxer.open(path, nullptr, std::string()) == 0, "open");
+    const int video_stream = muxer.add_stream();
+    const int audio_stream = muxer.add_stream();
+    check(video_stream == 0 && audio_stream == 1, "streams are numbered in order");
+
+    VideoEncoder video;
+    video.get_config().codec_name = p_options.video_codec;
+    video.get_config().rate_control_mode = "cbr";
+    video.get_config().frame_rate = fps;
+    AVCodecParameters *video_params = avcodec_parameters_alloc();
+    bool video_ok = true;
+    video.set_packet_sink([&](const AVPacket *p_packet) {
+        if (video_params->codec_type == AVMEDIA_TYPE_UNKNOWN) {
+            avcodec_parameters_from_context(video_params, video.get_codec_context());
+        }
+        video_ok = muxer.write_packet(video_stream, p_packet, video.get_time_base(), video_params) == 0 && video_ok;
+    });
+
+    AudioEncoder audio;
+    AudioEncoderOptions audio_options;
+    audio_options.codec_name = p_options.audio_codec;
+    audio_options.sample_rate = sample_rate;
+    audio_options.channels = 2;
+    audio_options.bit_rate = 128000;
+    audio_options.global_header = muxer.needs_global_header();
+    check(audio.setup(audio_options) == 0, "audio setup");
+    AVCodecParameters *audio_params = avcodec_parameters_alloc();
+    avcodec_parameters_from_context(audio_params, audio.get_codec_context());
+    bool audio_ok = true;
+    const PacketSink audio_sink = [&](const AVPacket *p_packet) {
+        audio_ok = muxer.write_packet(audio_stream, p_packet, audio.get_time_base(), audio_params) == 0 && audio_ok;
+    };
+
+    std::vector<uint8_t> rgba;
+    video.begin_packets(muxer.needs_global_header());
+    for (int i = 0; i < 5; i++) {
+        fill_test_frame(rgba, width, height, i);
+        video.encode_frame(rgba.data(), static_cast<int>(rgba.size()), width, height, AV_PIX_FMT_RGBA);
+    }
+    const int queued = muxer.get_queued_packets();
+    check(queued > 0 && !muxer.is_header_written(), "video waits for the audio stream");
+
+    std::vector<float> pcm(static_cast<size_t>(sample_rate / fps) * 2);
+    for (int i = 0; i < frame_count; i++) {
+        if (i >= 5) {
+            fill_test_frame(rgba, width, height, i);
+            video.encode_frame(rgba.data(), static_cast<int>(rgba.size()), width, height, AV_PIX_FMT_RGBA);
+        }
+        for (size_t s = 0; s < pcm.size(); s++) {
+            pcm[s] = 0.5f * std::sin(2.0f * 3.14159265f * 440.0f * (i * (sample_rate / fps) + s / 2) / sample_rate);
+        }
+        audio.encode(pcm.data(), static_cast<int64_t>(pcm.size()), audio_sink);
+    }
+    video.finish();
+    video.reset();
+    audio.flush(audio_sink);
+    check(video_ok && audio_ok, "every packet is accepted");
+    check(muxer.get_queued_packets() == 0, "the backlog is written once both streams are described");
+    check(muxer.finish() == 0, "finish");
+    avcodec_parameters_free(&video_params);
+    avcodec_parameters_free(&audio_params);
+
+    VideoDecoder video_decoder;
+    check(video_decoder.open_file(path.c_str()) == 0, "video stream opens");
+    int decoded_frames = 0;
+    video_decoder.decode([&decoded_frames](const AVFrame *) {
+        decoded_frames++;
+    });
+    check(decoded_frames == frame_count, "every video frame decodes back");
+
+    AudioDecoder audio_decoder;
+    check(audio_decoder.open_file(path.c_str()) == 0, "audio stream opens");
+    int64_t decoded_samples = 0;
+    audio_decoder.decode([&decoded_samples](const float *, int64_t p_count) {
+        decoded_samples += p_count;
+    });
+    check(decoded_samples >= static_cast<int64_t>(sample_rate) * 2 * 9 / 10, "audio covers the clip");
+    std::printf("  queued=%d packets=%lld frames=%d samples=%lld\n", queued, static_cast<long long>(muxer.get_packets_written()), decoded_frames, static_cast<long long>(decoded_samples));
+    std::filesystem::remove(path);
+}
+
+// MovieEncoder muxing both streams asynchronously into one file; each
+// stream is read back through its own decoder.
+void test_movie_round_trip(const Options &p_options) {
+    std::printf("movie round trip (%s + %s)\n", p_options.video_codec.c_str(), p_options.audio_codec.c_str());
+    if (!avcodec_find_encoder_by_name(p_options.video_codec.c_str()) || !avcodec_find_encoder_by_name(p_options.audio_codec.c_str())) {
+        std::printf("  [skip] encoder not available\n");
+        return;
+    }
+
+    const int width = 160;
+    const int height = 120;
+    const int fps = 30;
+    const int frame_count = 30;
+    const int sample_rate = 44100;
+    const std::string path = (std::filesystem::temp_directory_path() / "gdffmpeg_native_movie.mkv").string();
+
+    write_test_movie(p_options, path, width, height, fps, frame_count, sample_rate);
+
+    VideoDecoder video;
+    check(video.open_file(path.c_str()) == 0, "video stream opens");
+    int decoded_frames = 0;
+    video.decode([&decoded_frames](const AVFrame *) {
+        decoded_frames++;
+    });
+    check(decoded_frames == frame_count, "every video frame decodes back");
+
+    AudioDecoder audio;
+    check(audio.open_file(path.c_str()) == 0, "audio stream opens");
+    int64_t decoded_samples = 0;
+    audio.decode([&decoded_samples](const float *, int64_t p_count) {
+        decoded_samples += p_count;
+    });
+    check(decoded_samples >= static_cast<int64_t>(sample_rate) * 2 * 9 / 10, "audio covers the clip");
+    std::printf("  frames=%d samples=%lld\n", decoded_frames, static_cast<long long>(decoded_samples));
+
+    test_audio_transcode(p_options, path, decoded_samples);
+    test_video_transcode_rate(p_options, path, frame_count);
+    test_remux(path, frame_count);
+    test_smart_trim(path);
+    test_concat(p_options, path, frame_count);
+    test_batch_transcode(p_options, path);
+    test_thread_budget(path, frame_count);
+    std::filesystem::remove(path);
+}
+
+void test_pipeline_stats() {
+    std::printf("pipeline stats\n");
+    PipelineStats stats;
+    {
+        StageTimer timer(stats, PipelineStats::STAGE_DEMUX);
+    }
+    check(stats.summarize(PipelineStats::STAGE_DEMUX).count == 0, "disabled stats record nothing");
+
+    stats.set_enabled(true);
+    for (uint64_t i = 1; i <= 100; i++) {
+        stats.record(PipelineStats::STAGE_CONVERT, i);
+    }
+    const PipelineStats::Summary summary = stats.summarize(PipelineStats::STAGE_CONVERT);
+    check(summary.count == 100 && summary.total_usec == 5050, "count and total");
+    check(summary.p50_usec == 51 && summary.p99_usec == 100, "percentiles");
+}
+
+void test_chunked_buffer() {
+    std::printf("chunked buffer\n");
+    ChunkedBuffer buffer;
+    std::vector<uint8_t> expected;
+    // Odd-sized appends so chunk boundaries fall inside writes.
+    for (int i = 0; i < 2000; i++) {
+        std::vector<uint8_t> piece(static_cast<size_t>(i % 997) + 1, static_cast<uint8_t>(i));
+        buffer.append(piece.data(), piece.size());
+        expected.insert(expected.end(), piece.begin(), piece.end());
+    }
+    std::vector<uint8_t> joined(buffer.size());
+    buffer.copy_to(joined.data());
+    check(buffer.size() == expected.size(), "size matches appended bytes");
+    check(joined == expected, "bytes come back in order");
+
+    buffer.clear();
+    const uint8_t tail[3] = { 1, 2, 3 };
+    buffer.append(tail, 3);
+    std::vector<uint8_t> reused(buffer.size());
+    buffer.copy_to(reused.data());
+    check(reused == std::vector<uint8_t>({ 1, 2, 3 }), "clear() starts over");
+}
+
+void test_trace() {
+    std::printf("trace export\n");
+    Trace::clear();
+    Trace::set_enabled(true);
+    {
+        GDFFMPEG_TRACE_SCOPE("native_test_scope");
+    }
+    Trace::set_enabled(false);
+
+    std::string json;
+    const int64_t events = Trace::write_json(json);
+    check(events >= 2, "events recorded");
+    check(json.find("\"name\":\"native_test_scope\"") != std::string::npos, "scope appears in JSON");
+
+    // clear() while another thread is inside a scope: its event must land
+    // in the new generation and the old events must be gone.
+    Trace::set_enabled(true);
+    std::atomic<int> step{ 0 };
+    std::thread worker([&step]() {
+        GDFFMPEG_TRACE_SCOPE("native_test_worker_scope");
+        step = 1;
+        while (step.load() != 2) {
+            std::this_thread::yield();
+        }
+    });
+    while (step.load() != 1) {
+        std::this_thread::yield();
+    }
+    Trace::clear();
+    step = 2;
+    worker.join();
+    Trace::set_enabled(false);
+
+    json.clear();
+    Trace::write_json(json);
+    check(json.find("native_test_worker_scope") != std::string::npos, "scope open during clear() is kept");
+    check(json.find("\"name\":\"native_test_scope\"") == std::string::npos, "clear() drops earlier events");
+
+    // Threads started one after another reuse the buffer of the one before.
+    Trace::clear();
+    Trace::set_enabled(true);
+    for (int i = 0; i < 8; i++) {
+        std::thread([]() {
+            GDFFMPEG_TRACE_SCOPE("native_test_short_thread");
+        }).join();
+    }
+    Trace::set_enabled(false);
+    json.clear();
+    Trace::write_json(json);
+    int thread_tracks = 0;
+    for (size_t pos = json.find("\"thread_name\""); pos != std::string::npos; pos = json.find("\"thread_name\"", pos + 1)) {
+        thread_tracks++;
+    }
+    check(thread_tracks == 1, "exited threads hand their buffer back");
+    Trace::clear();
+}
+
+int run_tests(const Options &p_options) {
+    test_pipeline_stats();
+    test_trace();
+    test_chunked_buffer();
+    test_video_round_trip(p_options);
+    test_audio_round_trip(p_options);
+    test_segmented_encode(p_options);
+    test_packet_decode(p_options);
+    test_live_output(p_options);
+    test_segmented_output(p_options);
+    test_replay_buffer(p_options);
+    test_packet_muxer(p_options);
+    test_movie_round_trip(p_options);
+    Trace::shutdown();
+
+    std::printf("%s (%d failure%s)\n", failures == 0 ? "PASS" : "FAIL", failures, failures == 1 ? "" : "s");
+    return failures == 0 ? 0 : 1;
+}
+
+void print_stage(const PipelineStats &p_stats, PipelineStats::Stage p_stage, const char *p_name) {
+    const PipelineStats::Summary summary = p_stats.summarize(p_stage);
+    std::printf("  %-14s count=%-6llu total=%8.1fms p50=%6lluus p99=%6lluus\n", p_name,
+            static_cast<unsigned long long>(summary.count), summary.total_usec / 1000.0,
+            static_cast<unsigned long long>(summary.p50_usec), static_cast<unsigned long long>(summary.p99_usec));
+}
+
+int run_bench(const Options &p_options) {
+    if (!avcodec_find_encoder_by_name(p_options.codec.c_str())) {
+        std::fprintf(stderr, "Encoder not available: %s\n", p_options.codec.c_str());
+        return 1;
+    }
+
+    VideoEncoder encoder;
+    encoder.get_config().codec_name = p_options.codec;
+    encoder.get_config().preset = p_options.preset;
+    encoder.get_config().muxer_name = "matroska";
+
+    BufferSink sink;
+    double encode_seconds = 0.0;
+    if (!encode_clip(encoder, sink, p_options.width, p_options.height, p_options.frames, &encode_seconds)) {
+        std::fprintf(stderr, "Encoding failed\n");
+        return 1;
+    }
+    std::printf("encode %s/%s %dx%d: %d frames in %.3fs (%.1f fps, %zu bytes)\n",
+            p_options.codec.c_str(), p_options.preset.c_str(), p_options.width, p_options.height,
+            p_options.frames, encode_seconds, p_options.frames / encode_seconds, sink.bytes.size());
+
+    VideoDecoder decoder;
+    decoder.get_stats().set_enabled(true);
+    if (decoder.open_memory(sink.bytes.data(), sink.bytes.size()) != 0) {
+        std::fprintf(stderr, "Decoder could not open the encoded clip\n");
+        return 1;
+    }
+
+    std::vector<uint8_t> pixels;
+    int decoded = 0;
+    const auto start = std::chrono::steady_clock::now();
+    decoder.decode([&](const AVFrame *p_frame) {
+        int out_w = 0;
+        int out_h = 0;
+        decoder.get_output_size(p_frame, out_w, out_h);
+        pixels.resize(static_cast<size_t>(out_w) * out_h * 4);
+        if (decoder.convert(p_frame, pixels.data(), out_w * 4) == 0) {
+            decoded++;
+        }
+    });
+    const double decode_seconds = seconds_since(start);
+    std::printf("decode to RGBA: %d frames in %.3fs (%.1f fps)\n", decoded, decode_seconds, decoded / decode_seconds);
+
+    const PipelineStats &stats = decoder.get_stats();
+    print_stage(stats, PipelineStats::STAGE_DEMUX, "demux");
+    print_stage(stats, PipelineStats::STAGE_SEND_PACKET, "send_packet");
+    print_stage(stats, PipelineStats::STAGE_RECEIVE_FRAME, "receive_frame");
+    print_stage(stats, PipelineStats::STAGE_CONVERT, "sws_scale");
+    return 0;
+}
+
+bool parse_option(const char *p_arg, const char *p_name, std::string &r_value) {
+    const size_t length = std::strlen(p_name);
+    if (std::strncmp(p_arg, p_name, length) == 0 && p_arg[length] == '=') {
+        r_value = p_arg + length + 1;
+        return true;
+    }
+    return false;
+}
+
+int usage() {
+    std::fprintf(stderr,
+            "usage: gdffmpeg_native test [--video-codec=NAME] [--audio-codec=NAME]\n"
+            "       gdffmpeg_native bench [--codec=NAME] [--preset=NAME] [--size=WxH] [--frames=N]\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        return usage();
+    }
+
+    Options options;
+    for (int i = 2; i < argc; i++) {
+        std::string value;
+        if (parse_option(argv[i], "--video-codec", value)) {
+            options.video_codec = value;
+        } else if (parse_option(argv[i], "--audio-codec", value)) {
+            options.audio_codec = value;
+        } else if (parse_option(argv[i], "--codec", value)) {
+            options.codec = value;
+        } else if (parse_option(argv[i], "--preset", value)) {
+            options.preset = value;
+        } else if (parse_option(argv[i], "--frames", value)) {
+            options.frames = std::atoi(value.c_str());
+        } else if (parse_option(argv[i], "--size", value)) {
+            if (std::sscanf(value.c_str(), "%dx%d", &options.width, &options.height) != 2) {
+                return usage();
+            }
+        } else {
+            return usage();
+        }
+    }
+    if (options.frames <= 0 || options.width <= 0 || options.height <= 0) {
+        return usage();
+    }
+
+    const std::string mode = argv[1];
+    if (mode == "test") {
+        return run_tests(options);
+    }
+    if (mode == "bench") {
+        return run_bench(options);
+    }
+    return usage();
+}
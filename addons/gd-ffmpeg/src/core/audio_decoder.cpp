@@ -0,0 +1,342 @@
+#include "audio_decoder.h"
+
+#include "log.h"
+#include "thread_budget.h"
+#include "trace.h"
+
+extern "C" {
+    #include <libavutil/channel_layout.h>
+    #include <libavutil/mathematics.h>
+}
+
+namespace gdffmpeg {
+
+static const char *COMPONENT = "FFmpegAudioDecoder";
+
+// Demux buffer for in-memory inputs; compressed audio packets are small.
+static const int MEMORY_IO_BUFFER_SIZE = 4096;
+
+AudioDecoder::AudioDecoder() {
+    av_log_set_level(AV_LOG_ERROR);
+}
+
+AudioDecoder::~AudioDecoder() {
+    close();
+}
+
+void AudioDecoder::close() {
+    if (packet) {
+        av_packet_free(&packet);
+        packet = nullptr;
+    }
+    if (frame) {
+        av_frame_free(&frame);
+        frame = nullptr;
+    }
+    if (codec_ctx) {
+        Counters::free_codec_context(&codec_ctx);
+        codec_ctx = nullptr;
+    }
+    if (format_ctx) {
+        avformat_close_input(&format_ctx);
+        format_ctx = nullptr;
+    }
+    if (swr_ctx) {
+        swr_free(&swr_ctx);
+        swr_ctx = nullptr;
+    }
+    memory_reader.close();
+    scratch.clear();
+    scratch.shrink_to_fit();
+    tracked_memory.release();
+    audio_stream_index = -1;
+    target_sample_rate = 0;
+    target_channels = 0;
+}
+
+int AudioDecoder::setup_resampler(const AVChannelLayout &p_src_layout) {
+    if (!codec_ctx) {
+        return 1;
+    }
+
+    AVChannelLayout dst_layout = p_src_layout;
+    if (requested_channels > 0) {
+        if (requested_channels == 1) {
+            dst_layout = AV_CHANNEL_LAYOUT_MONO;
+        } else if (requested_channels == 2) {
+            dst_layout = AV_CHANNEL_LAYOUT_STEREO;
+        }
+        // (you can add more layouts later if needed)
+    }
+
+    const int dst_rate = requested_sample_rate > 0 ? requested_sample_rate : codec_ctx->sample_rate;
+
+    // New FFmpeg 5+/8 style: swr_alloc_set_opts2 returns int and takes SwrContext**
+    int ret = swr_alloc_set_opts2(
+        &swr_ctx,
+        &dst_layout,
+        AV_SAMPLE_FMT_FLT,
+        dst_rate,
+        &p_src_layout,
+        codec_ctx->sample_fmt,
+        codec_ctx->sample_rate,
+        0,
+        nullptr
+    );
+    if (ret < 0 || !swr_ctx) {
+        return 2;
+    }
+
+    if (swr_init(swr_ctx) < 0) {
+        swr_free(&swr_ctx);
+        return 3;
+    }
+
+    target_sample_rate = dst_rate;
+    target_channels = dst_layout.nb_channels;
+    return 0;
+}
+
+int AudioDecoder::open_file(const char *p_path) {
+    close();
+
+    format_ctx = avformat_alloc_context();
+    if (!format_ctx) {
+        return 1;
+    }
+    return open_input(p_path);
+}
+
+int AudioDecoder::open_memory(const uint8_t *p_data, size_t p_size) {
+    close();
+
+    format_ctx = avformat_alloc_context();
+    if (!format_ctx) {
+        return 1;
+    }
+
+    AVIOContext *avio_ctx = memory_reader.open(p_data, p_size, MEMORY_IO_BUFFER_SIZE);
+    if (!avio_ctx) {
+        log_info(COMPONENT, "Failed to allocate IO context");
+        return 1;
+    }
+    format_ctx->pb = avio_ctx;
+    format_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+    tracked_memory.add(memory_reader.get_buffer_size());
+    return open_input("");
+}
+
+int AudioDecoder::open_input(const char *p_path) {
+    if (avformat_open_input(&format_ctx, p_path, nullptr, nullptr) < 0) {
+        log_info(COMPONENT, "Failed to open input");
+        return 1;
+    }
+
+    if (avformat_find_stream_info(format_ctx, nullptr) < 0) {
+        log_info(COMPONENT, "Failed to find stream info");
+        return 2;
+    }
+
+    const AVCodec *codec = nullptr;
+    if (!input_codec_name.empty()) {
+        codec = avcodec_find_decoder_by_name(input_codec_name.c_str());
+    }
+
+    // locate audio stream
+    for (unsigned int i = 0; i < format_ctx->nb_streams; i++) {
+        if (format_ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
+            audio_stream_index = static_cast<int>(i);
+            if (!codec) {
+                codec = avcodec_find_decoder(format_ctx->streams[i]->codecpar->codec_id);
+            }
+            break;
+        }
+    }
+
+    if (audio_stream_index < 0 || !codec) {
+        log_info(COMPONENT, "No audio stream found");
+        return 3;
+    }
+
+    codec_ctx = avcodec_alloc_context3(codec);
+    avcodec_parameters_to_context(codec_ctx, format_ctx->streams[audio_stream_index]->codecpar);
+    // Audio codecs do not thread; take a single slot from the budget.
+    ThreadBudget::assign(codec_ctx, 1);
+
+    if (avcodec_open2(codec_ctx, codec, nullptr) < 0) {
+        log_info(COMPONENT, "Could not open decoder");
+        return 4;
+    }
+    Counters::codec_context_opened();
+
+    packet = av_packet_alloc();
+    frame = av_frame_alloc();
+    if (!packet || !frame) {
+        return 5;
+    }
+
+    if (setup_resampler(codec_ctx->ch_layout) != 0) {
+        log_info(COMPONENT, "Failed to configure resampler");
+        return 6;
+    }
+
+    return 0;
+}
+
+int AudioDecoder::convert_frame(const PcmSink &p_sink) {
+    GDFFMPEG_TRACE_SCOPE("decode_pcm_chunk");
+    const int dst_nb_channels = target_channels > 0 ? target_channels : frame->ch_layout.nb_channels;
+    const int64_t dst_nb_samples = av_rescale_rnd(
+        swr_get_delay(swr_ctx, frame->sample_rate) + frame->nb_samples,
+        target_sample_rate,
+        frame->sample_rate,
+        AV_ROUND_UP
+    );
+    if (dst_nb_samples <= 0 || dst_nb_samples > INT32_MAX / dst_nb_channels) {
+        return 1;
+    }
+
+    const size_t needed = static_cast<size_t>(dst_nb_samples) * dst_nb_channels;
+    if (scratch.size() < needed) {
+        tracked_memory.add(static_cast<int64_t>((needed - scratch.size()) * sizeof(float)));
+        scratch.resize(needed);
+    }
+
+    int converted = 0;
+    {
+        StageTimer timer(stats, PipelineStats::STAGE_CONVERT);
+        uint8_t *out = reinterpret_cast<uint8_t *>(scratch.data());
+        converted = swr_convert(
+            swr_ctx,
+            &out,
+            static_cast<int>(dst_nb_samples),
+            const_cast<const uint8_t **>(frame->extended_data),
+            frame->nb_samples
+        );
+    }
+    if (converted > 0) {
+        p_sink(scratch.data(), static_cast<int64_t>(converted) * dst_nb_channels);
+    }
+    return 0;
+}
+
+int AudioDecoder::receive_frame_timed() {
+    GDFFMPEG_TRACE_SCOPE("avcodec_receive_frame");
+    StageTimer timer(stats, PipelineStats::STAGE_RECEIVE_FRAME);
+    return avcodec_receive_frame(codec_ctx, frame);
+}
+
+int AudioDecoder::decode(const PcmSink &p_sink) {
+    GDFFMPEG_TRACE_SCOPE("decode_pcm");
+    if (!is_open()) {
+        return 1;
+    }
+    return decode_loop([this, &p_sink]() {
+        return convert_frame(p_sink);
+    });
+}
+
+int AudioDecoder::decode_frames(const AudioFrameSink &p_sink) {
+    GDFFMPEG_TRACE_SCOPE("decode_audio_frames");
+    if (!is_open()) {
+        return 1;
+    }
+    return decode_loop([this, &p_sink]() {
+        p_sink(frame);
+        return 0;
+    });
+}
+
+double AudioDecoder::get_duration() const {
+    if (!format_ctx || format_ctx->duration <= 0) {
+        return 0.0;
+    }
+    return static_cast<double>(format_ctx->duration) / AV_TIME_BASE;
+}
+
+AVRational AudioDecoder::get_time_base() const {
+    if (!format_ctx || audio_stream_index < 0) {
+        return AVRational{0, 1};
+    }
+    return format_ctx->streams[audio_stream_index]->time_base;
+}
+
+int AudioDecoder::decode_loop(const std::function<int()> &p_handle_frame) {
+    stop_requested = false;
+
+    while (!stop_requested) {
+        int read_ret = 0;
+        {
+            GDFFMPEG_TRACE_SCOPE("av_read_frame");
+            StageTimer timer(stats, PipelineStats::STAGE_DEMUX);
+            read_ret = av_read_frame(format_ctx, packet);
+        }
+        if (read_ret < 0) {
+            break;
+        }
+        if (packet->stream_index != audio_stream_index) {
+            av_packet_unref(packet);
+            continue;
+        }
+
+        int ret = 0;
+        {
+            GDFFMPEG_TRACE_SCOPE("avcodec_send_packet");
+            StageTimer timer(stats, PipelineStats::STAGE_SEND_PACKET);
+            ret = avcodec_send_packet(codec_ctx, packet);
+        }
+        av_packet_unref(packet);
+        if (ret < 0) {
+            log_info(COMPONENT, "Error sending packet to decoder");
+            break;
+        }
+
+        while (ret >= 0) {
+            ret = receive_frame_timed();
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                break;
+            }
+            if (ret < 0) {
+                log_info(COMPONENT, "Error receiving frame");
+                break;
+            }
+
+            if (p_handle_frame() != 0) {
+                log_info(COMPONENT, "Failed to allocate output samples");
+                av_frame_unref(frame);
+                break;
+            }
+            av_frame_unref(frame);
+            if (stop_requested) {
+                return 0;
+            }
+        }
+    }
+    if (stop_requested) {
+        return 0;
+    }
+
+    // Flush decoder
+    int ret = avcodec_send_packet(codec_ctx, nullptr);
+    if (ret >= 0) {
+        while (true) {
+            ret = receive_frame_timed();
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                break;
+            }
+            if (ret < 0) {
+                break;
+            }
+
+            const int convert_ret = p_handle_frame();
+            av_frame_unref(frame);
+            if (convert_ret != 0 || stop_requested) {
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+} // namespace gdffmpeg
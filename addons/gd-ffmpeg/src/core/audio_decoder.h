@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavformat/avformat.h>
+    #include <libswresample/swresample.h>
+}
+
+#include "counters.h"
+#include "memory_io.h"
+#include "pipeline_stats.h"
+
+namespace gdffmpeg {
+
+// Receives interleaved float32 PCM converted from one decoded frame.
+// p_sample_count counts floats (frames * channels); the buffer is reused.
+using PcmSink = std::function<void(const float *p_samples, int64_t p_sample_count)>;
+
+// Receives each decoded frame in the codec's own sample format. The frame is
+// unreferenced after the call.
+using AudioFrameSink = std::function<void(const AVFrame *p_frame)>;
+
+// Demuxes and decodes the first audio stream of a file or memory buffer,
+// resampling everything to interleaved float32.
+class AudioDecoder {
+public:
+    AudioDecoder();
+    ~AudioDecoder();
+
+    AudioDecoder(const AudioDecoder &) = delete;
+    AudioDecoder &operator=(const AudioDecoder &) = delete;
+
+    // Settings below are read when an input is opened.
+    void set_input_codec(const std::string &p_codec_name) { input_codec_name = p_codec_name; }
+    void set_output_sample_rate(int p_rate) { requested_sample_rate = p_rate; }
+    void set_output_channels(int p_channels) { requested_channels = p_channels; }
+
+    // Both return 0 on success. open_memory() does not copy; p_data must stay
+    // valid until close().
+    int open_file(const char *p_path);
+    int open_memory(const uint8_t *p_data, size_t p_size);
+    void close();
+
+    bool is_open() const { return codec_ctx && format_ctx && packet && frame && swr_ctx; }
+
+    // Decodes to the end of the input, flushing the decoder. Returns 0 on
+    // success, non-zero when nothing could be decoded.
+    int decode(const PcmSink &p_sink);
+
+    // Like decode(), but skips resampling and hands over the decoder's
+    // frames as they are.
+    int decode_frames(const AudioFrameSink &p_sink);
+
+    // Called from a sink: decode()/decode_frames() return 0 after the
+    // current frame, without reading further or flushing the decoder.
+    void stop() { stop_requested = true; }
+
+    // Time base of the decoded frames' pts.
+    AVRational get_time_base() const;
+
+    // Duration of the open container in seconds; 0 when unknown.
+    double get_duration() const;
+
+    // Output format of the open input; 0 while nothing is open.
+    int get_sample_rate() const { return target_sample_rate; }
+    int get_channels() const { return target_channels; }
+
+    // Stage names: demux, send_packet, receive_frame, swr_convert. The fifth
+    // stage (STAGE_GODOT_ALLOC) is left for the sink to time.
+    PipelineStats &get_stats() { return stats; }
+    const PipelineStats &get_stats() const { return stats; }
+
+private:
+    AVFormatContext *format_ctx = nullptr;
+    AVCodecContext *codec_ctx = nullptr;
+    SwrContext *swr_ctx = nullptr;
+    AVPacket *packet = nullptr;
+    AVFrame *frame = nullptr;
+    MemoryReader memory_reader;
+
+    int audio_stream_index = -1;
+    int requested_sample_rate = 0;
+    int requested_channels = 0;
+    int target_sample_rate = 0;
+    int target_channels = 0;
+    std::string input_codec_name;
+    bool stop_requested = false;
+
+    // Conversion output, grown as needed and reused across frames.
+    std::vector<float> scratch;
+
+    PipelineStats stats;
+    TrackedMemory tracked_memory;
+
+    int open_input(const char *p_path);
+    int setup_resampler(const AVChannelLayout &p_src_layout);
+    int receive_frame_timed();
+    int convert_frame(const PcmSink &p_sink);
+    // Reads, decodes and flushes the input, calling p_handle_frame for every
+    // frame received; a non-zero result stops at that frame.
+    int decode_loop(const std::function<int()> &p_handle_frame);
+};
+
+} // namespace gdffmpeg
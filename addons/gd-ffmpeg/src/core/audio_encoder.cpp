@@ -0,0 +1,295 @@
+#include "audio_encoder.h"
+
+#include "counters.h"
+#include "log.h"
+#include "options.h"
+#include "thread_budget.h"
+#include "trace.h"
+
+#include <cstring>
+
+extern "C" {
+    #include <libavutil/channel_layout.h>
+    #include <libavutil/error.h>
+}
+
+namespace gdffmpeg {
+
+static const char *COMPONENT = "FFmpegAudioEncoder";
+
+AudioEncoder::AudioEncoder() {
+    av_log_set_level(AV_LOG_ERROR);
+}
+
+AudioEncoder::~AudioEncoder() {
+    close();
+}
+
+void AudioEncoder::close() {
+    if (packet) {
+        av_packet_free(&packet);
+        packet = nullptr;
+    }
+    if (frame) {
+        av_frame_free(&frame);
+        frame = nullptr;
+    }
+    if (codec_ctx) {
+        Counters::free_codec_context(&codec_ctx);
+        codec_ctx = nullptr;
+    }
+    initialized = false;
+}
+
+int AudioEncoder::setup(const AudioEncoderOptions &p_options) {
+    // Clean any previous encoder state
+    close();
+
+    if (p_options.sample_rate <= 0 || p_options.channels <= 0 || p_options.bit_rate <= 0) {
+        log_info(COMPONENT, "Invalid encoder parameters");
+        return 1;
+    }
+
+    const AVCodec *codec = avcodec_find_encoder_by_name(p_options.codec_name.c_str());
+    if (!codec) {
+        log_info(COMPONENT, "Encoder not found: " + p_options.codec_name);
+        return 2;
+    }
+
+    codec_ctx = avcodec_alloc_context3(codec);
+    if (!codec_ctx) {
+        log_info(COMPONENT, "Failed to allocate codec context");
+        return 3;
+    }
+
+    sample_rate = p_options.sample_rate;
+    channels = p_options.channels;
+
+    codec_ctx->sample_rate = sample_rate;
+    codec_ctx->time_base = AVRational{1, sample_rate};
+    codec_ctx->bit_rate = p_options.bit_rate;
+    if (p_options.global_header) {
+        codec_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    // ---------- Channel layout (FFmpeg 5+/8 style: AVChannelLayout) ----------
+    if (channels == 1) {
+        codec_ctx->ch_layout = AV_CHANNEL_LAYOUT_MONO;
+    } else if (channels == 2) {
+        codec_ctx->ch_layout = AV_CHANNEL_LAYOUT_STEREO;
+    } else {
+        log_info(COMPONENT, "Only mono and stereo channel layouts are supported in this example");
+        return 4;
+    }
+
+    // ---------- Sample format (prefer float formats we implement) ----------
+    if (codec->sample_fmts && codec->sample_fmts[0] != AV_SAMPLE_FMT_NONE) {
+        AVSampleFormat chosen = AV_SAMPLE_FMT_NONE;
+
+        // First: look for planar float
+        const AVSampleFormat *p = codec->sample_fmts;
+        while (*p != AV_SAMPLE_FMT_NONE) {
+            if (*p == AV_SAMPLE_FMT_FLTP) {
+                chosen = *p;
+                break;
+            }
+            p++;
+        }
+
+        // Second: look for interleaved float
+        if (chosen == AV_SAMPLE_FMT_NONE) {
+            p = codec->sample_fmts;
+            while (*p != AV_SAMPLE_FMT_NONE) {
+                if (*p == AV_SAMPLE_FMT_FLT) {
+                    chosen = *p;
+                    break;
+                }
+                p++;
+            }
+        }
+
+        // Fallback: first available
+        if (chosen == AV_SAMPLE_FMT_NONE) {
+            chosen = codec->sample_fmts[0];
+        }
+
+        sample_fmt = chosen;
+        log_info(COMPONENT, "Using encoder sample format: " + std::to_string(sample_fmt));
+    } else {
+        // Encoder did not report formats; assume planar float
+        sample_fmt = AV_SAMPLE_FMT_FLTP;
+        log_info(COMPONENT, "Encoder did not report sample_fmts; assuming AV_SAMPLE_FMT_FLTP");
+    }
+
+    codec_ctx->sample_fmt = sample_fmt;
+
+    // ---------- Rate control / quality options ----------
+    if (!p_options.profile.empty()) {
+        apply_codec_option(COMPONENT, codec_ctx, "profile", p_options.profile.c_str());
+    }
+    if (!p_options.preset.empty()) {
+        apply_codec_option(COMPONENT, codec_ctx, "preset", p_options.preset.c_str());
+    }
+
+    if (p_options.bitrate_mode == "vbr") {
+        apply_codec_option_int(COMPONENT, codec_ctx, "vbr", 1);
+        if (p_options.quality >= 0) {
+            apply_codec_option_int(COMPONENT, codec_ctx, "compression_level", p_options.quality);
+            apply_codec_option_int(COMPONENT, codec_ctx, "q", p_options.quality);
+        }
+    } else {
+        apply_codec_option_int(COMPONENT, codec_ctx, "vbr", 0);
+    }
+
+    ThreadBudget::assign(codec_ctx, 1);
+
+    // Open encoder
+    if (avcodec_open2(codec_ctx, codec, nullptr) < 0) {
+        log_info(COMPONENT, "Failed to open codec");
+        Counters::free_codec_context(&codec_ctx);
+        codec_ctx = nullptr;
+        return 5;
+    }
+    Counters::codec_context_opened();
+
+    frame = av_frame_alloc();
+    if (!frame) {
+        log_info(COMPONENT, "Failed to allocate frame");
+        return 6;
+    }
+
+    packet = av_packet_alloc();
+    if (!packet) {
+        log_info(COMPONENT, "Failed to allocate packet");
+        av_frame_free(&frame);
+        frame = nullptr;
+        return 7;
+    }
+
+    frame_size = codec_ctx->frame_size > 0 ? codec_ctx->frame_size : 1024;
+    next_pts = 0;
+    initialized = true;
+    return 0;
+}
+
+int AudioEncoder::receive_packets(const PacketSink &p_sink) {
+    while (true) {
+        const int ret = avcodec_receive_packet(codec_ctx, packet);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            return 0;
+        } else if (ret < 0) {
+            log_info(COMPONENT, "Error receiving packet from encoder");
+            return ret;
+        }
+
+        if (packet->size > 0 && packet->data) {
+            Counters::add_bytes_written(packet->size);
+            if (p_sink) {
+                p_sink(packet);
+            }
+        }
+
+        av_packet_unref(packet);
+    }
+}
+
+int AudioEncoder::encode(const float *p_pcm_interleaved, int64_t p_sample_count, const PacketSink &p_sink) {
+    GDFFMPEG_TRACE_SCOPE("audio_encode");
+
+    if (!initialized || !codec_ctx || !frame || !packet) {
+        log_info(COMPONENT, "Encoder not initialized");
+        return 1;
+    }
+
+    if (!p_pcm_interleaved || p_sample_count <= 0 || channels <= 0) {
+        return 0;
+    }
+
+    if (p_sample_count % channels != 0) {
+        log_info(COMPONENT, "PCM array size is not divisible by channel count; truncating last partial frame");
+    }
+
+    const int64_t total_samples = p_sample_count / channels;
+
+    // Allocate frame buffers for the maximum chunk size
+    frame->nb_samples = frame_size;
+    frame->format = codec_ctx->sample_fmt;
+    frame->sample_rate = codec_ctx->sample_rate;
+    frame->ch_layout = codec_ctx->ch_layout;
+
+    if (av_frame_get_buffer(frame, 0) < 0) {
+        log_info(COMPONENT, "Failed to allocate frame buffer");
+        return 2;
+    }
+
+    const float *src = p_pcm_interleaved;
+    int64_t sample_pos = 0;
+    int result = 0;
+
+    while (sample_pos < total_samples) {
+        const int64_t remaining = total_samples - sample_pos;
+        const int nb = remaining < frame_size ? static_cast<int>(remaining) : frame_size;
+
+        if (av_frame_make_writable(frame) < 0) {
+            log_info(COMPONENT, "Frame not writable");
+            result = 3;
+            break;
+        }
+
+        // Actual number of samples we are sending this iteration
+        frame->nb_samples = nb;
+        frame->pts = next_pts;
+
+        if (sample_fmt == AV_SAMPLE_FMT_FLT) {
+            // Interleaved float: [L,R,L,R,...]
+            std::memcpy(frame->data[0], src + sample_pos * channels, static_cast<size_t>(nb) * channels * sizeof(float));
+        } else if (sample_fmt == AV_SAMPLE_FMT_FLTP) {
+            // Planar float: data[c] is a separate plane
+            for (int c = 0; c < channels; ++c) {
+                float *dst_ch = reinterpret_cast<float *>(frame->data[c]);
+                for (int s = 0; s < nb; ++s) {
+                    dst_ch[s] = src[(sample_pos + s) * channels + c];
+                }
+            }
+        } else {
+            log_info(COMPONENT, "Only FLT and FLTP formats are implemented in this example");
+            result = 4;
+            break;
+        }
+
+        // Send frame
+        GDFFMPEG_TRACE_SCOPE("audio_encode_chunk");
+        if (avcodec_send_frame(codec_ctx, frame) < 0) {
+            log_info(COMPONENT, "Error sending frame to encoder");
+            result = 5;
+            break;
+        }
+
+        // Read all available packets after this frame
+        if (receive_packets(p_sink) < 0) {
+            result = 6;
+            break;
+        }
+
+        sample_pos += nb;
+        next_pts += nb;
+    }
+
+    av_frame_unref(frame);
+    return result;
+}
+
+int AudioEncoder::flush(const PacketSink &p_sink) {
+    GDFFMPEG_TRACE_SCOPE("audio_flush");
+    if (!initialized || !codec_ctx || !packet) {
+        return 1;
+    }
+
+    if (avcodec_send_frame(codec_ctx, nullptr) < 0) {
+        return 2;
+    }
+
+    return receive_packets(p_sink) < 0 ? 3 : 0;
+}
+
+} // namespace gdffmpeg
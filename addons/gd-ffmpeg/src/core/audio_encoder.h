@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+}
+
+namespace gdffmpeg {
+
+// Receives every packet the encoder produces. The packet is only valid for the
+// duration of the call.
+using PacketSink = std::function<void(const AVPacket *p_packet)>;
+
+struct AudioEncoderOptions {
+    std::string codec_name;
+    int sample_rate = 0;
+    int channels = 0;
+    int64_t bit_rate = 0;
+    // "cbr" or "vbr".
+    std::string bitrate_mode = "cbr";
+    // Only used in VBR mode; -1 keeps the encoder default.
+    int quality = -1;
+    std::string profile;
+    std::string preset;
+    // Set when the packets go into a container that wants codec extradata
+    // (mp4, mkv, webm) rather than a raw bitstream such as ADTS.
+    bool global_header = false;
+};
+
+// Raw (un-muxed) audio encoder fed with interleaved float32 PCM.
+class AudioEncoder {
+public:
+    AudioEncoder();
+    ~AudioEncoder();
+
+    AudioEncoder(const AudioEncoder &) = delete;
+    AudioEncoder &operator=(const AudioEncoder &) = delete;
+
+    // Returns 0 on success, non-zero on error.
+    int setup(const AudioEncoderOptions &p_options);
+    void close();
+
+    // p_sample_count counts floats, i.e. frames * channels. Frames are stamped
+    // in 1/sample_rate units, continuing from the previous call. Returns 0 on
+    // success, non-zero on error.
+    int encode(const float *p_pcm_interleaved, int64_t p_sample_count, const PacketSink &p_sink);
+
+    // Drains the encoder. After this the encoder must be set up again.
+    int flush(const PacketSink &p_sink);
+
+    bool is_initialized() const { return initialized; }
+    int get_sample_rate() const { return sample_rate; }
+    int get_channels() const { return channels; }
+    int get_frame_size() const { return frame_size; }
+    AVCodecContext *get_codec_context() const { return codec_ctx; }
+    AVRational get_time_base() const { return codec_ctx ? codec_ctx->time_base : AVRational{0, 1}; }
+
+private:
+    AVCodecContext *codec_ctx = nullptr;
+    AVFrame *frame = nullptr;
+    AVPacket *packet = nullptr;
+
+    int sample_rate = 0;
+    int channels = 0;
+    AVSampleFormat sample_fmt = AV_SAMPLE_FMT_NONE;
+    bool initialized = false;
+    int frame_size = 1024;
+    int64_t next_pts = 0;
+
+    int receive_packets(const PacketSink &p_sink);
+};
+
+} // namespace gdffmpeg
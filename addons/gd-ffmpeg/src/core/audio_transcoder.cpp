@@ -0,0 +1,285 @@
+#include "audio_transcoder.h"
+
+#include "log.h"
+#include "trace.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+extern "C" {
+    #include <libavutil/audio_fifo.h>
+}
+
+namespace gdffmpeg {
+
+static const char *COMPONENT = "FFmpegAudioTranscoder";
+
+namespace {
+
+// Interleaved float32 FIFO between the decoder and the encoder. push()
+// blocks while the FIFO is full when a consumer runs on another thread.
+class PcmFifo {
+public:
+    PcmFifo(int p_channels, int p_capacity) :
+            channels(p_channels), capacity(p_capacity) {
+        fifo = av_audio_fifo_alloc(AV_SAMPLE_FMT_FLT, p_channels, p_capacity);
+    }
+
+    ~PcmFifo() {
+        if (fifo) {
+            av_audio_fifo_free(fifo);
+        }
+    }
+
+    PcmFifo(const PcmFifo &) = delete;
+    PcmFifo &operator=(const PcmFifo &) = delete;
+
+    bool is_valid() const { return fifo != nullptr; }
+
+    // p_sample_count counts floats, as in PcmSink. Returns false when the
+    // FIFO was aborted or could not grow.
+    bool push(const float *p_samples, int64_t p_sample_count, bool p_wait) {
+        const int nb = static_cast<int>(p_sample_count / channels);
+        std::unique_lock<std::mutex> lock(mutex);
+        if (p_wait) {
+            space_available.wait(lock, [this]() { return aborted || av_audio_fifo_size(fifo) < capacity; });
+        }
+        if (aborted) {
+            return false;
+        }
+        void *planes[1] = { const_cast<float *>(p_samples) };
+        if (av_audio_fifo_write(fifo, planes, nb) < nb) {
+            return false;
+        }
+        data_available.notify_one();
+        return true;
+    }
+
+    // Reads exactly p_frame_size sample frames into p_out, or whatever is
+    // left once the producer has finished. Returns the number read; 0 means
+    // the stream is over (or was aborted).
+    int pop(float *p_out, int p_frame_size, bool p_wait) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (p_wait) {
+            data_available.wait(lock, [this, p_frame_size]() {
+                return aborted || finished || av_audio_fifo_size(fifo) >= p_frame_size;
+            });
+        }
+        if (aborted) {
+            return 0;
+        }
+        const int available = av_audio_fifo_size(fifo);
+        if (available < p_frame_size && !finished) {
+            return 0;
+        }
+        const int nb = available < p_frame_size ? available : p_frame_size;
+        void *planes[1] = { p_out };
+        const int read = nb > 0 ? av_audio_fifo_read(fifo, planes, nb) : 0;
+        space_available.notify_one();
+        return read > 0 ? read : 0;
+    }
+
+    void finish() {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+        data_available.notify_all();
+    }
+
+    void abort() {
+        std::lock_guard<std::mutex> lock(mutex);
+        aborted = true;
+        data_available.notify_all();
+        space_available.notify_all();
+    }
+
+private:
+    AVAudioFifo *fifo = nullptr;
+    int channels = 0;
+    int capacity = 0;
+    bool finished = false;
+    bool aborted = false;
+    std::mutex mutex;
+    std::condition_variable data_available;
+    std::condition_variable space_available;
+};
+
+} // namespace
+
+int AudioTranscoder::open_decoder(AudioDecoder &p_decoder, const std::string &p_input) const {
+    p_decoder.set_input_codec(input_codec_name);
+    p_decoder.set_output_sample_rate(options.sample_rate);
+    p_decoder.set_output_channels(options.channels);
+    if (p_decoder.open_file(p_input.c_str()) != 0) {
+        return 1;
+    }
+    // The encoder only takes mono or stereo; fold anything wider down.
+    if (options.channels <= 0 && p_decoder.get_channels() > 2) {
+        p_decoder.close();
+        p_decoder.set_output_channels(2);
+        return p_decoder.open_file(p_input.c_str());
+    }
+    return 0;
+}
+
+int AudioTranscoder::transcode(const std::string &p_input, const std::string &p_output, OutputSink *p_sink) {
+    GDFFMPEG_TRACE_SCOPE("audio_transcode");
+    samples_transcoded = 0;
+
+    AudioDecoder decoder;
+    if (open_decoder(decoder, p_input) != 0) {
+        log_info(COMPONENT, "Failed to open input: " + p_input);
+        return 1;
+    }
+    const int channels = decoder.get_channels();
+
+    Muxer muxer;
+    if (muxer.open(p_output, p_sink, muxer_name) != 0) {
+        return 2;
+    }
+
+    AudioEncoderOptions encoder_options = options;
+    if (encoder_options.codec_name.empty()) {
+        encoder_options.codec_name = "aac";
+    }
+    if (encoder_options.bit_rate <= 0) {
+        encoder_options.bit_rate = 128000;
+    }
+    encoder_options.sample_rate = decoder.get_sample_rate();
+    encoder_options.channels = channels;
+    encoder_options.global_header = muxer.needs_global_header();
+
+    AudioEncoder encoder;
+    if (encoder.setup(encoder_options) != 0) {
+        log_info(COMPONENT, "Failed to setup encoder");
+        return 3;
+    }
+    AVStream *stream = muxer.add_stream(encoder.get_codec_context());
+    if (!stream || muxer.write_header() != 0) {
+        log_info(COMPONENT, "Failed to write container header");
+        return 4;
+    }
+
+    // Every frame but the last must be exactly frame_size long for codecs
+    // such as AAC, which is what the FIFO is for. It must hold at least one
+    // frame or the two sides would wait on each other.
+    const int frame_size = encoder.get_frame_size();
+    PcmFifo fifo(channels, max_buffered_samples > frame_size ? max_buffered_samples : frame_size);
+    AVPacket *mux_packet = av_packet_alloc();
+    if (!fifo.is_valid() || !mux_packet) {
+        av_packet_free(&mux_packet);
+        return 5;
+    }
+
+    int result = 0;
+    const AVRational time_base = encoder.get_time_base();
+    const int stream_index = stream->index;
+    const PacketSink mux = [&](const AVPacket *p_packet) {
+        if (result != 0) {
+            return;
+        }
+        if (av_packet_ref(mux_packet, p_packet) < 0 || muxer.write_packet(mux_packet, time_base, stream_index) != 0) {
+            log_info(COMPONENT, "Failed to write packet");
+            result = 6;
+        }
+    };
+
+    std::vector<float> chunk(static_cast<size_t>(frame_size) * channels);
+    ProgressReporter progress(progress_callback);
+    const double duration = decoder.get_duration();
+    const double sample_rate = decoder.get_sample_rate();
+    const auto encode_available = [&](bool p_wait) {
+        while (result == 0) {
+            const int nb = fifo.pop(chunk.data(), frame_size, p_wait);
+            if (nb <= 0) {
+                return;
+            }
+            if (encoder.encode(chunk.data(), static_cast<int64_t>(nb) * channels, mux) != 0) {
+                result = 7;
+                return;
+            }
+            samples_transcoded += nb;
+            progress.update(static_cast<double>(samples_transcoded) / sample_rate, duration);
+        }
+    };
+
+    // Set by the decoding thread when it stops for cancel_flag.
+    bool cancelled = false;
+    const auto check_cancelled = [&]() {
+        if (cancel_flag && *cancel_flag) {
+            cancelled = true;
+            decoder.stop();
+        }
+        return cancelled;
+    };
+
+    int decode_result = 0;
+    if (threaded) {
+        bool push_failed = false;
+        std::thread decode_thread([&]() {
+            decode_result = decoder.decode([&](const float *p_samples, int64_t p_sample_count) {
+                if (check_cancelled()) {
+                    return;
+                }
+                // Aborted by a failed encode, or the FIFO could not grow:
+                // there is no point decoding the rest of the input.
+                if (!fifo.push(p_samples, p_sample_count, true)) {
+                    push_failed = true;
+                    decoder.stop();
+                }
+            });
+            fifo.finish();
+        });
+        encode_available(true);
+        if (result != 0) {
+            // Unblocks the decoder, which then stops.
+            fifo.abort();
+        }
+        decode_thread.join();
+        if (result == 0 && push_failed) {
+            result = 5;
+        }
+    } else {
+        decode_result = decoder.decode([&](const float *p_samples, int64_t p_sample_count) {
+            if (check_cancelled()) {
+                return;
+            }
+            if (result == 0 && !fifo.push(p_samples, p_sample_count, false)) {
+                result = 5;
+            }
+            encode_available(false);
+            if (result != 0) {
+                decoder.stop();
+            }
+        });
+        fifo.finish();
+        encode_available(false);
+    }
+    decoder.close();
+
+    if (result == 0 && cancelled) {
+        result = ERR_CANCELLED;
+    }
+    if (result == 0 && decode_result != 0) {
+        log_info(COMPONENT, "Decoding failed");
+        result = 8;
+    }
+    if (result == 0 && samples_transcoded == 0) {
+        log_info(COMPONENT, "No samples decoded");
+        result = 9;
+    }
+    if (result == 0 && encoder.flush(mux) != 0) {
+        result = 7;
+    }
+    if (result == 0) {
+        muxer.write_trailer();
+        progress.finish();
+    }
+    av_packet_free(&mux_packet);
+    encoder.close();
+    muxer.close();
+    return result;
+}
+
+} // namespace gdffmpeg
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "audio_decoder.h"
+#include "audio_encoder.h"
+#include "muxer.h"
+#include "progress.h"
+
+namespace gdffmpeg {
+
+// Decodes the first audio stream of a file, resamples it and re-encodes it
+// into a container, one encoder frame at a time. Decoded PCM goes through a
+// bounded AVAudioFifo and packets are muxed as soon as the encoder emits
+// them, so memory use does not grow with the input's duration.
+class AudioTranscoder {
+public:
+    // Buffered between decoder and encoder: about 0.7 s at 48 kHz.
+    static constexpr int DEFAULT_MAX_BUFFERED_SAMPLES = 32768;
+    static constexpr int ERR_CANCELLED = 10;
+
+    // Output settings. sample_rate/channels of 0 keep the source's (down-
+    // mixed to stereo); global_header is set from the container.
+    AudioEncoderOptions &get_options() { return options; }
+
+    void set_input_codec(const std::string &p_codec_name) { input_codec_name = p_codec_name; }
+
+    // Container used when writing to an OutputSink; file outputs are
+    // guessed from the extension.
+    void set_muxer_name(const std::string &p_name) { muxer_name = p_name; }
+
+    // With threading on, decoding runs on its own thread while the calling
+    // thread encodes and muxes. Either way the FIFO holds at most
+    // p_samples sample frames plus one decoded frame.
+    void set_threaded(bool p_enabled) { threaded = p_enabled; }
+    void set_max_buffered_samples(int p_samples) { max_buffered_samples = p_samples > 0 ? p_samples : 1; }
+
+    // Checked once per decoded frame; once it reads true the transcode
+    // stops and returns ERR_CANCELLED. The flag must outlive transcode().
+    void set_cancel_flag(const std::atomic<bool> *p_flag) { cancel_flag = p_flag; }
+
+    // Transcodes p_input into p_output, or p_sink when non-null. Returns 0
+    // on success.
+    int transcode(const std::string &p_input, const std::string &p_output, OutputSink *p_sink = nullptr);
+
+    // Sample frames (per channel) encoded by the last transcode().
+    int64_t get_samples_transcoded() const { return samples_transcoded; }
+
+    // Reports the encoded length against the input's duration.
+    void set_progress_callback(const ProgressCallback &p_callback) { progress_callback = p_callback; }
+
+private:
+    AudioEncoderOptions options;
+    std::string input_codec_name;
+    std::string muxer_name = "adts";
+    bool threaded = false;
+    int max_buffered_samples = DEFAULT_MAX_BUFFERED_SAMPLES;
+    int64_t samples_transcoded = 0;
+    ProgressCallback progress_callback;
+    const std::atomic<bool> *cancel_flag = nullptr;
+
+    int open_decoder(AudioDecoder &p_decoder, const std::string &p_input) const;
+};
+
+} // namespace gdffmpeg
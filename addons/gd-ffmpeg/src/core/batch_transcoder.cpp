@@ -0,0 +1,197 @@
+#include "batch_transcoder.h"
+
+#include "audio_transcoder.h"
+#include "log.h"
+#include "trace.h"
+#include "video_transcoder.h"
+
+#include <algorithm>
+
+namespace gdffmpeg {
+
+static const char *COMPONENT = "FFmpegBatchTranscoder";
+
+BatchTranscoder::~BatchTranscoder() {
+    // Running jobs stop after their current frame, so this does not wait
+    // for whole files.
+    clear_callbacks();
+    cancel();
+    join();
+}
+
+void BatchTranscoder::set_job_started_callback(const JobCallback &p_callback) {
+    std::lock_guard<std::mutex> lock(callback_mutex);
+    job_started = p_callback;
+}
+
+void BatchTranscoder::set_job_progress_callback(const JobProgressCallback &p_callback) {
+    std::lock_guard<std::mutex> lock(callback_mutex);
+    job_progress = p_callback;
+}
+
+void BatchTranscoder::set_job_finished_callback(const JobFinishedCallback &p_callback) {
+    std::lock_guard<std::mutex> lock(callback_mutex);
+    job_finished = p_callback;
+}
+
+void BatchTranscoder::set_batch_finished_callback(const BatchFinishedCallback &p_callback) {
+    std::lock_guard<std::mutex> lock(callback_mutex);
+    batch_finished = p_callback;
+}
+
+void BatchTranscoder::clear_callbacks() {
+    std::lock_guard<std::mutex> lock(callback_mutex);
+    job_started = nullptr;
+    job_progress = nullptr;
+    job_finished = nullptr;
+    batch_finished = nullptr;
+}
+
+void BatchTranscoder::notify_job_started(int p_job) {
+    std::lock_guard<std::mutex> lock(callback_mutex);
+    if (job_started) {
+        job_started(p_job);
+    }
+}
+
+void BatchTranscoder::notify_job_progress(int p_job, double p_progress) {
+    std::lock_guard<std::mutex> lock(callback_mutex);
+    if (job_progress) {
+        job_progress(p_job, p_progress);
+    }
+}
+
+void BatchTranscoder::notify_job_finished(int p_job, int p_error) {
+    std::lock_guard<std::mutex> lock(callback_mutex);
+    if (job_finished) {
+        job_finished(p_job, p_error);
+    }
+}
+
+void BatchTranscoder::notify_batch_finished(int p_failed_jobs) {
+    std::lock_guard<std::mutex> lock(callback_mutex);
+    if (batch_finished) {
+        batch_finished(p_failed_jobs);
+    }
+}
+
+int BatchTranscoder::add_job(const TranscodeJob &p_job) {
+    if (running) {
+        log_info(COMPONENT, "Cannot add jobs while a batch is running");
+        return -1;
+    }
+    jobs.push_back(p_job);
+    return static_cast<int>(jobs.size()) - 1;
+}
+
+void BatchTranscoder::clear_jobs() {
+    if (running) {
+        log_info(COMPONENT, "Cannot clear jobs while a batch is running");
+        return;
+    }
+    jobs.clear();
+}
+
+void BatchTranscoder::join() {
+    for (std::thread &worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+}
+
+int BatchTranscoder::start() {
+    if (running) {
+        log_info(COMPONENT, "A batch is already running");
+        return 1;
+    }
+    if (jobs.empty()) {
+        log_info(COMPONENT, "No jobs to run");
+        return 2;
+    }
+    join();
+
+    const int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    const int wanted = worker_count > 0 ? worker_count : cores;
+    const int count = std::max(1, std::min(wanted, static_cast<int>(jobs.size())));
+    codec_threads = std::max(1, cores / count);
+
+    next_job = 0;
+    failed_jobs = 0;
+    cancelled = false;
+    active_workers = count;
+    running = true;
+    for (int i = 0; i < count; i++) {
+        workers.emplace_back(&BatchTranscoder::run_worker, this);
+    }
+    return 0;
+}
+
+void BatchTranscoder::wait() {
+    join();
+}
+
+void BatchTranscoder::run_worker() {
+    size_t index;
+    while ((index = next_job.fetch_add(1)) < jobs.size()) {
+        const int job = static_cast<int>(index);
+        int error = ERR_CANCELLED;
+        if (!cancelled) {
+            notify_job_started(job);
+            error = run_job(job);
+        }
+        if (error != 0) {
+            failed_jobs++;
+        }
+        notify_job_finished(job, error);
+    }
+    if (active_workers.fetch_sub(1) == 1) {
+        running = false;
+        notify_batch_finished(failed_jobs);
+    }
+}
+
+int BatchTranscoder::run_job(int p_index) {
+    GDFFMPEG_TRACE_SCOPE("batch_job");
+    const TranscodeJob &job = jobs[p_index];
+    const ProgressCallback progress = [this, p_index](double p_progress) {
+        notify_job_progress(p_index, p_progress);
+    };
+
+    int result = 0;
+    if (job.kind == TranscodeJob::KIND_VIDEO) {
+        VideoTranscoder transcoder;
+        transcoder.get_config() = job.video;
+        if (transcoder.get_config().thread_count <= 0) {
+            transcoder.get_config().thread_count = codec_threads;
+        }
+        transcoder.set_preferred_decoder(job.input_codec);
+        transcoder.set_frame_rate(job.frame_rate);
+        // The pool already keeps every core busy; a decode thread per job
+        // would only add contention.
+        transcoder.set_threaded(false);
+        transcoder.set_progress_callback(progress);
+        transcoder.set_cancel_flag(&cancelled);
+        result = transcoder.transcode(job.input, job.output);
+        if (result == VideoTranscoder::ERR_CANCELLED) {
+            return ERR_CANCELLED;
+        }
+    } else {
+        AudioTranscoder transcoder;
+        transcoder.get_options() = job.audio;
+        transcoder.set_input_codec(job.input_codec);
+        transcoder.set_progress_callback(progress);
+        transcoder.set_cancel_flag(&cancelled);
+        result = transcoder.transcode(job.input, job.output);
+        if (result == AudioTranscoder::ERR_CANCELLED) {
+            return ERR_CANCELLED;
+        }
+    }
+    if (result != 0) {
+        log_info(COMPONENT, "Job " + std::to_string(p_index) + " failed (" + job.input + "): " + std::to_string(result));
+    }
+    return result;
+}
+
+} // namespace gdffmpeg
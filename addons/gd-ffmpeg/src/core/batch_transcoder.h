@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio_encoder.h"
+#include "video_encoder.h"
+
+namespace gdffmpeg {
+
+// One file to transcode with VideoTranscoder or AudioTranscoder.
+struct TranscodeJob {
+    enum Kind {
+        KIND_AUDIO,
+        KIND_VIDEO,
+    };
+
+    Kind kind = KIND_AUDIO;
+    std::string input;
+    std::string output;
+    std::string input_codec;
+    // KIND_VIDEO. width/height 0 keep the source size; thread_count 0 takes
+    // the batch's share (see BatchTranscoder).
+    VideoEncoderConfig video;
+    // KIND_VIDEO; 0 keeps the source frame rate. Other rates drop or repeat
+    // frames, see VideoTranscoder::set_frame_rate().
+    int frame_rate = 0;
+    // KIND_AUDIO. sample_rate/channels 0 keep the source's.
+    AudioEncoderOptions audio;
+};
+
+// Runs a list of transcode jobs on a pool of worker threads. By default
+// there is one worker per core (fewer if there are fewer jobs), and every
+// video codec gets cores / workers threads of its own, so the codecs' own
+// frame/slice threads do not multiply past the core count.
+class BatchTranscoder {
+public:
+    // Error reported for jobs skipped or stopped by cancel().
+    static constexpr int ERR_CANCELLED = -1;
+
+    // All callbacks run on worker threads, one at a time.
+    using JobCallback = std::function<void(int p_job)>;
+    using JobProgressCallback = std::function<void(int p_job, double p_progress)>;
+    using JobFinishedCallback = std::function<void(int p_job, int p_error)>;
+    // Runs once after the last job, on the worker that finished it.
+    using BatchFinishedCallback = std::function<void(int p_failed_jobs)>;
+
+    BatchTranscoder() = default;
+    ~BatchTranscoder();
+
+    BatchTranscoder(const BatchTranscoder &) = delete;
+    BatchTranscoder &operator=(const BatchTranscoder &) = delete;
+
+    // Returns the job id, or -1 while a batch is running.
+    int add_job(const TranscodeJob &p_job);
+    void clear_jobs();
+    int get_job_count() const { return static_cast<int>(jobs.size()); }
+
+    // 0 picks one worker per core.
+    void set_worker_count(int p_workers) { worker_count = p_workers; }
+    int get_worker_count() const { return worker_count; }
+
+    void set_job_started_callback(const JobCallback &p_callback);
+    void set_job_progress_callback(const JobProgressCallback &p_callback);
+    void set_job_finished_callback(const JobFinishedCallback &p_callback);
+    void set_batch_finished_callback(const BatchFinishedCallback &p_callback);
+    // Drops every callback. Once this returns none is running or will run
+    // again, so their captures may go away. Must not be called from a
+    // callback.
+    void clear_callbacks();
+
+    // Starts the workers and returns immediately. Returns 0 on success,
+    // non-zero if a batch is already running or there is nothing to do.
+    int start();
+
+    // Blocks until every job has finished.
+    void wait();
+
+    // Jobs that have not started are skipped; running ones stop after
+    // their current frame. Both are reported with ERR_CANCELLED.
+    void cancel() { cancelled = true; }
+
+    bool is_running() const { return running; }
+    int get_failed_count() const { return failed_jobs; }
+
+private:
+    std::vector<TranscodeJob> jobs;
+    int worker_count = 0;
+
+    std::mutex callback_mutex;
+    JobCallback job_started;
+    JobProgressCallback job_progress;
+    JobFinishedCallback job_finished;
+    BatchFinishedCallback batch_finished;
+
+    std::vector<std::thread> workers;
+    std::atomic<size_t> next_job{ 0 };
+    std::atomic<int> active_workers{ 0 };
+    std::atomic<int> failed_jobs{ 0 };
+    std::atomic<bool> cancelled{ false };
+    std::atomic<bool> running{ false };
+    int codec_threads = 1;
+
+    void notify_job_started(int p_job);
+    void notify_job_progress(int p_job, double p_progress);
+    void notify_job_finished(int p_job, int p_error);
+    void notify_batch_finished(int p_failed_jobs);
+    void run_worker();
+    int run_job(int p_index);
+    void join();
+};
+
+} // namespace gdffmpeg
@@ -0,0 +1,50 @@
+#include "chunked_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace gdffmpeg {
+
+void ChunkedBuffer::append(const uint8_t *p_data, size_t p_size) {
+    while (p_size > 0) {
+        if (chunks.empty() || chunks.back().used == chunks.back().capacity) {
+            const size_t previous = chunks.empty() ? 0 : chunks.back().capacity;
+            Chunk chunk;
+            chunk.capacity = std::min(std::max(MIN_CHUNK_SIZE, previous * 2), MAX_CHUNK_SIZE);
+            chunk.data.reset(new uint8_t[chunk.capacity]);
+            chunks.push_back(std::move(chunk));
+        }
+
+        Chunk &tail = chunks.back();
+        const size_t to_copy = std::min(p_size, tail.capacity - tail.used);
+        std::memcpy(tail.data.get() + tail.used, p_data, to_copy);
+        tail.used += to_copy;
+        total += to_copy;
+        p_data += to_copy;
+        p_size -= to_copy;
+    }
+}
+
+void ChunkedBuffer::copy_to(uint8_t *p_dst) const {
+    for (const Chunk &chunk : chunks) {
+        std::memcpy(p_dst, chunk.data.get(), chunk.used);
+        p_dst += chunk.used;
+    }
+}
+
+void ChunkedBuffer::clear() {
+    if (chunks.size() > 1) {
+        chunks.resize(1);
+    }
+    if (!chunks.empty()) {
+        chunks[0].used = 0;
+    }
+    total = 0;
+}
+
+void ChunkedBuffer::release() {
+    chunks.clear();
+    total = 0;
+}
+
+} // namespace gdffmpeg
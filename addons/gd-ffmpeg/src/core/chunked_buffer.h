@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace gdffmpeg {
+
+// Append-only byte buffer made of chunks that double in size, so an append
+// never moves bytes already written. Long in-memory encodes stay linear;
+// copy_to() produces the contiguous result once at the end.
+class ChunkedBuffer {
+public:
+    static constexpr size_t MIN_CHUNK_SIZE = 64 * 1024;
+    static constexpr size_t MAX_CHUNK_SIZE = 16 * 1024 * 1024;
+
+    void append(const uint8_t *p_data, size_t p_size);
+
+    // Copies every byte, in order, to p_dst (which must hold size() bytes).
+    void copy_to(uint8_t *p_dst) const;
+
+    // Empties the buffer but keeps the first chunk, so a buffer cleared once
+    // per frame does not reallocate.
+    void clear();
+
+    // Empties the buffer and frees every chunk.
+    void release();
+
+    size_t size() const { return total; }
+    bool empty() const { return total == 0; }
+
+private:
+    struct Chunk {
+        std::unique_ptr<uint8_t[]> data;
+        size_t capacity = 0;
+        size_t used = 0;
+    };
+
+    std::vector<Chunk> chunks;
+    size_t total = 0;
+};
+
+} // namespace gdffmpeg
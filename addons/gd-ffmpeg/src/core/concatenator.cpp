@@ -0,0 +1,448 @@
+#include "concatenator.h"
+
+#include "audio_transcoder.h"
+#include "log.h"
+#include "trace.h"
+#include "video_transcoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <thread>
+
+namespace gdffmpeg {
+
+static const char *COMPONENT = "FFmpegConcat";
+
+namespace {
+
+// Demuxer for one clip with its first video and audio streams located.
+struct InputFile {
+    AVFormatContext *ctx = nullptr;
+    int video = -1;
+    int audio = -1;
+
+    ~InputFile() {
+        if (ctx) {
+            avformat_close_input(&ctx);
+        }
+    }
+
+    int open(const std::string &p_path) {
+        if (avformat_open_input(&ctx, p_path.c_str(), nullptr, nullptr) < 0) {
+            log_info(COMPONENT, "Failed to open input file: " + p_path);
+            return 1;
+        }
+        if (avformat_find_stream_info(ctx, nullptr) < 0) {
+            log_info(COMPONENT, "Failed to find stream info: " + p_path);
+            return 2;
+        }
+        for (unsigned int i = 0; i < ctx->nb_streams; i++) {
+            const AVStream *stream = ctx->streams[i];
+            if (stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && video < 0 && !(stream->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+                video = static_cast<int>(i);
+            } else if (stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO && audio < 0) {
+                audio = static_cast<int>(i);
+            }
+        }
+        return 0;
+    }
+};
+
+bool same_parameters(const AVStream *p_a, const AVStream *p_b) {
+    const AVCodecParameters *a = p_a->codecpar;
+    const AVCodecParameters *b = p_b->codecpar;
+    if (a->codec_id != b->codec_id || a->format != b->format || av_cmp_q(p_a->time_base, p_b->time_base) != 0) {
+        return false;
+    }
+    if (a->extradata_size != b->extradata_size ||
+            (a->extradata_size > 0 && std::memcmp(a->extradata, b->extradata, static_cast<size_t>(a->extradata_size)) != 0)) {
+        return false;
+    }
+    if (a->codec_type == AVMEDIA_TYPE_VIDEO) {
+        return a->width == b->width && a->height == b->height;
+    }
+    return a->sample_rate == b->sample_rate && a->ch_layout.nb_channels == b->ch_layout.nb_channels;
+}
+
+// Opens every input. Returns false if one fails; p_compatible reports
+// whether they can be stream-copied together.
+bool inspect_inputs(const std::vector<std::string> &p_inputs, bool &r_with_video, bool &r_with_audio, bool &r_compatible) {
+    r_with_video = true;
+    r_with_audio = true;
+    r_compatible = true;
+    InputFile first;
+    if (first.open(p_inputs[0]) != 0) {
+        return false;
+    }
+    r_with_video = first.video >= 0;
+    r_with_audio = first.audio >= 0;
+    for (size_t i = 1; i < p_inputs.size(); i++) {
+        InputFile clip;
+        if (clip.open(p_inputs[i]) != 0) {
+            return false;
+        }
+        if ((clip.video >= 0) != (first.video >= 0) || (clip.audio >= 0) != (first.audio >= 0)) {
+            r_compatible = false;
+        }
+        r_with_video = r_with_video && clip.video >= 0;
+        r_with_audio = r_with_audio && clip.audio >= 0;
+        if (r_compatible && first.video >= 0 && !same_parameters(first.ctx->streams[first.video], clip.ctx->streams[clip.video])) {
+            r_compatible = false;
+        }
+        if (r_compatible && first.audio >= 0 && !same_parameters(first.ctx->streams[first.audio], clip.ctx->streams[clip.audio])) {
+            r_compatible = false;
+        }
+    }
+    return true;
+}
+
+enum Slot {
+    SLOT_VIDEO,
+    SLOT_AUDIO,
+    SLOT_MAX,
+};
+
+} // namespace
+
+bool Concatenator::are_compatible(const std::vector<std::string> &p_inputs) {
+    bool with_video = false;
+    bool with_audio = false;
+    bool compatible = false;
+    return !p_inputs.empty() && inspect_inputs(p_inputs, with_video, with_audio, compatible) && compatible;
+}
+
+int Concatenator::copy_parts(const std::vector<Part> &p_parts, bool p_with_video, bool p_with_audio, const std::string &p_output, OutputSink *p_sink) {
+    GDFFMPEG_TRACE_SCOPE("concat_copy");
+    Muxer muxer;
+    if (muxer.open(p_output, p_sink, muxer_name) != 0) {
+        return 1;
+    }
+    for (const std::pair<std::string, std::string> &option : muxer_options) {
+        muxer.set_option(option.first, option.second);
+    }
+
+    int out_index[SLOT_MAX] = { -1, -1 };
+    int64_t last_dts[SLOT_MAX] = { INT64_MIN, INT64_MIN };
+    AVPacket *packet = av_packet_alloc();
+    if (!packet) {
+        return 2;
+    }
+
+    int result = 0;
+    int64_t offset_us = 0;
+    for (size_t part_index = 0; part_index < p_parts.size() && result == 0; part_index++) {
+        const Part &part = p_parts[part_index];
+        std::vector<std::unique_ptr<InputFile>> files;
+        // Per file: input stream index -> slot, or -1.
+        std::vector<std::vector<int>> slot_of;
+        bool found[SLOT_MAX] = { false, false };
+        for (const std::string &path : part) {
+            std::unique_ptr<InputFile> file = std::make_unique<InputFile>();
+            if (file->open(path) != 0) {
+                result = 3;
+                break;
+            }
+            std::vector<int> slots(file->ctx->nb_streams, -1);
+            if (p_with_video && file->video >= 0 && !found[SLOT_VIDEO]) {
+                slots[file->video] = SLOT_VIDEO;
+                found[SLOT_VIDEO] = true;
+            }
+            if (p_with_audio && file->audio >= 0 && !found[SLOT_AUDIO]) {
+                slots[file->audio] = SLOT_AUDIO;
+                found[SLOT_AUDIO] = true;
+            }
+            for (unsigned int i = 0; i < file->ctx->nb_streams; i++) {
+                if (slots[i] < 0) {
+                    file->ctx->streams[i]->discard = AVDISCARD_ALL;
+                }
+            }
+            slot_of.push_back(slots);
+            files.push_back(std::move(file));
+        }
+        if (result != 0) {
+            break;
+        }
+
+        if (part_index == 0) {
+            // The first clip defines the output streams.
+            for (size_t f = 0; f < files.size() && result == 0; f++) {
+                for (unsigned int i = 0; i < files[f]->ctx->nb_streams; i++) {
+                    const int slot = slot_of[f][i];
+                    if (slot < 0) {
+                        continue;
+                    }
+                    const AVStream *stream = files[f]->ctx->streams[i];
+                    AVStream *out = muxer.add_stream(stream->codecpar, stream->time_base);
+                    if (!out) {
+                        result = 4;
+                        break;
+                    }
+                    out_index[slot] = out->index;
+                }
+            }
+            if (result == 0 && muxer.write_header() != 0) {
+                result = 4;
+            }
+            if (result != 0) {
+                break;
+            }
+        }
+        for (int slot = 0; slot < SLOT_MAX; slot++) {
+            if ((out_index[slot] >= 0) != found[slot]) {
+                log_info(COMPONENT, "Clip " + std::to_string(part_index) + " does not have the same streams as the first");
+                result = 5;
+            }
+        }
+        if (result != 0) {
+            break;
+        }
+
+        // Reads the files of the part side by side, always writing the
+        // pending packet with the lowest dts, so the output stays interleaved.
+        std::vector<AVPacket *> pending(files.size(), nullptr);
+        std::vector<bool> exhausted(files.size(), false);
+        int64_t part_end_us = offset_us;
+        while (result == 0) {
+            for (size_t f = 0; f < files.size(); f++) {
+                while (!pending[f] && !exhausted[f]) {
+                    if (av_read_frame(files[f]->ctx, packet) < 0) {
+                        exhausted[f] = true;
+                    } else if (packet->stream_index >= static_cast<int>(slot_of[f].size()) || slot_of[f][packet->stream_index] < 0) {
+                        av_packet_unref(packet);
+                    } else {
+                        pending[f] = av_packet_clone(packet);
+                        av_packet_unref(packet);
+                        if (!pending[f]) {
+                            result = 6;
+                            break;
+                        }
+                    }
+                }
+            }
+            int next = -1;
+            int64_t next_us = INT64_MAX;
+            for (size_t f = 0; f < files.size(); f++) {
+                if (!pending[f]) {
+                    continue;
+                }
+                const AVPacket *candidate = pending[f];
+                const int64_t time = candidate->dts != AV_NOPTS_VALUE ? candidate->dts : candidate->pts;
+                const int64_t time_us = time == AV_NOPTS_VALUE ? INT64_MIN :
+                        av_rescale_q(time, files[f]->ctx->streams[candidate->stream_index]->time_base, AV_TIME_BASE_Q);
+                if (next < 0 || time_us < next_us) {
+                    next = static_cast<int>(f);
+                    next_us = time_us;
+                }
+            }
+            if (next < 0) {
+                break;
+            }
+
+            AVPacket *current = pending[next];
+            pending[next] = nullptr;
+            const AVStream *in_stream = files[next]->ctx->streams[current->stream_index];
+            const int slot = slot_of[next][current->stream_index];
+            const AVRational out_tb = muxer.get_format_context()->streams[out_index[slot]]->time_base;
+            const int64_t start = in_stream->start_time != AV_NOPTS_VALUE ? in_stream->start_time : 0;
+
+            // Each clip starts where the previous one ended.
+            if (current->pts != AV_NOPTS_VALUE) {
+                current->pts -= start;
+            }
+            if (current->dts != AV_NOPTS_VALUE) {
+                current->dts -= start;
+            }
+            av_packet_rescale_ts(current, in_stream->time_base, out_tb);
+            const int64_t shift = av_rescale_q(offset_us, AV_TIME_BASE_Q, out_tb);
+            if (current->pts != AV_NOPTS_VALUE) {
+                current->pts += shift;
+            }
+            if (current->dts != AV_NOPTS_VALUE) {
+                current->dts += shift;
+                // Reordering delays can differ between clips; never let dts
+                // step back at a join.
+                if (last_dts[slot] != INT64_MIN && current->dts <= last_dts[slot]) {
+                    current->dts = last_dts[slot] + 1;
+                    if (current->pts != AV_NOPTS_VALUE && current->pts < current->dts) {
+                        current->pts = current->dts;
+                    }
+                }
+                last_dts[slot] = current->dts;
+            }
+            const int64_t end = current->pts != AV_NOPTS_VALUE ? current->pts : current->dts;
+            if (end != AV_NOPTS_VALUE) {
+                part_end_us = std::max(part_end_us, av_rescale_q(end + std::max<int64_t>(current->duration, 0), out_tb, AV_TIME_BASE_Q));
+            }
+            current->pos = -1;
+            if (muxer.write_packet(current, out_tb, out_index[slot]) != 0) {
+                result = 7;
+            }
+            av_packet_free(&current);
+        }
+        for (AVPacket *leftover : pending) {
+            av_packet_free(&leftover);
+        }
+        offset_us = part_end_us;
+    }
+
+    av_packet_free(&packet);
+    if (result == 0 && muxer.write_trailer() != 0) {
+        result = 8;
+    }
+    muxer.close();
+    return result;
+}
+
+int Concatenator::reencode_clips(const std::vector<std::string> &p_inputs, bool p_with_video, bool p_with_audio, std::vector<Part> &p_parts) {
+    GDFFMPEG_TRACE_SCOPE("concat_reencode");
+    InputFile first;
+    if (first.open(p_inputs[0]) != 0) {
+        return 1;
+    }
+    VideoEncoderConfig config = video_config;
+    if (p_with_video && (config.width <= 0 || config.height <= 0)) {
+        config.width = first.ctx->streams[first.video]->codecpar->width;
+        config.height = first.ctx->streams[first.video]->codecpar->height;
+    }
+    // The rate decides the encoder time base, which ends up in the codec
+    // header (MPEG-4 VOL, H.264 VUI); copy_parts() writes every clip under
+    // the first one's, so all clips must be encoded at the same rate.
+    AVRational frame_rate = config.exact_frame_rate;
+    if (p_with_video && (frame_rate.num <= 0 || frame_rate.den <= 0)) {
+        frame_rate = av_guess_frame_rate(first.ctx, first.ctx->streams[first.video], nullptr);
+        if (frame_rate.num <= 0 || frame_rate.den <= 0) {
+            frame_rate = AVRational{ config.frame_rate, 1 };
+        }
+    }
+    config.exact_frame_rate = frame_rate;
+    AudioEncoderOptions audio = audio_options;
+    if (p_with_audio) {
+        const AVCodecParameters *params = first.ctx->streams[first.audio]->codecpar;
+        if (audio.sample_rate <= 0) {
+            audio.sample_rate = params->sample_rate;
+        }
+        if (audio.channels <= 0) {
+            audio.channels = std::min(params->ch_layout.nb_channels, 2);
+        }
+    }
+
+    const size_t clip_count = p_inputs.size();
+    const int hardware_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    const int workers = static_cast<int>(std::min<size_t>(thread_count > 0 ? thread_count : hardware_threads, clip_count));
+    if (config.thread_count <= 0) {
+        config.thread_count = std::max(1, hardware_threads / workers);
+    }
+
+    // Intermediates are Matroska, which takes any codec the settings name.
+    const std::string prefix = (std::filesystem::temp_directory_path() / ("gdffmpeg_concat_" +
+            std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "_")).string();
+    p_parts.assign(clip_count, Part());
+    for (size_t i = 0; i < clip_count; i++) {
+        if (p_with_video) {
+            p_parts[i].push_back(prefix + std::to_string(i) + "_video.mkv");
+        }
+        if (p_with_audio) {
+            p_parts[i].push_back(prefix + std::to_string(i) + "_audio.mka");
+        }
+    }
+
+    std::vector<int> results(clip_count, 0);
+    std::atomic<size_t> next_clip(0);
+    const auto work = [&]() {
+        size_t i;
+        while ((i = next_clip.fetch_add(1)) < clip_count) {
+            GDFFMPEG_TRACE_SCOPE("concat_reencode_clip");
+            size_t file = 0;
+            if (p_with_video) {
+                VideoTranscoder transcoder;
+                transcoder.get_config() = config;
+                transcoder.set_threaded(false);
+                transcoder.set_exact_frame_rate(frame_rate);
+                results[i] = transcoder.transcode(p_inputs[i], p_parts[i][file++]);
+            }
+            if (results[i] == 0 && p_with_audio) {
+                AudioTranscoder transcoder;
+                transcoder.get_options() = audio;
+                results[i] = transcoder.transcode(p_inputs[i], p_parts[i][file]);
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < workers; t++) {
+        threads.emplace_back(work);
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < clip_count; i++) {
+        if (results[i] != 0) {
+            log_info(COMPONENT, "Failed to re-encode " + p_inputs[i]);
+            return 2;
+        }
+    }
+
+    // Same settings should give the same parameters, but copy_parts() only
+    // keeps the first clip's header, so make sure before joining.
+    for (size_t file = 0; file < p_parts[0].size(); file++) {
+        std::vector<std::string> intermediates;
+        for (const Part &part : p_parts) {
+            intermediates.push_back(part[file]);
+        }
+        if (!are_compatible(intermediates)) {
+            log_info(COMPONENT, "Re-encoded clips still differ in codec parameters");
+            return 3;
+        }
+    }
+    return 0;
+}
+
+int Concatenator::concat(const std::vector<std::string> &p_inputs, const std::string &p_output, OutputSink *p_sink) {
+    GDFFMPEG_TRACE_SCOPE("concat");
+    stream_copied = false;
+    if (p_inputs.empty()) {
+        log_info(COMPONENT, "No inputs");
+        return 1;
+    }
+
+    bool with_video = false;
+    bool with_audio = false;
+    bool compatible = false;
+    if (!inspect_inputs(p_inputs, with_video, with_audio, compatible)) {
+        return 2;
+    }
+    if (!with_video && !with_audio) {
+        log_info(COMPONENT, "The clips share no video or audio stream");
+        return 3;
+    }
+
+    if (compatible && !force_reencode) {
+        std::vector<Part> parts;
+        for (const std::string &input : p_inputs) {
+            parts.push_back(Part{ input });
+        }
+        const int result = copy_parts(parts, with_video, with_audio, p_output, p_sink);
+        stream_copied = result == 0;
+        return result == 0 ? 0 : 4;
+    }
+
+    log_info(COMPONENT, "Clip parameters differ; re-encoding each clip");
+    std::vector<Part> parts;
+    int result = reencode_clips(p_inputs, with_video, with_audio, parts) == 0 ? 0 : 5;
+    if (result == 0 && copy_parts(parts, with_video, with_audio, p_output, p_sink) != 0) {
+        result = 4;
+    }
+    for (const Part &part : parts) {
+        for (const std::string &path : part) {
+            std::error_code ignored;
+            std::filesystem::remove(path, ignored);
+        }
+    }
+    return result;
+}
+
+} // namespace gdffmpeg
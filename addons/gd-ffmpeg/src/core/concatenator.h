@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+extern "C" {
+    #include <libavformat/avformat.h>
+}
+
+#include "audio_encoder.h"
+#include "muxer.h"
+#include "video_encoder.h"
+
+namespace gdffmpeg {
+
+// Joins clips end to end. When every clip carries the same video and audio
+// parameters (codec, extradata, time base, size/format or rate/layout)
+// their packets are stream-copied with shifted timestamps. Otherwise each
+// clip is re-encoded to common settings on a pool of threads, into
+// temporary files that are then stream-copied the same way.
+class Concatenator {
+public:
+    // Settings for the re-encode fallback. width/height of 0 take the first
+    // clip's size. Every clip is converted to exact_frame_rate, or to the
+    // first clip's rate when it is unset, so all intermediates share one
+    // time base and codec header; frame_rate is ignored.
+    VideoEncoderConfig &get_video_config() { return video_config; }
+    // sample_rate/channels of 0 take the first clip's (channels capped at 2).
+    AudioEncoderOptions &get_audio_options() { return audio_options; }
+
+    // Clips re-encoded at once; 0 uses std::thread::hardware_concurrency().
+    void set_thread_count(int p_threads) { thread_count = p_threads; }
+    // Skip the compatibility check and always re-encode.
+    void set_force_reencode(bool p_enabled) { force_reencode = p_enabled; }
+
+    // Output format for OutputSink output; see Muxer::open().
+    void set_muxer_name(const std::string &p_name) { muxer_name = p_name; }
+    void set_muxer_option(const std::string &p_key, const std::string &p_value) { muxer_options.emplace_back(p_key, p_value); }
+
+    // Writes p_inputs, in order, into p_output (or p_sink when non-null).
+    // Video and audio are each kept only when every clip has that stream. Returns 0 on
+    // success.
+    int concat(const std::vector<std::string> &p_inputs, const std::string &p_output, OutputSink *p_sink = nullptr);
+
+    // Whether the last concat() copied the source packets as they were.
+    bool was_stream_copied() const { return stream_copied; }
+
+    // True when p_inputs can be joined without re-encoding.
+    static bool are_compatible(const std::vector<std::string> &p_inputs);
+
+private:
+    // One clip as one or more files read side by side (e.g. the video and
+    // audio intermediates of a re-encoded clip).
+    using Part = std::vector<std::string>;
+
+    VideoEncoderConfig video_config;
+    AudioEncoderOptions audio_options;
+    int thread_count = 0;
+    bool force_reencode = false;
+    std::string muxer_name = "matroska";
+    std::vector<std::pair<std::string, std::string>> muxer_options;
+    bool stream_copied = false;
+
+    int copy_parts(const std::vector<Part> &p_parts, bool p_with_video, bool p_with_audio, const std::string &p_output, OutputSink *p_sink);
+    int reencode_clips(const std::vector<std::string> &p_inputs, bool p_with_video, bool p_with_audio, std::vector<Part> &p_parts);
+};
+
+} // namespace gdffmpeg
@@ -0,0 +1,25 @@
+#include "counters.h"
+
+#include "thread_budget.h"
+
+namespace gdffmpeg {
+
+std::atomic<int64_t> Counters::decoded_frames{0};
+std::atomic<int64_t> Counters::encoded_frames{0};
+std::atomic<int64_t> Counters::queued_frames{0};
+std::atomic<int64_t> Counters::bytes_written{0};
+std::atomic<int64_t> Counters::active_codec_contexts{0};
+std::atomic<int64_t> Counters::buffer_memory{0};
+
+void Counters::free_codec_context(AVCodecContext **p_ctx) {
+    if (!p_ctx || !*p_ctx) {
+        return;
+    }
+    if (avcodec_is_open(*p_ctx)) {
+        active_codec_contexts.fetch_sub(1, std::memory_order_relaxed);
+    }
+    ThreadBudget::release(*p_ctx);
+    avcodec_free_context(p_ctx);
+}
+
+} // namespace gdffmpeg
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+}
+
+namespace gdffmpeg {
+
+// Process-wide activity counters shared by every encoder/decoder. The
+// GDExtension publishes them as Performance monitors.
+class Counters {
+public:
+    static void add_decoded_frames(int64_t p_count) { decoded_frames.fetch_add(p_count, std::memory_order_relaxed); }
+    static void add_encoded_frames(int64_t p_count) { encoded_frames.fetch_add(p_count, std::memory_order_relaxed); }
+    static void add_queued_frames(int64_t p_delta) { queued_frames.fetch_add(p_delta, std::memory_order_relaxed); }
+    static void add_bytes_written(int64_t p_bytes) { bytes_written.fetch_add(p_bytes, std::memory_order_relaxed); }
+    static void add_buffer_memory(int64_t p_delta) { buffer_memory.fetch_add(p_delta, std::memory_order_relaxed); }
+
+    // Call after a successful avcodec_open2(); free_codec_context() undoes it.
+    static void codec_context_opened() { active_codec_contexts.fetch_add(1, std::memory_order_relaxed); }
+    static void free_codec_context(AVCodecContext **p_ctx);
+
+    static int64_t get_decoded_frames() { return decoded_frames.load(std::memory_order_relaxed); }
+    static int64_t get_encoded_frames() { return encoded_frames.load(std::memory_order_relaxed); }
+    static int64_t get_queued_frames() { return queued_frames.load(std::memory_order_relaxed); }
+    static int64_t get_bytes_written() { return bytes_written.load(std::memory_order_relaxed); }
+    static int64_t get_active_codec_contexts() { return active_codec_contexts.load(std::memory_order_relaxed); }
+    static int64_t get_buffer_memory() { return buffer_memory.load(std::memory_order_relaxed); }
+
+private:
+    static std::atomic<int64_t> decoded_frames;
+    static std::atomic<int64_t> encoded_frames;
+    static std::atomic<int64_t> queued_frames;
+    static std::atomic<int64_t> bytes_written;
+    static std::atomic<int64_t> active_codec_contexts;
+    static std::atomic<int64_t> buffer_memory;
+};
+
+// Bytes of FFmpeg-side buffers (IO buffers, frame pools, demux input) owned by
+// one instance. Released automatically so the global gauge cannot drift.
+class TrackedMemory {
+public:
+    ~TrackedMemory() { release(); }
+
+    void add(int64_t p_bytes) {
+        bytes += p_bytes;
+        Counters::add_buffer_memory(p_bytes);
+    }
+
+    void release() {
+        Counters::add_buffer_memory(-bytes);
+        bytes = 0;
+    }
+
+private:
+    int64_t bytes = 0;
+};
+
+} // namespace gdffmpeg
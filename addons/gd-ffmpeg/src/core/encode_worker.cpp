@@ -0,0 +1,140 @@
+#include "encode_worker.h"
+
+#include "counters.h"
+#include "trace.h"
+#include "video_encoder.h"
+
+namespace gdffmpeg {
+
+EncodeWorker::~EncodeWorker() {
+    stop();
+}
+
+void EncodeWorker::release_frame(EncoderFrame &p_frame) {
+    if (p_frame.release) {
+        p_frame.release();
+        p_frame.release = nullptr;
+    }
+}
+
+void EncodeWorker::start(VideoEncoder *p_encoder) {
+    stop();
+    encoder = p_encoder;
+    error = 0;
+    next_frame_index = 0;
+    draining = false;
+    discarding = false;
+    thread = std::thread(&EncodeWorker::run, this);
+}
+
+bool EncodeWorker::submit(EncoderFrame &&p_frame) {
+    std::unique_lock<std::mutex> lock(mutex);
+    space_available.wait(lock, [this]() {
+        return static_cast<int>(queue.size()) < max_queued_frames || error != 0 || !thread.joinable();
+    });
+    if (error != 0 || !thread.joinable() || draining) {
+        lock.unlock();
+        release_frame(p_frame);
+        return false;
+    }
+    queue.push_back(std::move(p_frame));
+    Counters::add_queued_frames(1);
+    lock.unlock();
+    frame_available.notify_one();
+    return true;
+}
+
+void EncodeWorker::run() {
+    while (true) {
+        EncoderFrame frame;
+        bool failed = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            frame_available.wait(lock, [this]() {
+                return !queue.empty() || draining || discarding;
+            });
+            if (discarding || queue.empty()) {
+                return;
+            }
+            frame = std::move(queue.front());
+            queue.pop_front();
+            encoding = true;
+            failed = error != 0;
+        }
+        Counters::add_queued_frames(-1);
+        space_available.notify_one();
+
+        // Frames queued behind a failure are dropped; the stream is broken.
+        int result = failed ? error : 0;
+        if (!failed) {
+            GDFFMPEG_TRACE_SCOPE("encode_worker_frame");
+            result = frame.av_frame ? encoder->encode_avframe(frame.av_frame) :
+                    encoder->encode_frame(frame.data, frame.size, frame.width, frame.height, frame.format,
+                    frame.linesize_count > 0 ? frame.linesizes : nullptr, frame.linesize_count);
+            if (result == 0 && frame.after_encode) {
+                result = frame.after_encode();
+            }
+        }
+        release_frame(frame);
+
+        int64_t frame_index = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            encoding = false;
+            frame_index = next_frame_index++;
+            if (result != 0 && error == 0) {
+                error = result;
+            }
+        }
+        if (result != 0) {
+            // Unblock producers so they observe the failure.
+            space_available.notify_all();
+        }
+        if (frame_callback) {
+            frame_callback(frame_index, result);
+        }
+    }
+}
+
+int EncodeWorker::join() {
+    if (thread.joinable()) {
+        thread.join();
+    }
+
+    std::deque<EncoderFrame> leftover;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        leftover.swap(queue);
+    }
+    Counters::add_queued_frames(-static_cast<int64_t>(leftover.size()));
+    for (EncoderFrame &frame : leftover) {
+        release_frame(frame);
+    }
+    space_available.notify_all();
+    return error;
+}
+
+int EncodeWorker::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        draining = true;
+    }
+    frame_available.notify_one();
+    return join();
+}
+
+void EncodeWorker::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        discarding = true;
+    }
+    frame_available.notify_one();
+    join();
+}
+
+int EncodeWorker::get_queue_depth() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<int>(queue.size()) + (encoding ? 1 : 0);
+}
+
+} // namespace gdffmpeg
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+extern "C" {
+    #include <libavutil/frame.h>
+    #include <libavutil/pixfmt.h>
+}
+
+namespace gdffmpeg {
+
+class VideoEncoder;
+
+// One raw frame handed to the worker. The pixels are not copied: release()
+// runs on the worker once the frame has been scaled into the encoder, and
+// must keep p_data valid until then.
+struct EncoderFrame {
+    const uint8_t *data = nullptr;
+    int size = 0;
+    int width = 0;
+    int height = 0;
+    AVPixelFormat format = AV_PIX_FMT_NONE;
+    int linesizes[AV_NUM_DATA_POINTERS] = {};
+    int linesize_count = 0;
+    // A decoded frame to encode instead of data/size; kept alive by release()
+    // like the pixel pointer.
+    const AVFrame *av_frame = nullptr;
+    std::function<void()> release;
+    // Optional extra work run on the worker right after a successful encode,
+    // e.g. muxing the matching audio block. Non-zero fails like an encode error.
+    std::function<int()> after_encode;
+};
+
+// Runs VideoEncoder::encode_frame() on a dedicated thread fed by a bounded
+// queue. submit() blocks once max_queued_frames are waiting, which keeps
+// memory bounded when the codec is slower than the producer.
+class EncodeWorker {
+public:
+    // Called on the worker thread after each frame; p_error is the
+    // encode_frame() result (0 on success).
+    using FrameCallback = std::function<void(int64_t p_frame_index, int p_error)>;
+
+    static constexpr int DEFAULT_MAX_QUEUED_FRAMES = 8;
+
+    ~EncodeWorker();
+
+    // Both only take effect on the next start().
+    void set_max_queued_frames(int p_frames) { max_queued_frames = p_frames > 0 ? p_frames : 1; }
+    int get_max_queued_frames() const { return max_queued_frames; }
+    void set_frame_callback(const FrameCallback &p_callback) { frame_callback = p_callback; }
+
+    // p_encoder must outlive the worker and must not be touched by the caller
+    // until finish() or stop() returns.
+    void start(VideoEncoder *p_encoder);
+
+    // Returns false (and releases the frame) when the worker is not running
+    // or a previous frame failed.
+    bool submit(EncoderFrame &&p_frame);
+
+    // Encodes everything still queued, joins the thread and returns the first
+    // encode error (0 if none). The encoder itself is not finished.
+    int finish();
+
+    // Drops queued frames and joins the thread.
+    void stop();
+
+    bool is_running() const { return thread.joinable(); }
+
+    // Frames queued or currently being encoded.
+    int get_queue_depth() const;
+
+private:
+    VideoEncoder *encoder = nullptr;
+    FrameCallback frame_callback;
+    int max_queued_frames = DEFAULT_MAX_QUEUED_FRAMES;
+
+    std::thread thread;
+    mutable std::mutex mutex;
+    std::condition_variable frame_available;
+    std::condition_variable space_available;
+    std::deque<EncoderFrame> queue;
+    bool encoding = false;
+    bool draining = false;
+    bool discarding = false;
+    int error = 0;
+    int64_t next_frame_index = 0;
+
+    void run();
+    int join();
+    static void release_frame(EncoderFrame &p_frame);
+};
+
+} // namespace gdffmpeg
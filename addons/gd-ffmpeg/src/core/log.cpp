@@ -0,0 +1,36 @@
+#include "log.h"
+
+#include <atomic>
+#include <cstdio>
+
+extern "C" {
+    #include <libavutil/error.h>
+}
+
+namespace gdffmpeg {
+
+static void default_log_handler(const char *p_component, const std::string &p_message, bool p_is_error) {
+    std::fprintf(p_is_error ? stderr : stdout, "[%s] %s\n", p_component, p_message.c_str());
+}
+
+static std::atomic<LogHandler> log_handler{&default_log_handler};
+
+void set_log_handler(LogHandler p_handler) {
+    log_handler.store(p_handler ? p_handler : &default_log_handler);
+}
+
+void log_info(const char *p_component, const std::string &p_message) {
+    log_handler.load()(p_component, p_message, false);
+}
+
+void log_error(const char *p_component, const std::string &p_message) {
+    log_handler.load()(p_component, p_message, true);
+}
+
+std::string error_string(int p_err) {
+    char err_buf[AV_ERROR_MAX_STRING_SIZE];
+    av_strerror(p_err, err_buf, sizeof(err_buf));
+    return std::string(err_buf);
+}
+
+} // namespace gdffmpeg
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+namespace gdffmpeg {
+
+// Core code never talks to Godot directly; messages go through this hook so
+// the GDExtension can route them to the editor output and native tools to stderr.
+using LogHandler = void (*)(const char *p_component, const std::string &p_message, bool p_is_error);
+
+void set_log_handler(LogHandler p_handler);
+
+void log_info(const char *p_component, const std::string &p_message);
+void log_error(const char *p_component, const std::string &p_message);
+
+// av_strerror() as a std::string.
+std::string error_string(int p_err);
+
+} // namespace gdffmpeg
@@ -0,0 +1,91 @@
+#include "memory_io.h"
+
+#include <cstdio>
+#include <cstring>
+
+extern "C" {
+    #include <libavutil/error.h>
+    #include <libavutil/mem.h>
+}
+
+namespace gdffmpeg {
+
+MemoryReader::~MemoryReader() {
+    close();
+}
+
+AVIOContext *MemoryReader::open(const uint8_t *p_data, size_t p_size, int p_buffer_size) {
+    close();
+    data = p_data;
+    size = p_size;
+    position = 0;
+
+    uint8_t *io_buffer = static_cast<uint8_t *>(av_malloc(p_buffer_size));
+    if (!io_buffer) {
+        return nullptr;
+    }
+    context = avio_alloc_context(io_buffer, p_buffer_size, 0, this, &MemoryReader::read_packet, nullptr, &MemoryReader::seek);
+    if (!context) {
+        av_free(io_buffer);
+        return nullptr;
+    }
+    buffer_size = p_buffer_size;
+    return context;
+}
+
+void MemoryReader::close() {
+    if (context) {
+        av_freep(&context->buffer);
+        avio_context_free(&context);
+    }
+    data = nullptr;
+    size = 0;
+    position = 0;
+    buffer_size = 0;
+}
+
+int MemoryReader::read_packet(void *p_opaque, uint8_t *p_buf, int p_buf_size) {
+    MemoryReader *self = static_cast<MemoryReader *>(p_opaque);
+    if (!self) {
+        return AVERROR(EIO);
+    }
+    if (self->position >= self->size) {
+        return AVERROR_EOF;
+    }
+    const size_t remaining = self->size - self->position;
+    const int to_copy = remaining < static_cast<size_t>(p_buf_size) ? static_cast<int>(remaining) : p_buf_size;
+    std::memcpy(p_buf, self->data + self->position, to_copy);
+    self->position += to_copy;
+    return to_copy;
+}
+
+int64_t MemoryReader::seek(void *p_opaque, int64_t p_offset, int p_whence) {
+    MemoryReader *self = static_cast<MemoryReader *>(p_opaque);
+    if (!self) {
+        return AVERROR(EIO);
+    }
+
+    int64_t target = 0;
+    switch (p_whence & ~AVSEEK_FORCE) {
+        case AVSEEK_SIZE:
+            return static_cast<int64_t>(self->size);
+        case SEEK_SET:
+            target = p_offset;
+            break;
+        case SEEK_CUR:
+            target = static_cast<int64_t>(self->position) + p_offset;
+            break;
+        case SEEK_END:
+            target = static_cast<int64_t>(self->size) + p_offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    if (target < 0 || target > static_cast<int64_t>(self->size)) {
+        return AVERROR(EINVAL);
+    }
+    self->position = static_cast<size_t>(target);
+    return target;
+}
+
+} // namespace gdffmpeg
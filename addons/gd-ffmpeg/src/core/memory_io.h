@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+    #include <libavformat/avio.h>
+}
+
+namespace gdffmpeg {
+
+// Read-only, seekable AVIOContext over a caller-owned buffer. The buffer must
+// outlive the context; nothing is copied up front.
+class MemoryReader {
+public:
+    static constexpr int DEFAULT_BUFFER_SIZE = 32 * 1024;
+
+    ~MemoryReader();
+
+    // Returns nullptr on allocation failure.
+    AVIOContext *open(const uint8_t *p_data, size_t p_size, int p_buffer_size = DEFAULT_BUFFER_SIZE);
+    void close();
+
+    AVIOContext *get_context() const { return context; }
+    int get_buffer_size() const { return buffer_size; }
+
+private:
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    size_t position = 0;
+    int buffer_size = 0;
+    AVIOContext *context = nullptr;
+
+    static int read_packet(void *p_opaque, uint8_t *p_buf, int p_buf_size);
+    static int64_t seek(void *p_opaque, int64_t p_offset, int p_whence);
+};
+
+} // namespace gdffmpeg
@@ -0,0 +1,111 @@
+#include "movie_encoder.h"
+
+#include "log.h"
+#include "trace.h"
+
+#include <memory>
+
+namespace gdffmpeg {
+
+static const char *COMPONENT = "MovieWriterFFmpeg";
+
+MovieEncoder::~MovieEncoder() {
+    abort();
+}
+
+int MovieEncoder::begin(const std::string &p_path) {
+    abort();
+
+    audio_enabled = !audio_options.codec_name.empty() && audio_options.channels > 0;
+    if (audio_enabled) {
+        AudioEncoderOptions options = audio_options;
+        options.global_header = VideoEncoder::container_needs_global_header(p_path, video.get_config().muxer_name);
+        const int err = audio.setup(options);
+        if (err != 0) {
+            log_error(COMPONENT, "Audio encoder setup failed with code " + std::to_string(err));
+            return 1;
+        }
+    }
+
+    video.begin(p_path, nullptr);
+    if (audio_enabled) {
+        video.set_audio_stream(audio.get_codec_context());
+    }
+    worker.start(&video);
+    return 0;
+}
+
+PacketSink MovieEncoder::audio_sink() {
+    return [this](const AVPacket *p_packet) {
+        if (video.write_audio_packet(p_packet) != 0 && audio_error == 0) {
+            audio_error = 1;
+        }
+    };
+}
+
+int MovieEncoder::encode_audio(std::vector<float> &p_pcm) {
+    GDFFMPEG_TRACE_SCOPE("movie_audio_block");
+    pending_pcm.insert(pending_pcm.end(), p_pcm.begin(), p_pcm.end());
+
+    const size_t block = static_cast<size_t>(audio.get_frame_size()) * audio.get_channels();
+    const size_t ready = block > 0 ? pending_pcm.size() / block * block : 0;
+    if (ready == 0) {
+        return 0;
+    }
+    const int err = audio.encode(pending_pcm.data(), static_cast<int64_t>(ready), audio_sink());
+    pending_pcm.erase(pending_pcm.begin(), pending_pcm.begin() + ready);
+    return err != 0 ? err : audio_error;
+}
+
+bool MovieEncoder::submit(EncoderFrame &&p_video, std::vector<float> &&p_audio) {
+    if (audio_enabled && !p_audio.empty()) {
+        // std::function needs a copyable target, so the block travels in a
+        // shared_ptr rather than being copied per frame.
+        std::shared_ptr<std::vector<float>> block = std::make_shared<std::vector<float>>(std::move(p_audio));
+        p_video.after_encode = [this, block]() {
+            return encode_audio(*block);
+        };
+    }
+    return worker.submit(std::move(p_video));
+}
+
+int MovieEncoder::finish() {
+    if (!worker.is_running()) {
+        return 0;
+    }
+    int err = worker.finish();
+
+    if (audio_enabled && video.is_header_written()) {
+        // The trailing partial block may be shorter than frame_size; codecs
+        // accept that for the final frame.
+        if (!pending_pcm.empty()) {
+            const int audio_err = audio.encode(pending_pcm.data(), static_cast<int64_t>(pending_pcm.size()), audio_sink());
+            if (err == 0) {
+                err = audio_err;
+            }
+        }
+        audio.flush(audio_sink());
+        if (err == 0) {
+            err = audio_error;
+        }
+    }
+
+    if (video.is_initialized()) {
+        video.finish();
+    }
+    video.reset();
+    audio.close();
+    pending_pcm.clear();
+    audio_error = 0;
+    return err;
+}
+
+void MovieEncoder::abort() {
+    worker.stop();
+    video.reset();
+    audio.close();
+    pending_pcm.clear();
+    audio_error = 0;
+}
+
+} // namespace gdffmpeg
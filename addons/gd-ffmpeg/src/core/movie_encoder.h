@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "audio_encoder.h"
+#include "encode_worker.h"
+#include "video_encoder.h"
+
+namespace gdffmpeg {
+
+// Records a movie with one video and (optionally) one audio stream into a
+// single container. Both are encoded and muxed on an EncodeWorker, so
+// submit() only blocks when the queue is full.
+class MovieEncoder {
+public:
+    MovieEncoder() = default;
+    ~MovieEncoder();
+
+    MovieEncoder(const MovieEncoder &) = delete;
+    MovieEncoder &operator=(const MovieEncoder &) = delete;
+
+    // Both are read by begin(). Audio is disabled when codec_name is empty
+    // or channels is 0.
+    VideoEncoderConfig &get_video_config() { return video.get_config(); }
+    AudioEncoderOptions &get_audio_options() { return audio_options; }
+
+    void set_max_queued_frames(int p_frames) { worker.set_max_queued_frames(p_frames); }
+
+    // Opens the audio encoder and starts the worker; the video codec and the
+    // container are opened with the first frame. Returns 0 on success.
+    int begin(const std::string &p_path);
+
+    // Queues one video frame plus the interleaved float PCM captured during
+    // it. p_audio may hold any number of samples; leftovers are carried to
+    // the next frame so the codec always sees full frames.
+    bool submit(EncoderFrame &&p_video, std::vector<float> &&p_audio);
+
+    // Drains the queue, flushes both codecs, writes the trailer and closes
+    // the file. Returns the first error seen (0 if none).
+    int finish();
+
+    // Stops without writing a trailer.
+    void abort();
+
+    bool is_active() const { return worker.is_running(); }
+    int get_queue_depth() const { return worker.get_queue_depth(); }
+
+private:
+    VideoEncoder video;
+    AudioEncoder audio;
+    AudioEncoderOptions audio_options;
+    bool audio_enabled = false;
+    // Samples not yet forming a full codec frame; only touched by the worker
+    // while it runs.
+    std::vector<float> pending_pcm;
+    int audio_error = 0;
+    EncodeWorker worker;
+
+    int encode_audio(std::vector<float> &p_pcm);
+    PacketSink audio_sink();
+};
+
+} // namespace gdffmpeg
@@ -0,0 +1,301 @@
+#include "muxer.h"
+
+#include "log.h"
+#include "trace.h"
+
+#include <cstring>
+
+namespace gdffmpeg {
+
+static const char *COMPONENT = "FFmpegMuxer";
+
+static bool is_mov_family(const AVOutputFormat *p_format) {
+    static const char *const names[] = { "mp4", "mov", "ipod", "ismv", "3gp", "3g2", "psp", "f4v" };
+    for (const char *name : names) {
+        if (std::strcmp(p_format->name, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool is_matroska_family(const AVOutputFormat *p_format) {
+    return std::strcmp(p_format->name, "matroska") == 0 || std::strcmp(p_format->name, "webm") == 0;
+}
+
+Muxer::~Muxer() {
+    close();
+}
+
+void Muxer::close() {
+    if (format_ctx) {
+        if (format_ctx->pb && format_ctx->pb != custom_io) {
+            avio_closep(&format_ctx->pb);
+        }
+        format_ctx->pb = nullptr;
+        avformat_free_context(format_ctx);
+        format_ctx = nullptr;
+    }
+    if (custom_io) {
+        av_freep(&custom_io->buffer);
+        avio_context_free(&custom_io);
+    }
+    tracked_memory.release();
+    counted_io_position = 0;
+    header_written = false;
+    output_path.clear();
+    output_sink = nullptr;
+    options.clear();
+    live_output = false;
+    fragment_duration_ms = 0;
+    file_written_callback = nullptr;
+    default_io_open = nullptr;
+    default_io_close = nullptr;
+    written_files.clear();
+}
+
+int Muxer::open(const std::string &p_path, OutputSink *p_sink, const std::string &p_muxer_name, bool p_force_muxer_name) {
+    close();
+    output_path = p_path;
+    output_sink = p_sink;
+
+    if (!p_sink && !p_path.empty()) {
+        const char *format_name = p_force_muxer_name && !p_muxer_name.empty() ? p_muxer_name.c_str() : nullptr;
+        if (avformat_alloc_output_context2(&format_ctx, nullptr, format_name, p_path.c_str()) < 0) {
+            log_info(COMPONENT, "Failed to allocate output context from path");
+            return 1;
+        }
+    } else {
+        const AVOutputFormat *output_format = av_guess_format(p_muxer_name.c_str(), nullptr, nullptr);
+        if (!output_format) {
+            log_info(COMPONENT, "Could not guess muxer format: " + p_muxer_name);
+            return 2;
+        }
+        format_ctx = avformat_alloc_context();
+        if (format_ctx) {
+            format_ctx->oformat = output_format;
+        }
+    }
+
+    if (!format_ctx) {
+        log_info(COMPONENT, "Failed to create format context");
+        return 3;
+    }
+    return 0;
+}
+
+bool Muxer::needs_global_header() const {
+    return format_ctx && (format_ctx->oformat->flags & AVFMT_GLOBALHEADER);
+}
+
+AVStream *Muxer::add_stream(const AVCodecContext *p_codec_ctx) {
+    if (!format_ctx || header_written || !p_codec_ctx) {
+        return nullptr;
+    }
+    AVStream *stream = avformat_new_stream(format_ctx, nullptr);
+    if (!stream) {
+        log_info(COMPONENT, "Failed to create stream");
+        return nullptr;
+    }
+    if (avcodec_parameters_from_context(stream->codecpar, p_codec_ctx) < 0) {
+        log_info(COMPONENT, "Failed to copy codec parameters");
+        return nullptr;
+    }
+    stream->time_base = p_codec_ctx->time_base;
+    return stream;
+}
+
+AVStream *Muxer::add_stream(const AVCodecParameters *p_params, AVRational p_time_base) {
+    if (!format_ctx || header_written || !p_params) {
+        return nullptr;
+    }
+    AVStream *stream = avformat_new_stream(format_ctx, nullptr);
+    if (!stream) {
+        log_info(COMPONENT, "Failed to create stream");
+        return nullptr;
+    }
+    if (avcodec_parameters_copy(stream->codecpar, p_params) < 0) {
+        log_info(COMPONENT, "Failed to copy codec parameters");
+        return nullptr;
+    }
+    // A tag valid in the source container (e.g. Matroska's) can be rejected
+    // by the destination; 0 lets the muxer choose.
+    stream->codecpar->codec_tag = 0;
+    stream->time_base = p_time_base;
+    return stream;
+}
+
+int Muxer::write_header() {
+    if (!format_ctx) {
+        return 1;
+    }
+
+    const bool use_custom_io = output_sink || output_path.empty();
+    if (!use_custom_io) {
+        if (file_written_callback) {
+            // Nested muxers (HLS, DASH) inherit these along with opaque.
+            default_io_open = format_ctx->io_open;
+            default_io_close = format_ctx->io_close2;
+            format_ctx->opaque = this;
+            format_ctx->io_open = &Muxer::io_open_callback;
+            format_ctx->io_close2 = &Muxer::io_close_callback;
+        }
+        if (!(format_ctx->oformat->flags & AVFMT_NOFILE)) {
+            if (avio_open(&format_ctx->pb, output_path.c_str(), AVIO_FLAG_WRITE) < 0) {
+                log_info(COMPONENT, "Could not open output file");
+                return 2;
+            }
+        }
+    } else {
+        const int buffer_size = io_buffer_size;
+        uint8_t *custom_io_buffer = static_cast<uint8_t *>(av_malloc(buffer_size));
+        if (!custom_io_buffer) {
+            log_info(COMPONENT, "Failed to allocate custom IO buffer");
+            return 3;
+        }
+        custom_io = avio_alloc_context(custom_io_buffer, buffer_size, 1, this, nullptr, &Muxer::write_callback, nullptr);
+        if (!custom_io) {
+            av_free(custom_io_buffer);
+            log_info(COMPONENT, "Failed to allocate custom IO context");
+            return 4;
+        }
+        format_ctx->pb = custom_io;
+        format_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+        tracked_memory.add(buffer_size);
+        if (!live_output && is_mov_family(format_ctx->oformat)) {
+            log_info(COMPONENT, "Output is not seekable; writing fragmented " + std::string(format_ctx->oformat->name));
+            live_output = true;
+        }
+    }
+
+    AVDictionary *header_options = nullptr;
+    if (live_output) {
+        // Added first so explicit set_option() values override them.
+        add_live_options(&header_options);
+    }
+    for (const std::pair<std::string, std::string> &option : options) {
+        av_dict_set(&header_options, option.first.c_str(), option.second.c_str(), 0);
+    }
+    const int header_ret = avformat_write_header(format_ctx, &header_options);
+    if (header_options) {
+        // Whatever is left was not recognised by the muxer.
+        const AVDictionaryEntry *entry = nullptr;
+        while ((entry = av_dict_iterate(header_options, entry))) {
+            log_info(COMPONENT, std::string("Unused muxer option: ") + entry->key);
+        }
+        av_dict_free(&header_options);
+    }
+    if (header_ret < 0) {
+        log_info(COMPONENT, "Failed to write header");
+        return 5;
+    }
+    header_written = true;
+    count_written_bytes();
+    return 0;
+}
+
+void Muxer::add_live_options(AVDictionary **r_options) {
+    const AVOutputFormat *format = format_ctx->oformat;
+    if (is_mov_family(format)) {
+        av_dict_set(r_options, "movflags", "+frag_keyframe+empty_moov+default_base_moof", 0);
+        if (fragment_duration_ms > 0) {
+            av_dict_set_int(r_options, "frag_duration", static_cast<int64_t>(fragment_duration_ms) * 1000, 0);
+        }
+    } else if (is_matroska_family(format)) {
+        av_dict_set(r_options, "live", "1", 0);
+        if (fragment_duration_ms > 0) {
+            av_dict_set_int(r_options, "cluster_time_limit", fragment_duration_ms, 0);
+        }
+    } else {
+        log_info(COMPONENT, std::string("No live mode for ") + format->name + "; writing it as-is");
+        return;
+    }
+    // Hand every completed fragment to the output instead of waiting for
+    // the IO buffer to fill.
+    format_ctx->flush_packets = 1;
+}
+
+int Muxer::write_packet(AVPacket *p_packet, AVRational p_time_base, int p_stream_index) {
+    if (!header_written || p_stream_index < 0 || p_stream_index >= static_cast<int>(format_ctx->nb_streams)) {
+        av_packet_unref(p_packet);
+        return 1;
+    }
+    p_packet->stream_index = p_stream_index;
+    av_packet_rescale_ts(p_packet, p_time_base, format_ctx->streams[p_stream_index]->time_base);
+    const int write_ret = av_interleaved_write_frame(format_ctx, p_packet);
+    av_packet_unref(p_packet);
+    if (write_ret < 0) {
+        log_info(COMPONENT, "Failed to write frame");
+        return 2;
+    }
+    count_written_bytes();
+    return 0;
+}
+
+int Muxer::write_trailer() {
+    if (!header_written) {
+        return 1;
+    }
+    av_write_trailer(format_ctx);
+    if (format_ctx->pb) {
+        avio_flush(format_ctx->pb);
+    }
+    count_written_bytes();
+    return 0;
+}
+
+int Muxer::write_callback(void *p_opaque, const uint8_t *p_buf, int p_buf_size) {
+    GDFFMPEG_TRACE_SCOPE("write_callback");
+    Muxer *muxer = static_cast<Muxer *>(p_opaque);
+    if (!muxer || p_buf_size <= 0) {
+        return 0;
+    }
+    if (muxer->output_sink) {
+        muxer->output_sink->write(p_buf, p_buf_size);
+    }
+    return p_buf_size;
+}
+
+int Muxer::io_open_callback(AVFormatContext *p_ctx, AVIOContext **r_pb, const char *p_url, int p_flags, AVDictionary **p_options) {
+    Muxer *muxer = static_cast<Muxer *>(p_ctx->opaque);
+    const int ret = muxer->default_io_open(p_ctx, r_pb, p_url, p_flags, p_options);
+    if (ret >= 0 && (p_flags & AVIO_FLAG_WRITE) && *r_pb) {
+        muxer->written_files[*r_pb] = p_url;
+    }
+    return ret;
+}
+
+int Muxer::io_close_callback(AVFormatContext *p_ctx, AVIOContext *p_pb) {
+    Muxer *muxer = static_cast<Muxer *>(p_ctx->opaque);
+    std::string path;
+    auto it = muxer->written_files.find(p_pb);
+    if (it != muxer->written_files.end()) {
+        path = it->second;
+        muxer->written_files.erase(it);
+    }
+    const int ret = muxer->default_io_close(p_ctx, p_pb);
+    if (ret >= 0 && !path.empty() && muxer->file_written_callback) {
+        // Playlists are written to "<name>.tmp" and renamed over the old
+        // one right after this close.
+        static const std::string temp_suffix = ".tmp";
+        if (path.size() > temp_suffix.size() && path.compare(path.size() - temp_suffix.size(), temp_suffix.size(), temp_suffix) == 0) {
+            path.resize(path.size() - temp_suffix.size());
+        }
+        muxer->file_written_callback(path);
+    }
+    return ret;
+}
+
+void Muxer::count_written_bytes() {
+    if (!format_ctx || !format_ctx->pb) {
+        return;
+    }
+    // avio_tell() covers path and sink outputs alike.
+    const int64_t position = avio_tell(format_ctx->pb);
+    if (position > counted_io_position) {
+        Counters::add_bytes_written(position - counted_io_position);
+        counted_io_position = position;
+    }
+}
+
+} // namespace gdffmpeg
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavformat/avformat.h>
+}
+
+#include "counters.h"
+
+namespace gdffmpeg {
+
+// Destination for muxed bytes when the encoder is not writing to a path.
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+    virtual void write(const uint8_t *p_data, int p_size) = 0;
+};
+
+// Owns one output container: a file path, or an OutputSink fed through a
+// custom AVIOContext. Streams are added from opened codec contexts; packets
+// are rescaled from their codec time base and interleaved.
+class Muxer {
+public:
+    // Large enough that a typical keyframe leaves in a handful of
+    // write_callback calls rather than dozens.
+    static constexpr int DEFAULT_IO_BUFFER_SIZE = 64 * 1024;
+
+    using FileWrittenCallback = std::function<void(const std::string &p_path)>;
+
+    Muxer() = default;
+    ~Muxer();
+
+    Muxer(const Muxer &) = delete;
+    Muxer &operator=(const Muxer &) = delete;
+
+    // Allocates the container. With p_sink (or an empty path) the format is
+    // p_muxer_name, otherwise it is guessed from p_path unless
+    // p_force_muxer_name is set. Nothing is written until write_header().
+    // Returns 0 on success.
+    int open(const std::string &p_path, OutputSink *p_sink, const std::string &p_muxer_name, bool p_force_muxer_name = false);
+
+    // Muxer private option (e.g. "movflags"), passed to write_header(). Set
+    // after open(); close() forgets them.
+    void set_option(const std::string &p_key, const std::string &p_value) { options.emplace_back(p_key, p_value); }
+
+    // Streaming layout for output that is played while it is written:
+    // fragmented MP4 (empty moov, then one moof+mdat per fragment) or live
+    // Matroska/WebM clusters. Each fragment is flushed to the output as soon
+    // as it is complete, so the muxer buffers at most one fragment.
+    // p_fragment_ms caps a fragment's duration; 0 cuts only at video
+    // keyframes. MP4-family containers switch to this automatically when
+    // writing to an OutputSink, since they cannot finish a regular file
+    // without seeking. Set after open(); read by write_header().
+    void set_live_output(bool p_enabled, int p_fragment_ms = 0) {
+        live_output = p_enabled;
+        fragment_duration_ms = p_fragment_ms > 0 ? p_fragment_ms : 0;
+    }
+    bool is_live_output() const { return live_output; }
+
+    // Called with the path of every extra file the muxer writes and closes
+    // by itself, such as HLS/DASH segments and playlist updates. Runs on the
+    // muxing thread. Set before write_header(); path output only.
+    void set_file_written_callback(const FileWrittenCallback &p_callback) { file_written_callback = p_callback; }
+
+    // Size of the custom AVIO buffer used for OutputSink output. Read by
+    // write_header().
+    void set_io_buffer_size(int p_bytes) { io_buffer_size = p_bytes > 0 ? p_bytes : DEFAULT_IO_BUFFER_SIZE; }
+    int get_io_buffer_size() const { return io_buffer_size; }
+
+    // Whether codecs feeding this container must set AV_CODEC_FLAG_GLOBAL_HEADER.
+    bool needs_global_header() const;
+
+    // Adds a stream copying p_codec_ctx's parameters and time base. Returns
+    // nullptr on failure.
+    AVStream *add_stream(const AVCodecContext *p_codec_ctx);
+    // Same for stream copy: p_params usually come from a demuxer or a
+    // bitstream filter. The codec tag is cleared so the container picks its own.
+    AVStream *add_stream(const AVCodecParameters *p_params, AVRational p_time_base);
+
+    // Opens the file (or custom IO) and writes the container header.
+    int write_header();
+
+    // Rescales p_packet from p_time_base to the stream's and interleaves it.
+    // The packet is unreferenced afterwards. Returns 0 on success.
+    int write_packet(AVPacket *p_packet, AVRational p_time_base, int p_stream_index);
+
+    // Writes the trailer and flushes the IO. The container stays allocated
+    // until close().
+    int write_trailer();
+
+    void close();
+
+    bool is_open() const { return format_ctx != nullptr; }
+    bool is_header_written() const { return header_written; }
+    AVFormatContext *get_format_context() const { return format_ctx; }
+
+private:
+    std::string output_path;
+    OutputSink *output_sink = nullptr;
+    int io_buffer_size = DEFAULT_IO_BUFFER_SIZE;
+    std::vector<std::pair<std::string, std::string>> options;
+    bool live_output = false;
+    int fragment_duration_ms = 0;
+
+    FileWrittenCallback file_written_callback;
+    // libavformat's own io_open/io_close2, wrapped while the callback is set.
+    int (*default_io_open)(AVFormatContext *, AVIOContext **, const char *, int, AVDictionary **) = nullptr;
+    int (*default_io_close)(AVFormatContext *, AVIOContext *) = nullptr;
+    std::unordered_map<const AVIOContext *, std::string> written_files;
+
+    AVFormatContext *format_ctx = nullptr;
+    AVIOContext *custom_io = nullptr;
+    bool header_written = false;
+
+    // Last output position already reported to Counters::add_bytes_written.
+    int64_t counted_io_position = 0;
+    TrackedMemory tracked_memory;
+
+    void count_written_bytes();
+    void add_live_options(AVDictionary **r_options);
+    static int write_callback(void *p_opaque, const uint8_t *p_buf, int p_buf_size);
+    static int io_open_callback(AVFormatContext *p_ctx, AVIOContext **r_pb, const char *p_url, int p_flags, AVDictionary **p_options);
+    static int io_close_callback(AVFormatContext *p_ctx, AVIOContext *p_pb);
+};
+
+} // namespace gdffmpeg
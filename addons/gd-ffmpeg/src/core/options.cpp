@@ -0,0 +1,47 @@
+#include "options.h"
+
+#include "log.h"
+
+extern "C" {
+    #include <libavutil/opt.h>
+}
+
+namespace gdffmpeg {
+
+static void report_option_error(const char *p_component, const char *p_key, int p_err) {
+    if (p_err < 0) {
+        log_info(p_component, "Could not apply option '" + std::string(p_key) + "' (" + error_string(p_err) + ")");
+    }
+}
+
+void apply_codec_option(const char *p_component, AVCodecContext *p_ctx, const char *p_key, const char *p_value) {
+    if (!p_ctx) {
+        return;
+    }
+    report_option_error(p_component, p_key, av_opt_set(p_ctx, p_key, p_value, 0));
+    if (p_ctx->priv_data) {
+        report_option_error(p_component, p_key, av_opt_set(p_ctx->priv_data, p_key, p_value, 0));
+    }
+}
+
+void apply_codec_option_int(const char *p_component, AVCodecContext *p_ctx, const char *p_key, int64_t p_value) {
+    if (!p_ctx) {
+        return;
+    }
+    report_option_error(p_component, p_key, av_opt_set_int(p_ctx, p_key, p_value, 0));
+    if (p_ctx->priv_data) {
+        report_option_error(p_component, p_key, av_opt_set_int(p_ctx->priv_data, p_key, p_value, 0));
+    }
+}
+
+void apply_codec_option_double(const char *p_component, AVCodecContext *p_ctx, const char *p_key, double p_value) {
+    if (!p_ctx) {
+        return;
+    }
+    report_option_error(p_component, p_key, av_opt_set_double(p_ctx, p_key, p_value, 0));
+    if (p_ctx->priv_data) {
+        report_option_error(p_component, p_key, av_opt_set_double(p_ctx->priv_data, p_key, p_value, 0));
+    }
+}
+
+} // namespace gdffmpeg
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+}
+
+namespace gdffmpeg {
+
+// Sets an AVOption on the codec context and, when present, its private
+// (encoder specific) context. Failures are logged under p_component.
+void apply_codec_option(const char *p_component, AVCodecContext *p_ctx, const char *p_key, const char *p_value);
+void apply_codec_option_int(const char *p_component, AVCodecContext *p_ctx, const char *p_key, int64_t p_value);
+void apply_codec_option_double(const char *p_component, AVCodecContext *p_ctx, const char *p_key, double p_value);
+
+} // namespace gdffmpeg
@@ -0,0 +1,166 @@
+#include "packet_muxer.h"
+
+#include "log.h"
+#include "trace.h"
+
+namespace gdffmpeg {
+
+static const char *COMPONENT = "FFmpegPacketMuxer";
+
+PacketMuxer::~PacketMuxer() {
+    close();
+}
+
+int PacketMuxer::open(const std::string &p_path, OutputSink *p_sink, const std::string &p_muxer_name, bool p_force_muxer_name) {
+    close();
+    packets_written = 0;
+    return muxer.open(p_path, p_sink, p_muxer_name, p_force_muxer_name);
+}
+
+int PacketMuxer::add_stream() {
+    if (!muxer.is_open() || muxer.is_header_written()) {
+        return -1;
+    }
+    streams.emplace_back();
+    return static_cast<int>(streams.size()) - 1;
+}
+
+int PacketMuxer::write_packet(int p_stream, const AVPacket *p_packet, AVRational p_time_base, const AVCodecParameters *p_params) {
+    if (!muxer.is_open() || !p_packet || p_stream < 0 || p_stream >= static_cast<int>(streams.size())) {
+        return 1;
+    }
+    Stream &stream = streams[p_stream];
+    if (!stream.params) {
+        if (muxer.is_header_written()) {
+            // Left out of the header by finish(); nothing can be added now.
+            return 2;
+        }
+        if (!p_params) {
+            log_info(COMPONENT, "First packet of stream " + std::to_string(p_stream) + " carries no codec parameters");
+            return 3;
+        }
+        stream.params = avcodec_parameters_alloc();
+        if (!stream.params || avcodec_parameters_copy(stream.params, p_params) < 0) {
+            avcodec_parameters_free(&stream.params);
+            return 4;
+        }
+        stream.time_base = p_time_base;
+    }
+
+    // A reference, not a copy: encoder packets are ref-counted.
+    AVPacket *ref = av_packet_clone(p_packet);
+    if (!ref) {
+        return 5;
+    }
+
+    if (!muxer.is_header_written()) {
+        bool described = true;
+        for (const Stream &s : streams) {
+            described = described && s.params;
+        }
+        if (!described) {
+            tracked_memory.add(ref->size);
+            queued.push_back(QueuedPacket{ ref, p_time_base, p_stream });
+            return 0;
+        }
+        const int start_result = start_output();
+        if (start_result != 0) {
+            av_packet_free(&ref);
+            return start_result;
+        }
+    }
+
+    const int result = write_to_muxer(ref, p_time_base, p_stream);
+    av_packet_free(&ref);
+    return result;
+}
+
+int PacketMuxer::start_output() {
+    GDFFMPEG_TRACE_SCOPE("packet_muxer_header");
+    for (Stream &stream : streams) {
+        if (!stream.params) {
+            continue;
+        }
+        AVStream *output = muxer.add_stream(stream.params, stream.time_base);
+        if (!output) {
+            return 10;
+        }
+        stream.output_index = output->index;
+    }
+    if (muxer.write_header() != 0) {
+        return 11;
+    }
+
+    // The muxer interleaves by dts across streams, so the backlog can go in
+    // arrival order.
+    int result = 0;
+    for (QueuedPacket &packet : queued) {
+        if (result == 0) {
+            result = write_to_muxer(packet.packet, packet.time_base, packet.stream);
+        }
+        av_packet_free(&packet.packet);
+    }
+    queued.clear();
+    tracked_memory.release();
+    return result;
+}
+
+int PacketMuxer::write_to_muxer(AVPacket *p_packet, AVRational p_time_base, int p_stream) {
+    const int output_index = streams[p_stream].output_index;
+    if (output_index < 0) {
+        av_packet_unref(p_packet);
+        return 2;
+    }
+    if (muxer.write_packet(p_packet, p_time_base, output_index) != 0) {
+        return 12;
+    }
+    packets_written++;
+    return 0;
+}
+
+int PacketMuxer::finish() {
+    GDFFMPEG_TRACE_SCOPE("packet_muxer_finish");
+    if (!muxer.is_open()) {
+        return 1;
+    }
+    int result = 0;
+    if (!muxer.is_header_written()) {
+        int described = 0;
+        for (const Stream &stream : streams) {
+            described += stream.params ? 1 : 0;
+        }
+        if (described == 0) {
+            log_info(COMPONENT, "No packets were written");
+            result = 13;
+        } else {
+            if (described < static_cast<int>(streams.size())) {
+                log_info(COMPONENT, "Streams without packets are left out of the output");
+            }
+            result = start_output();
+        }
+    }
+    if (result == 0 && muxer.write_trailer() != 0) {
+        result = 14;
+    }
+    close();
+    return result;
+}
+
+void PacketMuxer::close() {
+    for (QueuedPacket &packet : queued) {
+        av_packet_free(&packet.packet);
+    }
+    queued.clear();
+    tracked_memory.release();
+    clear_streams();
+    muxer.close();
+}
+
+void PacketMuxer::clear_streams() {
+    for (Stream &stream : streams) {
+        avcodec_parameters_free(&stream.params);
+    }
+    streams.clear();
+}
+
+} // namespace gdffmpeg
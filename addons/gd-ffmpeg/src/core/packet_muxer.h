@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+}
+
+#include "counters.h"
+#include "muxer.h"
+
+namespace gdffmpeg {
+
+// Combines packets from independent encoders (e.g. one video and one audio
+// encoder) into a single container. Streams are declared before the first
+// packet; each one takes its codec parameters from the first packet it
+// receives. Packets are held back until every declared stream is described,
+// then the header is written and everything is interleaved by timestamp.
+// Not thread-safe: feed it from one thread.
+class PacketMuxer {
+public:
+    PacketMuxer() = default;
+    ~PacketMuxer();
+
+    PacketMuxer(const PacketMuxer &) = delete;
+    PacketMuxer &operator=(const PacketMuxer &) = delete;
+
+    // Same rules as Muxer::open(). Forgets the previous streams. Returns 0
+    // on success.
+    int open(const std::string &p_path, OutputSink *p_sink, const std::string &p_muxer_name, bool p_force_muxer_name = false);
+
+    // Live output, IO buffer size and muxer options go through here before
+    // the header is written.
+    Muxer &get_muxer() { return muxer; }
+
+    // Declares a stream and returns its index, or -1 once the header is
+    // written or before open().
+    int add_stream();
+    int get_stream_count() const { return static_cast<int>(streams.size()); }
+
+    // Whether the encoders must set AV_CODEC_FLAG_GLOBAL_HEADER.
+    bool needs_global_header() const { return muxer.needs_global_header(); }
+
+    // References p_packet, stamped in p_time_base, for p_stream. p_params
+    // describe the stream on its first packet and are ignored afterwards.
+    // Returns 0 on success.
+    int write_packet(int p_stream, const AVPacket *p_packet, AVRational p_time_base, const AVCodecParameters *p_params);
+
+    // Writes out anything still held back (streams that never received a
+    // packet are left out) and the trailer, then closes the container.
+    // Returns 0 on success.
+    int finish();
+
+    // Drops held-back packets and closes without a trailer.
+    void close();
+
+    bool is_open() const { return muxer.is_open(); }
+    bool is_header_written() const { return muxer.is_header_written(); }
+    // Packets muxed since open(); still valid after finish().
+    int64_t get_packets_written() const { return packets_written; }
+    // Packets waiting for a stream that has not received one yet.
+    int get_queued_packets() const { return static_cast<int>(queued.size()); }
+
+private:
+    struct Stream {
+        AVCodecParameters *params = nullptr;
+        AVRational time_base = AVRational{0, 1};
+        int output_index = -1;
+    };
+
+    struct QueuedPacket {
+        AVPacket *packet = nullptr;
+        AVRational time_base = AVRational{0, 1};
+        int stream = -1;
+    };
+
+    Muxer muxer;
+    std::vector<Stream> streams;
+    std::vector<QueuedPacket> queued;
+    int64_t packets_written = 0;
+    TrackedMemory tracked_memory;
+
+    int start_output();
+    int write_to_muxer(AVPacket *p_packet, AVRational p_time_base, int p_stream);
+    void clear_streams();
+};
+
+} // namespace gdffmpeg
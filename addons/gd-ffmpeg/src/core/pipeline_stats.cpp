@@ -0,0 +1,47 @@
+#include "pipeline_stats.h"
+
+#include <algorithm>
+
+namespace gdffmpeg {
+
+void PipelineStats::record(Stage p_stage, uint64_t p_usec) {
+    StageData &data = stages[p_stage];
+    data.count++;
+    data.total_usec += p_usec;
+
+    const uint32_t sample = p_usec > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(p_usec);
+    if (data.samples.size() < SAMPLE_WINDOW) {
+        data.samples.push_back(sample);
+    } else {
+        data.samples[data.next_sample] = sample;
+        data.next_sample = (data.next_sample + 1) % SAMPLE_WINDOW;
+    }
+}
+
+void PipelineStats::reset() {
+    for (int i = 0; i < STAGE_MAX; i++) {
+        stages[i] = StageData();
+    }
+}
+
+uint64_t PipelineStats::percentile(const StageData &p_data, double p_fraction) {
+    if (p_data.samples.empty()) {
+        return 0;
+    }
+    std::vector<uint32_t> sorted = p_data.samples;
+    const size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p_fraction * sorted.size()));
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted[index];
+}
+
+PipelineStats::Summary PipelineStats::summarize(Stage p_stage) const {
+    const StageData &data = stages[p_stage];
+    Summary summary;
+    summary.count = data.count;
+    summary.total_usec = data.total_usec;
+    summary.p50_usec = percentile(data, 0.50);
+    summary.p99_usec = percentile(data, 0.99);
+    return summary;
+}
+
+} // namespace gdffmpeg
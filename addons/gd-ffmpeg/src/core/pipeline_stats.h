@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gdffmpeg {
+
+// Per-stage timing counters for a decode pipeline. Stages are plain indices so
+// each decoder can name them to match the FFmpeg/Godot call they wrap.
+class PipelineStats {
+public:
+    enum Stage {
+        STAGE_DEMUX,
+        STAGE_SEND_PACKET,
+        STAGE_RECEIVE_FRAME,
+        STAGE_CONVERT,
+        STAGE_GODOT_ALLOC,
+        STAGE_MAX
+    };
+
+    struct Summary {
+        uint64_t count = 0;
+        uint64_t total_usec = 0;
+        uint64_t p50_usec = 0;
+        uint64_t p99_usec = 0;
+    };
+
+    // Newest samples kept per stage for the percentile estimates.
+    static constexpr size_t SAMPLE_WINDOW = 4096;
+
+    void set_enabled(bool p_enabled) { enabled = p_enabled; }
+    bool is_enabled() const { return enabled; }
+
+    void record(Stage p_stage, uint64_t p_usec);
+    void reset();
+    Summary summarize(Stage p_stage) const;
+
+private:
+    struct StageData {
+        uint64_t count = 0;
+        uint64_t total_usec = 0;
+        std::vector<uint32_t> samples;
+        size_t next_sample = 0;
+    };
+
+    bool enabled = false;
+    StageData stages[STAGE_MAX];
+
+    static uint64_t percentile(const StageData &p_data, double p_fraction);
+};
+
+// Times the enclosing scope into one stage. When collection is disabled the
+// clock is never read, so the only cost is the branch on is_enabled().
+class StageTimer {
+public:
+    StageTimer(PipelineStats &p_stats, PipelineStats::Stage p_stage) :
+            stats(p_stats.is_enabled() ? &p_stats : nullptr), stage(p_stage) {
+        if (stats) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~StageTimer() {
+        if (stats) {
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            stats->record(stage, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+        }
+    }
+
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+
+private:
+    PipelineStats *stats;
+    PipelineStats::Stage stage;
+    std::chrono::steady_clock::time_point start;
+};
+
+} // namespace gdffmpeg
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <functional>
+
+namespace gdffmpeg {
+
+// Receives how much of a job is done, in [0, 1]. Called on the thread doing
+// the work.
+using ProgressCallback = std::function<void(double p_progress)>;
+
+// Forwards progress to a callback in whole-percent steps, so a long job
+// reports about a hundred times rather than once per frame.
+class ProgressReporter {
+public:
+    explicit ProgressReporter(const ProgressCallback &p_callback) :
+            callback(p_callback) {}
+
+    // p_total <= 0 (unknown duration) reports nothing until finish().
+    void update(double p_position, double p_total) {
+        if (!callback || p_total <= 0.0) {
+            return;
+        }
+        double progress = p_position / p_total;
+        progress = progress < 0.0 ? 0.0 : (progress > 1.0 ? 1.0 : progress);
+        const int percent = static_cast<int>(progress * 100.0);
+        if (percent > last_percent) {
+            last_percent = percent;
+            callback(progress);
+        }
+    }
+
+    void finish() {
+        if (callback && last_percent < 100) {
+            last_percent = 100;
+            callback(1.0);
+        }
+    }
+
+private:
+    ProgressCallback callback;
+    int last_percent = -1;
+};
+
+} // namespace gdffmpeg
@@ -0,0 +1,229 @@
+#include "remuxer.h"
+
+#include "log.h"
+#include "trace.h"
+
+namespace gdffmpeg {
+
+static const char *COMPONENT = "FFmpegRemuxer";
+
+static bool is_copyable_type(AVMediaType p_type) {
+    return p_type == AVMEDIA_TYPE_VIDEO || p_type == AVMEDIA_TYPE_AUDIO || p_type == AVMEDIA_TYPE_SUBTITLE;
+}
+
+Remuxer::~Remuxer() {
+    close();
+}
+
+void Remuxer::close() {
+    for (OutputStream &output : outputs) {
+        av_bsf_free(&output.bsf);
+    }
+    outputs.clear();
+    av_packet_free(&packet);
+    av_packet_free(&filtered);
+    muxer.close();
+    if (input_ctx) {
+        avformat_close_input(&input_ctx);
+    }
+}
+
+int Remuxer::probe(const std::string &p_path, std::vector<StreamInfo> &p_streams) {
+    p_streams.clear();
+    AVFormatContext *ctx = nullptr;
+    if (avformat_open_input(&ctx, p_path.c_str(), nullptr, nullptr) < 0) {
+        log_info(COMPONENT, "Failed to open input file: " + p_path);
+        return 1;
+    }
+    if (avformat_find_stream_info(ctx, nullptr) < 0) {
+        avformat_close_input(&ctx);
+        log_info(COMPONENT, "Failed to find stream info");
+        return 2;
+    }
+    for (unsigned int i = 0; i < ctx->nb_streams; i++) {
+        const AVStream *stream = ctx->streams[i];
+        StreamInfo info;
+        info.index = static_cast<int>(i);
+        info.type = stream->codecpar->codec_type;
+        info.codec_name = avcodec_get_name(stream->codecpar->codec_id);
+        info.time_base = stream->time_base;
+        info.duration = stream->duration;
+        p_streams.push_back(info);
+    }
+    avformat_close_input(&ctx);
+    return 0;
+}
+
+int Remuxer::open_output(const std::string &p_output, OutputSink *p_sink) {
+    if (muxer.open(p_output, p_sink, muxer_name, true) != 0) {
+        return 1;
+    }
+    for (const std::pair<std::string, std::string> &option : muxer_options) {
+        muxer.set_option(option.first, option.second);
+    }
+    return 0;
+}
+
+int Remuxer::add_output(AVStream *p_input_stream) {
+    OutputStream &output = outputs[p_input_stream->index];
+    const AVCodecParameters *params = p_input_stream->codecpar;
+    output.time_base = p_input_stream->time_base;
+
+    std::map<int, std::string>::const_iterator filter = bitstream_filters.find(p_input_stream->index);
+    if (filter == bitstream_filters.end()) {
+        filter = bitstream_filters.find(-1);
+    }
+    if (filter != bitstream_filters.end() && !filter->second.empty()) {
+        if (av_bsf_list_parse_str(filter->second.c_str(), &output.bsf) < 0) {
+            log_info(COMPONENT, "Invalid bitstream filter: " + filter->second);
+            return 1;
+        }
+        if (avcodec_parameters_copy(output.bsf->par_in, params) < 0) {
+            return 2;
+        }
+        output.bsf->time_base_in = p_input_stream->time_base;
+        if (av_bsf_init(output.bsf) < 0) {
+            log_info(COMPONENT, "Failed to initialise bitstream filter: " + filter->second);
+            return 3;
+        }
+        params = output.bsf->par_out;
+        output.time_base = output.bsf->time_base_out;
+    }
+
+    AVStream *stream = muxer.add_stream(params, output.time_base);
+    if (!stream) {
+        return 4;
+    }
+    stream->disposition = p_input_stream->disposition;
+    av_dict_copy(&stream->metadata, p_input_stream->metadata, 0);
+    output.index = stream->index;
+    return 0;
+}
+
+int Remuxer::write(OutputStream &p_output, AVPacket *p_packet) {
+    p_packet->pos = -1;
+    if (!p_output.bsf) {
+        packets_copied++;
+        return muxer.write_packet(p_packet, p_output.time_base, p_output.index);
+    }
+    // A null packet flushes the filter.
+    if (av_bsf_send_packet(p_output.bsf, p_packet && (p_packet->data || p_packet->side_data_elems) ? p_packet : nullptr) < 0) {
+        av_packet_unref(p_packet);
+        log_info(COMPONENT, "Bitstream filter rejected a packet");
+        return 1;
+    }
+    while (true) {
+        const int ret = av_bsf_receive_packet(p_output.bsf, filtered);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            return 0;
+        }
+        if (ret < 0) {
+            log_info(COMPONENT, "Bitstream filter failed");
+            return 2;
+        }
+        packets_copied++;
+        if (muxer.write_packet(filtered, p_output.time_base, p_output.index) != 0) {
+            return 3;
+        }
+    }
+}
+
+int Remuxer::flush_filters() {
+    for (OutputStream &output : outputs) {
+        if (output.bsf && output.index >= 0) {
+            av_packet_unref(packet);
+            if (write(output, packet) != 0) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int Remuxer::remux(const std::string &p_input, const std::string &p_output, OutputSink *p_sink) {
+    GDFFMPEG_TRACE_SCOPE("remux");
+    close();
+    packets_copied = 0;
+
+    if (avformat_open_input(&input_ctx, p_input.c_str(), nullptr, nullptr) < 0) {
+        log_info(COMPONENT, "Failed to open input file: " + p_input);
+        return 1;
+    }
+    if (avformat_find_stream_info(input_ctx, nullptr) < 0) {
+        log_info(COMPONENT, "Failed to find stream info");
+        close();
+        return 2;
+    }
+
+    std::vector<int> order = selected_streams;
+    if (order.empty()) {
+        for (unsigned int i = 0; i < input_ctx->nb_streams; i++) {
+            if (is_copyable_type(input_ctx->streams[i]->codecpar->codec_type)) {
+                order.push_back(static_cast<int>(i));
+            }
+        }
+    }
+    if (order.empty()) {
+        log_info(COMPONENT, "No streams to copy");
+        close();
+        return 3;
+    }
+
+    if (open_output(p_output, p_sink) != 0) {
+        close();
+        return 4;
+    }
+    outputs.assign(input_ctx->nb_streams, OutputStream());
+    for (int index : order) {
+        if (index < 0 || index >= static_cast<int>(input_ctx->nb_streams) || outputs[index].index >= 0) {
+            log_info(COMPONENT, "Invalid or repeated stream index: " + std::to_string(index));
+            close();
+            return 5;
+        }
+        if (add_output(input_ctx->streams[index]) != 0) {
+            close();
+            return 5;
+        }
+    }
+    // Unselected streams are skipped by the demuxer as well.
+    for (unsigned int i = 0; i < input_ctx->nb_streams; i++) {
+        if (outputs[i].index < 0) {
+            input_ctx->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+
+    packet = av_packet_alloc();
+    filtered = av_packet_alloc();
+    if (!packet || !filtered || muxer.write_header() != 0) {
+        close();
+        return 6;
+    }
+
+    int result = 0;
+    int read_ret = 0;
+    while ((read_ret = av_read_frame(input_ctx, packet)) >= 0) {
+        if (packet->stream_index < 0 || packet->stream_index >= static_cast<int>(outputs.size()) || outputs[packet->stream_index].index < 0) {
+            av_packet_unref(packet);
+            continue;
+        }
+        if (write(outputs[packet->stream_index], packet) != 0) {
+            log_info(COMPONENT, "Failed to copy packet");
+            result = 7;
+            break;
+        }
+    }
+    if (result == 0 && read_ret != AVERROR_EOF) {
+        log_info(COMPONENT, "Failed to read input");
+        result = 8;
+    }
+    if (result == 0 && flush_filters() != 0) {
+        result = 7;
+    }
+    if (result == 0 && muxer.write_trailer() != 0) {
+        result = 9;
+    }
+    close();
+    return result;
+}
+
+} // namespace gdffmpeg
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+extern "C" {
+    #include <libavcodec/bsf.h>
+    #include <libavformat/avformat.h>
+}
+
+#include "muxer.h"
+
+namespace gdffmpeg {
+
+// Summary of one input stream, for picking what to copy.
+struct StreamInfo {
+    int index = -1;
+    AVMediaType type = AVMEDIA_TYPE_UNKNOWN;
+    std::string codec_name;
+    AVRational time_base = AVRational{0, 1};
+    // In time_base units; AV_NOPTS_VALUE when unknown.
+    int64_t duration = AV_NOPTS_VALUE;
+};
+
+// Copies packets from one container into another without decoding them,
+// optionally through bitstream filters. Throughput is bounded by IO, not by
+// any codec.
+class Remuxer {
+public:
+    Remuxer() = default;
+    ~Remuxer();
+
+    Remuxer(const Remuxer &) = delete;
+    Remuxer &operator=(const Remuxer &) = delete;
+
+    // Input stream indices to copy, in output order. Empty copies every
+    // video, audio and subtitle stream.
+    void set_streams(const std::vector<int> &p_indices) { selected_streams = p_indices; }
+
+    // Bitstream filter chain applied to input stream p_stream, or to every
+    // stream without its own chain when p_stream is -1. Uses
+    // av_bsf_list_parse_str() syntax, e.g. "h264_mp4toannexb" or
+    // "aac_adtstoasc". Muxers insert the usual conversions on their own; this
+    // is for anything beyond that.
+    void set_bitstream_filter(int p_stream, const std::string &p_filters) { bitstream_filters[p_stream] = p_filters; }
+    void clear_bitstream_filters() { bitstream_filters.clear(); }
+
+    // Output format; required for OutputSink output, otherwise overrides the
+    // guess from the path's extension (e.g. "mp4" for a ".m4s" path).
+    void set_muxer_name(const std::string &p_name) { muxer_name = p_name; }
+    void set_muxer_option(const std::string &p_key, const std::string &p_value) { muxer_options.emplace_back(p_key, p_value); }
+    void clear_muxer_options() { muxer_options.clear(); }
+
+    // Returns 0 on success.
+    int remux(const std::string &p_input, const std::string &p_output, OutputSink *p_sink = nullptr);
+
+    int64_t get_packets_copied() const { return packets_copied; }
+
+    // Fills p_streams with the streams of p_path. Returns 0 on success.
+    static int probe(const std::string &p_path, std::vector<StreamInfo> &p_streams);
+
+private:
+    struct OutputStream {
+        int index = -1;
+        AVRational time_base = AVRational{0, 1};
+        AVBSFContext *bsf = nullptr;
+    };
+
+    std::vector<int> selected_streams;
+    std::map<int, std::string> bitstream_filters;
+    std::string muxer_name;
+    std::vector<std::pair<std::string, std::string>> muxer_options;
+
+    AVFormatContext *input_ctx = nullptr;
+    Muxer muxer;
+    // Indexed by input stream; index -1 means the stream is dropped.
+    std::vector<OutputStream> outputs;
+    AVPacket *packet = nullptr;
+    AVPacket *filtered = nullptr;
+    int64_t packets_copied = 0;
+
+    int open_output(const std::string &p_output, OutputSink *p_sink);
+    int add_output(AVStream *p_input_stream);
+    int write(OutputStream &p_output, AVPacket *p_packet);
+    int flush_filters();
+    void close();
+};
+
+} // namespace gdffmpeg
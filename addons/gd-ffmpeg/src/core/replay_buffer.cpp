@@ -0,0 +1,190 @@
+#include "replay_buffer.h"
+
+#include "log.h"
+#include "muxer.h"
+#include "trace.h"
+
+#include <algorithm>
+
+namespace gdffmpeg {
+
+static const char *COMPONENT = "FFmpegReplayBuffer";
+
+ReplayBuffer::~ReplayBuffer() {
+    clear();
+}
+
+void ReplayBuffer::configure(double p_seconds, int64_t p_max_bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    max_seconds = p_seconds > 0.0 ? p_seconds : 0.0;
+    max_bytes = p_max_bytes > 0 ? p_max_bytes : 0;
+}
+
+int ReplayBuffer::set_stream(const AVCodecContext *p_codec_ctx) {
+    if (!p_codec_ctx) {
+        return 1;
+    }
+    AVCodecParameters *copy = avcodec_parameters_alloc();
+    if (!copy || avcodec_parameters_from_context(copy, p_codec_ctx) < 0) {
+        avcodec_parameters_free(&copy);
+        log_info(COMPONENT, "Failed to copy codec parameters");
+        return 2;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    avcodec_parameters_free(&params);
+    params = copy;
+    time_base = p_codec_ctx->time_base;
+    return 0;
+}
+
+bool ReplayBuffer::has_stream() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return params != nullptr;
+}
+
+void ReplayBuffer::push(const AVPacket *p_packet) {
+    if (!p_packet || p_packet->pts == AV_NOPTS_VALUE) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    const bool keyframe = (p_packet->flags & AV_PKT_FLAG_KEY) != 0;
+    if (gops.empty() && !keyframe) {
+        return;
+    }
+    AVPacket *ref = av_packet_clone(p_packet);
+    if (!ref) {
+        return;
+    }
+    if (keyframe) {
+        gops.emplace_back();
+        gops.back().start_pts = ref->pts;
+        gops.back().end_pts = ref->pts;
+    }
+    Gop &gop = gops.back();
+    gop.packets.push_back(ref);
+    gop.start_pts = std::min(gop.start_pts, ref->pts);
+    gop.end_pts = std::max(gop.end_pts, ref->pts + std::max<int64_t>(ref->duration, 0));
+    gop.bytes += ref->size;
+    total_bytes += ref->size;
+    tracked_memory.add(ref->size);
+    if (keyframe) {
+        trim();
+    }
+}
+
+void ReplayBuffer::drop_front() {
+    Gop &gop = gops.front();
+    for (AVPacket *packet : gop.packets) {
+        av_packet_free(&packet);
+    }
+    total_bytes -= gop.bytes;
+    tracked_memory.add(-gop.bytes);
+    gops.pop_front();
+}
+
+void ReplayBuffer::trim() {
+    // Only whole GOPs before the newest one can go.
+    while (gops.size() > 1) {
+        const double without_front = static_cast<double>(gops.back().end_pts - gops[1].start_pts) * av_q2d(time_base);
+        const bool too_long = without_front >= max_seconds;
+        const bool too_big = max_bytes > 0 && total_bytes > max_bytes;
+        if (!too_long && !too_big) {
+            break;
+        }
+        drop_front();
+    }
+}
+
+double ReplayBuffer::span_seconds() const {
+    if (gops.empty() || time_base.den == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(gops.back().end_pts - gops.front().start_pts) * av_q2d(time_base);
+}
+
+void ReplayBuffer::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    while (!gops.empty()) {
+        drop_front();
+    }
+    avcodec_parameters_free(&params);
+    time_base = AVRational{0, 1};
+}
+
+double ReplayBuffer::get_buffered_seconds() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return span_seconds();
+}
+
+int64_t ReplayBuffer::get_buffered_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return total_bytes;
+}
+
+int ReplayBuffer::save(const std::string &p_path, const std::string &p_muxer_name) const {
+    GDFFMPEG_TRACE_SCOPE("save_replay");
+    // Take references under the lock and mux without it, so the encoder
+    // keeps pushing while the file is written.
+    std::vector<AVPacket *> packets;
+    AVCodecParameters *stream_params = avcodec_parameters_alloc();
+    AVRational stream_time_base;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!params || gops.empty()) {
+            avcodec_parameters_free(&stream_params);
+            log_info(COMPONENT, "Nothing buffered to save");
+            return 1;
+        }
+        if (!stream_params || avcodec_parameters_copy(stream_params, params) < 0) {
+            avcodec_parameters_free(&stream_params);
+            return 2;
+        }
+        stream_time_base = time_base;
+        for (const Gop &gop : gops) {
+            for (const AVPacket *packet : gop.packets) {
+                AVPacket *ref = av_packet_clone(packet);
+                if (ref) {
+                    packets.push_back(ref);
+                }
+            }
+        }
+    }
+
+    Muxer muxer;
+    int result = 0;
+    AVStream *stream = nullptr;
+    if (muxer.open(p_path, nullptr, p_muxer_name, !p_muxer_name.empty()) != 0) {
+        result = 3;
+    } else if (!(stream = muxer.add_stream(stream_params, stream_time_base))) {
+        result = 4;
+    } else if (muxer.write_header() != 0) {
+        result = 5;
+    }
+
+    // The first packet is a keyframe in decode order; starting its dts at
+    // zero keeps every timestamp non-negative.
+    const int64_t offset = packets.front()->dts != AV_NOPTS_VALUE ? packets.front()->dts : packets.front()->pts;
+    for (AVPacket *packet : packets) {
+        if (result == 0) {
+            packet->pts -= offset;
+            if (packet->dts != AV_NOPTS_VALUE) {
+                packet->dts -= offset;
+            }
+            if (muxer.write_packet(packet, stream_time_base, stream->index) != 0) {
+                result = 6;
+            }
+        }
+        av_packet_free(&packet);
+    }
+    if (result == 0 && muxer.write_trailer() != 0) {
+        result = 7;
+    }
+    muxer.close();
+    avcodec_parameters_free(&stream_params);
+    if (result != 0) {
+        log_info(COMPONENT, "Failed to save replay to " + p_path + ": " + std::to_string(result));
+    }
+    return result;
+}
+
+} // namespace gdffmpeg
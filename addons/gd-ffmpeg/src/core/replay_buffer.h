@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+}
+
+#include "counters.h"
+
+namespace gdffmpeg {
+
+// Rolling window of the most recent encoded packets of one stream, kept as
+// whole GOPs so the oldest data can be dropped without breaking decoding.
+// save() muxes the window into a file by stream copy. push() and save()
+// may run on different threads.
+class ReplayBuffer {
+public:
+    ReplayBuffer() = default;
+    ~ReplayBuffer();
+
+    ReplayBuffer(const ReplayBuffer &) = delete;
+    ReplayBuffer &operator=(const ReplayBuffer &) = delete;
+
+    // Keeps at least p_seconds (when available), dropping the oldest GOP
+    // once the rest still covers it. p_max_bytes caps the payload; 0 means
+    // no cap. The newest GOP is always kept. Applies from the next push().
+    void configure(double p_seconds, int64_t p_max_bytes);
+
+    // Copies the parameters and time base save() writes the stream with.
+    // Returns 0 on success.
+    int set_stream(const AVCodecContext *p_codec_ctx);
+    bool has_stream() const;
+
+    // References p_packet, stamped in the set_stream() time base. Packets
+    // before the first keyframe are dropped.
+    void push(const AVPacket *p_packet);
+
+    // Drops every packet and the stream description.
+    void clear();
+
+    // Writes the buffered GOPs to p_path, timestamps starting at zero. The
+    // container comes from the extension unless p_muxer_name is given.
+    // Returns 0 on success.
+    int save(const std::string &p_path, const std::string &p_muxer_name = std::string()) const;
+
+    double get_buffered_seconds() const;
+    int64_t get_buffered_bytes() const;
+
+private:
+    struct Gop {
+        std::vector<AVPacket *> packets;
+        int64_t start_pts = 0;
+        int64_t end_pts = 0;
+        int64_t bytes = 0;
+    };
+
+    mutable std::mutex mutex;
+    std::deque<Gop> gops;
+    AVCodecParameters *params = nullptr;
+    AVRational time_base = AVRational{0, 1};
+    double max_seconds = 30.0;
+    int64_t max_bytes = 0;
+    int64_t total_bytes = 0;
+    TrackedMemory tracked_memory;
+
+    void drop_front();
+    void trim();
+    double span_seconds() const;
+};
+
+} // namespace gdffmpeg
@@ -0,0 +1,144 @@
+#include "segmented_encoder.h"
+
+#include "log.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+namespace gdffmpeg {
+
+static const char *COMPONENT = "FFmpegVideoEncoder";
+
+namespace {
+
+struct Segment {
+    int64_t first_frame = 0;
+    int64_t frame_count = 0;
+    VideoEncoder encoder;
+    std::vector<AVPacket *> packets;
+    int result = 0;
+    std::thread thread;
+
+    void free_packets() {
+        for (AVPacket *packet : packets) {
+            av_packet_free(&packet);
+        }
+        packets.clear();
+    }
+};
+
+} // namespace
+
+int SegmentedEncoder::encode(const std::vector<EncoderFrame> &p_frames, const std::string &p_path, OutputSink *p_sink) {
+    GDFFMPEG_TRACE_SCOPE("segmented_encode");
+    if (p_frames.empty()) {
+        log_info(COMPONENT, "No frames provided");
+        return 1;
+    }
+
+    VideoEncoderConfig segment_config = config;
+    if (segment_config.width <= 0 || segment_config.height <= 0) {
+        segment_config.width = p_frames[0].width;
+        segment_config.height = p_frames[0].height;
+    }
+
+    const int hardware_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    const int64_t total_frames = static_cast<int64_t>(p_frames.size());
+    const int64_t gop = std::max(1, config.keyframe_interval);
+    const int64_t gop_count = (total_frames + gop - 1) / gop;
+    const int64_t wanted = std::min<int64_t>(thread_count > 0 ? thread_count : hardware_threads, gop_count);
+    const int64_t gops_per_segment = (gop_count + wanted - 1) / wanted;
+    const int64_t segment_count = (gop_count + gops_per_segment - 1) / gops_per_segment;
+    if (segment_config.thread_count <= 0) {
+        // Split the cores between the encoders instead of letting each codec
+        // size its own pool for the whole machine.
+        segment_config.thread_count = std::max<int>(1, hardware_threads / static_cast<int>(segment_count));
+    }
+
+    Muxer muxer;
+    if (muxer.open(p_path, p_sink, config.muxer_name) != 0) {
+        return 2;
+    }
+    muxer.set_io_buffer_size(config.io_buffer_size);
+    muxer.set_live_output(config.live_output, config.fragment_duration_ms);
+    const bool global_header = muxer.needs_global_header();
+
+    std::vector<std::unique_ptr<Segment>> segments;
+    for (int64_t k = 0; k < segment_count; k++) {
+        std::unique_ptr<Segment> segment = std::make_unique<Segment>();
+        segment->first_frame = k * gops_per_segment * gop;
+        segment->frame_count = std::min(gops_per_segment * gop, total_frames - segment->first_frame);
+        segment->encoder.get_config() = segment_config;
+        Segment *raw = segment.get();
+        segment->encoder.set_packet_sink([raw](const AVPacket *p_packet) {
+            if (AVPacket *copy = av_packet_clone(p_packet)) {
+                raw->packets.push_back(copy);
+            }
+        });
+        segment->thread = std::thread([raw, &p_frames, global_header]() {
+            GDFFMPEG_TRACE_SCOPE("segment_encode");
+            raw->encoder.begin_packets(global_header);
+            for (int64_t i = 0; i < raw->frame_count && raw->result == 0; i++) {
+                const EncoderFrame &frame = p_frames[static_cast<size_t>(raw->first_frame + i)];
+                raw->result = frame.av_frame ? raw->encoder.encode_avframe(frame.av_frame) :
+                        raw->encoder.encode_frame(frame.data, frame.size, frame.width, frame.height, frame.format,
+                        frame.linesize_count > 0 ? frame.linesizes : nullptr, frame.linesize_count);
+            }
+            if (raw->result == 0) {
+                raw->result = raw->encoder.finish();
+            }
+        });
+        segments.push_back(std::move(segment));
+    }
+
+    // Segments are muxed in order as they finish, so later ones keep
+    // encoding while earlier packets are written and freed.
+    const AVRational time_base = get_time_base();
+    AVStream *stream = nullptr;
+    int result = 0;
+    for (std::unique_ptr<Segment> &segment : segments) {
+        segment->thread.join();
+        if (result == 0 && segment->result != 0) {
+            log_info(COMPONENT, "Segment starting at frame " + std::to_string(segment->first_frame) + " failed");
+            result = 3;
+        }
+        if (result == 0 && !stream) {
+            stream = muxer.add_stream(segment->encoder.get_codec_context());
+            if (!stream || muxer.write_header() != 0) {
+                result = 4;
+            }
+        }
+        if (result == 0) {
+            GDFFMPEG_TRACE_SCOPE("segment_mux");
+            muxing_codec_ctx = segment->encoder.get_codec_context();
+            for (AVPacket *packet : segment->packets) {
+                if (packet->pts != AV_NOPTS_VALUE) {
+                    packet->pts += segment->first_frame;
+                }
+                if (packet->dts != AV_NOPTS_VALUE) {
+                    packet->dts += segment->first_frame;
+                }
+                if (packet_sink) {
+                    packet_sink(packet);
+                }
+                if (muxer.write_packet(packet, time_base, stream->index) != 0) {
+                    result = 5;
+                    break;
+                }
+            }
+        }
+        muxing_codec_ctx = nullptr;
+        segment->free_packets();
+        segment->encoder.reset();
+    }
+
+    if (result == 0) {
+        muxer.write_trailer();
+    }
+    muxer.close();
+    return result;
+}
+
+} // namespace gdffmpeg
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+#include "encode_worker.h"
+#include "video_encoder.h"
+
+namespace gdffmpeg {
+
+// Encodes a complete frame sequence in parallel. The frames are cut into
+// runs of whole GOPs, each run is encoded by its own VideoEncoder on its own
+// thread, and the packets are muxed in order with their timestamps shifted
+// to the run's first frame. Every run starts on a keyframe, so the joined
+// bitstream decodes like a single encode with the same keyframe interval.
+class SegmentedEncoder {
+public:
+    // keyframe_interval sets the cut granularity. width/height default to
+    // the first frame's size so every segment scales the same way.
+    VideoEncoderConfig &get_config() { return config; }
+
+    // Segments encoded at once; 0 uses std::thread::hardware_concurrency().
+    void set_thread_count(int p_threads) { thread_count = p_threads; }
+
+    // Called on the calling thread with every packet, timestamps already
+    // offset (codec time base), in the order they are muxed.
+    void set_packet_sink(const PacketSink &p_sink) { packet_sink = p_sink; }
+
+    // p_frames are read concurrently from several threads and must stay
+    // valid for the whole call; their release callbacks are not used.
+    // Muxes into p_path, or p_sink when non-null. Returns 0 on success.
+    int encode(const std::vector<EncoderFrame> &p_frames, const std::string &p_path, OutputSink *p_sink);
+
+    AVRational get_time_base() const { return av_inv_q(config.get_frame_rate()); }
+
+    // Codec context of the segment being muxed. Only valid inside the packet
+    // sink; every segment shares the same parameters.
+    const AVCodecContext *get_codec_context() const { return muxing_codec_ctx; }
+
+private:
+    VideoEncoderConfig config;
+    const AVCodecContext *muxing_codec_ctx = nullptr;
+    PacketSink packet_sink;
+    int thread_count = 0;
+};
+
+} // namespace gdffmpeg
@@ -0,0 +1,458 @@
+#include "smart_trimmer.h"
+
+#include "log.h"
+#include "trace.h"
+#include "video_decoder.h"
+#include "video_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gdffmpeg {
+
+static const char *COMPONENT = "FFmpegRemuxer";
+
+static int64_t packet_time(const AVPacket *p_packet) {
+    return p_packet->pts != AV_NOPTS_VALUE ? p_packet->pts : p_packet->dts;
+}
+
+static void shift_packet(AVPacket *p_packet, int64_t p_offset) {
+    if (p_packet->pts != AV_NOPTS_VALUE) {
+        p_packet->pts -= p_offset;
+    }
+    if (p_packet->dts != AV_NOPTS_VALUE) {
+        p_packet->dts -= p_offset;
+    }
+}
+
+SmartTrimmer::~SmartTrimmer() {
+    close();
+}
+
+void SmartTrimmer::free_gop() {
+    for (AVPacket *gop_packet : gop) {
+        av_packet_free(&gop_packet);
+    }
+    gop.clear();
+}
+
+void SmartTrimmer::close() {
+    free_gop();
+    av_bsf_free(&annexb_bsf);
+    av_packet_free(&packet);
+    av_packet_free(&filtered);
+    outputs.clear();
+    muxer.close();
+    if (input_ctx) {
+        avformat_close_input(&input_ctx);
+    }
+    video_index = -1;
+    video_written = false;
+}
+
+int SmartTrimmer::add_video_output(AVStream *p_stream) {
+    const AVCodecParameters *params = p_stream->codecpar;
+    AVRational time_base = p_stream->time_base;
+
+    // avcC/hvcC extradata starts with version 1; Annex B with a start code.
+    const bool length_prefixed = params->extradata_size > 0 && params->extradata[0] == 1;
+    const char *filter_name = nullptr;
+    if (length_prefixed && params->codec_id == AV_CODEC_ID_H264) {
+        filter_name = "h264_mp4toannexb";
+    } else if (length_prefixed && params->codec_id == AV_CODEC_ID_HEVC) {
+        filter_name = "hevc_mp4toannexb";
+    }
+    if (filter_name) {
+        const AVBitStreamFilter *filter = av_bsf_get_by_name(filter_name);
+        if (!filter || av_bsf_alloc(filter, &annexb_bsf) < 0 ||
+                avcodec_parameters_copy(annexb_bsf->par_in, params) < 0) {
+            return 1;
+        }
+        annexb_bsf->time_base_in = time_base;
+        if (av_bsf_init(annexb_bsf) < 0) {
+            log_info(COMPONENT, std::string("Failed to initialise ") + filter_name);
+            return 1;
+        }
+        params = annexb_bsf->par_out;
+        time_base = annexb_bsf->time_base_out;
+    }
+    smart_render = annexb_bsf != nullptr;
+    if (smart_render) {
+        log_info(COMPONENT, "Smart rendering: copying whole GOPs, re-encoding the boundary ones");
+    } else {
+        log_info(COMPONENT, std::string("No Annex B splice path for this ") + avcodec_get_name(params->codec_id) +
+                " stream; re-encoding the whole range");
+    }
+
+    AVStream *stream = muxer.add_stream(params, time_base);
+    if (!stream) {
+        return 2;
+    }
+    stream->disposition = p_stream->disposition;
+    outputs[p_stream->index].index = stream->index;
+    video_index = p_stream->index;
+    return 0;
+}
+
+int SmartTrimmer::setup_streams(double p_start, double p_end) {
+    std::vector<int> order = selected_streams;
+    if (order.empty()) {
+        for (unsigned int i = 0; i < input_ctx->nb_streams; i++) {
+            const AVMediaType type = input_ctx->streams[i]->codecpar->codec_type;
+            if (type == AVMEDIA_TYPE_VIDEO || type == AVMEDIA_TYPE_AUDIO || type == AVMEDIA_TYPE_SUBTITLE) {
+                order.push_back(static_cast<int>(i));
+            }
+        }
+    }
+
+    outputs.assign(input_ctx->nb_streams, OutputStream());
+    const int64_t start_us = static_cast<int64_t>(std::llround(p_start * AV_TIME_BASE));
+    const int64_t end_us = p_end > p_start ? static_cast<int64_t>(std::llround(p_end * AV_TIME_BASE)) : INT64_MAX;
+    for (int index : order) {
+        if (index < 0 || index >= static_cast<int>(input_ctx->nb_streams) || outputs[index].index >= 0) {
+            log_info(COMPONENT, "Invalid or repeated stream index: " + std::to_string(index));
+            return 1;
+        }
+        AVStream *stream = input_ctx->streams[index];
+        OutputStream &output = outputs[index];
+        output.start = av_rescale_q(start_us, AV_TIME_BASE_Q, stream->time_base);
+        output.end = end_us == INT64_MAX ? INT64_MAX : av_rescale_q(end_us, AV_TIME_BASE_Q, stream->time_base);
+
+        if (stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            if (video_index >= 0) {
+                continue;
+            }
+            if (add_video_output(stream) != 0) {
+                return 2;
+            }
+            continue;
+        }
+        AVStream *copy = muxer.add_stream(stream->codecpar, stream->time_base);
+        if (!copy) {
+            return 2;
+        }
+        copy->disposition = stream->disposition;
+        av_dict_copy(&copy->metadata, stream->metadata, 0);
+        output.index = copy->index;
+    }
+
+    bool any = false;
+    for (unsigned int i = 0; i < input_ctx->nb_streams; i++) {
+        if (outputs[i].index < 0) {
+            input_ctx->streams[i]->discard = AVDISCARD_ALL;
+        } else {
+            any = true;
+        }
+    }
+    if (!any) {
+        log_info(COMPONENT, "No streams to copy");
+        return 3;
+    }
+
+    if (start_us > 0) {
+        // Land on the keyframe at or before the in point so the first
+        // partial GOP can be decoded.
+        const int seek_stream = video_index;
+        const int64_t seek_ts = seek_stream >= 0 ? outputs[seek_stream].start : start_us;
+        if (av_seek_frame(input_ctx, seek_stream, seek_ts, AVSEEK_FLAG_BACKWARD) < 0) {
+            log_info(COMPONENT, "Seek failed; reading from the beginning");
+        }
+    }
+    return 0;
+}
+
+int SmartTrimmer::write_video(AVPacket *p_packet, AVRational p_time_base) {
+    video_written = true;
+    return muxer.write_packet(p_packet, p_time_base, outputs[video_index].index);
+}
+
+int SmartTrimmer::write_copied(AVPacket *p_packet) {
+    const AVRational time_base = input_ctx->streams[video_index]->time_base;
+    if (!annexb_bsf) {
+        packets_copied++;
+        return write_video(p_packet, time_base);
+    }
+    if (av_bsf_send_packet(annexb_bsf, p_packet) < 0) {
+        av_packet_unref(p_packet);
+        return 1;
+    }
+    while (true) {
+        const int ret = av_bsf_receive_packet(annexb_bsf, filtered);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            return 0;
+        }
+        if (ret < 0) {
+            return 2;
+        }
+        packets_copied++;
+        if (write_video(filtered, annexb_bsf->time_base_out) != 0) {
+            return 3;
+        }
+    }
+}
+
+int SmartTrimmer::copy_gop() {
+    const int64_t offset = outputs[video_index].start;
+    for (AVPacket *gop_packet : gop) {
+        shift_packet(gop_packet, offset);
+        if (write_copied(gop_packet) != 0) {
+            log_info(COMPONENT, "Failed to copy packet");
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int SmartTrimmer::reencode_gop(int64_t p_delay) {
+    GDFFMPEG_TRACE_SCOPE("trim_reencode_gop");
+    AVStream *stream = input_ctx->streams[video_index];
+    const AVCodecParameters *params = stream->codecpar;
+    const OutputStream &output = outputs[video_index];
+
+    const AVCodec *codec = encoder_name.empty() ? avcodec_find_encoder(params->codec_id) : avcodec_find_encoder_by_name(encoder_name.c_str());
+    if (!codec) {
+        log_info(COMPONENT, std::string("No encoder available for ") + avcodec_get_name(params->codec_id));
+        return 1;
+    }
+
+    VideoDecoder decoder;
+    if (decoder.open_parameters(params, stream->time_base) != 0) {
+        return 2;
+    }
+
+    // Match the source stream so the re-encoded frames splice in; one GOP,
+    // no reordering, headers in-band.
+    VideoEncoder encoder;
+    VideoEncoderConfig &config = encoder.get_config();
+    config.codec_name = codec->name;
+    config.pix_fmt = params->format >= 0 ? static_cast<AVPixelFormat>(params->format) : AV_PIX_FMT_YUV420P;
+    config.width = params->width;
+    config.height = params->height;
+    // Exact, so time-base-derived header fields (VOL time increment
+    // resolution, VUI timing) match the source.
+    const AVRational rate = av_guess_frame_rate(input_ctx, stream, nullptr);
+    if (rate.num > 0 && rate.den > 0) {
+        config.exact_frame_rate = rate;
+    }
+    config.keyframe_interval = static_cast<int>(gop.size()) + 1;
+    config.max_b_frames = 0;
+    config.preset = preset;
+    if (params->bit_rate > 0) {
+        config.rate_control_mode = "cbr";
+        config.bit_rate = params->bit_rate;
+    } else {
+        config.rate_control_mode = "vbr";
+        config.quality = quality;
+    }
+
+    std::vector<AVPacket *> encoded;
+    encoder.set_packet_sink([&encoded](const AVPacket *p_packet) {
+        if (AVPacket *copy = av_packet_clone(p_packet)) {
+            encoded.push_back(copy);
+        }
+    });
+    encoder.begin_packets(false);
+
+    // Source timestamps of the frames handed to the encoder, by input order;
+    // the encoder stamps its packets with that index.
+    std::vector<int64_t> frame_pts;
+    std::vector<int64_t> frame_durations;
+    int result = 0;
+    const FrameSink sink = [&](const AVFrame *p_frame) {
+        const int64_t pts = p_frame->best_effort_timestamp != AV_NOPTS_VALUE ? p_frame->best_effort_timestamp : p_frame->pts;
+        if (result != 0 || pts == AV_NOPTS_VALUE || pts < output.start || pts >= output.end) {
+            return;
+        }
+        frame_pts.push_back(pts);
+        frame_durations.push_back(p_frame->duration);
+        if (encoder.encode_avframe(p_frame) != 0) {
+            result = 3;
+        }
+    };
+    for (const AVPacket *gop_packet : gop) {
+        if (result == 0 && decoder.decode_packet(gop_packet, sink) != 0) {
+            result = 4;
+        }
+    }
+    if (result == 0) {
+        decoder.decode_packet(nullptr, sink);
+        encoder.finish();
+    }
+
+    for (AVPacket *encoded_packet : encoded) {
+        const int64_t index = encoded_packet->pts;
+        if (result == 0 && index >= 0 && index < static_cast<int64_t>(frame_pts.size())) {
+            encoded_packet->pts = frame_pts[index] - output.start;
+            encoded_packet->dts = encoded_packet->pts - p_delay;
+            encoded_packet->duration = frame_durations[index] > 0 ? frame_durations[index] : 0;
+            if (write_video(encoded_packet, stream->time_base) != 0) {
+                log_info(COMPONENT, "Failed to write re-encoded packet");
+                result = 5;
+            }
+        }
+        av_packet_free(&encoded_packet);
+    }
+    frames_reencoded += static_cast<int64_t>(frame_pts.size());
+    encoder.reset();
+    decoder.close();
+    return result;
+}
+
+int SmartTrimmer::close_gop(const AVPacket *p_next) {
+    const OutputStream &output = outputs[video_index];
+    const AVPacket *key = gop.front();
+    const int64_t gop_start = packet_time(key);
+    int64_t gop_end = p_next ? packet_time(p_next) : gop_start;
+    if (!p_next) {
+        for (const AVPacket *gop_packet : gop) {
+            gop_end = std::max(gop_end, packet_time(gop_packet) + std::max<int64_t>(gop_packet->duration, 1));
+        }
+    }
+
+    int result = 0;
+    if (gop_end <= output.start || gop_start >= output.end) {
+        // Read while seeking towards the in point; nothing to keep.
+    } else if (smart_render && gop_start >= output.start && gop_end <= output.end) {
+        result = copy_gop();
+    } else {
+        // A boundary GOP, or any GOP in range without smart rendering.
+        // The re-encoded frames' dts trail their pts by the neighbouring
+        // copied GOP's reorder delay, which keeps dts increasing across the
+        // splice on either side.
+        int64_t delay = 0;
+        if (video_written && key->dts != AV_NOPTS_VALUE) {
+            delay = gop_start - key->dts;
+        } else if (p_next && p_next->dts != AV_NOPTS_VALUE) {
+            delay = packet_time(p_next) - p_next->dts;
+        }
+        result = reencode_gop(std::max<int64_t>(delay, 0));
+    }
+    free_gop();
+    return result;
+}
+
+int SmartTrimmer::handle_video_packet(AVPacket *p_packet) {
+    OutputStream &output = outputs[video_index];
+    const bool is_key = (p_packet->flags & AV_PKT_FLAG_KEY) != 0;
+    if (is_key && !gop.empty()) {
+        if (close_gop(p_packet) != 0) {
+            av_packet_unref(p_packet);
+            return 1;
+        }
+    }
+    if (is_key && packet_time(p_packet) >= output.end) {
+        output.finished = true;
+    }
+    // Nothing before the first keyframe can be decoded.
+    if (output.finished || (gop.empty() && !is_key)) {
+        av_packet_unref(p_packet);
+        return 0;
+    }
+    AVPacket *held = av_packet_alloc();
+    if (!held) {
+        av_packet_unref(p_packet);
+        return 2;
+    }
+    av_packet_move_ref(held, p_packet);
+    gop.push_back(held);
+    return 0;
+}
+
+int SmartTrimmer::trim(const std::string &p_input, const std::string &p_output, double p_start, double p_end, OutputSink *p_sink) {
+    GDFFMPEG_TRACE_SCOPE("smart_trim");
+    close();
+    packets_copied = 0;
+    frames_reencoded = 0;
+    smart_render = false;
+
+    if (avformat_open_input(&input_ctx, p_input.c_str(), nullptr, nullptr) < 0) {
+        log_info(COMPONENT, "Failed to open input file: " + p_input);
+        return 1;
+    }
+    if (avformat_find_stream_info(input_ctx, nullptr) < 0) {
+        log_info(COMPONENT, "Failed to find stream info");
+        close();
+        return 2;
+    }
+    if (muxer.open(p_output, p_sink, muxer_name, true) != 0) {
+        close();
+        return 3;
+    }
+    for (const std::pair<std::string, std::string> &option : muxer_options) {
+        muxer.set_option(option.first, option.second);
+    }
+    if (setup_streams(std::max(0.0, p_start), p_end) != 0) {
+        close();
+        return 4;
+    }
+
+    packet = av_packet_alloc();
+    filtered = av_packet_alloc();
+    if (!packet || !filtered || muxer.write_header() != 0) {
+        close();
+        return 5;
+    }
+
+    int result = 0;
+    int read_ret = 0;
+    while ((read_ret = av_read_frame(input_ctx, packet)) >= 0) {
+        const int index = packet->stream_index;
+        if (index < 0 || index >= static_cast<int>(outputs.size()) || outputs[index].index < 0 || outputs[index].finished) {
+            av_packet_unref(packet);
+            continue;
+        }
+        OutputStream &output = outputs[index];
+        if (index == video_index) {
+            if (handle_video_packet(packet) != 0) {
+                result = 6;
+                break;
+            }
+        } else {
+            const int64_t time = packet_time(packet);
+            if (time != AV_NOPTS_VALUE && time >= output.end) {
+                output.finished = true;
+            }
+            if (time == AV_NOPTS_VALUE || time < output.start || output.finished) {
+                av_packet_unref(packet);
+            } else {
+                shift_packet(packet, output.start);
+                packet->pos = -1;
+                packets_copied++;
+                if (muxer.write_packet(packet, input_ctx->streams[index]->time_base, output.index) != 0) {
+                    result = 6;
+                    break;
+                }
+            }
+        }
+
+        bool all_finished = true;
+        for (const OutputStream &stream_output : outputs) {
+            if (stream_output.index >= 0 && !stream_output.finished) {
+                all_finished = false;
+                break;
+            }
+        }
+        if (all_finished) {
+            break;
+        }
+    }
+    if (result == 0 && read_ret < 0 && read_ret != AVERROR_EOF) {
+        log_info(COMPONENT, "Failed to read input");
+        result = 7;
+    }
+    if (result == 0 && video_index >= 0 && !gop.empty() && close_gop(nullptr) != 0) {
+        result = 6;
+    }
+    if (result == 0 && annexb_bsf) {
+        // Drain the filter; it holds no packets in practice.
+        av_packet_unref(packet);
+        write_copied(packet);
+    }
+    if (result == 0 && muxer.write_trailer() != 0) {
+        result = 8;
+    }
+    close();
+    return result;
+}
+
+} // namespace gdffmpeg
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+extern "C" {
+    #include <libavcodec/bsf.h>
+    #include <libavformat/avformat.h>
+}
+
+#include "muxer.h"
+
+namespace gdffmpeg {
+
+// Cuts [start, end) out of a file with as little re-encoding as possible.
+// Video GOPs that lie entirely inside the range are stream-copied; only the
+// partial GOPs at the in and out points are decoded and re-encoded, as
+// closed GOPs without B-frames and with in-band headers, so they splice
+// next to the copied packets. Other streams are copied packet by packet.
+//
+// Assumes closed GOPs in the source, which is what libx264 and most
+// hardware encoders produce by default. Only the first selected video
+// stream is smart-rendered; further video streams are dropped.
+//
+// Smart rendering needs H.264/HEVC with length-prefixed packets (MP4,
+// Matroska): copied keyframes are converted to Annex B with the source's
+// parameter sets in front, so the re-encoded GOP's headers do not carry
+// over. For any other codec a boundary GOP's in-band header (e.g. the
+// MPEG-4 VOL) would apply to the copied GOPs after it, so every GOP in the
+// range is re-encoded instead.
+class SmartTrimmer {
+public:
+    SmartTrimmer() = default;
+    ~SmartTrimmer();
+
+    SmartTrimmer(const SmartTrimmer &) = delete;
+    SmartTrimmer &operator=(const SmartTrimmer &) = delete;
+
+    // Same meaning as the Remuxer settings.
+    void set_streams(const std::vector<int> &p_indices) { selected_streams = p_indices; }
+    void set_muxer_name(const std::string &p_name) { muxer_name = p_name; }
+    void set_muxer_option(const std::string &p_key, const std::string &p_value) { muxer_options.emplace_back(p_key, p_value); }
+    void clear_muxer_options() { muxer_options.clear(); }
+
+    // Encoder for the boundary GOPs; empty uses FFmpeg's default encoder for
+    // the source codec.
+    void set_encoder_name(const std::string &p_name) { encoder_name = p_name; }
+    // CRF used when the source bit rate is unknown.
+    void set_quality(int p_quality) { quality = p_quality; }
+    void set_preset(const std::string &p_preset) { preset = p_preset; }
+
+    // p_start/p_end in seconds; p_end <= p_start runs to the end of the
+    // input. The output timeline starts at 0. Returns 0 on success.
+    int trim(const std::string &p_input, const std::string &p_output, double p_start, double p_end, OutputSink *p_sink = nullptr);
+
+    int64_t get_packets_copied() const { return packets_copied; }
+    // Whether the last trim() copied whole GOPs, or re-encoded the whole
+    // range because the codec has no Annex B path.
+    bool was_smart_rendered() const { return smart_render; }
+    int64_t get_frames_reencoded() const { return frames_reencoded; }
+
+private:
+    struct OutputStream {
+        int index = -1;
+        int64_t start = 0;
+        int64_t end = INT64_MAX;
+        bool finished = false;
+    };
+
+    std::vector<int> selected_streams;
+    std::string muxer_name;
+    std::vector<std::pair<std::string, std::string>> muxer_options;
+    std::string encoder_name;
+    int quality = 18;
+    std::string preset = "medium";
+
+    AVFormatContext *input_ctx = nullptr;
+    Muxer muxer;
+    std::vector<OutputStream> outputs;
+    AVPacket *packet = nullptr;
+    AVPacket *filtered = nullptr;
+
+    int video_index = -1;
+    // Converts copied H.264/HEVC packets to Annex B so they share in-band
+    // parameter sets with the re-encoded ones.
+    AVBSFContext *annexb_bsf = nullptr;
+    // Off when the codec cannot be spliced; see the class comment.
+    bool smart_render = false;
+    // Packets of the GOP being read, in decode order, starting at a keyframe.
+    std::vector<AVPacket *> gop;
+    bool video_written = false;
+
+    int64_t packets_copied = 0;
+    int64_t frames_reencoded = 0;
+
+    int setup_streams(double p_start, double p_end);
+    int add_video_output(AVStream *p_stream);
+    int handle_video_packet(AVPacket *p_packet);
+    // Copies or re-encodes the buffered GOP. p_next is the keyframe that
+    // follows it, or null at the end of the input.
+    int close_gop(const AVPacket *p_next);
+    int copy_gop();
+    int reencode_gop(int64_t p_delay);
+    int write_copied(AVPacket *p_packet);
+    int write_video(AVPacket *p_packet, AVRational p_time_base);
+    void free_gop();
+    void close();
+};
+
+} // namespace gdffmpeg
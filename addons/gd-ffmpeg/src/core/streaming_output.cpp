@@ -0,0 +1,68 @@
+#include "streaming_output.h"
+
+#include "log.h"
+
+#include <filesystem>
+#include <system_error>
+
+namespace gdffmpeg {
+
+static const char *COMPONENT = "FFmpegStreamingOutput";
+
+std::string get_streaming_playlist_path(const std::string &p_directory, const StreamingOutputOptions &p_options) {
+    const char *name = p_options.format == StreamingOutputOptions::FORMAT_DASH ? "stream.mpd" : "stream.m3u8";
+    return (std::filesystem::path(p_directory) / name).string();
+}
+
+bool streaming_output_needs_global_header(const StreamingOutputOptions &p_options) {
+    return p_options.format == StreamingOutputOptions::FORMAT_DASH || p_options.hls_segment_type == "fmp4";
+}
+
+int open_streaming_output(Muxer &p_muxer, const std::string &p_directory, const StreamingOutputOptions &p_options) {
+    if (p_directory.empty() || p_options.segment_seconds <= 0.0) {
+        log_info(COMPONENT, "Invalid segmented output settings");
+        return 1;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(p_directory, error);
+    if (error) {
+        log_info(COMPONENT, "Could not create " + p_directory + ": " + error.message());
+        return 2;
+    }
+
+    const bool dash = p_options.format == StreamingOutputOptions::FORMAT_DASH;
+    if (p_muxer.open(get_streaming_playlist_path(p_directory, p_options), nullptr, dash ? "dash" : "hls", true) != 0) {
+        return 3;
+    }
+
+    const std::string segment_seconds = std::to_string(p_options.segment_seconds);
+    const std::string playlist_size = std::to_string(p_options.playlist_size > 0 ? p_options.playlist_size : 0);
+    if (dash) {
+        p_muxer.set_option("seg_duration", segment_seconds);
+        p_muxer.set_option("window_size", playlist_size);
+        p_muxer.set_option("use_template", "1");
+        p_muxer.set_option("use_timeline", "1");
+        return 0;
+    }
+
+    const bool fmp4 = p_options.hls_segment_type == "fmp4";
+    if (!fmp4 && p_options.hls_segment_type != "mpegts") {
+        log_info(COMPONENT, "Unknown HLS segment type " + p_options.hls_segment_type + "; using mpegts");
+    }
+    p_muxer.set_option("hls_time", segment_seconds);
+    p_muxer.set_option("hls_list_size", playlist_size);
+    p_muxer.set_option("hls_segment_type", fmp4 ? "fmp4" : "mpegts");
+    p_muxer.set_option("hls_segment_filename", (std::filesystem::path(p_directory) / (fmp4 ? "segment_%05d.m4s" : "segment_%05d.ts")).string());
+    if (fmp4) {
+        p_muxer.set_option("hls_fmp4_init_filename", "init.mp4");
+    }
+    // A rolling window removes segments that fall out of the playlist; a
+    // full one is an event playlist that only grows.
+    p_muxer.set_option("hls_flags", p_options.playlist_size > 0 ? "delete_segments+independent_segments" : "independent_segments");
+    if (p_options.playlist_size <= 0) {
+        p_muxer.set_option("hls_playlist_type", "event");
+    }
+    return 0;
+}
+
+} // namespace gdffmpeg
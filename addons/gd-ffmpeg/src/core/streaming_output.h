@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+
+#include "muxer.h"
+
+namespace gdffmpeg {
+
+// HLS or DASH presentation written into a directory: a playlist
+// (stream.m3u8) or manifest (stream.mpd) plus one file per segment. The
+// muxer starts a segment at the first keyframe after segment_seconds, so
+// the keyframe interval should divide the segment length.
+struct StreamingOutputOptions {
+    enum Format {
+        FORMAT_HLS,
+        FORMAT_DASH,
+    };
+
+    Format format = FORMAT_HLS;
+    double segment_seconds = 4.0;
+    // Segments listed in the playlist; older ones are deleted from disk.
+    // 0 keeps and lists every segment.
+    int playlist_size = 6;
+    // HLS only: "mpegts" or "fmp4". DASH segments are always fMP4.
+    std::string hls_segment_type = "mpegts";
+};
+
+// Creates p_directory if needed and opens p_muxer on its playlist with the
+// segmenter options set. Returns 0 on success.
+int open_streaming_output(Muxer &p_muxer, const std::string &p_directory, const StreamingOutputOptions &p_options);
+
+// Whether codecs feeding the segments should set
+// AV_CODEC_FLAG_GLOBAL_HEADER: fMP4 segments keep headers in the init
+// segment, MPEG-TS segments carry them in-band.
+bool streaming_output_needs_global_header(const StreamingOutputOptions &p_options);
+
+// Path of the playlist/manifest open_streaming_output() writes.
+std::string get_streaming_playlist_path(const std::string &p_directory, const StreamingOutputOptions &p_options);
+
+} // namespace gdffmpeg
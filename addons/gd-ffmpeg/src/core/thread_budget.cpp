@@ -0,0 +1,297 @@
+#include "thread_budget.h"
+
+#include "trace.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace gdffmpeg {
+
+std::atomic<bool> ThreadBudget::enabled{false};
+std::atomic<bool> ThreadBudget::shared_pool_enabled{false};
+
+namespace {
+
+struct Grant {
+    int threads = 0;
+    // Runs its slice jobs on the shared pool.
+    bool pooled = false;
+};
+
+std::mutex budget_mutex;
+std::unordered_map<const AVCodecContext *, Grant> grants;
+int total_threads = 0;
+int max_threads_per_context = 0;
+int threads_in_use = 0;
+// Pool workers counted in threads_in_use while pooled_contexts > 0.
+int pooled_contexts = 0;
+int pool_threads_counted = 0;
+
+int resolved_total_threads() {
+    if (total_threads > 0) {
+        return total_threads;
+    }
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+int resolved_threads_per_context() {
+    return max_threads_per_context > 0 ? max_threads_per_context : std::max(1, resolved_total_threads() / 4);
+}
+
+// One execute()/execute2() call. The caller works on it as slot 0; pool
+// workers take the other slots up to the codec's thread_count, since
+// execute2() jobs index per-thread state by slot.
+struct Batch {
+    AVCodecContext *ctx = nullptr;
+    int (*func)(AVCodecContext *, void *) = nullptr;
+    int (*func2)(AVCodecContext *, void *, int, int) = nullptr;
+    char *arg = nullptr;
+    int size = 0;
+    int *ret = nullptr;
+    int count = 0;
+    int max_slots = 1;
+
+    std::atomic<int> next_job{0};
+    std::atomic<int> next_slot{1};
+    std::atomic<int> done{0};
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    void run(int p_slot) {
+        int job;
+        while ((job = next_job.fetch_add(1)) < count) {
+            const int result = func ? func(ctx, arg + static_cast<size_t>(job) * size) : func2(ctx, arg, job, p_slot);
+            if (ret) {
+                ret[job] = result;
+            }
+            if (done.fetch_add(1) + 1 == count) {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.notify_all();
+            }
+        }
+    }
+
+    bool exhausted() const { return next_job.load() >= count; }
+};
+
+class SharedPool {
+public:
+    ~SharedPool() { stop(); }
+
+    // Starts p_count workers unless already running. Returns the number of
+    // workers.
+    int ensure_started(int p_count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!workers.empty()) {
+            return static_cast<int>(workers.size());
+        }
+        stopping = false;
+        for (int i = 0; i < p_count; i++) {
+            workers.emplace_back(&SharedPool::worker_loop, this);
+        }
+        return p_count;
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+        queue.clear();
+    }
+
+    void run(const std::shared_ptr<Batch> &p_batch) {
+        if (p_batch->count <= 0) {
+            return;
+        }
+        if (p_batch->count > 1 && p_batch->max_slots > 1) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push_back(p_batch);
+            }
+            wake.notify_all();
+        }
+        p_batch->run(0);
+        std::unique_lock<std::mutex> lock(p_batch->mutex);
+        p_batch->finished.wait(lock, [&p_batch]() { return p_batch->done.load() >= p_batch->count; });
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::shared_ptr<Batch>> queue;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+
+    void worker_loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (stopping) {
+                return;
+            }
+            // Batches stay queued until they run out of jobs or slots, so
+            // several workers can join the same one.
+            std::shared_ptr<Batch> batch = queue.front();
+            const int slot = batch->exhausted() ? batch->max_slots : batch->next_slot.fetch_add(1);
+            if (slot + 1 >= batch->max_slots) {
+                queue.pop_front();
+            }
+            if (slot >= batch->max_slots) {
+                continue;
+            }
+            lock.unlock();
+            {
+                GDFFMPEG_TRACE_SCOPE("codec_pool_job");
+                batch->run(slot);
+            }
+            lock.lock();
+        }
+    }
+};
+
+SharedPool shared_pool;
+
+int pool_execute(AVCodecContext *p_ctx, int (*p_func)(AVCodecContext *, void *), void *p_arg, int *r_ret, int p_count, int p_size) {
+    std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+    batch->ctx = p_ctx;
+    batch->func = p_func;
+    batch->arg = static_cast<char *>(p_arg);
+    batch->size = p_size;
+    batch->ret = r_ret;
+    batch->count = p_count;
+    batch->max_slots = std::max(1, p_ctx->thread_count);
+    shared_pool.run(batch);
+    return 0;
+}
+
+int pool_execute2(AVCodecContext *p_ctx, int (*p_func)(AVCodecContext *, void *, int, int), void *p_arg, int *r_ret, int p_count) {
+    std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+    batch->ctx = p_ctx;
+    batch->func2 = p_func;
+    batch->arg = static_cast<char *>(p_arg);
+    batch->ret = r_ret;
+    batch->count = p_count;
+    batch->max_slots = std::max(1, p_ctx->thread_count);
+    shared_pool.run(batch);
+    return 0;
+}
+
+} // namespace
+
+void ThreadBudget::set_total_threads(int p_threads) {
+    std::lock_guard<std::mutex> lock(budget_mutex);
+    total_threads = std::max(0, p_threads);
+}
+
+int ThreadBudget::get_total_threads() {
+    std::lock_guard<std::mutex> lock(budget_mutex);
+    return resolved_total_threads();
+}
+
+void ThreadBudget::set_max_threads_per_context(int p_threads) {
+    std::lock_guard<std::mutex> lock(budget_mutex);
+    max_threads_per_context = std::max(0, p_threads);
+}
+
+int ThreadBudget::get_max_threads_per_context() {
+    std::lock_guard<std::mutex> lock(budget_mutex);
+    return resolved_threads_per_context();
+}
+
+void ThreadBudget::assign(AVCodecContext *p_ctx, int p_requested) {
+    if (!p_ctx) {
+        return;
+    }
+    if (!is_enabled()) {
+        if (p_requested > 0) {
+            p_ctx->thread_count = p_requested;
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(budget_mutex);
+    const int available = std::max(1, resolved_total_threads() - threads_in_use);
+    const int granted = std::min(p_requested > 0 ? p_requested : resolved_threads_per_context(), available);
+
+    release_locked(p_ctx);
+    grants[p_ctx] = Grant{ granted, false };
+    threads_in_use += granted;
+    p_ctx->thread_count = granted;
+}
+
+void ThreadBudget::attach(AVCodecContext *p_ctx) {
+    if (!p_ctx || !is_enabled() || !is_shared_pool_enabled()) {
+        return;
+    }
+    // Only contexts libavcodec opened in slice mode: frame-threaded
+    // decoders (H.264, HEVC, ...) keep their frame threads, which the pool
+    // cannot take over.
+    if (p_ctx->thread_count <= 1 || !(p_ctx->active_thread_type & FF_THREAD_SLICE)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(budget_mutex);
+    auto it = grants.find(p_ctx);
+    if (it == grants.end() || it->second.pooled) {
+        return;
+    }
+    // One context's worth of helpers, shared by every pooled context.
+    const int workers = shared_pool.ensure_started(std::max(1, resolved_threads_per_context() - 1));
+    if (pooled_contexts++ == 0) {
+        pool_threads_counted = workers;
+        threads_in_use += workers;
+    }
+    // The pool's workers run the slice jobs now; the context itself only
+    // keeps the thread that calls execute().
+    threads_in_use -= it->second.threads - 1;
+    it->second.threads = 1;
+    it->second.pooled = true;
+    p_ctx->execute = pool_execute;
+    p_ctx->execute2 = pool_execute2;
+}
+
+void ThreadBudget::release(const AVCodecContext *p_ctx) {
+    std::lock_guard<std::mutex> lock(budget_mutex);
+    release_locked(p_ctx);
+}
+
+void ThreadBudget::release_locked(const AVCodecContext *p_ctx) {
+    auto it = grants.find(p_ctx);
+    if (it == grants.end()) {
+        return;
+    }
+    threads_in_use -= it->second.threads;
+    if (it->second.pooled && --pooled_contexts == 0) {
+        threads_in_use -= pool_threads_counted;
+        pool_threads_counted = 0;
+    }
+    grants.erase(it);
+}
+
+int ThreadBudget::get_threads_in_use() {
+    std::lock_guard<std::mutex> lock(budget_mutex);
+    return threads_in_use;
+}
+
+int ThreadBudget::get_budgeted_contexts() {
+    std::lock_guard<std::mutex> lock(budget_mutex);
+    return static_cast<int>(grants.size());
+}
+
+void ThreadBudget::shutdown() {
+    shared_pool.stop();
+}
+
+} // namespace gdffmpeg
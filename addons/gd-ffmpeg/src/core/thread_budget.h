@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+}
+
+namespace gdffmpeg {
+
+// Process-wide cap on the threads FFmpeg codecs may spawn. Every codec
+// context asks for its thread_count here before avcodec_open2() and returns
+// it when freed, so many concurrent decoders/encoders share the cores
+// instead of each starting its own full set of frame/slice threads.
+//
+// Optionally, contexts that libavcodec opens in slice mode (encoders such
+// as mpeg4, decoders without frame threading) run their execute()/
+// execute2() jobs on one shared pool of max_threads_per_context - 1
+// workers, sized when first used. Idle pool workers join whichever codec
+// has jobs pending and the calling codec thread always works through its
+// own, so a busy pool never stalls a codec. Frame-threaded decoders are
+// left alone. While any context uses the pool its workers count against
+// the budget once, and each pooled context only counts its calling thread.
+//
+// The pool takes over after avcodec_open2(), which has already started the
+// codec's own thread_count - 1 slice threads. Those stay parked for the
+// life of the context: no CPU, but a stack and a kernel thread each.
+//
+// Disabled by default: codecs then keep FFmpeg's own thread count (or the
+// caller's explicit one).
+class ThreadBudget {
+public:
+    static void set_enabled(bool p_enabled) { enabled.store(p_enabled, std::memory_order_relaxed); }
+    static bool is_enabled() { return enabled.load(std::memory_order_relaxed); }
+
+    // Threads shared by every codec context; 0 uses hardware_concurrency().
+    static void set_total_threads(int p_threads);
+    static int get_total_threads();
+
+    // Threads given to a context that does not ask for a count; 0 uses a
+    // quarter of the budget.
+    static void set_max_threads_per_context(int p_threads);
+    static int get_max_threads_per_context();
+
+    // Only affects contexts opened afterwards.
+    static void set_shared_pool_enabled(bool p_enabled) { shared_pool_enabled.store(p_enabled, std::memory_order_relaxed); }
+    static bool is_shared_pool_enabled() { return shared_pool_enabled.load(std::memory_order_relaxed); }
+
+    // Call before avcodec_open2(). Sets p_ctx->thread_count from the budget;
+    // p_requested (0 = no preference) is an upper bound. While disabled only
+    // an explicit p_requested is applied.
+    static void assign(AVCodecContext *p_ctx, int p_requested);
+
+    // Call after a successful avcodec_open2(). Routes the context's
+    // execute()/execute2() through the shared pool when it is enabled and
+    // the codec was opened with slice threads.
+    static void attach(AVCodecContext *p_ctx);
+
+    // Returns p_ctx's threads to the budget. Counters::free_codec_context()
+    // calls it; unknown contexts are ignored.
+    static void release(const AVCodecContext *p_ctx);
+
+    static int get_threads_in_use();
+    static int get_budgeted_contexts();
+
+    // Stops the shared pool; call only at extension shutdown.
+    static void shutdown();
+
+private:
+    static std::atomic<bool> enabled;
+    static std::atomic<bool> shared_pool_enabled;
+
+    // Caller holds the budget lock.
+    static void release_locked(const AVCodecContext *p_ctx);
+};
+
+} // namespace gdffmpeg
@@ -0,0 +1,224 @@
+#include "trace.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace gdffmpeg {
+
+namespace {
+
+struct TraceEvent {
+    const char *name;
+    uint64_t start_usec;
+    uint64_t duration_usec;
+};
+
+constexpr int64_t EVENTS_PER_CHUNK = 16384;
+constexpr int64_t MAX_CHUNKS_PER_THREAD = 64;
+
+// Lifecycle of a ThreadBuffer. A thread that exits hands its buffer back
+// (FREE) for the next new thread to claim; shutdown() marks buffers that
+// are still owned ORPHANED so their owner frees them on exit.
+enum BufferState : int {
+    BUFFER_OWNED,
+    BUFFER_FREE,
+    BUFFER_ORPHANED,
+};
+
+struct TraceChunk {
+    TraceEvent events[EVENTS_PER_CHUNK];
+    std::atomic<int64_t> count{0};
+    std::atomic<TraceChunk *> next{nullptr};
+};
+
+} // namespace
+
+// Written only by its owning thread, including the reset after clear();
+// readers follow the chunk list and read each chunk's count with acquire
+// ordering, so they never see a torn event.
+struct Trace::ThreadBuffer {
+    uint32_t thread_id = 0;
+    // Generation the events belong to; published after a reset completes.
+    std::atomic<uint64_t> generation{0};
+    TraceChunk *head = nullptr;
+    TraceChunk *tail = nullptr;
+    int64_t chunk_count = 0;
+    std::atomic<int> state{BUFFER_OWNED};
+    ThreadBuffer *next = nullptr;
+};
+
+std::atomic<bool> Trace::enabled{false};
+std::atomic<Trace::ThreadBuffer *> Trace::buffers{nullptr};
+std::atomic<uint32_t> Trace::next_thread_id{1};
+std::atomic<int64_t> Trace::dropped_events{0};
+std::atomic<uint64_t> Trace::generation{0};
+std::atomic<uint64_t> Trace::epoch{0};
+
+void Trace::free_buffer(ThreadBuffer *p_buffer) {
+    TraceChunk *chunk = p_buffer->head;
+    while (chunk) {
+        TraceChunk *next = chunk->next.load(std::memory_order_relaxed);
+        delete chunk;
+        chunk = next;
+    }
+    delete p_buffer;
+}
+
+void Trace::release_buffer(ThreadBuffer *p_buffer) {
+    // Whichever of the owner and shutdown() comes second frees it.
+    if (p_buffer->state.exchange(BUFFER_FREE, std::memory_order_acq_rel) == BUFFER_ORPHANED) {
+        free_buffer(p_buffer);
+    }
+}
+
+Trace::ThreadBuffer *Trace::get_thread_buffer() {
+    // Hands the buffer back when the thread exits, so the short-lived
+    // threads of segmented encodes and batches reuse buffers instead of each
+    // leaving one behind.
+    struct Owner {
+        ThreadBuffer *buffer = nullptr;
+        uint64_t epoch = 0;
+
+        ~Owner() {
+            if (buffer) {
+                release_buffer(buffer);
+            }
+        }
+    };
+    thread_local Owner owner;
+
+    const uint64_t current_epoch = epoch.load(std::memory_order_acquire);
+    if (owner.buffer && owner.epoch == current_epoch) {
+        return owner.buffer;
+    }
+    if (owner.buffer) {
+        // Claimed before the last shutdown().
+        release_buffer(owner.buffer);
+        owner.buffer = nullptr;
+    }
+    owner.epoch = current_epoch;
+
+    // Events of the exited owner stay in the buffer; the new one appends
+    // after them under the same thread id.
+    for (ThreadBuffer *free = buffers.load(std::memory_order_acquire); free; free = free->next) {
+        int expected = BUFFER_FREE;
+        if (free->state.compare_exchange_strong(expected, BUFFER_OWNED, std::memory_order_acq_rel)) {
+            owner.buffer = free;
+            return free;
+        }
+    }
+
+    ThreadBuffer *buffer = new ThreadBuffer();
+    buffer->thread_id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+    buffer->head = new TraceChunk();
+    buffer->tail = buffer->head;
+    buffer->chunk_count = 1;
+    buffer->generation.store(generation.load(std::memory_order_acquire), std::memory_order_release);
+
+    ThreadBuffer *expected = buffers.load(std::memory_order_relaxed);
+    do {
+        buffer->next = expected;
+    } while (!buffers.compare_exchange_weak(expected, buffer, std::memory_order_release, std::memory_order_relaxed));
+    owner.buffer = buffer;
+    return buffer;
+}
+
+void Trace::reset_buffer(ThreadBuffer *p_buffer, uint64_t p_generation) {
+    // Only the owning thread gets here, so nothing else touches the chunks;
+    // readers already skip the buffer because its generation is stale.
+    TraceChunk *extra = p_buffer->head->next.exchange(nullptr, std::memory_order_acq_rel);
+    while (extra) {
+        TraceChunk *next = extra->next.load(std::memory_order_relaxed);
+        delete extra;
+        extra = next;
+    }
+    p_buffer->head->count.store(0, std::memory_order_release);
+    p_buffer->tail = p_buffer->head;
+    p_buffer->chunk_count = 1;
+    p_buffer->generation.store(p_generation, std::memory_order_release);
+}
+
+void Trace::record(const char *p_name, uint64_t p_start_usec, uint64_t p_end_usec) {
+    ThreadBuffer *buffer = get_thread_buffer();
+    const uint64_t current = generation.load(std::memory_order_acquire);
+    if (buffer->generation.load(std::memory_order_relaxed) != current) {
+        reset_buffer(buffer, current);
+    }
+    TraceChunk *chunk = buffer->tail;
+    int64_t index = chunk->count.load(std::memory_order_relaxed);
+    if (index >= EVENTS_PER_CHUNK) {
+        if (buffer->chunk_count >= MAX_CHUNKS_PER_THREAD) {
+            dropped_events.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        TraceChunk *fresh = new TraceChunk();
+        chunk->next.store(fresh, std::memory_order_release);
+        buffer->tail = fresh;
+        buffer->chunk_count++;
+        chunk = fresh;
+        index = 0;
+    }
+
+    TraceEvent &event = chunk->events[index];
+    event.name = p_name;
+    event.start_usec = p_start_usec;
+    event.duration_usec = p_end_usec >= p_start_usec ? p_end_usec - p_start_usec : 0;
+    chunk->count.store(index + 1, std::memory_order_release);
+}
+
+void Trace::clear() {
+    // Freeing another thread's chunks here would race with a TraceScope that
+    // is still open on it; each owner resets its own buffer instead.
+    generation.fetch_add(1, std::memory_order_acq_rel);
+    dropped_events.store(0, std::memory_order_relaxed);
+}
+
+int64_t Trace::write_json(std::string &r_out) {
+    int64_t written = 0;
+    char line[256];
+    r_out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    const uint64_t current = generation.load(std::memory_order_acquire);
+    for (ThreadBuffer *buffer = buffers.load(std::memory_order_acquire); buffer; buffer = buffer->next) {
+        if (buffer->generation.load(std::memory_order_acquire) != current) {
+            // Cleared, and its thread has not recorded since.
+            continue;
+        }
+        std::snprintf(line, sizeof(line),
+                "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"gd-ffmpeg %u\"}}",
+                written > 0 ? "," : "", buffer->thread_id, buffer->thread_id);
+        r_out += line;
+        written++;
+
+        for (TraceChunk *chunk = buffer->head; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+            const int64_t count = chunk->count.load(std::memory_order_acquire);
+            for (int64_t i = 0; i < count; i++) {
+                const TraceEvent &event = chunk->events[i];
+                std::snprintf(line, sizeof(line),
+                        ",{\"name\":\"%s\",\"cat\":\"gd-ffmpeg\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%llu,\"dur\":%llu}",
+                        event.name, buffer->thread_id,
+                        static_cast<unsigned long long>(event.start_usec),
+                        static_cast<unsigned long long>(event.duration_usec));
+                r_out += line;
+                written++;
+            }
+        }
+    }
+    r_out += "]}";
+    return written;
+}
+
+void Trace::shutdown() {
+    enabled.store(false, std::memory_order_relaxed);
+    epoch.fetch_add(1, std::memory_order_acq_rel);
+    ThreadBuffer *buffer = buffers.exchange(nullptr, std::memory_order_acq_rel);
+    while (buffer) {
+        ThreadBuffer *next = buffer->next;
+        // A thread that is still alive frees its buffer when it exits.
+        if (buffer->state.exchange(BUFFER_ORPHANED, std::memory_order_acq_rel) == BUFFER_FREE) {
+            free_buffer(buffer);
+        }
+        buffer = next;
+    }
+}
+
+} // namespace gdffmpeg
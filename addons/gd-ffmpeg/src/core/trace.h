@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace gdffmpeg {
+
+// Opt-in recorder of Chrome trace-event "complete" events. Each thread appends
+// to its own chunked buffer without taking locks; buffers are published on a
+// lock-free list the first time a thread records an event, and handed back
+// for reuse when the thread exits.
+class Trace {
+public:
+    static void set_enabled(bool p_enabled) { enabled.store(p_enabled, std::memory_order_relaxed); }
+    static bool is_enabled() { return enabled.load(std::memory_order_relaxed); }
+
+    static uint64_t now_usec() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // p_name must be a string literal (or otherwise outlive the trace).
+    static void record(const char *p_name, uint64_t p_start_usec, uint64_t p_end_usec);
+
+    // Drops all recorded events. Safe while other threads record: each
+    // thread empties its own buffer the next time it records, and buffers
+    // not emptied yet are skipped by write_json(). Must not run concurrently
+    // with write_json().
+    static void clear();
+
+    // Appends {"traceEvents":[...]} JSON to r_out. Returns the event count.
+    static int64_t write_json(std::string &r_out);
+
+    static int64_t get_dropped_events() { return dropped_events.load(std::memory_order_relaxed); }
+
+    // Releases every thread buffer (those of live threads when they exit);
+    // call only at extension shutdown.
+    static void shutdown();
+
+private:
+    struct ThreadBuffer;
+
+    static std::atomic<bool> enabled;
+    static std::atomic<ThreadBuffer *> buffers;
+    static std::atomic<uint32_t> next_thread_id;
+    static std::atomic<int64_t> dropped_events;
+    // Bumped by clear(); a buffer holds events only for the generation it
+    // was last reset in.
+    static std::atomic<uint64_t> generation;
+    // Bumped by shutdown() so threads drop buffers claimed before it.
+    static std::atomic<uint64_t> epoch;
+
+    static ThreadBuffer *get_thread_buffer();
+    static void release_buffer(ThreadBuffer *p_buffer);
+    static void free_buffer(ThreadBuffer *p_buffer);
+    static void reset_buffer(ThreadBuffer *p_buffer, uint64_t p_generation);
+};
+
+class TraceScope {
+public:
+    explicit TraceScope(const char *p_name) :
+            name(Trace::is_enabled() ? p_name : nullptr), start(name ? Trace::now_usec() : 0) {}
+
+    ~TraceScope() {
+        if (name) {
+            Trace::record(name, start, Trace::now_usec());
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *name;
+    uint64_t start;
+};
+
+#define GDFFMPEG_TRACE_CONCAT_INNER(a, b) a##b
+#define GDFFMPEG_TRACE_CONCAT(a, b) GDFFMPEG_TRACE_CONCAT_INNER(a, b)
+#define GDFFMPEG_TRACE_SCOPE(m_name) ::gdffmpeg::TraceScope GDFFMPEG_TRACE_CONCAT(_gdffmpeg_trace_scope_, __LINE__)(m_name)
+
+} // namespace gdffmpeg
@@ -0,0 +1,418 @@
+#include "video_decoder.h"
+
+#include "log.h"
+#include "thread_budget.h"
+#include "trace.h"
+
+#include <cstring>
+
+extern "C" {
+    #include <libavutil/pixdesc.h>
+}
+
+namespace gdffmpeg {
+
+static const char *COMPONENT = "FFmpegVideoDecoder";
+
+VideoDecoder::~VideoDecoder() {
+    close();
+}
+
+void VideoDecoder::set_output_resolution(int p_width, int p_height) {
+    output_width = p_width;
+    output_height = p_height;
+}
+
+int VideoDecoder::open_file(const char *p_path) {
+    close();
+    return open_input(p_path);
+}
+
+int VideoDecoder::open_memory(const uint8_t *p_data, size_t p_size) {
+    close();
+
+    AVIOContext *avio_ctx = memory_reader.open(p_data, p_size);
+    if (!avio_ctx) {
+        return 2;
+    }
+    tracked_memory.add(memory_reader.get_buffer_size());
+
+    format_ctx = avformat_alloc_context();
+    if (!format_ctx) {
+        close();
+        return 1;
+    }
+    format_ctx->pb = avio_ctx;
+    format_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+    if (avformat_open_input(&format_ctx, nullptr, nullptr, nullptr) < 0) {
+        log_info(COMPONENT, "Failed to open input from memory");
+        close();
+        return 3;
+    }
+    if (avformat_find_stream_info(format_ctx, nullptr) < 0) {
+        log_info(COMPONENT, "Failed to find stream info");
+        return 2;
+    }
+    return 0;
+}
+
+int VideoDecoder::open_input(const char *p_path) {
+    if (avformat_open_input(&format_ctx, p_path, nullptr, nullptr) < 0) {
+        log_info(COMPONENT, "Failed to open input file");
+        return 1;
+    }
+    if (avformat_find_stream_info(format_ctx, nullptr) < 0) {
+        log_info(COMPONENT, "Failed to find stream info");
+        return 2;
+    }
+    return 0;
+}
+
+void VideoDecoder::close() {
+    if (sws_ctx) {
+        sws_freeContext(sws_ctx);
+        sws_ctx = nullptr;
+    }
+    sws_src_w = 0;
+    sws_src_h = 0;
+    sws_src_fmt = AV_PIX_FMT_NONE;
+    sws_dst_w = 0;
+    sws_dst_h = 0;
+    sws_dst_fmt = AV_PIX_FMT_NONE;
+    source_has_alpha = false;
+    if (frame) {
+        av_frame_free(&frame);
+        frame = nullptr;
+    }
+    if (packet) {
+        av_packet_free(&packet);
+        packet = nullptr;
+    }
+    if (codec_ctx) {
+        Counters::free_codec_context(&codec_ctx);
+        codec_ctx = nullptr;
+    }
+    if (format_ctx) {
+        avformat_close_input(&format_ctx);
+        format_ctx = nullptr;
+    }
+    // The custom AVIOContext (if any) is owned by the reader, not the demuxer.
+    memory_reader.close();
+    video_stream_index = -1;
+    tracked_memory.release();
+}
+
+bool VideoDecoder::pixel_format_has_alpha(AVPixelFormat p_fmt) {
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(p_fmt);
+    return desc && (desc->flags & AV_PIX_FMT_FLAG_ALPHA);
+}
+
+void VideoDecoder::premultiply_rgba(uint8_t *p_pixels, int64_t p_pixel_count) {
+    for (int64_t i = 0; i < p_pixel_count; i++) {
+        uint8_t *px = p_pixels + i * 4;
+        const unsigned int a = px[3];
+        if (a == 255) {
+            continue;
+        }
+        // Rounded x * a / 255 without a division.
+        for (int c = 0; c < 3; c++) {
+            const unsigned int t = px[c] * a + 128;
+            px[c] = static_cast<uint8_t>((t + (t >> 8)) >> 8);
+        }
+    }
+}
+
+void VideoDecoder::get_output_size(const AVFrame *p_frame, int &r_width, int &r_height) const {
+    r_width = output_width > 0 ? output_width : p_frame->width;
+    r_height = output_height > 0 ? output_height : p_frame->height;
+}
+
+int VideoDecoder::convert(const AVFrame *p_frame, uint8_t *p_dst, int p_dst_linesize) {
+    GDFFMPEG_TRACE_SCOPE("convert_frame");
+    int dst_width = 0;
+    int dst_height = 0;
+    get_output_size(p_frame, dst_width, dst_height);
+    const AVPixelFormat src_fmt = static_cast<AVPixelFormat>(p_frame->format);
+    const AVPixelFormat dst_fmt = is_rgb_output() ? AV_PIX_FMT_RGB24 : AV_PIX_FMT_RGBA;
+
+    if (!sws_ctx || sws_src_w != p_frame->width || sws_src_h != p_frame->height || sws_src_fmt != src_fmt ||
+            sws_dst_w != dst_width || sws_dst_h != dst_height || sws_dst_fmt != dst_fmt) {
+        if (sws_ctx) {
+            sws_freeContext(sws_ctx);
+        }
+        sws_ctx = sws_getContext(
+            p_frame->width,
+            p_frame->height,
+            src_fmt,
+            dst_width,
+            dst_height,
+            dst_fmt,
+            SWS_BILINEAR,
+            nullptr,
+            nullptr,
+            nullptr
+        );
+        sws_src_w = p_frame->width;
+        sws_src_h = p_frame->height;
+        sws_src_fmt = src_fmt;
+        sws_dst_w = dst_width;
+        sws_dst_h = dst_height;
+        sws_dst_fmt = dst_fmt;
+    }
+
+    if (!sws_ctx) {
+        return 1;
+    }
+
+    // The yuva -> RGBA conversion carries the alpha plane through in the same
+    // pass, straight into the caller's buffer.
+    uint8_t *dst_data[4] = { p_dst, nullptr, nullptr, nullptr };
+    int dst_linesizes[4] = { p_dst_linesize, 0, 0, 0 };
+    {
+        StageTimer timer(stats, PipelineStats::STAGE_CONVERT);
+        sws_scale(
+            sws_ctx,
+            p_frame->data,
+            p_frame->linesize,
+            0,
+            p_frame->height,
+            dst_data,
+            dst_linesizes
+        );
+
+        if (!is_rgb_output() && premultiply_alpha && pixel_format_has_alpha(src_fmt)) {
+            if (p_dst_linesize == dst_width * 4) {
+                premultiply_rgba(p_dst, static_cast<int64_t>(dst_width) * dst_height);
+            } else {
+                for (int y = 0; y < dst_height; y++) {
+                    premultiply_rgba(p_dst + static_cast<int64_t>(y) * p_dst_linesize, dst_width);
+                }
+            }
+        }
+    }
+
+    Counters::add_decoded_frames(1);
+    return 0;
+}
+
+const AVCodec *VideoDecoder::select_decoder(const AVStream *p_stream) {
+    const AVCodecID codec_id = p_stream->codecpar->codec_id;
+
+    // WebM stores the VP8/VP9 alpha plane as a BlockAdditional side stream that
+    // only the libvpx decoders understand; the native ones silently drop it.
+    const AVDictionaryEntry *alpha_tag = av_dict_get(p_stream->metadata, "alpha_mode", nullptr, 0);
+    const bool webm_alpha = alpha_tag && std::strcmp(alpha_tag->value, "1") == 0 &&
+            (codec_id == AV_CODEC_ID_VP9 || codec_id == AV_CODEC_ID_VP8);
+    source_has_alpha = webm_alpha || pixel_format_has_alpha(static_cast<AVPixelFormat>(p_stream->codecpar->format));
+
+    const AVCodec *codec = nullptr;
+    if (!preferred_codec.empty()) {
+        codec = avcodec_find_decoder_by_name(preferred_codec.c_str());
+    }
+    if (!codec && webm_alpha) {
+        codec = avcodec_find_decoder_by_name(codec_id == AV_CODEC_ID_VP9 ? "libvpx-vp9" : "libvpx");
+        if (!codec) {
+            log_info(COMPONENT, "Stream has an alpha channel but libvpx is not available; alpha will be dropped");
+        }
+    }
+    if (!codec) {
+        codec = avcodec_find_decoder(codec_id);
+    }
+    return codec;
+}
+
+void VideoDecoder::find_video_stream() {
+    if (video_stream_index >= 0) {
+        return;
+    }
+    for (unsigned int i = 0; i < format_ctx->nb_streams; i++) {
+        if (format_ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            video_stream_index = static_cast<int>(i);
+            break;
+        }
+    }
+}
+
+int VideoDecoder::open_codec() {
+    find_video_stream();
+    if (video_stream_index < 0) {
+        log_info(COMPONENT, "No video stream found");
+        return 1;
+    }
+
+    const AVStream *video_stream = format_ctx->streams[video_stream_index];
+
+    const AVCodec *codec = select_decoder(video_stream);
+    if (!codec) {
+        log_info(COMPONENT, "Decoder not found");
+        return 2;
+    }
+
+    return open_decoder(codec, video_stream->codecpar, video_stream->time_base);
+}
+
+int VideoDecoder::open_decoder(const AVCodec *p_codec, const AVCodecParameters *p_params, AVRational p_time_base) {
+    codec_ctx = avcodec_alloc_context3(p_codec);
+    if (!codec_ctx) {
+        return 3;
+    }
+    avcodec_parameters_to_context(codec_ctx, p_params);
+    codec_ctx->pkt_timebase = p_time_base;
+    ThreadBudget::assign(codec_ctx, 0);
+    if (avcodec_open2(codec_ctx, p_codec, nullptr) < 0) {
+        log_info(COMPONENT, "Failed to open codec");
+        return 4;
+    }
+    Counters::codec_context_opened();
+    ThreadBudget::attach(codec_ctx);
+    source_has_alpha = source_has_alpha || pixel_format_has_alpha(codec_ctx->pix_fmt);
+
+    frame = av_frame_alloc();
+    packet = av_packet_alloc();
+    return frame && packet ? 0 : 5;
+}
+
+int VideoDecoder::open_parameters(const AVCodecParameters *p_params, AVRational p_time_base) {
+    close();
+    if (!p_params || p_params->codec_type != AVMEDIA_TYPE_VIDEO) {
+        log_info(COMPONENT, "Codec parameters do not describe a video stream");
+        return 1;
+    }
+
+    const AVCodec *codec = nullptr;
+    if (!preferred_codec.empty()) {
+        codec = avcodec_find_decoder_by_name(preferred_codec.c_str());
+    }
+    if (!codec) {
+        codec = avcodec_find_decoder(p_params->codec_id);
+    }
+    if (!codec) {
+        log_info(COMPONENT, "Decoder not found");
+        return 2;
+    }
+    source_has_alpha = pixel_format_has_alpha(static_cast<AVPixelFormat>(p_params->format));
+
+    const int err = open_decoder(codec, p_params, p_time_base);
+    if (err != 0) {
+        close();
+    }
+    return err;
+}
+
+AVRational VideoDecoder::get_frame_rate() {
+    if (!format_ctx) {
+        return AVRational{0, 1};
+    }
+    find_video_stream();
+    if (video_stream_index < 0) {
+        return AVRational{0, 1};
+    }
+    return av_guess_frame_rate(format_ctx, format_ctx->streams[video_stream_index], nullptr);
+}
+
+double VideoDecoder::get_duration() const {
+    if (!format_ctx || format_ctx->duration <= 0) {
+        return 0.0;
+    }
+    return static_cast<double>(format_ctx->duration) / AV_TIME_BASE;
+}
+
+AVRational VideoDecoder::get_time_base() const {
+    if (format_ctx && video_stream_index >= 0) {
+        return format_ctx->streams[video_stream_index]->time_base;
+    }
+    return codec_ctx ? codec_ctx->pkt_timebase : AVRational{0, 1};
+}
+
+int VideoDecoder::receive_frame_timed() {
+    GDFFMPEG_TRACE_SCOPE("avcodec_receive_frame");
+    StageTimer timer(stats, PipelineStats::STAGE_RECEIVE_FRAME);
+    return avcodec_receive_frame(codec_ctx, frame);
+}
+
+int VideoDecoder::decode(const FrameSink &p_sink) {
+    GDFFMPEG_TRACE_SCOPE("decode_frames");
+    if (!format_ctx) {
+        log_info(COMPONENT, "No input loaded");
+        return 1;
+    }
+
+    if (!codec_ctx) {
+        const int err = open_codec();
+        if (err != 0) {
+            return 1 + err;
+        }
+    }
+
+    stop_requested = false;
+    while (!stop_requested) {
+        int read_ret = 0;
+        {
+            GDFFMPEG_TRACE_SCOPE("av_read_frame");
+            StageTimer timer(stats, PipelineStats::STAGE_DEMUX);
+            read_ret = av_read_frame(format_ctx, packet);
+        }
+        if (read_ret < 0) {
+            break;
+        }
+        if (packet->stream_index != video_stream_index) {
+            av_packet_unref(packet);
+            continue;
+        }
+        int send_ret = 0;
+        {
+            GDFFMPEG_TRACE_SCOPE("avcodec_send_packet");
+            StageTimer timer(stats, PipelineStats::STAGE_SEND_PACKET);
+            send_ret = avcodec_send_packet(codec_ctx, packet);
+        }
+        av_packet_unref(packet);
+        if (send_ret < 0) {
+            break;
+        }
+
+        while (!stop_requested && receive_frame_timed() == 0) {
+            p_sink(frame);
+            av_frame_unref(frame);
+        }
+    }
+    if (stop_requested) {
+        return 0;
+    }
+
+    // Flush
+    avcodec_send_packet(codec_ctx, nullptr);
+    while (!stop_requested && receive_frame_timed() == 0) {
+        p_sink(frame);
+        av_frame_unref(frame);
+    }
+
+    return 0;
+}
+
+int VideoDecoder::decode_packet(const AVPacket *p_packet, const FrameSink &p_sink) {
+    GDFFMPEG_TRACE_SCOPE("decode_packet");
+    if (!codec_ctx || format_ctx) {
+        log_info(COMPONENT, "Decoder was not opened for packet input");
+        return 1;
+    }
+
+    int send_ret = 0;
+    {
+        GDFFMPEG_TRACE_SCOPE("avcodec_send_packet");
+        StageTimer timer(stats, PipelineStats::STAGE_SEND_PACKET);
+        send_ret = avcodec_send_packet(codec_ctx, p_packet);
+    }
+    if (send_ret < 0 && send_ret != AVERROR_EOF) {
+        log_info(COMPONENT, "Failed to send packet");
+        return 2;
+    }
+
+    while (receive_frame_timed() == 0) {
+        p_sink(frame);
+        av_frame_unref(frame);
+    }
+    return 0;
+}
+
+} // namespace gdffmpeg
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavformat/avformat.h>
+    #include <libswscale/swscale.h>
+}
+
+#include "counters.h"
+#include "memory_io.h"
+#include "pipeline_stats.h"
+
+namespace gdffmpeg {
+
+// Called for every decoded frame. The frame is unreferenced after the call;
+// use VideoDecoder::convert() from inside the sink to get packed pixels.
+using FrameSink = std::function<void(const AVFrame *p_frame)>;
+
+// Demuxes and decodes the first video stream of a file or memory buffer and
+// converts frames to packed RGBA (or RGB24) on request.
+class VideoDecoder {
+public:
+    VideoDecoder() = default;
+    ~VideoDecoder();
+
+    VideoDecoder(const VideoDecoder &) = delete;
+    VideoDecoder &operator=(const VideoDecoder &) = delete;
+
+    void set_preferred_codec(const std::string &p_name) { preferred_codec = p_name; }
+
+    // AV_PIX_FMT_RGB24 selects 3-byte output; every other format yields RGBA.
+    void set_output_pixel_format(AVPixelFormat p_fmt) { output_pix_fmt = p_fmt; }
+    AVPixelFormat get_output_pixel_format() const { return output_pix_fmt; }
+
+    // 0 keeps the source dimension.
+    void set_output_resolution(int p_width, int p_height);
+
+    void set_premultiply_alpha(bool p_enabled) { premultiply_alpha = p_enabled; }
+    bool get_premultiply_alpha() const { return premultiply_alpha; }
+
+    // True once decoding has started on a source carrying an alpha plane.
+    bool has_alpha() const { return source_has_alpha; }
+
+    // Both return 0 on success. open_memory() does not copy; p_data must stay
+    // valid until close().
+    int open_file(const char *p_path);
+    int open_memory(const uint8_t *p_data, size_t p_size);
+    void close();
+
+    // Opens a decoder for packets that arrive without a container, e.g. from
+    // an encoder. decode_packet() then feeds it; p_time_base is the packets'
+    // time base. Returns 0 on success.
+    int open_parameters(const AVCodecParameters *p_params, AVRational p_time_base = AVRational{0, 1});
+
+    // Time base of the decoded frames' pts.
+    AVRational get_time_base() const;
+
+    // Duration of the open container in seconds; 0 when unknown.
+    double get_duration() const;
+
+    // Frame rate of the opened container's video stream; {0, 1} if unknown.
+    AVRational get_frame_rate();
+
+    bool is_open() const { return format_ctx != nullptr; }
+    bool is_codec_open() const { return codec_ctx != nullptr; }
+
+    // Decodes every frame of the video stream, flushing the decoder at the
+    // end. Returns 0 on success.
+    int decode(const FrameSink &p_sink);
+
+    // Called from a sink: decode() returns 0 after the current frame,
+    // without reading further or flushing the decoder.
+    void stop() { stop_requested = true; }
+
+    // Sends one packet to a decoder opened with open_parameters() and passes
+    // every frame it releases to p_sink. A null packet flushes the decoder.
+    // Returns 0 on success.
+    int decode_packet(const AVPacket *p_packet, const FrameSink &p_sink);
+
+    // Output layout for p_frame with the current settings.
+    bool is_rgb_output() const { return output_pix_fmt == AV_PIX_FMT_RGB24; }
+    int get_bytes_per_pixel() const { return is_rgb_output() ? 3 : 4; }
+    void get_output_size(const AVFrame *p_frame, int &r_width, int &r_height) const;
+
+    // Scales p_frame into p_dst (get_output_size() rows of p_dst_linesize
+    // bytes), premultiplying alpha if requested. Returns 0 on success.
+    int convert(const AVFrame *p_frame, uint8_t *p_dst, int p_dst_linesize);
+
+    // Stage names: demux, send_packet, receive_frame, sws_scale. The fifth
+    // stage (STAGE_GODOT_ALLOC) is left for the sink to time.
+    PipelineStats &get_stats() { return stats; }
+    const PipelineStats &get_stats() const { return stats; }
+
+    static bool pixel_format_has_alpha(AVPixelFormat p_fmt);
+    static void premultiply_rgba(uint8_t *p_pixels, int64_t p_pixel_count);
+
+private:
+    std::string preferred_codec;
+    AVFormatContext *format_ctx = nullptr;
+    AVCodecContext *codec_ctx = nullptr;
+    AVFrame *frame = nullptr;
+    AVPacket *packet = nullptr;
+    MemoryReader memory_reader;
+    SwsContext *sws_ctx = nullptr;
+    int sws_src_w = 0;
+    int sws_src_h = 0;
+    AVPixelFormat sws_src_fmt = AV_PIX_FMT_NONE;
+    int sws_dst_w = 0;
+    int sws_dst_h = 0;
+    AVPixelFormat sws_dst_fmt = AV_PIX_FMT_NONE;
+    AVPixelFormat output_pix_fmt = AV_PIX_FMT_RGBA;
+    bool premultiply_alpha = false;
+    bool stop_requested = false;
+    bool source_has_alpha = false;
+    int output_width = 0;
+    int output_height = 0;
+    int video_stream_index = -1;
+
+    PipelineStats stats;
+    TrackedMemory tracked_memory;
+
+    int open_input(const char *p_path);
+    void find_video_stream();
+    int open_codec();
+    int open_decoder(const AVCodec *p_codec, const AVCodecParameters *p_params, AVRational p_time_base);
+    const AVCodec *select_decoder(const AVStream *p_stream);
+    int receive_frame_timed();
+};
+
+} // namespace gdffmpeg
@@ -0,0 +1,445 @@
+#include "video_encoder.h"
+
+#include "log.h"
+#include "options.h"
+#include "thread_budget.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstring>
+
+extern "C" {
+    #include <libavutil/imgutils.h>
+}
+
+namespace gdffmpeg {
+
+static const char *COMPONENT = "FFmpegVideoEncoder";
+
+VideoEncoder::~VideoEncoder() {
+    reset();
+}
+
+void VideoEncoder::reset() {
+    if (sws_ctx) {
+        sws_freeContext(sws_ctx);
+        sws_ctx = nullptr;
+    }
+    if (frame) {
+        av_frame_free(&frame);
+        frame = nullptr;
+    }
+    av_frame_free(&input_ref);
+    if (pkt) {
+        av_packet_free(&pkt);
+        pkt = nullptr;
+    }
+    if (audio_pkt) {
+        av_packet_free(&audio_pkt);
+        audio_pkt = nullptr;
+    }
+    audio_codec_ctx = nullptr;
+    audio_stream = nullptr;
+    if (codec_ctx) {
+        Counters::free_codec_context(&codec_ctx);
+        codec_ctx = nullptr;
+    }
+    Counters::add_queued_frames(-frames_in_flight);
+    frames_in_flight = 0;
+    tracked_memory.release();
+    stream = nullptr;
+    opened = false;
+    pts_counter = 0;
+
+    muxer.close();
+    output_path.clear();
+    output_sink = nullptr;
+    packets_only = false;
+    packets_global_header = false;
+    segmented = false;
+}
+
+void VideoEncoder::begin(const std::string &p_path, OutputSink *p_sink) {
+    reset();
+    output_path = p_path;
+    output_sink = p_sink;
+}
+
+void VideoEncoder::begin_segmented(const std::string &p_directory, const StreamingOutputOptions &p_options) {
+    reset();
+    output_path = p_directory;
+    segmented = true;
+    streaming_options = p_options;
+}
+
+void VideoEncoder::begin_packets(bool p_global_header) {
+    reset();
+    packets_only = true;
+    packets_global_header = p_global_header;
+}
+
+int VideoEncoder::initialize(int p_width, int p_height, AVPixelFormat p_src_format) {
+    if (opened) {
+        return 0;
+    }
+    if (codec_ctx) {
+        // An earlier attempt got past allocation and failed; stay failed
+        // until the next begin().
+        return 1;
+    }
+
+    const int target_width = config.width > 0 ? config.width : p_width;
+    const int target_height = config.height > 0 ? config.height : p_height;
+    if (target_width <= 0 || target_height <= 0) {
+        log_info(COMPONENT, "Invalid dimensions for encoder initialization");
+        return 1;
+    }
+
+    const AVCodec *codec = avcodec_find_encoder_by_name(config.codec_name.c_str());
+    if (!codec) {
+        codec = avcodec_find_encoder(AV_CODEC_ID_H264);
+    }
+    if (!codec) {
+        log_info(COMPONENT, "Encoder not found");
+        return 2;
+    }
+
+    if (segmented) {
+        if (open_streaming_output(muxer, output_path, streaming_options) != 0) {
+            return 3;
+        }
+        muxer.set_file_written_callback(file_written_callback);
+    } else if (!packets_only) {
+        if (muxer.open(output_path, output_sink, config.muxer_name) != 0) {
+            return 3;
+        }
+        muxer.set_io_buffer_size(config.io_buffer_size);
+        muxer.set_live_output(config.live_output, config.fragment_duration_ms);
+    }
+
+    codec_ctx = avcodec_alloc_context3(codec);
+    if (!codec_ctx) {
+        log_info(COMPONENT, "Failed to allocate codec context");
+        return 7;
+    }
+
+    codec_ctx->codec_id = codec->id;
+    codec_ctx->width = target_width;
+    codec_ctx->height = target_height;
+    codec_ctx->pix_fmt = config.pix_fmt;
+    const AVRational frame_rate = config.get_frame_rate();
+    codec_ctx->time_base = av_inv_q(frame_rate);
+    codec_ctx->framerate = frame_rate;
+    codec_ctx->gop_size = config.keyframe_interval;
+    if (segmented) {
+        const int segment_frames = std::max(1, static_cast<int>(streaming_options.segment_seconds * av_q2d(frame_rate) + 0.5));
+        if (codec_ctx->gop_size > segment_frames) {
+            log_info(COMPONENT, "Keyframe interval shortened to " + std::to_string(segment_frames) + " frames to match the segment length");
+            codec_ctx->gop_size = segment_frames;
+        }
+    }
+    if (config.max_b_frames >= 0) {
+        codec_ctx->max_b_frames = config.max_b_frames;
+    }
+    ThreadBudget::assign(codec_ctx, config.thread_count);
+
+    if (config.rate_control_mode == "cbr") {
+        codec_ctx->bit_rate = config.bit_rate;
+    } else {
+        codec_ctx->bit_rate = 0;
+        apply_codec_option_int(COMPONENT, codec_ctx, "crf", config.quality);
+    }
+
+    apply_codec_option(COMPONENT, codec_ctx, "preset", config.preset.c_str());
+    if (!config.profile.empty()) {
+        apply_codec_option(COMPONENT, codec_ctx, "profile", config.profile.c_str());
+    }
+
+    bool global_header = muxer.needs_global_header();
+    if (packets_only) {
+        global_header = packets_global_header;
+    } else if (segmented) {
+        global_header = streaming_output_needs_global_header(streaming_options);
+    }
+    if (global_header) {
+        codec_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    if (avcodec_open2(codec_ctx, codec, nullptr) < 0) {
+        log_info(COMPONENT, "Failed to open codec");
+        return 8;
+    }
+    Counters::codec_context_opened();
+    ThreadBudget::attach(codec_ctx);
+
+    if (!packets_only) {
+        stream = muxer.add_stream(codec_ctx);
+        if (!stream) {
+            return 6;
+        }
+        if (audio_codec_ctx) {
+            audio_stream = muxer.add_stream(audio_codec_ctx);
+            if (!audio_stream) {
+                log_info(COMPONENT, "Failed to create audio stream");
+                return 9;
+            }
+        }
+        if (muxer.write_header() != 0) {
+            return 13;
+        }
+    }
+
+    frame = av_frame_alloc();
+    pkt = av_packet_alloc();
+    if (!frame || !pkt) {
+        log_info(COMPONENT, "Failed to allocate frame/packet");
+        return 14;
+    }
+
+    frame->format = codec_ctx->pix_fmt;
+    frame->width = codec_ctx->width;
+    frame->height = codec_ctx->height;
+
+    if (av_frame_get_buffer(frame, 32) < 0) {
+        log_info(COMPONENT, "Failed to allocate frame buffer");
+        return 15;
+    }
+    tracked_memory.add(av_image_get_buffer_size(codec_ctx->pix_fmt, codec_ctx->width, codec_ctx->height, 32));
+
+    sws_ctx = sws_getCachedContext(
+        nullptr,
+        p_width,
+        p_height,
+        p_src_format,
+        codec_ctx->width,
+        codec_ctx->height,
+        codec_ctx->pix_fmt,
+        SWS_BILINEAR,
+        nullptr,
+        nullptr,
+        nullptr
+    );
+
+    if (!sws_ctx && (p_src_format != codec_ctx->pix_fmt || p_width != codec_ctx->width || p_height != codec_ctx->height)) {
+        log_info(COMPONENT, "Failed to create scale context");
+        return 16;
+    }
+
+    opened = true;
+    return 0;
+}
+
+int VideoEncoder::write_packets() {
+    while (true) {
+        const int receive_ret = avcodec_receive_packet(codec_ctx, pkt);
+        if (receive_ret == AVERROR(EAGAIN) || receive_ret == AVERROR_EOF) {
+            return 0;
+        }
+        if (receive_ret < 0) {
+            log_info(COMPONENT, "Failed to receive packet");
+            return receive_ret;
+        }
+        packet_received();
+        if (packet_sink) {
+            packet_sink(pkt);
+        }
+        if (packets_only) {
+            av_packet_unref(pkt);
+            continue;
+        }
+        if (muxer.write_packet(pkt, codec_ctx->time_base, stream->index) != 0) {
+            return -1;
+        }
+    }
+}
+
+int VideoEncoder::encode_frame(const uint8_t *p_src, int p_src_size, int p_width, int p_height, AVPixelFormat p_src_format, const int *p_linesizes, int p_linesize_count) {
+    GDFFMPEG_TRACE_SCOPE("encode_frame_internal");
+    const int final_width = p_width > 0 ? p_width : config.width;
+    const int final_height = p_height > 0 ? p_height : config.height;
+
+    if (!p_src || final_width <= 0 || final_height <= 0) {
+        log_info(COMPONENT, "Invalid frame payload");
+        return 1;
+    }
+
+    if (initialize(final_width, final_height, p_src_format) != 0) {
+        return 2;
+    }
+
+    int linesizes[AV_NUM_DATA_POINTERS] = {0};
+    if (p_linesizes && p_linesize_count > 0) {
+        const int to_copy = p_linesize_count < AV_NUM_DATA_POINTERS ? p_linesize_count : AV_NUM_DATA_POINTERS;
+        for (int i = 0; i < to_copy; i++) {
+            linesizes[i] = p_linesizes[i];
+        }
+    } else if (av_image_fill_linesizes(linesizes, p_src_format, final_width) < 0) {
+        log_info(COMPONENT, "Could not compute line sizes for frame");
+        return 3;
+    }
+
+    uint8_t *src_data[AV_NUM_DATA_POINTERS] = {nullptr};
+    const int required_size = av_image_fill_pointers(src_data, p_src_format, final_height, const_cast<uint8_t *>(p_src), linesizes);
+    if (required_size < 0 || required_size > p_src_size) {
+        log_info(COMPONENT, "Invalid buffer/stride combination for frame");
+        return 4;
+    }
+
+    return encode_planes(src_data, linesizes, final_width, final_height, p_src_format);
+}
+
+int VideoEncoder::encode_avframe(const AVFrame *p_frame) {
+    GDFFMPEG_TRACE_SCOPE("encode_avframe");
+    if (!p_frame || p_frame->width <= 0 || p_frame->height <= 0 || !p_frame->data[0]) {
+        log_info(COMPONENT, "Invalid frame payload");
+        return 1;
+    }
+
+    const AVPixelFormat src_format = static_cast<AVPixelFormat>(p_frame->format);
+    if (initialize(p_frame->width, p_frame->height, src_format) != 0) {
+        return 2;
+    }
+
+    if (src_format != codec_ctx->pix_fmt || p_frame->width != codec_ctx->width || p_frame->height != codec_ctx->height) {
+        return encode_planes(p_frame->data, p_frame->linesize, p_frame->width, p_frame->height, src_format);
+    }
+
+    // Already in the codec's layout: hand the encoder a new reference to the
+    // same buffers instead of copying the planes.
+    if (!input_ref) {
+        input_ref = av_frame_alloc();
+        if (!input_ref) {
+            return 5;
+        }
+    }
+    if (av_frame_ref(input_ref, p_frame) < 0) {
+        log_info(COMPONENT, "Could not reference frame");
+        return 5;
+    }
+    input_ref->pts = pts_counter++;
+    input_ref->pict_type = AV_PICTURE_TYPE_NONE;
+    const int result = send_frame(input_ref);
+    av_frame_unref(input_ref);
+    return result;
+}
+
+int VideoEncoder::encode_planes(uint8_t *const p_src_data[], const int p_linesizes[], int p_width, int p_height, AVPixelFormat p_src_format) {
+    SwsContext *active_sws = sws_ctx;
+    if (p_src_format != codec_ctx->pix_fmt || p_width != codec_ctx->width || p_height != codec_ctx->height) {
+        active_sws = sws_getCachedContext(
+            sws_ctx,
+            p_width,
+            p_height,
+            p_src_format,
+            codec_ctx->width,
+            codec_ctx->height,
+            codec_ctx->pix_fmt,
+            SWS_BILINEAR,
+            nullptr,
+            nullptr,
+            nullptr
+        );
+        sws_ctx = active_sws;
+        if (!active_sws) {
+            log_info(COMPONENT, "Failed to create scale context");
+            return 8;
+        }
+    }
+
+    if (av_frame_make_writable(frame) < 0) {
+        log_info(COMPONENT, "Frame not writable");
+        return 5;
+    }
+
+    if (active_sws) {
+        GDFFMPEG_TRACE_SCOPE("sws_scale");
+        sws_scale(
+            active_sws,
+            p_src_data,
+            p_linesizes,
+            0,
+            p_height,
+            frame->data,
+            frame->linesize
+        );
+    } else {
+        av_image_copy(frame->data, frame->linesize, const_cast<const uint8_t **>(p_src_data), p_linesizes, codec_ctx->pix_fmt, codec_ctx->width, codec_ctx->height);
+    }
+
+    frame->pts = pts_counter++;
+    return send_frame(frame);
+}
+
+int VideoEncoder::send_frame(AVFrame *p_frame) {
+    int send_ret = 0;
+    {
+        GDFFMPEG_TRACE_SCOPE("avcodec_send_frame");
+        send_ret = avcodec_send_frame(codec_ctx, p_frame);
+    }
+    if (send_ret < 0) {
+        log_info(COMPONENT, "Failed to send frame to encoder");
+        return 6;
+    }
+    frames_in_flight++;
+    Counters::add_queued_frames(1);
+
+    const int write_ret = write_packets();
+    return write_ret < 0 ? 7 : 0;
+}
+
+int VideoEncoder::write_audio_packet(const AVPacket *p_packet) {
+    if (!muxer.is_header_written() || !audio_stream || !p_packet) {
+        return 1;
+    }
+    if (!audio_pkt) {
+        audio_pkt = av_packet_alloc();
+        if (!audio_pkt) {
+            return 2;
+        }
+    }
+    if (av_packet_ref(audio_pkt, p_packet) < 0) {
+        return 3;
+    }
+    if (muxer.write_packet(audio_pkt, audio_codec_ctx->time_base, audio_stream->index) != 0) {
+        log_info(COMPONENT, "Failed to write audio packet");
+        return 4;
+    }
+    return 0;
+}
+
+bool VideoEncoder::container_needs_global_header(const std::string &p_path, const std::string &p_muxer_name) {
+    const AVOutputFormat *format = p_path.empty() ? nullptr : av_guess_format(nullptr, p_path.c_str(), nullptr);
+    if (!format) {
+        format = av_guess_format(p_muxer_name.c_str(), nullptr, nullptr);
+    }
+    return format && (format->flags & AVFMT_GLOBALHEADER);
+}
+
+bool VideoEncoder::is_supported_source_format(AVPixelFormat p_format) {
+    return p_format != AV_PIX_FMT_NONE && sws_isSupportedInput(p_format) > 0;
+}
+
+int VideoEncoder::finish() {
+    GDFFMPEG_TRACE_SCOPE("flush_internal");
+    if (!codec_ctx || !pkt) {
+        return 0;
+    }
+
+    avcodec_send_frame(codec_ctx, nullptr);
+    write_packets();
+
+    if (!packets_only) {
+        muxer.write_trailer();
+    }
+    return 0;
+}
+
+void VideoEncoder::packet_received() {
+    Counters::add_encoded_frames(1);
+    if (frames_in_flight > 0) {
+        frames_in_flight--;
+        Counters::add_queued_frames(-1);
+    }
+}
+
+} // namespace gdffmpeg
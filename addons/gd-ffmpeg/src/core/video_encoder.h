@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+    #include <libavformat/avformat.h>
+    #include <libswscale/swscale.h>
+}
+
+#include "audio_encoder.h"
+#include "counters.h"
+#include "muxer.h"
+#include "streaming_output.h"
+
+namespace gdffmpeg {
+
+struct VideoEncoderConfig {
+    std::string codec_name = "libx264";
+    AVPixelFormat pix_fmt = AV_PIX_FMT_YUV420P;
+    int frame_rate = 30;
+    // When set, replaces frame_rate with an exact rational rate such as
+    // 30000/1001, so NTSC sources keep their timing.
+    AVRational exact_frame_rate = AVRational{0, 1};
+    // 0 takes the size of the first frame.
+    int width = 0;
+    int height = 0;
+    int64_t bit_rate = 4000000;
+    int quality = 23;
+    // "cbr" uses bit_rate, "vbr" uses quality as CRF.
+    std::string rate_control_mode = "vbr";
+    std::string preset = "medium";
+    std::string profile;
+    int keyframe_interval = 12;
+    // -1 keeps the codec default; 0 makes decode order match presentation.
+    int max_b_frames = -1;
+    // Codec worker threads; 0 lets the codec pick.
+    int thread_count = 0;
+    // Container used when muxing into an OutputSink rather than a path.
+    std::string muxer_name = "mp4";
+    // AVIO buffer for OutputSink output; see Muxer::set_io_buffer_size().
+    int io_buffer_size = Muxer::DEFAULT_IO_BUFFER_SIZE;
+    // Fragmented MP4 / live Matroska output; see Muxer::set_live_output().
+    bool live_output = false;
+    int fragment_duration_ms = 0;
+
+    AVRational get_frame_rate() const {
+        return exact_frame_rate.num > 0 && exact_frame_rate.den > 0 ? exact_frame_rate : AVRational{frame_rate, 1};
+    }
+};
+
+// Encodes raw frames and muxes them into a file or an OutputSink. The codec
+// and muxer are opened lazily on the first frame, whose size and pixel format
+// configure the scaler.
+class VideoEncoder {
+public:
+    VideoEncoder() = default;
+    ~VideoEncoder();
+
+    VideoEncoder(const VideoEncoder &) = delete;
+    VideoEncoder &operator=(const VideoEncoder &) = delete;
+
+    // Only read by begin()/the first frame; changes mid-stream are ignored.
+    VideoEncoderConfig &get_config() { return config; }
+    const VideoEncoderConfig &get_config() const { return config; }
+
+    // Called with every encoded packet (codec time base) before it is muxed.
+    void set_packet_sink(const PacketSink &p_sink) { packet_sink = p_sink; }
+
+    // Discards any open stream and targets p_path, or p_sink when non-null.
+    // Nothing is opened until the first frame.
+    void begin(const std::string &p_path, OutputSink *p_sink);
+
+    // Like begin(), but writes an HLS/DASH presentation into p_directory.
+    // The keyframe interval is shortened to the segment length if it is
+    // longer, so every segment can start on a keyframe.
+    void begin_segmented(const std::string &p_directory, const StreamingOutputOptions &p_options);
+
+    // Called with every segment and playlist update written by
+    // begin_segmented() output, on the muxing thread.
+    void set_file_written_callback(const Muxer::FileWrittenCallback &p_callback) { file_written_callback = p_callback; }
+
+    // Like begin(), but without a container: packets only reach the packet
+    // sink. p_global_header should match the container they end up in.
+    void begin_packets(bool p_global_header);
+
+    // p_linesizes may be null for tightly packed input. Frames whose size or
+    // format differ from the codec's are converted with swscale, so callers
+    // never need to pre-scale. Returns 0 on success.
+    int encode_frame(const uint8_t *p_src, int p_src_size, int p_width, int p_height, AVPixelFormat p_src_format, const int *p_linesizes = nullptr, int p_linesize_count = 0);
+
+    // Encodes a decoded frame. One already in the codec's size and pixel
+    // format is passed by reference without touching its pixels; others go
+    // through swscale like encode_frame(). The frame's pts is replaced.
+    int encode_avframe(const AVFrame *p_frame);
+
+    // Muxes a second (audio) stream next to the video. Call after begin() and
+    // before the first frame; p_codec_ctx must be open and outlive the stream.
+    void set_audio_stream(const AVCodecContext *p_codec_ctx) { audio_codec_ctx = p_codec_ctx; }
+
+    // Writes an audio packet stamped in the audio codec's time base. Only
+    // valid once the header is written, and never concurrently with
+    // encode_frame()/finish(). Returns 0 on success.
+    int write_audio_packet(const AVPacket *p_packet);
+
+    // Whether the container chosen for p_path (or p_muxer_name when the path
+    // has no known extension) stores codec extradata out of band.
+    static bool container_needs_global_header(const std::string &p_path, const std::string &p_muxer_name);
+
+    // True when swscale can read p_format, i.e. encode_frame() accepts it.
+    static bool is_supported_source_format(AVPixelFormat p_format);
+
+    // Drains the codec and writes the trailer. The stream stays open until
+    // reset() so callers can still inspect it.
+    int finish();
+
+    // Frees every FFmpeg resource and forgets the output target.
+    void reset();
+
+    bool is_initialized() const { return opened; }
+    bool is_header_written() const { return muxer.is_header_written(); }
+    AVRational get_time_base() const { return codec_ctx ? codec_ctx->time_base : AVRational{0, 1}; }
+    int get_stream_index() const { return stream ? stream->index : -1; }
+    AVCodecContext *get_codec_context() const { return codec_ctx; }
+
+private:
+    VideoEncoderConfig config;
+    PacketSink packet_sink;
+
+    std::string output_path;
+    OutputSink *output_sink = nullptr;
+    bool packets_only = false;
+    bool packets_global_header = false;
+    bool segmented = false;
+    StreamingOutputOptions streaming_options;
+    Muxer::FileWrittenCallback file_written_callback;
+
+    Muxer muxer;
+    AVCodecContext *codec_ctx = nullptr;
+    AVStream *stream = nullptr;
+    AVFrame *frame = nullptr;
+    // Reference to a caller's frame while it is sent by encode_avframe().
+    AVFrame *input_ref = nullptr;
+    AVPacket *pkt = nullptr;
+    SwsContext *sws_ctx = nullptr;
+    const AVCodecContext *audio_codec_ctx = nullptr;
+    AVStream *audio_stream = nullptr;
+    AVPacket *audio_pkt = nullptr;
+    int64_t pts_counter = 0;
+    bool opened = false;
+
+    // Monitor bookkeeping: frames sent but not yet returned as packets.
+    int64_t frames_in_flight = 0;
+    TrackedMemory tracked_memory;
+
+    int initialize(int p_width, int p_height, AVPixelFormat p_src_format);
+    int encode_planes(uint8_t *const p_src_data[], const int p_linesizes[], int p_width, int p_height, AVPixelFormat p_src_format);
+    int send_frame(AVFrame *p_frame);
+    int write_packets();
+    void packet_received();
+};
+
+} // namespace gdffmpeg
@@ -0,0 +1,203 @@
+#include "video_transcoder.h"
+
+#include "log.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace gdffmpeg {
+
+static const char *COMPONENT = "FFmpegVideoTranscoder";
+
+namespace {
+
+// Places decoded frames on the output's constant frame grid the way
+// FFmpeg's fps filter does: every output slot shows the newest frame that
+// starts at or before it. Faster sources lose frames, slower or variable
+// rate ones repeat them, and the duration stays that of the input.
+class FrameRateConverter {
+public:
+    using EmitFunction = std::function<bool(const AVFrame *)>;
+
+    FrameRateConverter(AVRational p_input_time_base, AVRational p_output_rate, const EmitFunction &p_emit) :
+            input_time_base(p_input_time_base), slot_time_base(av_inv_q(p_output_rate)), emit(p_emit) {}
+
+    ~FrameRateConverter() {
+        av_frame_free(&held);
+    }
+
+    // Emits the previous frame for every slot before p_frame's. Returns
+    // false when emitting failed.
+    bool push(const AVFrame *p_frame) {
+        const int64_t timestamp = p_frame->best_effort_timestamp != AV_NOPTS_VALUE ? p_frame->best_effort_timestamp : p_frame->pts;
+        if (timestamp != AV_NOPTS_VALUE && first_timestamp == AV_NOPTS_VALUE) {
+            first_timestamp = timestamp;
+        }
+        // Untimed frames take the slot after the previous one.
+        const int64_t slot = timestamp != AV_NOPTS_VALUE ? to_slot(timestamp) : (held ? held_slot + 1 : 0);
+        if (held && !emit_until(slot)) {
+            return false;
+        }
+        av_frame_free(&held);
+        held = av_frame_clone(p_frame);
+        if (!held) {
+            return false;
+        }
+        held_slot = slot;
+        held_end_slot = timestamp != AV_NOPTS_VALUE && p_frame->duration > 0 ? to_slot(timestamp + p_frame->duration) : slot + 1;
+        return true;
+    }
+
+    // Emits the last frame until the end of its display time, and at least
+    // once when nothing was emitted yet.
+    bool finish() {
+        if (!held) {
+            return true;
+        }
+        const bool ok = emit_until(emitted == 0 ? std::max(held_end_slot, next_slot + 1) : held_end_slot);
+        av_frame_free(&held);
+        return ok;
+    }
+
+private:
+    AVRational input_time_base;
+    AVRational slot_time_base;
+    EmitFunction emit;
+    AVFrame *held = nullptr;
+    int64_t held_slot = 0;
+    int64_t held_end_slot = 0;
+    int64_t first_timestamp = AV_NOPTS_VALUE;
+    int64_t next_slot = 0;
+    int64_t emitted = 0;
+
+    int64_t to_slot(int64_t p_timestamp) const {
+        return av_rescale_q_rnd(p_timestamp - first_timestamp, input_time_base, slot_time_base, static_cast<AVRounding>(AV_ROUND_NEAR_INF | AV_ROUND_PASS_MINMAX));
+    }
+
+    bool emit_until(int64_t p_slot) {
+        for (; next_slot < p_slot; next_slot++) {
+            if (!emit(held)) {
+                return false;
+            }
+            emitted++;
+        }
+        return true;
+    }
+};
+
+} // namespace
+
+int VideoTranscoder::transcode(const std::string &p_input, const std::string &p_output, OutputSink *p_sink) {
+    GDFFMPEG_TRACE_SCOPE("video_transcode");
+    frames_transcoded = 0;
+
+    VideoDecoder decoder;
+    decoder.set_preferred_codec(preferred_decoder);
+    if (decoder.open_file(p_input.c_str()) != 0) {
+        log_info(COMPONENT, "Failed to open input: " + p_input);
+        return 1;
+    }
+
+    // The source rate is kept exactly (30000/1001 stays NTSC); frames are
+    // retimed onto the output grid either way, so variable rate inputs keep
+    // their timing too.
+    AVRational output_rate = frame_rate;
+    if (output_rate.num <= 0 || output_rate.den <= 0) {
+        output_rate = decoder.get_frame_rate();
+        if (output_rate.num <= 0 || output_rate.den <= 0) {
+            output_rate = AVRational{30, 1};
+        }
+    }
+
+    VideoEncoder encoder;
+    encoder.get_config() = config;
+    encoder.get_config().exact_frame_rate = output_rate;
+    encoder.begin(p_output, p_sink);
+
+    ProgressReporter progress(progress_callback);
+    const double duration = decoder.get_duration();
+    const AVRational time_base = decoder.get_time_base();
+    const auto report = [&](const AVFrame *p_frame) {
+        if (p_frame->pts != AV_NOPTS_VALUE) {
+            progress.update(static_cast<double>(p_frame->pts) * av_q2d(time_base), duration);
+        }
+    };
+
+    int result = 0;
+    EncodeWorker worker;
+    if (threaded) {
+        worker.set_max_queued_frames(max_queued_frames);
+        worker.start(&encoder);
+    }
+    FrameRateConverter converter(time_base, output_rate, [&](const AVFrame *p_frame) {
+        if (!threaded) {
+            if (encoder.encode_avframe(p_frame) != 0) {
+                result = 4;
+                return false;
+            }
+            frames_transcoded++;
+            return true;
+        }
+        // The queue holds references, not copies, of the decoder's frames.
+        AVFrame *held = av_frame_clone(p_frame);
+        if (!held) {
+            result = 3;
+            return false;
+        }
+        EncoderFrame frame;
+        frame.av_frame = held;
+        frame.release = [held]() mutable {
+            av_frame_free(&held);
+        };
+        if (!worker.submit(std::move(frame))) {
+            result = 4;
+            return false;
+        }
+        frames_transcoded++;
+        return true;
+    });
+    const int decode_result = decoder.decode([&](const AVFrame *p_frame) {
+        if (result == 0 && cancel_flag && *cancel_flag) {
+            result = ERR_CANCELLED;
+        }
+        if (result != 0) {
+            decoder.stop();
+            return;
+        }
+        if (!converter.push(p_frame) && result == 0) {
+            result = 3;
+        }
+        report(p_frame);
+    });
+    // Emit failures are recorded in result.
+    if (result == 0) {
+        converter.finish();
+    }
+    if (threaded) {
+        const int worker_result = worker.finish();
+        if (result == 0 && worker_result != 0) {
+            result = 4;
+        }
+    }
+
+    if (result == 0 && decode_result != 0) {
+        log_info(COMPONENT, "Decoding failed");
+        result = 2;
+    }
+    if (result == 0 && frames_transcoded == 0) {
+        log_info(COMPONENT, "No frames decoded");
+        result = 5;
+    }
+    if (result == 0 && encoder.finish() != 0) {
+        result = 6;
+    }
+    if (result == 0) {
+        progress.finish();
+    }
+    encoder.reset();
+    decoder.close();
+    return result;
+}
+
+} // namespace gdffmpeg
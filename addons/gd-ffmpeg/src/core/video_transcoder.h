@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "encode_worker.h"
+#include "progress.h"
+#include "video_decoder.h"
+#include "video_encoder.h"
+
+namespace gdffmpeg {
+
+// Decodes the first video stream of a file and re-encodes it frame by frame.
+// Decoded AVFrames go to the encoder as they are; swscale only runs when
+// the output size or pixel format differs from the source. Memory stays
+// bounded by the frame queue, whatever the clip length.
+class VideoTranscoder {
+public:
+    static constexpr int ERR_CANCELLED = 7;
+
+    // Output settings. width/height of 0 keep the source size.
+    VideoEncoderConfig &get_config() { return config; }
+
+    void set_preferred_decoder(const std::string &p_name) { preferred_decoder = p_name; }
+
+    // 0 keeps the source frame rate. Otherwise frames are dropped or
+    // repeated by timestamp, so the output lasts as long as the input.
+    void set_frame_rate(int p_fps) { frame_rate = AVRational{ p_fps > 0 ? p_fps : 0, 1 }; }
+    // Like set_frame_rate(), for fractional rates such as 30000/1001.
+    void set_exact_frame_rate(AVRational p_rate) { frame_rate = p_rate; }
+
+    // With threading on, frames are decoded on the calling thread and
+    // encoded on an EncodeWorker; at most p_frames wait in between.
+    void set_threaded(bool p_enabled) { threaded = p_enabled; }
+    void set_max_queued_frames(int p_frames) { max_queued_frames = p_frames; }
+
+    // Checked once per decoded frame; once it reads true the transcode
+    // stops and returns ERR_CANCELLED. The flag must outlive transcode().
+    void set_cancel_flag(const std::atomic<bool> *p_flag) { cancel_flag = p_flag; }
+
+    // Transcodes p_input into p_output, or p_sink when non-null. Returns 0
+    // on success.
+    int transcode(const std::string &p_input, const std::string &p_output, OutputSink *p_sink = nullptr);
+
+    // Frames handed to the encoder, after rate conversion.
+    int64_t get_frames_transcoded() const { return frames_transcoded; }
+
+    // Reports the decode position against the input's duration.
+    void set_progress_callback(const ProgressCallback &p_callback) { progress_callback = p_callback; }
+
+private:
+    VideoEncoderConfig config;
+    std::string preferred_decoder;
+    AVRational frame_rate = AVRational{0, 1};
+    bool threaded = true;
+    int max_queued_frames = EncodeWorker::DEFAULT_MAX_QUEUED_FRAMES;
+    int64_t frames_transcoded = 0;
+    ProgressCallback progress_callback;
+    const std::atomic<bool> *cancel_flag = nullptr;
+};
+
+} // namespace gdffmpeg
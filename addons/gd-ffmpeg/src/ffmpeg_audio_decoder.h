@@ -3,14 +3,14 @@
 #include <godot_cpp/classes/ref_counted.hpp>
 #include <godot_cpp/core/class_db.hpp>
 #include <godot_cpp/classes/audio_stream_wav.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
 #include <godot_cpp/variant/packed_byte_array.hpp>
 #include <godot_cpp/variant/packed_float32_array.hpp>
 
-extern "C" {
-    #include <libavcodec/avcodec.h>
-    #include <libavformat/avformat.h>
-    #include <libswresample/swresample.h>
-}
+#include "ffmpeg_frame.h"
+
+#include "core/audio_decoder.h"
+#include "core/audio_transcoder.h"
 
 namespace godot {
 
@@ -18,35 +18,15 @@ class FFmpegAudioDecoder : public RefCounted {
     GDCLASS(FFmpegAudioDecoder, RefCounted);
 
 private:
-    AVFormatContext *format_ctx = nullptr;
-    AVCodecContext *codec_ctx = nullptr;
-    SwrContext *swr_ctx = nullptr;
-    AVIOContext *avio_ctx = nullptr;
-    AVPacket *packet = nullptr;
-    AVFrame *frame = nullptr;
-
-    int audio_stream_index = -1;
-    int target_sample_rate = 0;
-    int target_channels = 0;
-    AVSampleFormat target_format = AV_SAMPLE_FMT_FLT;
-    String input_codec_name;
-
+    gdffmpeg::AudioDecoder decoder;
     PackedByteArray source_bytes;
-    size_t source_pos = 0;
 
-    int open_input_internal(const char *p_path);
-    int setup_resampler(const AVChannelLayout &p_src_layout);
     void clear_resources();
 
-    static int read_packet(void *opaque, uint8_t *buf, int buf_size);
-
 protected:
     static void _bind_methods();
 
 public:
-    FFmpegAudioDecoder();
-    ~FFmpegAudioDecoder();
-
     void set_input_codec(const String &p_codec_name);
     void set_output_sample_rate(int p_rate);
     void set_output_channels(int p_channels);
@@ -57,23 +37,32 @@ public:
     PackedFloat32Array decode_pcm();
     Array decode_audio_frames();                // now returns Array of {left,right} dictionaries
     Ref<AudioStreamWAV> decode_audio_stream();
+    // FFmpegFrames in the codec's own sample format and rate; the output
+    // rate/channel settings are not applied.
+    Array decode_frame_objects();
 
     PackedFloat32Array decode_pcm_from_file(const String &p_path);
     Array decode_audio_frames_from_file(const String &p_path);
     Ref<AudioStreamWAV> decode_audio_stream_from_file(const String &p_path);
 
-    int get_sample_rate() const { return target_sample_rate; }
-    int get_channels() const { return target_channels; }
+    int get_sample_rate() const { return decoder.get_sample_rate(); }
+    int get_channels() const { return decoder.get_channels(); }
+
+    // Per-stage timings (demux, send_packet, receive_frame, swr_convert,
+    // pcm_resize). Disabled by default; collection is free while off.
+    void set_stats_enabled(bool p_enabled);
+    bool is_stats_enabled() const;
+    void reset_stats();
+    Dictionary get_stats() const;
 };
 
+// Streams decode -> resample -> encode -> mux chunk by chunk; see
+// gdffmpeg::AudioTranscoder.
 class FFmpegAudioTranscoder : public RefCounted {
     GDCLASS(FFmpegAudioTranscoder, RefCounted);
 
 private:
-    String input_codec;
-    String output_codec;
-    int output_sample_rate = 0;
-    int output_channels = 0;
+    gdffmpeg::AudioTranscoder transcoder;
 
 protected:
     static void _bind_methods();
@@ -83,9 +72,17 @@ public:
     void set_output_codec(const String &p_codec_name);
     void set_output_sample_rate(int p_rate);
     void set_output_channels(int p_channels);
+    void set_bit_rate(int64_t p_bit_rate);
+
+    // Decode on a separate thread while the caller encodes and muxes.
+    void set_threaded(bool p_enabled);
+    // Upper bound on sample frames waiting between decoder and encoder.
+    void set_max_buffered_samples(int p_samples);
 
-    // Returns 0 on success.
+    // The container is picked from the output extension (.m4a, .aac, .mp3,
+    // .ogg, ...). Returns 0 on success.
     int transcode_file(const String &p_input_path, const String &p_output_path);
+    int64_t get_samples_transcoded() const;
 };
 
 } // namespace godot
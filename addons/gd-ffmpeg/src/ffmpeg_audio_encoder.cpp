@@ -1,4 +1,5 @@
 #include "ffmpeg_audio_encoder.h"
+#include "ffmpeg_buffers.h"
 
 #include <godot_cpp/variant/utility_functions.hpp>
 #include <godot_cpp/variant/variant.hpp>
@@ -8,40 +9,6 @@
 
 namespace godot {
 
-static void log_ffmpeg(const String &msg) {
-    UtilityFunctions::print("[FFmpegAudioEncoder] ", msg);
-}
-
-static void apply_option_to_target(void *p_target, const char *p_key, const Variant &p_value) {
-    if (!p_target || p_value.get_type() == Variant::NIL) {
-        return;
-    }
-
-    int err = 0;
-    switch (p_value.get_type()) {
-        case Variant::INT:
-            err = av_opt_set_int(p_target, p_key, static_cast<int64_t>(p_value), 0);
-            break;
-        case Variant::FLOAT:
-            err = av_opt_set_double(p_target, p_key, static_cast<double>(p_value), 0);
-            break;
-        case Variant::BOOL:
-            err = av_opt_set_int(p_target, p_key, bool(p_value) ? 1 : 0, 0);
-            break;
-        default: {
-            const CharString utf8_value = String(p_value).utf8();
-            err = av_opt_set(p_target, p_key, utf8_value.get_data(), 0);
-            break;
-        }
-    }
-
-    if (err < 0) {
-        char err_buf[AV_ERROR_MAX_STRING_SIZE];
-        av_strerror(err, err_buf, sizeof(err_buf));
-        log_ffmpeg("Could not apply option '" + String(p_key) + "' (" + String(err_buf) + ")");
-    }
-}
-
 // Convert an Array of frames into interleaved PCM.
 // To avoid AudioFrame (which your bindings don't have), we accept:
 //  - Dictionary { "left": float, "right": float }
@@ -145,36 +112,6 @@ static PackedFloat32Array audio_stream_to_pcm(const Ref<AudioStream> &p_stream,
     return pcm;
 }
 
-static void apply_option_to_encoder(AVCodecContext *p_ctx, const char *p_key, const Variant &p_value) {
-    if (!p_ctx) {
-        return;
-    }
-    apply_option_to_target(p_ctx, p_key, p_value);
-    if (p_ctx->priv_data) {
-        apply_option_to_target(p_ctx->priv_data, p_key, p_value);
-    }
-}
-
-FFmpegAudioEncoder::FFmpegAudioEncoder() {
-    av_log_set_level(AV_LOG_ERROR);
-}
-
-FFmpegAudioEncoder::~FFmpegAudioEncoder() {
-    if (packet) {
-        av_packet_free(&packet);
-        packet = nullptr;
-    }
-    if (frame) {
-        av_frame_free(&frame);
-        frame = nullptr;
-    }
-    if (codec_ctx) {
-        avcodec_free_context(&codec_ctx);
-        codec_ctx = nullptr;
-    }
-    initialized = false;
-}
-
 void FFmpegAudioEncoder::_bind_methods() {
     ClassDB::bind_method(
         D_METHOD("setup_encoder", "codec_name", "sample_rate", "channels", "bit_rate", "options"),
@@ -192,6 +129,10 @@ void FFmpegAudioEncoder::_bind_methods() {
         D_METHOD("encode_stream_peer", "stream_peer", "bytes"),
         &FFmpegAudioEncoder::encode_stream_peer
     );
+    ClassDB::bind_method(
+        D_METHOD("push_frame", "frame"),
+        &FFmpegAudioEncoder::push_frame
+    );
     ClassDB::bind_method(
         D_METHOD("encode_audio_frames", "frames"),
         &FFmpegAudioEncoder::encode_audio_frames
@@ -232,273 +173,90 @@ void FFmpegAudioEncoder::_bind_methods() {
         D_METHOD("flush"),
         &FFmpegAudioEncoder::flush
     );
+    ClassDB::bind_method(
+        D_METHOD("set_packet_callback", "callable"),
+        &FFmpegAudioEncoder::set_packet_callback
+    );
+    ClassDB::bind_method(
+        D_METHOD("get_packet_callback"),
+        &FFmpegAudioEncoder::get_packet_callback
+    );
 }
 
 int FFmpegAudioEncoder::setup_encoder(const String &p_codec_name, int p_sample_rate, int p_channels, int p_bit_rate, const Dictionary &p_options) {
-    // Clean any previous encoder state
-    if (packet) {
-        av_packet_free(&packet);
-        packet = nullptr;
-    }
-    if (frame) {
-        av_frame_free(&frame);
-        frame = nullptr;
-    }
-    if (codec_ctx) {
-        avcodec_free_context(&codec_ctx);
-        codec_ctx = nullptr;
-    }
-    initialized = false;
+    gdffmpeg::AudioEncoderOptions options;
+    options.codec_name = p_codec_name.utf8().get_data();
+    options.sample_rate = p_sample_rate;
+    options.channels = p_channels;
+    options.bit_rate = p_bit_rate;
 
-    int target_bit_rate = p_bit_rate;
     if (p_options.has("bit_rate")) {
         const Variant opt_br = p_options["bit_rate"];
         const Variant::Type t = opt_br.get_type();
         if (t == Variant::INT || t == Variant::FLOAT) {
-            target_bit_rate = static_cast<int>(double(opt_br));
+            options.bit_rate = static_cast<int64_t>(double(opt_br));
         }
     }
 
-    if (p_sample_rate <= 0 || p_channels <= 0 || target_bit_rate <= 0) {
-        log_ffmpeg("Invalid encoder parameters");
-        return 1;
-    }
-
-    String bitrate_mode = "cbr";
     if (p_options.has("bitrate_mode")) {
-        bitrate_mode = String(p_options["bitrate_mode"]).to_lower();
+        options.bitrate_mode = String(p_options["bitrate_mode"]).to_lower().utf8().get_data();
     }
 
-    int quality = -1;
     if (p_options.has("quality")) {
         Variant vq = p_options["quality"];
         const Variant::Type qt = vq.get_type();
         if (qt == Variant::INT || qt == Variant::FLOAT) {
-            quality = static_cast<int>(double(vq));
+            options.quality = static_cast<int>(double(vq));
         }
     }
 
-    const String profile = p_options.has("profile") ? String(p_options["profile"]) : String();
-    const String preset = p_options.has("preset") ? String(p_options["preset"]) : String();
-
-    const CharString codec_name_utf8 = p_codec_name.utf8();
-    const AVCodec *codec = avcodec_find_encoder_by_name(codec_name_utf8.get_data());
-    if (!codec) {
-        log_ffmpeg("Encoder not found: " + p_codec_name);
-        return 2;
+    if (p_options.has("profile")) {
+        options.profile = String(p_options["profile"]).utf8().get_data();
     }
-
-    codec_ctx = avcodec_alloc_context3(codec);
-    if (!codec_ctx) {
-        log_ffmpeg("Failed to allocate codec context");
-        return 3;
+    if (p_options.has("preset")) {
+        options.preset = String(p_options["preset"]).utf8().get_data();
     }
-
-    sample_rate = p_sample_rate;
-    channels = p_channels;
-
-    codec_ctx->sample_rate = sample_rate;
-    codec_ctx->bit_rate = target_bit_rate;
-
-    // ---------- Channel layout (FFmpeg 5+/8 style: AVChannelLayout) ----------
-    if (channels == 1) {
-        codec_ctx->ch_layout = AV_CHANNEL_LAYOUT_MONO;
-    } else if (channels == 2) {
-        codec_ctx->ch_layout = AV_CHANNEL_LAYOUT_STEREO;
-    } else {
-        log_ffmpeg("Only mono and stereo channel layouts are supported in this example");
-        return 4;
+    if (p_options.has("global_header")) {
+        options.global_header = bool(p_options["global_header"]);
     }
 
-    // ---------- Sample format (prefer float formats we implement) ----------
-    if (codec->sample_fmts && codec->sample_fmts[0] != AV_SAMPLE_FMT_NONE) {
-        AVSampleFormat chosen = AV_SAMPLE_FMT_NONE;
-
-        // First: look for planar float
-        const AVSampleFormat *p = codec->sample_fmts;
-        while (*p != AV_SAMPLE_FMT_NONE) {
-            if (*p == AV_SAMPLE_FMT_FLTP) {
-                chosen = *p;
-                break;
-            }
-            p++;
-        }
-
-        // Second: look for interleaved float
-        if (chosen == AV_SAMPLE_FMT_NONE) {
-            p = codec->sample_fmts;
-            while (*p != AV_SAMPLE_FMT_NONE) {
-                if (*p == AV_SAMPLE_FMT_FLT) {
-                    chosen = *p;
-                    break;
-                }
-                p++;
-            }
-        }
-
-        // Fallback: first available
-        if (chosen == AV_SAMPLE_FMT_NONE) {
-            chosen = codec->sample_fmts[0];
-        }
+    packet_codec_parameters.reset();
+    return encoder.setup(options);
+}
 
-        sample_fmt = chosen;
-        log_ffmpeg("Using encoder sample format: " + String::num_int64(sample_fmt));
-    } else {
-        // Encoder did not report formats; assume planar float
-        sample_fmt = AV_SAMPLE_FMT_FLTP;
-        log_ffmpeg("Encoder did not report sample_fmts; assuming AV_SAMPLE_FMT_FLTP");
+void FFmpegAudioEncoder::handle_packet(const AVPacket *p_packet) {
+    output_buffer.append(p_packet->data, p_packet->size);
+    if (!packet_callback.is_valid()) {
+        return;
     }
-
-    codec_ctx->sample_fmt = sample_fmt;
-
-    // ---------- Rate control / quality options ----------
-    if (!profile.is_empty()) {
-        apply_option_to_encoder(codec_ctx, "profile", profile);
+    if (!packet_codec_parameters) {
+        packet_codec_parameters = FFmpegPacket::make_codec_parameters(encoder.get_codec_context());
     }
-    if (!preset.is_empty()) {
-        apply_option_to_encoder(codec_ctx, "preset", preset);
-    }
-
-    if (bitrate_mode == "vbr") {
-        apply_option_to_encoder(codec_ctx, "vbr", true);
-        if (quality >= 0) {
-            apply_option_to_encoder(codec_ctx, "compression_level", quality);
-            apply_option_to_encoder(codec_ctx, "q", quality);
-        }
-    } else {
-        apply_option_to_encoder(codec_ctx, "vbr", false);
-    }
-
-    // Open encoder
-    if (avcodec_open2(codec_ctx, codec, nullptr) < 0) {
-        log_ffmpeg("Failed to open codec");
-        avcodec_free_context(&codec_ctx);
-        codec_ctx = nullptr;
-        return 5;
+    Ref<FFmpegPacket> wrapped = FFmpegPacket::create(p_packet, encoder.get_time_base(), 0, packet_codec_parameters);
+    if (wrapped.is_valid()) {
+        packet_callback.call(wrapped);
     }
+}
 
-    frame = av_frame_alloc();
-    if (!frame) {
-        log_ffmpeg("Failed to allocate frame");
-        return 6;
-    }
+void FFmpegAudioEncoder::set_packet_callback(const Callable &p_callable) {
+    packet_callback = p_callable;
+}
 
-    packet = av_packet_alloc();
-    if (!packet) {
-        log_ffmpeg("Failed to allocate packet");
-        av_frame_free(&frame);
-        frame = nullptr;
-        return 7;
-    }
+Callable FFmpegAudioEncoder::get_packet_callback() const {
+    return packet_callback;
+}
 
-    frame_size = codec_ctx->frame_size > 0 ? codec_ctx->frame_size : 1024;
-    initialized = true;
-    return 0;
+PackedByteArray FFmpegAudioEncoder::take_output() {
+    const PackedByteArray output = chunked_buffer_to_packed(output_buffer);
+    output_buffer.clear();
+    return output;
 }
 
 PackedByteArray FFmpegAudioEncoder::encode(const PackedFloat32Array &p_pcm_interleaved) {
-    PackedByteArray output;
-
-    if (!initialized || !codec_ctx || !frame || !packet) {
-        log_ffmpeg("Encoder not initialized");
-        return output;
-    }
-
-    const int total_floats = p_pcm_interleaved.size();
-    if (total_floats <= 0 || channels <= 0) {
-        return output;
-    }
-
-    if (total_floats % channels != 0) {
-        log_ffmpeg("PCM array size is not divisible by channel count; truncating last partial frame");
-    }
-
-    const int total_samples = total_floats / channels;
-
-    // Allocate frame buffers for the maximum chunk size
-    frame->nb_samples = frame_size;
-    frame->format = codec_ctx->sample_fmt;
-    frame->sample_rate = codec_ctx->sample_rate;
-    frame->ch_layout = codec_ctx->ch_layout;
-
-    if (av_frame_get_buffer(frame, 0) < 0) {
-        log_ffmpeg("Failed to allocate frame buffer");
-        return output;
-    }
-
-    const float *src = p_pcm_interleaved.ptr();
-    int sample_pos = 0;
-
-    while (sample_pos < total_samples) {
-        const int remaining = total_samples - sample_pos;
-        const int nb = remaining < frame_size ? remaining : frame_size;
-
-        if (av_frame_make_writable(frame) < 0) {
-            log_ffmpeg("Frame not writable");
-            av_frame_unref(frame);
-            break;
-        }
-
-        // Actual number of samples we are sending this iteration
-        frame->nb_samples = nb;
-
-        if (sample_fmt == AV_SAMPLE_FMT_FLT) {
-            // Interleaved float: [L,R,L,R,...]
-            float *dst = reinterpret_cast<float *>(frame->data[0]);
-            const int samples_interleaved = nb * channels;
-            const int src_offset = sample_pos * channels;
-            std::memcpy(
-                dst,
-                src + src_offset,
-                samples_interleaved * sizeof(float)
-            );
-        } else if (sample_fmt == AV_SAMPLE_FMT_FLTP) {
-            // Planar float: data[c] is a separate plane
-            for (int c = 0; c < channels; ++c) {
-                float *dst_ch = reinterpret_cast<float *>(frame->data[c]);
-                for (int s = 0; s < nb; ++s) {
-                    const int src_index = (sample_pos + s) * channels + c;
-                    dst_ch[s] = src[src_index];
-                }
-            }
-        } else {
-            log_ffmpeg("Only FLT and FLTP formats are implemented in this example");
-            av_frame_unref(frame);
-            return output;
-        }
-
-        // Send frame
-        int ret = avcodec_send_frame(codec_ctx, frame);
-        if (ret < 0) {
-            log_ffmpeg("Error sending frame to encoder");
-            av_frame_unref(frame);
-            break;
-        }
-
-        // Read all available packets after this frame
-        while (ret >= 0) {
-            ret = avcodec_receive_packet(codec_ctx, packet);
-            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-                break;
-            } else if (ret < 0) {
-                log_ffmpeg("Error receiving packet from encoder");
-                break;
-            }
-
-            if (packet->size > 0 && packet->data) {
-                const int old_size = output.size();
-                output.resize(old_size + packet->size);
-                std::memcpy(output.ptrw() + old_size, packet->data, packet->size);
-            }
-
-            av_packet_unref(packet);
-        }
-
-        sample_pos += nb;
-    }
-
-    av_frame_unref(frame);
-    return output;
+    encoder.encode(p_pcm_interleaved.ptr(), p_pcm_interleaved.size(), [this](const AVPacket *p_packet) {
+        handle_packet(p_packet);
+    });
+    return take_output();
 }
 
 PackedByteArray FFmpegAudioEncoder::encode_bytes(const PackedByteArray &p_pcm_bytes) {
@@ -536,9 +294,22 @@ PackedByteArray FFmpegAudioEncoder::encode_stream_peer(const Ref<StreamPeer> &p_
     return encode_bytes(raw);
 }
 
+PackedByteArray FFmpegAudioEncoder::push_frame(const Ref<FFmpegFrame> &p_frame) {
+    if (p_frame.is_null() || !p_frame->is_audio()) {
+        UtilityFunctions::printerr("[FFmpegAudioEncoder] push_frame expects an audio FFmpegFrame");
+        return PackedByteArray();
+    }
+    if (p_frame->get_sample_rate() != encoder.get_sample_rate() || p_frame->get_channels() != encoder.get_channels()) {
+        UtilityFunctions::printerr("[FFmpegAudioEncoder] Frame sample rate/channels do not match the encoder");
+        return PackedByteArray();
+    }
+    // The encoder consumes interleaved float; to_pcm() is the single
+    // conversion from the decoder's sample format.
+    return encode(p_frame->to_pcm());
+}
 
 PackedByteArray FFmpegAudioEncoder::encode_audio_frames(const Array &p_frames) {
-    PackedFloat32Array pcm = frames_to_pcm(p_frames, channels);
+    PackedFloat32Array pcm = frames_to_pcm(p_frames, encoder.get_channels());
     return encode(pcm);
 }
 
@@ -551,7 +322,7 @@ PackedByteArray FFmpegAudioEncoder::encode_audio_stream(const Ref<AudioStream> &
         return PackedByteArray();
     }
 
-    if ((stream_rate > 0 && stream_rate != sample_rate) || (stream_channels > 0 && stream_channels != channels)) {
+    if ((stream_rate > 0 && stream_rate != encoder.get_sample_rate()) || (stream_channels > 0 && stream_channels != encoder.get_channels())) {
         UtilityFunctions::printerr("[FFmpegAudioEncoder] AudioStream format does not match encoder setup");
         return PackedByteArray();
     }
@@ -653,32 +424,10 @@ int FFmpegAudioEncoder::encode_pcm_bytes_to_file_access(const PackedByteArray &p
 }
 
 PackedByteArray FFmpegAudioEncoder::flush() {
-    PackedByteArray output;
-    if (!initialized || !codec_ctx || !packet) {
-        return output;
-    }
-
-    int ret = avcodec_send_frame(codec_ctx, nullptr);
-    if (ret < 0) {
-        return output;
-    }
-
-    while (true) {
-        ret = avcodec_receive_packet(codec_ctx, packet);
-        if (ret == AVERROR_EOF || ret == AVERROR(EAGAIN)) {
-            break;
-        }
-        if (ret < 0) {
-            break;
-        }
-
-        const int old_size = output.size();
-        output.resize(old_size + packet->size);
-        std::memcpy(output.ptrw() + old_size, packet->data, packet->size);
-        av_packet_unref(packet);
-    }
-
-    return output;
+    encoder.flush([this](const AVPacket *p_packet) {
+        handle_packet(p_packet);
+    });
+    return take_output();
 }
 
 } // namespace godot
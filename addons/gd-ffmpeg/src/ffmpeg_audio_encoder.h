@@ -6,16 +6,16 @@
 #include <godot_cpp/classes/audio_stream_wav.hpp>
 #include <godot_cpp/classes/file_access.hpp>
 #include <godot_cpp/classes/stream_peer.hpp>
+#include <godot_cpp/variant/callable.hpp>
 #include <godot_cpp/variant/dictionary.hpp>
 #include <godot_cpp/variant/packed_float32_array.hpp>
 #include <godot_cpp/variant/packed_byte_array.hpp>
 
-extern "C" {
-    #include <libavcodec/avcodec.h>
-    #include <libavutil/opt.h>
-    #include <libavutil/channel_layout.h>
-    #include <libavutil/error.h>
-}
+#include "ffmpeg_frame.h"
+#include "ffmpeg_packet.h"
+
+#include "core/audio_encoder.h"
+#include "core/chunked_buffer.h"
 
 namespace godot {
 
@@ -23,24 +23,24 @@ class FFmpegAudioEncoder : public RefCounted {
     GDCLASS(FFmpegAudioEncoder, RefCounted);
 
 private:
-    AVCodecContext *codec_ctx = nullptr;
-    AVFrame *frame = nullptr;
-    AVPacket *packet = nullptr;
+    gdffmpeg::AudioEncoder encoder;
+    // Reused by encode()/flush(); packets are gathered here and copied into
+    // the returned array once.
+    gdffmpeg::ChunkedBuffer output_buffer;
+    Callable packet_callback;
+    SharedCodecParameters packet_codec_parameters;
 
-    int sample_rate = 0;
-    int channels = 0;
-    AVSampleFormat sample_fmt = AV_SAMPLE_FMT_NONE;
-    bool initialized = false;
-    int frame_size = 1024;
+    void handle_packet(const AVPacket *p_packet);
+    PackedByteArray take_output();
 
 protected:
     static void _bind_methods();
 
 public:
-    FFmpegAudioEncoder();
-    ~FFmpegAudioEncoder();
-
-    // Returns 0 on success, non-zero on error.
+    // p_options may override bit_rate and set bitrate_mode, quality, profile,
+    // preset and global_header (true when the packets go to an FFmpegMuxer
+    // whose needs_global_header() is true). Returns 0 on success, non-zero
+    // on error.
     int setup_encoder(const String &p_codec_name, int p_sample_rate, int p_channels, int p_bit_rate, const Dictionary &p_options = Dictionary());
 
     // Input: interleaved float32 PCM (L, R, L, R, ...) with the same
@@ -48,6 +48,9 @@ public:
     PackedByteArray encode(const PackedFloat32Array &p_pcm_interleaved);
     PackedByteArray encode_bytes(const PackedByteArray &p_pcm_bytes);
     PackedByteArray encode_stream_peer(const Ref<StreamPeer> &p_stream_peer, int p_bytes = -1);
+    // Encodes a decoded audio frame. Its sample rate and channel count must
+    // match setup_encoder().
+    PackedByteArray push_frame(const Ref<FFmpegFrame> &p_frame);
 
     // Convenience overloads for Godot-native data.
     PackedByteArray encode_audio_frames(const Array &p_frames);
@@ -64,6 +67,11 @@ public:
 
     // Flush any remaining buffered data from the encoder.
     PackedByteArray flush();
+
+    // Called with an FFmpegPacket for every packet encode()/flush() produce,
+    // in addition to the returned bytes.
+    void set_packet_callback(const Callable &p_callable);
+    Callable get_packet_callback() const;
 };
 
 } // namespace godot
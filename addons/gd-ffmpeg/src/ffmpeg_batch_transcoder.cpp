@@ -0,0 +1,173 @@
+#include "ffmpeg_batch_transcoder.h"
+
+#include <godot_cpp/classes/project_settings.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
+
+extern "C" {
+    #include <libavutil/pixdesc.h>
+}
+
+namespace godot {
+
+static void log_batch(const String &p_msg) {
+    UtilityFunctions::print("[FFmpegBatchTranscoder] ", p_msg);
+}
+
+void FFmpegBatchTranscoder::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("add_audio_job", "input_path", "output_path", "settings"), &FFmpegBatchTranscoder::add_audio_job, DEFVAL(Dictionary()));
+    ClassDB::bind_method(D_METHOD("add_video_job", "input_path", "output_path", "settings"), &FFmpegBatchTranscoder::add_video_job, DEFVAL(Dictionary()));
+    ClassDB::bind_method(D_METHOD("clear_jobs"), &FFmpegBatchTranscoder::clear_jobs);
+    ClassDB::bind_method(D_METHOD("get_job_count"), &FFmpegBatchTranscoder::get_job_count);
+    ClassDB::bind_method(D_METHOD("set_worker_count", "workers"), &FFmpegBatchTranscoder::set_worker_count);
+    ClassDB::bind_method(D_METHOD("get_worker_count"), &FFmpegBatchTranscoder::get_worker_count);
+    ClassDB::bind_method(D_METHOD("start"), &FFmpegBatchTranscoder::start);
+    ClassDB::bind_method(D_METHOD("wait"), &FFmpegBatchTranscoder::wait);
+    ClassDB::bind_method(D_METHOD("cancel"), &FFmpegBatchTranscoder::cancel);
+    ClassDB::bind_method(D_METHOD("is_running"), &FFmpegBatchTranscoder::is_running);
+
+    ADD_SIGNAL(MethodInfo("job_started", PropertyInfo(Variant::INT, "job_id")));
+    ADD_SIGNAL(MethodInfo("job_progress", PropertyInfo(Variant::INT, "job_id"), PropertyInfo(Variant::FLOAT, "progress")));
+    ADD_SIGNAL(MethodInfo("job_finished", PropertyInfo(Variant::INT, "job_id"), PropertyInfo(Variant::INT, "error")));
+    ADD_SIGNAL(MethodInfo("batch_finished", PropertyInfo(Variant::INT, "failed_jobs")));
+}
+
+FFmpegBatchTranscoder::FFmpegBatchTranscoder() {
+    // Every callback runs on a worker thread, so the signals are emitted on
+    // the next idle frame.
+    batch.set_job_started_callback([this](int p_job) {
+        call_deferred("emit_signal", "job_started", p_job);
+    });
+    batch.set_job_progress_callback([this](int p_job, double p_progress) {
+        call_deferred("emit_signal", "job_progress", p_job, p_progress);
+    });
+    batch.set_job_finished_callback([this](int p_job, int p_error) {
+        call_deferred("emit_signal", "job_finished", p_job, p_error);
+    });
+    batch.set_batch_finished_callback([this](int p_failed_jobs) {
+        call_deferred("emit_signal", "batch_finished", p_failed_jobs);
+    });
+}
+
+FFmpegBatchTranscoder::~FFmpegBatchTranscoder() {
+    // The callbacks hold this object; none may queue a signal once it is
+    // going away. The batch then cancels, and its running jobs stop after
+    // their current frame.
+    batch.clear_callbacks();
+}
+
+void FFmpegBatchTranscoder::apply_common_settings(const Dictionary &p_settings, gdffmpeg::TranscodeJob &r_job) {
+    if (p_settings.has("input_codec")) {
+        r_job.input_codec = String(p_settings["input_codec"]).utf8().get_data();
+    }
+}
+
+int FFmpegBatchTranscoder::add_audio_job(const String &p_input_path, const String &p_output_path, const Dictionary &p_settings) {
+    ProjectSettings *settings = ProjectSettings::get_singleton();
+    gdffmpeg::TranscodeJob job;
+    job.kind = gdffmpeg::TranscodeJob::KIND_AUDIO;
+    job.input = settings->globalize_path(p_input_path).utf8().get_data();
+    job.output = settings->globalize_path(p_output_path).utf8().get_data();
+    apply_common_settings(p_settings, job);
+
+    if (p_settings.has("codec")) {
+        job.audio.codec_name = String(p_settings["codec"]).utf8().get_data();
+    }
+    if (p_settings.has("bit_rate")) {
+        job.audio.bit_rate = p_settings["bit_rate"];
+    }
+    if (p_settings.has("sample_rate")) {
+        job.audio.sample_rate = p_settings["sample_rate"];
+    }
+    if (p_settings.has("channels")) {
+        job.audio.channels = p_settings["channels"];
+    }
+    return batch.add_job(job);
+}
+
+int FFmpegBatchTranscoder::add_video_job(const String &p_input_path, const String &p_output_path, const Dictionary &p_settings) {
+    ProjectSettings *settings = ProjectSettings::get_singleton();
+    gdffmpeg::TranscodeJob job;
+    job.kind = gdffmpeg::TranscodeJob::KIND_VIDEO;
+    job.input = settings->globalize_path(p_input_path).utf8().get_data();
+    job.output = settings->globalize_path(p_output_path).utf8().get_data();
+    apply_common_settings(p_settings, job);
+
+    if (p_settings.has("codec")) {
+        job.video.codec_name = String(p_settings["codec"]).utf8().get_data();
+    }
+    if (p_settings.has("pixel_format")) {
+        const String name = p_settings["pixel_format"];
+        const AVPixelFormat fmt = av_get_pix_fmt(name.to_lower().utf8().get_data());
+        if (fmt == AV_PIX_FMT_NONE) {
+            log_batch("Unknown pixel format: " + name);
+            return -1;
+        }
+        job.video.pix_fmt = fmt;
+    }
+    if (p_settings.has("frame_rate")) {
+        job.frame_rate = p_settings["frame_rate"];
+    }
+    if (p_settings.has("width")) {
+        job.video.width = p_settings["width"];
+    }
+    if (p_settings.has("height")) {
+        job.video.height = p_settings["height"];
+    }
+    if (p_settings.has("bit_rate")) {
+        job.video.bit_rate = p_settings["bit_rate"];
+    }
+    if (p_settings.has("rate_control_mode")) {
+        job.video.rate_control_mode = String(p_settings["rate_control_mode"]).to_lower().utf8().get_data();
+    }
+    if (p_settings.has("quality")) {
+        job.video.quality = p_settings["quality"];
+    }
+    if (p_settings.has("preset")) {
+        job.video.preset = String(p_settings["preset"]).utf8().get_data();
+    }
+    if (p_settings.has("keyframe_interval")) {
+        job.video.keyframe_interval = p_settings["keyframe_interval"];
+    }
+    if (p_settings.has("threads")) {
+        job.video.thread_count = p_settings["threads"];
+    }
+    return batch.add_job(job);
+}
+
+void FFmpegBatchTranscoder::clear_jobs() {
+    batch.clear_jobs();
+}
+
+int FFmpegBatchTranscoder::get_job_count() const {
+    return batch.get_job_count();
+}
+
+void FFmpegBatchTranscoder::set_worker_count(int p_workers) {
+    batch.set_worker_count(p_workers > 0 ? p_workers : 0);
+}
+
+int FFmpegBatchTranscoder::get_worker_count() const {
+    return batch.get_worker_count();
+}
+
+int FFmpegBatchTranscoder::start() {
+    const int result = batch.start();
+    if (result != 0) {
+        log_batch("Failed to start batch: " + String::num_int64(result));
+    }
+    return result;
+}
+
+void FFmpegBatchTranscoder::wait() {
+    batch.wait();
+}
+
+void FFmpegBatchTranscoder::cancel() {
+    batch.cancel();
+}
+
+bool FFmpegBatchTranscoder::is_running() const {
+    return batch.is_running();
+}
+
+} // namespace godot
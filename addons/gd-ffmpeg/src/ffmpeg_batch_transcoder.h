@@ -0,0 +1,51 @@
+#pragma once
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+
+#include "core/batch_transcoder.h"
+
+namespace godot {
+
+// Queue of file transcodes run in parallel on a worker pool; see
+// gdffmpeg::BatchTranscoder. Progress and results arrive as signals on the
+// main thread.
+class FFmpegBatchTranscoder : public RefCounted {
+    GDCLASS(FFmpegBatchTranscoder, RefCounted);
+
+private:
+    gdffmpeg::BatchTranscoder batch;
+
+    static void apply_common_settings(const Dictionary &p_settings, gdffmpeg::TranscodeJob &r_job);
+
+protected:
+    static void _bind_methods();
+
+public:
+    FFmpegBatchTranscoder();
+    ~FFmpegBatchTranscoder();
+
+    // p_settings keys (all optional): "codec", "bit_rate", "sample_rate",
+    // "channels", "input_codec". Returns the job id, or -1.
+    int add_audio_job(const String &p_input_path, const String &p_output_path, const Dictionary &p_settings);
+    // p_settings keys (all optional): "codec", "pixel_format", "frame_rate",
+    // "width", "height", "bit_rate", "rate_control_mode", "quality",
+    // "preset", "keyframe_interval", "threads", "input_codec". Returns the
+    // job id, or -1.
+    int add_video_job(const String &p_input_path, const String &p_output_path, const Dictionary &p_settings);
+    void clear_jobs();
+    int get_job_count() const;
+
+    // Jobs run at once; 0 uses one per core.
+    void set_worker_count(int p_workers);
+    int get_worker_count() const;
+
+    // Returns 0 once the workers are started.
+    int start();
+    void wait();
+    void cancel();
+    bool is_running() const;
+};
+
+} // namespace godot
@@ -0,0 +1,69 @@
+#include "ffmpeg_buffers.h"
+
+#include <cstring>
+
+namespace godot {
+
+PackedByteArray chunked_buffer_to_packed(const gdffmpeg::ChunkedBuffer &p_buffer) {
+    PackedByteArray bytes;
+    if (!p_buffer.empty()) {
+        bytes.resize(static_cast<int64_t>(p_buffer.size()));
+        p_buffer.copy_to(bytes.ptrw());
+    }
+    return bytes;
+}
+
+void GodotOutputSink::write(const uint8_t *p_data, int p_size) {
+    if (deferred) {
+        std::lock_guard<std::mutex> lock(backlog_mutex);
+        backlog.insert(backlog.end(), p_data, p_data + p_size);
+        return;
+    }
+    forward(p_data, p_size);
+}
+
+void GodotOutputSink::flush_backlog() {
+    std::vector<uint8_t> ready;
+    {
+        std::lock_guard<std::mutex> lock(backlog_mutex);
+        ready.swap(backlog);
+    }
+    if (!ready.empty()) {
+        forward(ready.data(), static_cast<int>(ready.size()));
+    }
+}
+
+void GodotOutputSink::forward(const uint8_t *p_data, int p_size) {
+    pending_output.append(p_data, p_size);
+    if (collecting_output) {
+        full_output.append(p_data, p_size);
+    }
+
+    if (stream_peer.is_null() && file_access.is_null()) {
+        return;
+    }
+    PackedByteArray chunk;
+    chunk.resize(p_size);
+    memcpy(chunk.ptrw(), p_data, p_size);
+
+    if (stream_peer.is_valid()) {
+        stream_peer->put_data(chunk);
+    }
+
+    if (file_access.is_valid()) {
+        file_access->store_buffer(chunk);
+    }
+}
+
+void GodotOutputSink::clear() {
+    pending_output.clear();
+    full_output.release();
+    collecting_output = false;
+    deferred = false;
+    stream_peer = Ref<StreamPeer>();
+    file_access = Ref<FileAccess>();
+    std::lock_guard<std::mutex> lock(backlog_mutex);
+    backlog.clear();
+}
+
+} // namespace godot
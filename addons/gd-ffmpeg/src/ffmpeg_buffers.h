@@ -0,0 +1,44 @@
+#pragma once
+
+#include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/classes/stream_peer.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+
+#include "core/chunked_buffer.h"
+#include "core/muxer.h"
+
+#include <mutex>
+#include <vector>
+
+namespace godot {
+
+// Materialises everything appended to p_buffer as one PackedByteArray.
+PackedByteArray chunked_buffer_to_packed(const gdffmpeg::ChunkedBuffer &p_buffer);
+
+// Routes muxed bytes to the per-call result, the whole-file result and any
+// StreamPeer/FileAccess given to begin(). In deferred mode the muxing thread
+// only appends to a backlog; flush_backlog() forwards it on the caller's
+// thread so Godot objects are never touched off the main thread.
+class GodotOutputSink : public gdffmpeg::OutputSink {
+public:
+    // Output of the current push/end call, and of the whole session when
+    // collecting into memory. Materialised once per call.
+    gdffmpeg::ChunkedBuffer pending_output;
+    gdffmpeg::ChunkedBuffer full_output;
+    bool collecting_output = false;
+    bool deferred = false;
+    Ref<StreamPeer> stream_peer;
+    Ref<FileAccess> file_access;
+
+    void write(const uint8_t *p_data, int p_size) override;
+    void flush_backlog();
+    void clear();
+
+private:
+    std::mutex backlog_mutex;
+    std::vector<uint8_t> backlog;
+
+    void forward(const uint8_t *p_data, int p_size);
+};
+
+} // namespace godot
@@ -0,0 +1,106 @@
+#include "ffmpeg_concat.h"
+
+#include <godot_cpp/classes/project_settings.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
+
+#include <string>
+#include <vector>
+
+#include "core/trace.h"
+
+namespace godot {
+
+static void log_concat(const String &p_msg) {
+    UtilityFunctions::print("[FFmpegConcat] ", p_msg);
+}
+
+static std::vector<std::string> globalize_paths(const PackedStringArray &p_paths) {
+    ProjectSettings *settings = ProjectSettings::get_singleton();
+    std::vector<std::string> paths;
+    paths.reserve(p_paths.size());
+    for (int64_t i = 0; i < p_paths.size(); i++) {
+        paths.push_back(settings->globalize_path(p_paths[i]).utf8().get_data());
+    }
+    return paths;
+}
+
+void FFmpegConcat::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("set_codec_name", "name"), &FFmpegConcat::set_codec_name);
+    ClassDB::bind_method(D_METHOD("set_preset", "preset"), &FFmpegConcat::set_preset);
+    ClassDB::bind_method(D_METHOD("set_rate_control_mode", "mode"), &FFmpegConcat::set_rate_control_mode);
+    ClassDB::bind_method(D_METHOD("set_quality", "value"), &FFmpegConcat::set_quality);
+    ClassDB::bind_method(D_METHOD("set_bit_rate", "bps"), &FFmpegConcat::set_bit_rate);
+    ClassDB::bind_method(D_METHOD("set_resolution", "width", "height"), &FFmpegConcat::set_resolution);
+    ClassDB::bind_method(D_METHOD("set_audio_codec", "name"), &FFmpegConcat::set_audio_codec);
+    ClassDB::bind_method(D_METHOD("set_audio_bit_rate", "bps"), &FFmpegConcat::set_audio_bit_rate);
+    ClassDB::bind_method(D_METHOD("set_thread_count", "threads"), &FFmpegConcat::set_thread_count);
+    ClassDB::bind_method(D_METHOD("set_force_reencode", "enabled"), &FFmpegConcat::set_force_reencode);
+    ClassDB::bind_method(D_METHOD("are_compatible", "paths"), &FFmpegConcat::are_compatible);
+    ClassDB::bind_method(D_METHOD("concat", "paths", "output_path"), &FFmpegConcat::concat);
+    ClassDB::bind_method(D_METHOD("was_stream_copied"), &FFmpegConcat::was_stream_copied);
+}
+
+void FFmpegConcat::set_codec_name(const String &p_name) {
+    concatenator.get_video_config().codec_name = p_name.utf8().get_data();
+}
+
+void FFmpegConcat::set_preset(const String &p_preset) {
+    concatenator.get_video_config().preset = p_preset.utf8().get_data();
+}
+
+void FFmpegConcat::set_rate_control_mode(const String &p_mode) {
+    concatenator.get_video_config().rate_control_mode = p_mode.to_lower().utf8().get_data();
+}
+
+void FFmpegConcat::set_quality(int p_quality) {
+    concatenator.get_video_config().quality = p_quality;
+}
+
+void FFmpegConcat::set_bit_rate(int64_t p_bit_rate) {
+    if (p_bit_rate > 0) {
+        concatenator.get_video_config().bit_rate = p_bit_rate;
+    }
+}
+
+void FFmpegConcat::set_resolution(int p_width, int p_height) {
+    if (p_width >= 0 && p_height >= 0) {
+        concatenator.get_video_config().width = p_width;
+        concatenator.get_video_config().height = p_height;
+    }
+}
+
+void FFmpegConcat::set_audio_codec(const String &p_name) {
+    concatenator.get_audio_options().codec_name = p_name.utf8().get_data();
+}
+
+void FFmpegConcat::set_audio_bit_rate(int64_t p_bit_rate) {
+    concatenator.get_audio_options().bit_rate = p_bit_rate;
+}
+
+void FFmpegConcat::set_thread_count(int p_threads) {
+    concatenator.set_thread_count(p_threads);
+}
+
+void FFmpegConcat::set_force_reencode(bool p_enabled) {
+    concatenator.set_force_reencode(p_enabled);
+}
+
+bool FFmpegConcat::are_compatible(const PackedStringArray &p_paths) const {
+    return gdffmpeg::Concatenator::are_compatible(globalize_paths(p_paths));
+}
+
+int FFmpegConcat::concat(const PackedStringArray &p_paths, const String &p_output_path) {
+    GDFFMPEG_TRACE_SCOPE("concat_files");
+    const CharString output = ProjectSettings::get_singleton()->globalize_path(p_output_path).utf8();
+    const int result = concatenator.concat(globalize_paths(p_paths), output.get_data());
+    if (result != 0) {
+        log_concat("Concat failed with code " + String::num_int64(result));
+    }
+    return result;
+}
+
+bool FFmpegConcat::was_stream_copied() const {
+    return concatenator.was_stream_copied();
+}
+
+} // namespace godot
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/packed_string_array.hpp>
+
+#include "core/concatenator.h"
+
+namespace godot {
+
+// Joins clips into one file, stream-copying when their parameters match and
+// re-encoding each clip in parallel otherwise; see gdffmpeg::Concatenator.
+class FFmpegConcat : public RefCounted {
+    GDCLASS(FFmpegConcat, RefCounted);
+
+private:
+    gdffmpeg::Concatenator concatenator;
+
+protected:
+    static void _bind_methods();
+
+public:
+    // Settings for the re-encode fallback.
+    void set_codec_name(const String &p_name);
+    void set_preset(const String &p_preset);
+    void set_rate_control_mode(const String &p_mode);
+    void set_quality(int p_quality);
+    void set_bit_rate(int64_t p_bit_rate);
+    // 0x0 takes the first clip's size.
+    void set_resolution(int p_width, int p_height);
+    void set_audio_codec(const String &p_name);
+    void set_audio_bit_rate(int64_t p_bit_rate);
+    // Clips re-encoded at once; 0 uses every core.
+    void set_thread_count(int p_threads);
+    void set_force_reencode(bool p_enabled);
+
+    // True when p_paths can be joined without re-encoding.
+    bool are_compatible(const PackedStringArray &p_paths) const;
+
+    // Returns 0 on success.
+    int concat(const PackedStringArray &p_paths, const String &p_output_path);
+    bool was_stream_copied() const;
+};
+
+} // namespace godot
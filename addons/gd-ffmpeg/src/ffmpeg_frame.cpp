@@ -0,0 +1,264 @@
+#include "ffmpeg_frame.h"
+
+#include <godot_cpp/variant/utility_functions.hpp>
+
+#include <cstring>
+
+extern "C" {
+    #include <libavutil/imgutils.h>
+    #include <libavutil/pixdesc.h>
+    #include <libavutil/samplefmt.h>
+    #include <libswresample/swresample.h>
+    #include <libswscale/swscale.h>
+}
+
+namespace godot {
+
+static void log_frame(const String &p_msg) {
+    UtilityFunctions::print("[FFmpegFrame] ", p_msg);
+}
+
+void FFmpegFrame::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("is_video"), &FFmpegFrame::is_video);
+    ClassDB::bind_method(D_METHOD("is_audio"), &FFmpegFrame::is_audio);
+    ClassDB::bind_method(D_METHOD("get_format_name"), &FFmpegFrame::get_format_name);
+    ClassDB::bind_method(D_METHOD("get_pts"), &FFmpegFrame::get_pts);
+    ClassDB::bind_method(D_METHOD("get_pts_seconds"), &FFmpegFrame::get_pts_seconds);
+    ClassDB::bind_method(D_METHOD("get_time_base_num"), &FFmpegFrame::get_time_base_num);
+    ClassDB::bind_method(D_METHOD("get_time_base_den"), &FFmpegFrame::get_time_base_den);
+    ClassDB::bind_method(D_METHOD("get_width"), &FFmpegFrame::get_width);
+    ClassDB::bind_method(D_METHOD("get_height"), &FFmpegFrame::get_height);
+    ClassDB::bind_method(D_METHOD("get_sample_rate"), &FFmpegFrame::get_sample_rate);
+    ClassDB::bind_method(D_METHOD("get_channels"), &FFmpegFrame::get_channels);
+    ClassDB::bind_method(D_METHOD("get_sample_count"), &FFmpegFrame::get_sample_count);
+    ClassDB::bind_method(D_METHOD("get_plane_count"), &FFmpegFrame::get_plane_count);
+    ClassDB::bind_method(D_METHOD("get_line_size", "plane"), &FFmpegFrame::get_line_size);
+    ClassDB::bind_method(D_METHOD("get_plane_data", "plane"), &FFmpegFrame::get_plane_data);
+    ClassDB::bind_method(D_METHOD("to_image", "width", "height", "with_alpha"), &FFmpegFrame::to_image, DEFVAL(0), DEFVAL(0), DEFVAL(true));
+    ClassDB::bind_method(D_METHOD("to_bytes", "format", "width", "height"), &FFmpegFrame::to_bytes, DEFVAL(String()), DEFVAL(0), DEFVAL(0));
+    ClassDB::bind_method(D_METHOD("to_pcm"), &FFmpegFrame::to_pcm);
+}
+
+FFmpegFrame::FFmpegFrame() {
+    frame = av_frame_alloc();
+}
+
+FFmpegFrame::~FFmpegFrame() {
+    av_frame_free(&frame);
+}
+
+Ref<FFmpegFrame> FFmpegFrame::create(const AVFrame *p_frame, AVRational p_time_base) {
+    Ref<FFmpegFrame> wrapped;
+    if (!p_frame) {
+        return wrapped;
+    }
+    wrapped.instantiate();
+    if (!wrapped->frame || av_frame_ref(wrapped->frame, p_frame) < 0) {
+        return Ref<FFmpegFrame>();
+    }
+    wrapped->time_base = p_time_base;
+    return wrapped;
+}
+
+bool FFmpegFrame::is_video() const {
+    return frame && frame->width > 0 && frame->height > 0;
+}
+
+bool FFmpegFrame::is_audio() const {
+    return frame && frame->nb_samples > 0 && !is_video();
+}
+
+String FFmpegFrame::get_format_name() const {
+    const char *name = nullptr;
+    if (is_video()) {
+        name = av_get_pix_fmt_name(static_cast<AVPixelFormat>(frame->format));
+    } else if (is_audio()) {
+        name = av_get_sample_fmt_name(static_cast<AVSampleFormat>(frame->format));
+    }
+    return name ? String(name) : String();
+}
+
+int64_t FFmpegFrame::get_pts() const {
+    return frame ? frame->pts : AV_NOPTS_VALUE;
+}
+
+double FFmpegFrame::get_pts_seconds() const {
+    if (!frame || frame->pts == AV_NOPTS_VALUE || time_base.den == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(frame->pts) * av_q2d(time_base);
+}
+
+int FFmpegFrame::get_time_base_num() const {
+    return time_base.num;
+}
+
+int FFmpegFrame::get_time_base_den() const {
+    return time_base.den;
+}
+
+int FFmpegFrame::get_width() const {
+    return frame ? frame->width : 0;
+}
+
+int FFmpegFrame::get_height() const {
+    return frame ? frame->height : 0;
+}
+
+int FFmpegFrame::get_sample_rate() const {
+    return frame ? frame->sample_rate : 0;
+}
+
+int FFmpegFrame::get_channels() const {
+    return frame ? frame->ch_layout.nb_channels : 0;
+}
+
+int FFmpegFrame::get_sample_count() const {
+    return frame ? frame->nb_samples : 0;
+}
+
+int FFmpegFrame::get_plane_count() const {
+    if (is_video()) {
+        return av_pix_fmt_count_planes(static_cast<AVPixelFormat>(frame->format));
+    }
+    if (is_audio()) {
+        return av_sample_fmt_is_planar(static_cast<AVSampleFormat>(frame->format)) ? frame->ch_layout.nb_channels : 1;
+    }
+    return 0;
+}
+
+int FFmpegFrame::get_line_size(int p_plane) const {
+    if (p_plane < 0 || p_plane >= get_plane_count() || p_plane >= AV_NUM_DATA_POINTERS) {
+        return 0;
+    }
+    return frame->linesize[p_plane];
+}
+
+PackedByteArray FFmpegFrame::get_plane_data(int p_plane) const {
+    PackedByteArray out;
+    if (p_plane < 0 || p_plane >= get_plane_count()) {
+        return out;
+    }
+
+    int64_t size = 0;
+    if (is_video()) {
+        // Chroma planes of subsampled formats have fewer rows.
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
+        const bool chroma = desc && (p_plane == 1 || p_plane == 2) && !(desc->flags & AV_PIX_FMT_FLAG_RGB);
+        const int rows = chroma ? AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h) : frame->height;
+        size = static_cast<int64_t>(frame->linesize[p_plane]) * rows;
+    } else {
+        size = frame->linesize[0];
+    }
+    const uint8_t *src = frame->extended_data ? frame->extended_data[p_plane] : frame->data[p_plane];
+    if (!src || size <= 0) {
+        return out;
+    }
+    out.resize(size);
+    memcpy(out.ptrw(), src, static_cast<size_t>(size));
+    return out;
+}
+
+Ref<Image> FFmpegFrame::to_image(int p_width, int p_height, bool p_with_alpha) const {
+    if (!is_video()) {
+        return Ref<Image>();
+    }
+    const int width = p_width > 0 ? p_width : frame->width;
+    const int height = p_height > 0 ? p_height : frame->height;
+    const String format = p_with_alpha ? "rgba" : "rgb24";
+    const PackedByteArray bytes = to_bytes(format, width, height);
+    if (bytes.is_empty()) {
+        return Ref<Image>();
+    }
+    Ref<Image> img;
+    img.instantiate();
+    img->set_data(width, height, false, p_with_alpha ? Image::FORMAT_RGBA8 : Image::FORMAT_RGB8, bytes);
+    return img;
+}
+
+PackedByteArray FFmpegFrame::to_bytes(const String &p_format, int p_width, int p_height) const {
+    PackedByteArray out;
+    if (is_audio()) {
+        const AVSampleFormat fmt = static_cast<AVSampleFormat>(frame->format);
+        const int plane_size = av_samples_get_buffer_size(nullptr, av_sample_fmt_is_planar(fmt) ? 1 : frame->ch_layout.nb_channels, frame->nb_samples, fmt, 1);
+        const int planes = get_plane_count();
+        if (plane_size <= 0) {
+            return out;
+        }
+        out.resize(static_cast<int64_t>(plane_size) * planes);
+        for (int i = 0; i < planes; i++) {
+            memcpy(out.ptrw() + static_cast<int64_t>(plane_size) * i, frame->extended_data[i], static_cast<size_t>(plane_size));
+        }
+        return out;
+    }
+    if (!is_video()) {
+        return out;
+    }
+
+    const AVPixelFormat src_fmt = static_cast<AVPixelFormat>(frame->format);
+    AVPixelFormat dst_fmt = src_fmt;
+    if (!p_format.is_empty()) {
+        dst_fmt = av_get_pix_fmt(p_format.to_lower().utf8().get_data());
+        if (dst_fmt == AV_PIX_FMT_NONE) {
+            log_frame("Unknown pixel format: " + p_format);
+            return out;
+        }
+    }
+    const int width = p_width > 0 ? p_width : frame->width;
+    const int height = p_height > 0 ? p_height : frame->height;
+
+    if (dst_fmt == src_fmt && width == frame->width && height == frame->height) {
+        const int size = av_image_get_buffer_size(src_fmt, width, height, 1);
+        if (size <= 0) {
+            return out;
+        }
+        out.resize(size);
+        av_image_copy_to_buffer(out.ptrw(), size, frame->data, frame->linesize, src_fmt, width, height, 1);
+        return out;
+    }
+
+    const int size = av_image_get_buffer_size(dst_fmt, width, height, 1);
+    if (size <= 0) {
+        return out;
+    }
+    SwsContext *sws = sws_getContext(frame->width, frame->height, src_fmt, width, height, dst_fmt, SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!sws) {
+        log_frame("Failed to create scale context");
+        return out;
+    }
+    out.resize(size);
+    uint8_t *dst_data[4] = { nullptr };
+    int dst_linesizes[4] = { 0 };
+    av_image_fill_arrays(dst_data, dst_linesizes, out.ptrw(), dst_fmt, width, height, 1);
+    sws_scale(sws, frame->data, frame->linesize, 0, frame->height, dst_data, dst_linesizes);
+    sws_freeContext(sws);
+    return out;
+}
+
+PackedFloat32Array FFmpegFrame::to_pcm() const {
+    PackedFloat32Array out;
+    if (!is_audio()) {
+        return out;
+    }
+
+    SwrContext *swr = nullptr;
+    if (swr_alloc_set_opts2(&swr, &frame->ch_layout, AV_SAMPLE_FMT_FLT, frame->sample_rate,
+                &frame->ch_layout, static_cast<AVSampleFormat>(frame->format), frame->sample_rate, 0, nullptr) < 0 ||
+            swr_init(swr) < 0) {
+        swr_free(&swr);
+        log_frame("Failed to create resampler");
+        return out;
+    }
+
+    out.resize(static_cast<int64_t>(frame->nb_samples) * frame->ch_layout.nb_channels);
+    uint8_t *dst = reinterpret_cast<uint8_t *>(out.ptrw());
+    const int converted = swr_convert(swr, &dst, frame->nb_samples, const_cast<const uint8_t **>(frame->extended_data), frame->nb_samples);
+    swr_free(&swr);
+    if (converted < 0) {
+        return PackedFloat32Array();
+    }
+    out.resize(static_cast<int64_t>(converted) * frame->ch_layout.nb_channels);
+    return out;
+}
+
+} // namespace godot
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <godot_cpp/classes/image.hpp>
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
+
+extern "C" {
+    #include <libavutil/frame.h>
+}
+
+namespace godot {
+
+// Decoded video or audio frame sharing the decoder's buffers through
+// av_frame_ref(). It stays in its native pixel or sample format; Image,
+// byte and PCM conversions only happen when one of the to_* methods is
+// called. Encoders take it as-is through push_frame().
+class FFmpegFrame : public RefCounted {
+    GDCLASS(FFmpegFrame, RefCounted);
+
+private:
+    AVFrame *frame = nullptr;
+    AVRational time_base = AVRational{0, 1};
+
+protected:
+    static void _bind_methods();
+
+public:
+    FFmpegFrame();
+    ~FFmpegFrame();
+
+    // References p_frame's buffers. Returns a null Ref if that fails.
+    static Ref<FFmpegFrame> create(const AVFrame *p_frame, AVRational p_time_base);
+
+    const AVFrame *get_frame() const { return frame; }
+    AVRational get_time_base() const { return time_base; }
+
+    bool is_video() const;
+    bool is_audio() const;
+    // Pixel format name for video ("yuv420p"), sample format name for audio
+    // ("fltp").
+    String get_format_name() const;
+
+    int64_t get_pts() const;
+    double get_pts_seconds() const;
+    int get_time_base_num() const;
+    int get_time_base_den() const;
+
+    int get_width() const;
+    int get_height() const;
+
+    int get_sample_rate() const;
+    int get_channels() const;
+    int get_sample_count() const;
+
+    // Raw planes as stored, including any row padding.
+    int get_plane_count() const;
+    int get_line_size(int p_plane) const;
+    PackedByteArray get_plane_data(int p_plane) const;
+
+    // Video: RGBA8 (or RGB8) Image, optionally scaled. Returns null for
+    // audio frames or on failure.
+    Ref<Image> to_image(int p_width = 0, int p_height = 0, bool p_with_alpha = true) const;
+    // Video: tightly packed planes in p_format ("" keeps the frame's own
+    // format), scaled when p_width/p_height are set. Audio: the sample
+    // planes back to back.
+    PackedByteArray to_bytes(const String &p_format = String(), int p_width = 0, int p_height = 0) const;
+    // Audio: interleaved float32 samples at the frame's own rate and layout.
+    PackedFloat32Array to_pcm() const;
+};
+
+} // namespace godot
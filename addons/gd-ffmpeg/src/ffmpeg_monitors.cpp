@@ -0,0 +1,117 @@
+#include "ffmpeg_monitors.h"
+
+#include "core/counters.h"
+#include "core/thread_budget.h"
+
+#include <godot_cpp/classes/performance.hpp>
+#include <godot_cpp/classes/time.hpp>
+#include <godot_cpp/variant/callable_method_pointer.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
+
+namespace godot {
+
+static const char *MONITOR_DECODE_FPS = "gd_ffmpeg/decode_fps";
+static const char *MONITOR_ENCODE_FPS = "gd_ffmpeg/encode_fps";
+static const char *MONITOR_QUEUED_FRAMES = "gd_ffmpeg/queued_frames";
+static const char *MONITOR_BYTES_PER_SECOND = "gd_ffmpeg/bytes_written_per_sec";
+static const char *MONITOR_CODEC_CONTEXTS = "gd_ffmpeg/active_codec_contexts";
+static const char *MONITOR_BUFFER_MEMORY = "gd_ffmpeg/ffmpeg_memory_bytes";
+static const char *MONITOR_CODEC_THREADS = "gd_ffmpeg/codec_threads";
+
+// Turns a monotonically increasing counter into a per-second rate between two
+// polls. The Monitors tab samples about once per second, so this is a
+// one-second moving window in practice.
+struct RateSampler {
+    int64_t last_count = 0;
+    uint64_t last_usec = 0;
+    double last_rate = 0.0;
+
+    double sample(int64_t p_count) {
+        const uint64_t now = Time::get_singleton()->get_ticks_usec();
+        if (last_usec == 0) {
+            last_usec = now;
+            last_count = p_count;
+            return 0.0;
+        }
+        const uint64_t elapsed = now - last_usec;
+        if (elapsed < 100000) {
+            return last_rate;
+        }
+        last_rate = static_cast<double>(p_count - last_count) * 1000000.0 / static_cast<double>(elapsed);
+        last_count = p_count;
+        last_usec = now;
+        return last_rate;
+    }
+};
+
+static RateSampler decode_rate;
+static RateSampler encode_rate;
+static RateSampler bytes_rate;
+
+Variant FFmpegMonitors::get_decode_fps() {
+    return decode_rate.sample(gdffmpeg::Counters::get_decoded_frames());
+}
+
+Variant FFmpegMonitors::get_encode_fps() {
+    return encode_rate.sample(gdffmpeg::Counters::get_encoded_frames());
+}
+
+Variant FFmpegMonitors::get_queued_frames() {
+    return gdffmpeg::Counters::get_queued_frames();
+}
+
+Variant FFmpegMonitors::get_bytes_written_per_second() {
+    return bytes_rate.sample(gdffmpeg::Counters::get_bytes_written());
+}
+
+Variant FFmpegMonitors::get_active_codec_contexts() {
+    return gdffmpeg::Counters::get_active_codec_contexts();
+}
+
+Variant FFmpegMonitors::get_buffer_memory() {
+    return gdffmpeg::Counters::get_buffer_memory();
+}
+
+Variant FFmpegMonitors::get_codec_threads() {
+    return gdffmpeg::ThreadBudget::get_threads_in_use();
+}
+
+void FFmpegMonitors::register_monitors() {
+    Performance *performance = Performance::get_singleton();
+    if (!performance) {
+        UtilityFunctions::printerr("[FFmpegMonitors] Performance singleton unavailable; monitors not registered");
+        return;
+    }
+
+    performance->add_custom_monitor(MONITOR_DECODE_FPS, callable_mp_static(&FFmpegMonitors::get_decode_fps));
+    performance->add_custom_monitor(MONITOR_ENCODE_FPS, callable_mp_static(&FFmpegMonitors::get_encode_fps));
+    performance->add_custom_monitor(MONITOR_QUEUED_FRAMES, callable_mp_static(&FFmpegMonitors::get_queued_frames));
+    performance->add_custom_monitor(MONITOR_BYTES_PER_SECOND, callable_mp_static(&FFmpegMonitors::get_bytes_written_per_second));
+    performance->add_custom_monitor(MONITOR_CODEC_CONTEXTS, callable_mp_static(&FFmpegMonitors::get_active_codec_contexts));
+    performance->add_custom_monitor(MONITOR_BUFFER_MEMORY, callable_mp_static(&FFmpegMonitors::get_buffer_memory));
+    performance->add_custom_monitor(MONITOR_CODEC_THREADS, callable_mp_static(&FFmpegMonitors::get_codec_threads));
+}
+
+void FFmpegMonitors::unregister_monitors() {
+    Performance *performance = Performance::get_singleton();
+    if (!performance) {
+        return;
+    }
+
+    const char *names[] = {
+        MONITOR_DECODE_FPS,
+        MONITOR_ENCODE_FPS,
+        MONITOR_QUEUED_FRAMES,
+        MONITOR_BYTES_PER_SECOND,
+        MONITOR_CODEC_CONTEXTS,
+        MONITOR_BUFFER_MEMORY,
+        MONITOR_CODEC_THREADS,
+    };
+    for (const char *name : names) {
+        if (performance->has_custom_monitor(name)) {
+            performance->remove_custom_monitor(name);
+        }
+    }
+}
+
+} // namespace godot
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <godot_cpp/variant/variant.hpp>
+
+namespace godot {
+
+// Publishes the core activity counters (gdffmpeg::Counters) as Performance
+// custom monitors (Debugger > Monitors > gd_ffmpeg).
+class FFmpegMonitors {
+public:
+    static void register_monitors();
+    static void unregister_monitors();
+
+private:
+    static Variant get_decode_fps();
+    static Variant get_encode_fps();
+    static Variant get_queued_frames();
+    static Variant get_bytes_written_per_second();
+    static Variant get_active_codec_contexts();
+    static Variant get_buffer_memory();
+    static Variant get_codec_threads();
+};
+
+} // namespace godot
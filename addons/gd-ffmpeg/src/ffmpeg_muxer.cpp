@@ -0,0 +1,124 @@
+#include "ffmpeg_muxer.h"
+
+#include <godot_cpp/classes/project_settings.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
+
+#include "core/trace.h"
+
+namespace godot {
+
+static void log_muxer(const String &p_msg) {
+    UtilityFunctions::print("[FFmpegMuxer] ", p_msg);
+}
+
+void FFmpegMuxer::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("set_container_format", "name"), &FFmpegMuxer::set_container_format);
+    ClassDB::bind_method(D_METHOD("get_container_format"), &FFmpegMuxer::get_container_format);
+    ClassDB::bind_method(D_METHOD("set_live_output", "enabled"), &FFmpegMuxer::set_live_output);
+    ClassDB::bind_method(D_METHOD("is_live_output"), &FFmpegMuxer::is_live_output);
+    ClassDB::bind_method(D_METHOD("set_fragment_duration", "msec"), &FFmpegMuxer::set_fragment_duration);
+    ClassDB::bind_method(D_METHOD("get_fragment_duration"), &FFmpegMuxer::get_fragment_duration);
+    ClassDB::bind_method(D_METHOD("begin", "path", "stream_peer", "file_access"), &FFmpegMuxer::begin, DEFVAL(String()), DEFVAL(Ref<StreamPeer>()), DEFVAL(Ref<FileAccess>()));
+    ClassDB::bind_method(D_METHOD("add_stream"), &FFmpegMuxer::add_stream);
+    ClassDB::bind_method(D_METHOD("needs_global_header"), &FFmpegMuxer::needs_global_header);
+    ClassDB::bind_method(D_METHOD("write_packet", "stream", "packet"), &FFmpegMuxer::write_packet);
+    ClassDB::bind_method(D_METHOD("end"), &FFmpegMuxer::end);
+    ClassDB::bind_method(D_METHOD("get_packets_written"), &FFmpegMuxer::get_packets_written);
+    ClassDB::bind_method(D_METHOD("get_queued_packets"), &FFmpegMuxer::get_queued_packets);
+}
+
+void FFmpegMuxer::set_container_format(const String &p_name) {
+    if (p_name.is_empty()) {
+        log_muxer("Container format cannot be empty");
+        return;
+    }
+    container_format = p_name.to_lower().utf8().get_data();
+}
+
+String FFmpegMuxer::get_container_format() const {
+    return String::utf8(container_format.c_str());
+}
+
+void FFmpegMuxer::set_live_output(bool p_enabled) {
+    live_output = p_enabled;
+}
+
+bool FFmpegMuxer::is_live_output() const {
+    return live_output;
+}
+
+void FFmpegMuxer::set_fragment_duration(int p_msec) {
+    fragment_duration_ms = p_msec > 0 ? p_msec : 0;
+}
+
+int FFmpegMuxer::get_fragment_duration() const {
+    return fragment_duration_ms;
+}
+
+int FFmpegMuxer::begin(const String &p_path, const Ref<StreamPeer> &p_stream_peer, const Ref<FileAccess> &p_file_access) {
+    muxer.close();
+    output.clear();
+    output.stream_peer = p_stream_peer;
+    output.file_access = p_file_access;
+    output.collecting_output = p_path.is_empty() && p_stream_peer.is_null() && p_file_access.is_null();
+
+    const bool use_sink = p_path.is_empty() || p_stream_peer.is_valid() || p_file_access.is_valid();
+    const CharString path = use_sink ? CharString() : ProjectSettings::get_singleton()->globalize_path(p_path).utf8();
+    const int result = muxer.open(use_sink ? std::string() : std::string(path.get_data()), use_sink ? &output : nullptr, container_format);
+    if (result != 0) {
+        log_muxer("Failed to open the output: " + String::num_int64(result));
+        output.clear();
+        return result;
+    }
+    if (live_output) {
+        muxer.get_muxer().set_live_output(true, fragment_duration_ms);
+    }
+    return 0;
+}
+
+int FFmpegMuxer::add_stream() {
+    const int index = muxer.add_stream();
+    if (index < 0) {
+        log_muxer("Streams must be added after begin() and before the first packet");
+    }
+    return index;
+}
+
+bool FFmpegMuxer::needs_global_header() const {
+    return muxer.needs_global_header();
+}
+
+int FFmpegMuxer::write_packet(int p_stream, const Ref<FFmpegPacket> &p_packet) {
+    if (p_packet.is_null() || !p_packet->get_packet()) {
+        return 1;
+    }
+    const SharedCodecParameters &params = p_packet->get_codec_parameters();
+    const int result = muxer.write_packet(p_stream, p_packet->get_packet(), p_packet->get_time_base(), params.get());
+    // Bytes already went to the StreamPeer/FileAccess or the full output.
+    output.pending_output.clear();
+    if (result != 0) {
+        log_muxer("Failed to write packet to stream " + String::num_int64(p_stream) + ": " + String::num_int64(result));
+    }
+    return result;
+}
+
+PackedByteArray FFmpegMuxer::end() {
+    GDFFMPEG_TRACE_SCOPE("muxer_end");
+    const int result = muxer.finish();
+    if (result != 0) {
+        log_muxer("Finishing the output failed with code " + String::num_int64(result));
+    }
+    const PackedByteArray bytes = result == 0 && output.collecting_output ? chunked_buffer_to_packed(output.full_output) : PackedByteArray();
+    output.clear();
+    return bytes;
+}
+
+int64_t FFmpegMuxer::get_packets_written() const {
+    return muxer.get_packets_written();
+}
+
+int FFmpegMuxer::get_queued_packets() const {
+    return muxer.get_queued_packets();
+}
+
+} // namespace godot
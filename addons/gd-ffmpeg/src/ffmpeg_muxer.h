@@ -0,0 +1,71 @@
+#pragma once
+
+#include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/classes/stream_peer.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+
+#include "ffmpeg_buffers.h"
+#include "ffmpeg_packet.h"
+
+#include "core/packet_muxer.h"
+
+#include <string>
+
+namespace godot {
+
+// Muxes FFmpegPackets from several encoders (typically one
+// FFmpegVideoEncoder in begin_packets() mode and one FFmpegAudioEncoder)
+// into one container, interleaved by timestamp. Each stream is described by
+// the codec parameters of its first packet; the header is written once
+// every stream has received one.
+class FFmpegMuxer : public RefCounted {
+    GDCLASS(FFmpegMuxer, RefCounted);
+
+private:
+    gdffmpeg::PacketMuxer muxer;
+    GodotOutputSink output;
+    std::string container_format = "mp4";
+    bool live_output = false;
+    int fragment_duration_ms = 0;
+
+protected:
+    static void _bind_methods();
+
+public:
+    // Container used for memory and StreamPeer/FileAccess output (default
+    // "mp4"); file paths pick theirs from the extension.
+    void set_container_format(const String &p_name);
+    String get_container_format() const;
+    // Fragmented MP4 or live Matroska/WebM, as in FFmpegVideoEncoder. MP4
+    // output to memory or a StreamPeer is always fragmented.
+    void set_live_output(bool p_enabled);
+    bool is_live_output() const;
+    void set_fragment_duration(int p_msec);
+    int get_fragment_duration() const;
+
+    // Opens p_path, or collects into memory when no path or sink is given.
+    // Abandons any previous output. Returns 0 on success.
+    int begin(const String &p_path = String(), const Ref<StreamPeer> &p_stream_peer = Ref<StreamPeer>(), const Ref<FileAccess> &p_file_access = Ref<FileAccess>());
+    // Declares a stream after begin() and before the first packet. Returns
+    // its index, or -1.
+    int add_stream();
+    // Whether the encoders feeding this container need global headers
+    // (FFmpegVideoEncoder.begin_packets(true), the audio "global_header"
+    // option). Valid after begin().
+    bool needs_global_header() const;
+
+    // Packets arriving before every stream is described are held back.
+    // Timestamps are rescaled from the packet's time base. Returns 0 on
+    // success.
+    int write_packet(int p_stream, const Ref<FFmpegPacket> &p_packet);
+    // Writes the trailer. Returns the whole container when collecting into
+    // memory, otherwise an empty array.
+    PackedByteArray end();
+
+    int64_t get_packets_written() const;
+    int get_queued_packets() const;
+};
+
+} // namespace godot
@@ -0,0 +1,149 @@
+#include "ffmpeg_packet.h"
+
+#include <cstring>
+
+namespace godot {
+
+void FFmpegPacket::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("get_data"), &FFmpegPacket::get_data);
+    ClassDB::bind_method(D_METHOD("get_size"), &FFmpegPacket::get_size);
+    ClassDB::bind_method(D_METHOD("get_pts"), &FFmpegPacket::get_pts);
+    ClassDB::bind_method(D_METHOD("get_dts"), &FFmpegPacket::get_dts);
+    ClassDB::bind_method(D_METHOD("get_duration"), &FFmpegPacket::get_duration);
+    ClassDB::bind_method(D_METHOD("get_flags"), &FFmpegPacket::get_flags);
+    ClassDB::bind_method(D_METHOD("is_key"), &FFmpegPacket::is_key);
+    ClassDB::bind_method(D_METHOD("get_stream_index"), &FFmpegPacket::get_stream_index);
+    ClassDB::bind_method(D_METHOD("get_time_base_num"), &FFmpegPacket::get_time_base_num);
+    ClassDB::bind_method(D_METHOD("get_time_base_den"), &FFmpegPacket::get_time_base_den);
+    ClassDB::bind_method(D_METHOD("get_pts_seconds"), &FFmpegPacket::get_pts_seconds);
+    ClassDB::bind_method(D_METHOD("get_side_data_types"), &FFmpegPacket::get_side_data_types);
+    ClassDB::bind_method(D_METHOD("get_side_data", "type"), &FFmpegPacket::get_side_data);
+    ClassDB::bind_method(D_METHOD("get_codec_name"), &FFmpegPacket::get_codec_name);
+}
+
+FFmpegPacket::FFmpegPacket() {
+    packet = av_packet_alloc();
+}
+
+FFmpegPacket::~FFmpegPacket() {
+    av_packet_free(&packet);
+}
+
+Ref<FFmpegPacket> FFmpegPacket::create(const AVPacket *p_packet, AVRational p_time_base, int p_stream_index, const SharedCodecParameters &p_params) {
+    Ref<FFmpegPacket> wrapped;
+    if (!p_packet) {
+        return wrapped;
+    }
+    wrapped.instantiate();
+    if (!wrapped->packet || av_packet_ref(wrapped->packet, p_packet) < 0) {
+        return Ref<FFmpegPacket>();
+    }
+    wrapped->packet->stream_index = p_stream_index;
+    wrapped->time_base = p_time_base;
+    wrapped->codec_parameters = p_params;
+    return wrapped;
+}
+
+SharedCodecParameters FFmpegPacket::make_codec_parameters(const AVCodecContext *p_codec_ctx) {
+    if (!p_codec_ctx) {
+        return SharedCodecParameters();
+    }
+    AVCodecParameters *params = avcodec_parameters_alloc();
+    if (!params) {
+        return SharedCodecParameters();
+    }
+    if (avcodec_parameters_from_context(params, p_codec_ctx) < 0) {
+        avcodec_parameters_free(&params);
+        return SharedCodecParameters();
+    }
+    return SharedCodecParameters(params, [](const AVCodecParameters *p_params) {
+        AVCodecParameters *owned = const_cast<AVCodecParameters *>(p_params);
+        avcodec_parameters_free(&owned);
+    });
+}
+
+PackedByteArray FFmpegPacket::get_data() {
+    if (!data_cached && packet && packet->data && packet->size > 0) {
+        data_cache.resize(packet->size);
+        memcpy(data_cache.ptrw(), packet->data, static_cast<size_t>(packet->size));
+    }
+    data_cached = true;
+    return data_cache;
+}
+
+int FFmpegPacket::get_size() const {
+    return packet ? packet->size : 0;
+}
+
+int64_t FFmpegPacket::get_pts() const {
+    return packet ? packet->pts : AV_NOPTS_VALUE;
+}
+
+int64_t FFmpegPacket::get_dts() const {
+    return packet ? packet->dts : AV_NOPTS_VALUE;
+}
+
+int64_t FFmpegPacket::get_duration() const {
+    return packet ? packet->duration : 0;
+}
+
+int FFmpegPacket::get_flags() const {
+    return packet ? packet->flags : 0;
+}
+
+bool FFmpegPacket::is_key() const {
+    return (get_flags() & AV_PKT_FLAG_KEY) != 0;
+}
+
+int FFmpegPacket::get_stream_index() const {
+    return packet ? packet->stream_index : -1;
+}
+
+int FFmpegPacket::get_time_base_num() const {
+    return time_base.num;
+}
+
+int FFmpegPacket::get_time_base_den() const {
+    return time_base.den;
+}
+
+double FFmpegPacket::get_pts_seconds() const {
+    if (!packet || packet->pts == AV_NOPTS_VALUE || time_base.den == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(packet->pts) * av_q2d(time_base);
+}
+
+PackedInt32Array FFmpegPacket::get_side_data_types() const {
+    PackedInt32Array types;
+    if (!packet) {
+        return types;
+    }
+    for (int i = 0; i < packet->side_data_elems; i++) {
+        types.append(static_cast<int32_t>(packet->side_data[i].type));
+    }
+    return types;
+}
+
+PackedByteArray FFmpegPacket::get_side_data(int p_type) const {
+    PackedByteArray out;
+    if (!packet) {
+        return out;
+    }
+    size_t size = 0;
+    const uint8_t *data = av_packet_get_side_data(packet, static_cast<AVPacketSideDataType>(p_type), &size);
+    if (data && size > 0) {
+        out.resize(static_cast<int64_t>(size));
+        memcpy(out.ptrw(), data, size);
+    }
+    return out;
+}
+
+String FFmpegPacket::get_codec_name() const {
+    if (!codec_parameters) {
+        return String();
+    }
+    return String(avcodec_get_name(codec_parameters->codec_id));
+}
+
+} // namespace godot
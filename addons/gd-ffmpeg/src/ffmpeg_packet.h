@@ -0,0 +1,73 @@
+#pragma once
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_int32_array.hpp>
+
+extern "C" {
+    #include <libavcodec/avcodec.h>
+}
+
+#include <memory>
+
+namespace godot {
+
+// Codec description shared by every packet of one encoder session.
+using SharedCodecParameters = std::shared_ptr<const AVCodecParameters>;
+
+// Encoded packet that shares the encoder's AVPacket buffer through
+// av_packet_ref(). Passing it between encoders, decoders and muxers never
+// copies the payload; get_data() copies once, on first use.
+class FFmpegPacket : public RefCounted {
+    GDCLASS(FFmpegPacket, RefCounted);
+
+private:
+    AVPacket *packet = nullptr;
+    AVRational time_base = AVRational{0, 1};
+    SharedCodecParameters codec_parameters;
+    PackedByteArray data_cache;
+    bool data_cached = false;
+
+protected:
+    static void _bind_methods();
+
+public:
+    FFmpegPacket();
+    ~FFmpegPacket();
+
+    // References p_packet (no copy when it is ref-counted, which encoder
+    // output always is) and stamps p_stream_index. Returns a null Ref if the
+    // reference fails.
+    static Ref<FFmpegPacket> create(const AVPacket *p_packet, AVRational p_time_base, int p_stream_index, const SharedCodecParameters &p_params = SharedCodecParameters());
+
+    // Snapshot of p_codec_ctx's parameters for create(). Null on failure.
+    static SharedCodecParameters make_codec_parameters(const AVCodecContext *p_codec_ctx);
+
+    const AVPacket *get_packet() const { return packet; }
+    AVRational get_time_base() const { return time_base; }
+    const SharedCodecParameters &get_codec_parameters() const { return codec_parameters; }
+
+    PackedByteArray get_data();
+    int get_size() const;
+    int64_t get_pts() const;
+    int64_t get_dts() const;
+    int64_t get_duration() const;
+    int get_flags() const;
+    bool is_key() const;
+    int get_stream_index() const;
+    int get_time_base_num() const;
+    int get_time_base_den() const;
+    double get_pts_seconds() const;
+
+    // AVPacketSideDataType values present on the packet.
+    PackedInt32Array get_side_data_types() const;
+    // Copy of the side data of p_type, or an empty array.
+    PackedByteArray get_side_data(int p_type) const;
+
+    // Decoder name for the codec that produced the packet, or "" when the
+    // packet carries no codec parameters.
+    String get_codec_name() const;
+};
+
+} // namespace godot
@@ -0,0 +1,134 @@
+#include "ffmpeg_remuxer.h"
+
+#include <godot_cpp/classes/project_settings.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
+
+#include <vector>
+
+#include "core/trace.h"
+
+namespace godot {
+
+static void log_remuxer(const String &p_msg) {
+    UtilityFunctions::print("[FFmpegRemuxer] ", p_msg);
+}
+
+void FFmpegRemuxer::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("set_streams", "indices"), &FFmpegRemuxer::set_streams);
+    ClassDB::bind_method(D_METHOD("set_bitstream_filter", "stream", "filters"), &FFmpegRemuxer::set_bitstream_filter);
+    ClassDB::bind_method(D_METHOD("clear_bitstream_filters"), &FFmpegRemuxer::clear_bitstream_filters);
+    ClassDB::bind_method(D_METHOD("set_format", "name"), &FFmpegRemuxer::set_format);
+    ClassDB::bind_method(D_METHOD("set_format_option", "key", "value"), &FFmpegRemuxer::set_format_option);
+    ClassDB::bind_method(D_METHOD("clear_format_options"), &FFmpegRemuxer::clear_format_options);
+    ClassDB::bind_method(D_METHOD("probe_streams", "path"), &FFmpegRemuxer::probe_streams);
+    ClassDB::bind_method(D_METHOD("remux", "input_path", "output_path"), &FFmpegRemuxer::remux);
+    ClassDB::bind_method(D_METHOD("trim", "input_path", "output_path", "start", "end"), &FFmpegRemuxer::trim);
+    ClassDB::bind_method(D_METHOD("set_trim_encoder", "name"), &FFmpegRemuxer::set_trim_encoder);
+    ClassDB::bind_method(D_METHOD("set_trim_quality", "quality"), &FFmpegRemuxer::set_trim_quality);
+    ClassDB::bind_method(D_METHOD("set_trim_preset", "preset"), &FFmpegRemuxer::set_trim_preset);
+    ClassDB::bind_method(D_METHOD("get_frames_reencoded"), &FFmpegRemuxer::get_frames_reencoded);
+    ClassDB::bind_method(D_METHOD("get_packets_copied"), &FFmpegRemuxer::get_packets_copied);
+}
+
+void FFmpegRemuxer::set_streams(const PackedInt32Array &p_indices) {
+    std::vector<int> indices;
+    indices.reserve(p_indices.size());
+    for (int64_t i = 0; i < p_indices.size(); i++) {
+        indices.push_back(p_indices[i]);
+    }
+    remuxer.set_streams(indices);
+    trimmer.set_streams(indices);
+}
+
+void FFmpegRemuxer::set_bitstream_filter(int p_stream, const String &p_filters) {
+    remuxer.set_bitstream_filter(p_stream, p_filters.utf8().get_data());
+}
+
+void FFmpegRemuxer::clear_bitstream_filters() {
+    remuxer.clear_bitstream_filters();
+}
+
+void FFmpegRemuxer::set_format(const String &p_name) {
+    remuxer.set_muxer_name(p_name.utf8().get_data());
+    trimmer.set_muxer_name(p_name.utf8().get_data());
+}
+
+void FFmpegRemuxer::set_format_option(const String &p_key, const String &p_value) {
+    remuxer.set_muxer_option(p_key.utf8().get_data(), p_value.utf8().get_data());
+    trimmer.set_muxer_option(p_key.utf8().get_data(), p_value.utf8().get_data());
+}
+
+void FFmpegRemuxer::clear_format_options() {
+    remuxer.clear_muxer_options();
+    trimmer.clear_muxer_options();
+}
+
+Array FFmpegRemuxer::probe_streams(const String &p_path) const {
+    Array result;
+    std::vector<gdffmpeg::StreamInfo> streams;
+    const CharString path = ProjectSettings::get_singleton()->globalize_path(p_path).utf8();
+    if (gdffmpeg::Remuxer::probe(path.get_data(), streams) != 0) {
+        return result;
+    }
+    for (const gdffmpeg::StreamInfo &info : streams) {
+        Dictionary d;
+        const char *type = av_get_media_type_string(info.type);
+        d["index"] = info.index;
+        d["type"] = String(type ? type : "unknown");
+        d["codec"] = String(info.codec_name.c_str());
+        d["time_base_num"] = info.time_base.num;
+        d["time_base_den"] = info.time_base.den;
+        d["duration"] = info.duration == AV_NOPTS_VALUE ? -1.0 : static_cast<double>(info.duration) * av_q2d(info.time_base);
+        result.append(d);
+    }
+    return result;
+}
+
+int FFmpegRemuxer::remux(const String &p_input_path, const String &p_output_path) {
+    GDFFMPEG_TRACE_SCOPE("remux_file");
+    ProjectSettings *settings = ProjectSettings::get_singleton();
+    const CharString input = settings->globalize_path(p_input_path).utf8();
+    const CharString output = settings->globalize_path(p_output_path).utf8();
+    const int result = remuxer.remux(input.get_data(), output.get_data());
+    packets_copied = remuxer.get_packets_copied();
+    if (result != 0) {
+        log_remuxer("Remux failed with code " + String::num_int64(result));
+    }
+    return result;
+}
+
+int FFmpegRemuxer::trim(const String &p_input_path, const String &p_output_path, double p_start, double p_end) {
+    GDFFMPEG_TRACE_SCOPE("trim_file");
+    ProjectSettings *settings = ProjectSettings::get_singleton();
+    const CharString input = settings->globalize_path(p_input_path).utf8();
+    const CharString output = settings->globalize_path(p_output_path).utf8();
+    const int result = trimmer.trim(input.get_data(), output.get_data(), p_start, p_end);
+    packets_copied = trimmer.get_packets_copied();
+    if (result != 0) {
+        log_remuxer("Trim failed with code " + String::num_int64(result));
+    }
+    return result;
+}
+
+void FFmpegRemuxer::set_trim_encoder(const String &p_name) {
+    trimmer.set_encoder_name(p_name.utf8().get_data());
+}
+
+void FFmpegRemuxer::set_trim_quality(int p_quality) {
+    trimmer.set_quality(p_quality);
+}
+
+void FFmpegRemuxer::set_trim_preset(const String &p_preset) {
+    trimmer.set_preset(p_preset.utf8().get_data());
+}
+
+int64_t FFmpegRemuxer::get_frames_reencoded() const {
+    return trimmer.get_frames_reencoded();
+}
+
+int64_t FFmpegRemuxer::get_packets_copied() const {
+    return packets_copied;
+}
+
+} // namespace godot
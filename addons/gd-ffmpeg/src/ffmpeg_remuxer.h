@@ -0,0 +1,69 @@
+#pragma once
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/packed_int32_array.hpp>
+
+#include "core/remuxer.h"
+#include "core/smart_trimmer.h"
+
+namespace godot {
+
+// Stream-copies packets between containers (MKV -> MP4, MP4 -> fragmented
+// MP4, elementary stream extraction) without decoding anything. trim()
+// cuts a time range, re-encoding only the GOPs the cut points fall into
+// where the codec allows it.
+class FFmpegRemuxer : public RefCounted {
+    GDCLASS(FFmpegRemuxer, RefCounted);
+
+private:
+    gdffmpeg::Remuxer remuxer;
+    gdffmpeg::SmartTrimmer trimmer;
+    int64_t packets_copied = 0;
+
+protected:
+    static void _bind_methods();
+
+public:
+    // Input stream indices to copy, in output order; empty copies every
+    // video, audio and subtitle stream.
+    void set_streams(const PackedInt32Array &p_indices);
+    // Bitstream filter chain for one input stream, or for all of them with
+    // stream -1 (e.g. "h264_mp4toannexb", "aac_adtstoasc").
+    void set_bitstream_filter(int p_stream, const String &p_filters);
+    void clear_bitstream_filters();
+    // Output container name ("mp4", "matroska", "mpegts", "h264", "adts");
+    // empty guesses it from the output extension.
+    void set_format(const String &p_name);
+    // Muxer option such as ("movflags", "frag_keyframe+empty_moov").
+    void set_format_option(const String &p_key, const String &p_value);
+    void clear_format_options();
+
+    // One Dictionary per input stream: index, type ("video", "audio",
+    // "subtitle", ...), codec, time_base_num, time_base_den, duration
+    // (seconds, -1 when unknown).
+    Array probe_streams(const String &p_path) const;
+
+    // Returns 0 on success.
+    int remux(const String &p_input_path, const String &p_output_path);
+
+    // Copies [p_start, p_end) seconds of the input; p_end <= p_start runs to
+    // the end. For H.264/HEVC in MP4 or Matroska, whole GOPs inside the
+    // range are stream-copied and the partial ones at either end are
+    // re-encoded to match the source; other codecs re-encode the whole
+    // range. Assumes closed GOPs. Returns 0 on success.
+    int trim(const String &p_input_path, const String &p_output_path, double p_start, double p_end);
+    // Encoder for the boundary GOPs; empty picks FFmpeg's default for the
+    // source codec.
+    void set_trim_encoder(const String &p_name);
+    // CRF for the boundary GOPs when the source bit rate is unknown.
+    void set_trim_quality(int p_quality);
+    void set_trim_preset(const String &p_preset);
+    int64_t get_frames_reencoded() const;
+
+    // Packets stream-copied by the last remux() or trim().
+    int64_t get_packets_copied() const;
+};
+
+} // namespace godot
@@ -0,0 +1,19 @@
+#include "ffmpeg_stats.h"
+
+namespace godot {
+
+Dictionary pipeline_stats_to_dictionary(const gdffmpeg::PipelineStats &p_stats, const char *const p_stage_names[gdffmpeg::PipelineStats::STAGE_MAX]) {
+    Dictionary out;
+    for (int i = 0; i < gdffmpeg::PipelineStats::STAGE_MAX; i++) {
+        const gdffmpeg::PipelineStats::Summary summary = p_stats.summarize(static_cast<gdffmpeg::PipelineStats::Stage>(i));
+        Dictionary stage;
+        stage["count"] = static_cast<int64_t>(summary.count);
+        stage["total_usec"] = static_cast<int64_t>(summary.total_usec);
+        stage["p50_usec"] = static_cast<int64_t>(summary.p50_usec);
+        stage["p99_usec"] = static_cast<int64_t>(summary.p99_usec);
+        out[p_stage_names[i]] = stage;
+    }
+    return out;
+}
+
+} // namespace godot
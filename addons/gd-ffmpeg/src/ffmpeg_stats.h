@@ -0,0 +1,12 @@
+#pragma once
+
+#include <godot_cpp/variant/dictionary.hpp>
+
+#include "core/pipeline_stats.h"
+
+namespace godot {
+
+// { stage_name: { count, total_usec, p50_usec, p99_usec } }
+Dictionary pipeline_stats_to_dictionary(const gdffmpeg::PipelineStats &p_stats, const char *const p_stage_names[gdffmpeg::PipelineStats::STAGE_MAX]);
+
+} // namespace godot
@@ -0,0 +1,60 @@
+#include "ffmpeg_thread_budget.h"
+
+#include "core/thread_budget.h"
+
+namespace godot {
+
+void FFmpegThreadBudget::_bind_methods() {
+    ClassDB::bind_static_method("FFmpegThreadBudget", D_METHOD("set_enabled", "enabled"), &FFmpegThreadBudget::set_enabled);
+    ClassDB::bind_static_method("FFmpegThreadBudget", D_METHOD("is_enabled"), &FFmpegThreadBudget::is_enabled);
+    ClassDB::bind_static_method("FFmpegThreadBudget", D_METHOD("set_total_threads", "threads"), &FFmpegThreadBudget::set_total_threads);
+    ClassDB::bind_static_method("FFmpegThreadBudget", D_METHOD("get_total_threads"), &FFmpegThreadBudget::get_total_threads);
+    ClassDB::bind_static_method("FFmpegThreadBudget", D_METHOD("set_max_threads_per_context", "threads"), &FFmpegThreadBudget::set_max_threads_per_context);
+    ClassDB::bind_static_method("FFmpegThreadBudget", D_METHOD("get_max_threads_per_context"), &FFmpegThreadBudget::get_max_threads_per_context);
+    ClassDB::bind_static_method("FFmpegThreadBudget", D_METHOD("set_shared_pool_enabled", "enabled"), &FFmpegThreadBudget::set_shared_pool_enabled);
+    ClassDB::bind_static_method("FFmpegThreadBudget", D_METHOD("is_shared_pool_enabled"), &FFmpegThreadBudget::is_shared_pool_enabled);
+    ClassDB::bind_static_method("FFmpegThreadBudget", D_METHOD("get_threads_in_use"), &FFmpegThreadBudget::get_threads_in_use);
+    ClassDB::bind_static_method("FFmpegThreadBudget", D_METHOD("get_budgeted_contexts"), &FFmpegThreadBudget::get_budgeted_contexts);
+}
+
+void FFmpegThreadBudget::set_enabled(bool p_enabled) {
+    gdffmpeg::ThreadBudget::set_enabled(p_enabled);
+}
+
+bool FFmpegThreadBudget::is_enabled() {
+    return gdffmpeg::ThreadBudget::is_enabled();
+}
+
+void FFmpegThreadBudget::set_total_threads(int p_threads) {
+    gdffmpeg::ThreadBudget::set_total_threads(p_threads);
+}
+
+int FFmpegThreadBudget::get_total_threads() {
+    return gdffmpeg::ThreadBudget::get_total_threads();
+}
+
+void FFmpegThreadBudget::set_max_threads_per_context(int p_threads) {
+    gdffmpeg::ThreadBudget::set_max_threads_per_context(p_threads);
+}
+
+int FFmpegThreadBudget::get_max_threads_per_context() {
+    return gdffmpeg::ThreadBudget::get_max_threads_per_context();
+}
+
+void FFmpegThreadBudget::set_shared_pool_enabled(bool p_enabled) {
+    gdffmpeg::ThreadBudget::set_shared_pool_enabled(p_enabled);
+}
+
+bool FFmpegThreadBudget::is_shared_pool_enabled() {
+    return gdffmpeg::ThreadBudget::is_shared_pool_enabled();
+}
+
+int FFmpegThreadBudget::get_threads_in_use() {
+    return gdffmpeg::ThreadBudget::get_threads_in_use();
+}
+
+int FFmpegThreadBudget::get_budgeted_contexts() {
+    return gdffmpeg::ThreadBudget::get_budgeted_contexts();
+}
+
+} // namespace godot
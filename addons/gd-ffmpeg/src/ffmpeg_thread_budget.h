@@ -0,0 +1,35 @@
+#pragma once
+
+#include <godot_cpp/classes/object.hpp>
+#include <godot_cpp/core/class_db.hpp>
+
+namespace godot {
+
+// Script-facing controls for the process-wide codec thread budget
+// (gdffmpeg::ThreadBudget), e.g. FFmpegThreadBudget.set_enabled(true).
+// Settings apply to codec contexts opened afterwards.
+class FFmpegThreadBudget : public Object {
+    GDCLASS(FFmpegThreadBudget, Object);
+
+protected:
+    static void _bind_methods();
+
+public:
+    static void set_enabled(bool p_enabled);
+    static bool is_enabled();
+
+    // 0 uses every core.
+    static void set_total_threads(int p_threads);
+    static int get_total_threads();
+    // 0 uses a quarter of the budget.
+    static void set_max_threads_per_context(int p_threads);
+    static int get_max_threads_per_context();
+
+    static void set_shared_pool_enabled(bool p_enabled);
+    static bool is_shared_pool_enabled();
+
+    static int get_threads_in_use();
+    static int get_budgeted_contexts();
+};
+
+} // namespace godot
@@ -0,0 +1,64 @@
+#include "ffmpeg_trace.h"
+
+#include "core/trace.h"
+
+#include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
+
+#include <cstring>
+#include <string>
+
+namespace godot {
+
+void FFmpegTracer::_bind_methods() {
+    ClassDB::bind_static_method("FFmpegTracer", D_METHOD("start"), &FFmpegTracer::start);
+    ClassDB::bind_static_method("FFmpegTracer", D_METHOD("stop"), &FFmpegTracer::stop);
+    ClassDB::bind_static_method("FFmpegTracer", D_METHOD("is_running"), &FFmpegTracer::is_running);
+    ClassDB::bind_static_method("FFmpegTracer", D_METHOD("clear"), &FFmpegTracer::clear);
+    ClassDB::bind_static_method("FFmpegTracer", D_METHOD("get_dropped_events"), &FFmpegTracer::get_dropped_events);
+    ClassDB::bind_static_method("FFmpegTracer", D_METHOD("save", "path"), &FFmpegTracer::save);
+}
+
+void FFmpegTracer::start() {
+    gdffmpeg::Trace::clear();
+    gdffmpeg::Trace::set_enabled(true);
+}
+
+void FFmpegTracer::stop() {
+    gdffmpeg::Trace::set_enabled(false);
+}
+
+bool FFmpegTracer::is_running() {
+    return gdffmpeg::Trace::is_enabled();
+}
+
+void FFmpegTracer::clear() {
+    if (gdffmpeg::Trace::is_enabled()) {
+        UtilityFunctions::printerr("[FFmpegTracer] Stop the tracer before clearing it");
+        return;
+    }
+    gdffmpeg::Trace::clear();
+}
+
+int64_t FFmpegTracer::get_dropped_events() {
+    return gdffmpeg::Trace::get_dropped_events();
+}
+
+int FFmpegTracer::save(const String &p_path) {
+    std::string json;
+    gdffmpeg::Trace::write_json(json);
+
+    Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::WRITE);
+    if (file.is_null()) {
+        UtilityFunctions::printerr("[FFmpegTracer] Could not open file: " + p_path);
+        return 1;
+    }
+
+    PackedByteArray bytes;
+    bytes.resize(static_cast<int64_t>(json.size()));
+    memcpy(bytes.ptrw(), json.data(), json.size());
+    file->store_buffer(bytes);
+    return 0;
+}
+
+} // namespace godot
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <godot_cpp/classes/object.hpp>
+#include <godot_cpp/core/class_db.hpp>
+
+namespace godot {
+
+// Script-facing controls: FFmpegTracer.start(), .stop(), .save("user://trace.json").
+class FFmpegTracer : public Object {
+    GDCLASS(FFmpegTracer, Object);
+
+protected:
+    static void _bind_methods();
+
+public:
+    static void start();
+    static void stop();
+    static bool is_running();
+    static void clear();
+    static int64_t get_dropped_events();
+
+    // Writes Chrome/Perfetto trace JSON. Returns 0 on success.
+    static int save(const String &p_path);
+};
+
+} // namespace godot
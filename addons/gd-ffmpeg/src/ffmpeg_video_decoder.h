@@ -5,14 +5,13 @@
 #include <godot_cpp/classes/texture2d.hpp>
 #include <godot_cpp/classes/ref_counted.hpp>
 #include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
 #include <godot_cpp/variant/packed_byte_array.hpp>
 
-extern "C" {
-    #include <libavcodec/avcodec.h>
-    #include <libavformat/avformat.h>
-    #include <libavutil/imgutils.h>
-    #include <libswscale/swscale.h>
-}
+#include "ffmpeg_frame.h"
+#include "ffmpeg_packet.h"
+
+#include "core/video_decoder.h"
 
 namespace godot {
 
@@ -20,38 +19,47 @@ class FFmpegVideoDecoder : public RefCounted {
     GDCLASS(FFmpegVideoDecoder, RefCounted);
 
 private:
-    String preferred_codec;
-    AVFormatContext *format_ctx = nullptr;
-    AVCodecContext *codec_ctx = nullptr;
-    AVFrame *frame = nullptr;
-    AVPacket *packet = nullptr;
-    SwsContext *sws_ctx = nullptr;
-    int sws_src_w = 0;
-    int sws_src_h = 0;
-    AVPixelFormat output_pix_fmt = AV_PIX_FMT_RGBA;
-    int output_width = 0;
-    int output_height = 0;
-    int video_stream_index = -1;
-
+    gdffmpeg::VideoDecoder decoder;
     PackedByteArray source_bytes;
-    size_t source_pos = 0;
+    bool frame_objects = false;
 
-    int open_input_internal(const char *p_path);
     void clear_resources();
-    Ref<Image> convert_frame(AVFrame *p_src);
+    Ref<Image> convert_frame(const AVFrame *p_src);
+    // Appends an FFmpegFrame (when enabled and p_allow_objects) or an Image
+    // per decoded frame. r_frames must outlive the returned sink.
+    gdffmpeg::FrameSink collect_into(Array &r_frames, bool p_allow_objects);
+    Array decode_images();
     static AVPixelFormat pixel_format_from_string(const String &p_name);
-    static String pixel_format_to_string(AVPixelFormat p_fmt);
 
 protected:
     static void _bind_methods();
 
 public:
-    ~FFmpegVideoDecoder();
-
     void set_preferred_codec(const String &p_name);
     void set_output_pixel_format(const String &p_fmt);
     void set_output_resolution(int p_width, int p_height);
 
+    // "straight" (default) or "premultiplied"; only affects RGBA output.
+    void set_alpha_mode(const String &p_mode);
+    String get_alpha_mode() const;
+
+    // True once decoding has started on a source carrying an alpha plane
+    // (yuva420p/yuva444p, ProRes 4444, VP8/VP9 WebM with alpha_mode=1).
+    bool has_alpha() const;
+
+    // Per-stage timings (demux, send_packet, receive_frame, sws_scale,
+    // create_image). Disabled by default; collection is free while off.
+    void set_stats_enabled(bool p_enabled);
+    bool is_stats_enabled() const;
+    void reset_stats();
+    Dictionary get_stats() const;
+
+    // When enabled, decode_frames(), decode_packet() and flush_packets()
+    // return FFmpegFrames in the decoder's native format instead of RGBA
+    // Images; the output format/resolution settings are then not applied.
+    void set_frame_objects_enabled(bool p_enabled);
+    bool is_frame_objects_enabled() const;
+
     int load_file(const String &p_path);
     int load_bytes(const PackedByteArray &p_bytes);
 
@@ -64,6 +72,14 @@ public:
     // Convenience: decode frames into Texture2D resources.
     Array decode_textures();
 
+    // Packet input, e.g. from an encoder's packet callback. The decoder is
+    // opened from the first packet's codec parameters; load_file() or
+    // load_bytes() switch back to container input. Returns the Images the
+    // packet completed, which may be none while the decoder buffers.
+    Array decode_packet(const Ref<FFmpegPacket> &p_packet);
+    // Drains frames still held by the decoder after the last packet.
+    Array flush_packets();
+
     Array decode_frames_from_file(const String &p_path);
     Array decode_frame_bytes_from_file(const String &p_path);
     Array decode_textures_from_file(const String &p_path);
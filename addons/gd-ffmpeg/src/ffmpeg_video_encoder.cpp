@@ -1,9 +1,13 @@
 #include "ffmpeg_video_encoder.h"
 
+#include "ffmpeg_buffers.h"
+
+#include <godot_cpp/classes/project_settings.hpp>
 #include <godot_cpp/core/error_macros.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
 #include <godot_cpp/variant/variant.hpp>
 #include <godot_cpp/variant/dictionary.hpp>
+#include <algorithm>
 #include <cstring>
 
 namespace godot {
@@ -12,48 +16,26 @@ static void log_video_encoder(const String &p_msg) {
     UtilityFunctions::print("[FFmpegVideoEncoder] ", p_msg);
 }
 
-static void apply_video_option_to_target(void *p_target, const char *p_key, const Variant &p_value) {
-    if (!p_target || p_value.get_type() == Variant::NIL) {
-        return;
-    }
-
-    int err = 0;
-    switch (p_value.get_type()) {
-        case Variant::INT:
-            err = av_opt_set_int(p_target, p_key, static_cast<int64_t>(p_value), 0);
-            break;
-        case Variant::FLOAT:
-            err = av_opt_set_double(p_target, p_key, static_cast<double>(p_value), 0);
-            break;
-        case Variant::BOOL:
-            err = av_opt_set_int(p_target, p_key, bool(p_value) ? 1 : 0, 0);
-            break;
-        default: {
-            const CharString utf8_value = String(p_value).utf8();
-            err = av_opt_set(p_target, p_key, utf8_value.get_data(), 0);
-            break;
+FFmpegVideoEncoder::FFmpegVideoEncoder() {
+    encoder.set_packet_sink([this](const AVPacket *p_packet) {
+        if (replay_active) {
+            if (!replay.has_stream()) {
+                replay.set_stream(encoder.get_codec_context());
+            }
+            replay.push(p_packet);
         }
-    }
-
-    if (err < 0) {
-        char err_buf[AV_ERROR_MAX_STRING_SIZE];
-        av_strerror(err, err_buf, sizeof(err_buf));
-        log_video_encoder("Could not apply option '" + String(p_key) + "' (" + String(err_buf) + ")");
-    }
-}
-
-static void apply_video_option(AVCodecContext *p_ctx, const char *p_key, const Variant &p_value) {
-    if (!p_ctx) {
-        return;
-    }
-    apply_video_option_to_target(p_ctx, p_key, p_value);
-    if (p_ctx->priv_data) {
-        apply_video_option_to_target(p_ctx->priv_data, p_key, p_value);
-    }
-}
-
-FFmpegVideoEncoder::~FFmpegVideoEncoder() {
-    reset_state();
+        dispatch_packet(p_packet);
+    });
+    // Runs on the worker thread, so the signal is emitted on the next idle frame.
+    worker.set_frame_callback([this](int64_t p_frame_index, int p_error) {
+        if (p_error == 0) {
+            call_deferred("emit_signal", "frame_encoded", p_frame_index);
+        }
+    });
+    // Runs on whichever thread muxes (the worker in async mode).
+    encoder.set_file_written_callback([this](const std::string &p_path) {
+        call_deferred("emit_signal", "segment_written", String::utf8(p_path.c_str()));
+    });
 }
 
 void FFmpegVideoEncoder::_bind_methods() {
@@ -71,15 +53,51 @@ void FFmpegVideoEncoder::_bind_methods() {
 
     // Streaming controls
     ClassDB::bind_method(D_METHOD("begin", "path", "stream_peer", "file_access"), &FFmpegVideoEncoder::begin);
+    ClassDB::bind_method(D_METHOD("begin_packets", "global_header"), &FFmpegVideoEncoder::begin_packets, DEFVAL(true));
+    ClassDB::bind_method(D_METHOD("begin_replay", "seconds", "max_memory_bytes"), &FFmpegVideoEncoder::begin_replay, DEFVAL(30.0), DEFVAL(0));
+    ClassDB::bind_method(D_METHOD("save_replay", "path"), &FFmpegVideoEncoder::save_replay);
+    ClassDB::bind_method(D_METHOD("get_replay_duration"), &FFmpegVideoEncoder::get_replay_duration);
+    ClassDB::bind_method(D_METHOD("get_replay_memory"), &FFmpegVideoEncoder::get_replay_memory);
+    ClassDB::bind_method(D_METHOD("begin_segmented", "directory", "segment_seconds", "format", "playlist_size"), &FFmpegVideoEncoder::begin_segmented, DEFVAL(4.0), DEFVAL("hls"), DEFVAL(6));
     ClassDB::bind_method(D_METHOD("push_image", "image"), &FFmpegVideoEncoder::push_image);
+    ClassDB::bind_method(D_METHOD("push_frame", "frame"), &FFmpegVideoEncoder::push_frame);
     ClassDB::bind_method(D_METHOD("push_frame_bytes", "bytes", "width", "height", "format"), &FFmpegVideoEncoder::push_frame_bytes);
     ClassDB::bind_method(D_METHOD("push_frame_bytes_strided", "bytes", "width", "height", "line_sizes", "format"), &FFmpegVideoEncoder::push_frame_bytes_strided);
     ClassDB::bind_method(D_METHOD("push_frame_stream_peer", "stream_peer", "bytes", "width", "height", "format"), &FFmpegVideoEncoder::push_frame_stream_peer);
     ClassDB::bind_method(D_METHOD("end"), &FFmpegVideoEncoder::end);
+    ClassDB::bind_method(D_METHOD("set_io_buffer_size", "bytes"), &FFmpegVideoEncoder::set_io_buffer_size);
+    ClassDB::bind_method(D_METHOD("get_io_buffer_size"), &FFmpegVideoEncoder::get_io_buffer_size);
+    ClassDB::bind_method(D_METHOD("set_container_format", "name"), &FFmpegVideoEncoder::set_container_format);
+    ClassDB::bind_method(D_METHOD("get_container_format"), &FFmpegVideoEncoder::get_container_format);
+    ClassDB::bind_method(D_METHOD("set_live_output", "enabled"), &FFmpegVideoEncoder::set_live_output);
+    ClassDB::bind_method(D_METHOD("is_live_output"), &FFmpegVideoEncoder::is_live_output);
+    ClassDB::bind_method(D_METHOD("set_fragment_duration", "msec"), &FFmpegVideoEncoder::set_fragment_duration);
+    ClassDB::bind_method(D_METHOD("get_fragment_duration"), &FFmpegVideoEncoder::get_fragment_duration);
 
     ClassDB::bind_method(D_METHOD("set_packet_callback", "callable"), &FFmpegVideoEncoder::set_packet_callback);
     ClassDB::bind_method(D_METHOD("get_packet_callback"), &FFmpegVideoEncoder::get_packet_callback);
+    ClassDB::bind_method(D_METHOD("set_packet_objects_enabled", "enabled"), &FFmpegVideoEncoder::set_packet_objects_enabled);
+    ClassDB::bind_method(D_METHOD("is_packet_objects_enabled"), &FFmpegVideoEncoder::is_packet_objects_enabled);
+    ClassDB::bind_method(D_METHOD("set_packet_buffering", "enabled"), &FFmpegVideoEncoder::set_packet_buffering);
+    ClassDB::bind_method(D_METHOD("is_packet_buffering"), &FFmpegVideoEncoder::is_packet_buffering);
     ClassDB::bind_method(D_METHOD("drain_packets"), &FFmpegVideoEncoder::drain_packets);
+    ClassDB::bind_method(D_METHOD("drain_packets_packed"), &FFmpegVideoEncoder::drain_packets_packed);
+
+    // Parallel offline encoding
+    ClassDB::bind_method(D_METHOD("set_parallel_encoding", "enabled"), &FFmpegVideoEncoder::set_parallel_encoding);
+    ClassDB::bind_method(D_METHOD("is_parallel_encoding"), &FFmpegVideoEncoder::is_parallel_encoding);
+    ClassDB::bind_method(D_METHOD("set_parallel_thread_count", "threads"), &FFmpegVideoEncoder::set_parallel_thread_count);
+    ClassDB::bind_method(D_METHOD("get_parallel_thread_count"), &FFmpegVideoEncoder::get_parallel_thread_count);
+
+    // Asynchronous encoding
+    ClassDB::bind_method(D_METHOD("set_async_enabled", "enabled"), &FFmpegVideoEncoder::set_async_enabled);
+    ClassDB::bind_method(D_METHOD("is_async_enabled"), &FFmpegVideoEncoder::is_async_enabled);
+    ClassDB::bind_method(D_METHOD("set_max_queued_frames", "frames"), &FFmpegVideoEncoder::set_max_queued_frames);
+    ClassDB::bind_method(D_METHOD("get_max_queued_frames"), &FFmpegVideoEncoder::get_max_queued_frames);
+    ClassDB::bind_method(D_METHOD("get_queue_depth"), &FFmpegVideoEncoder::get_queue_depth);
+
+    ADD_SIGNAL(MethodInfo("frame_encoded", PropertyInfo(Variant::INT, "frame_index")));
+    ADD_SIGNAL(MethodInfo("segment_written", PropertyInfo(Variant::STRING, "path")));
 
     // Encoding entry points
     ClassDB::bind_method(D_METHOD("encode_images_to_file", "frames", "path"),
@@ -95,64 +113,64 @@ void FFmpegVideoEncoder::_bind_methods() {
 
 void FFmpegVideoEncoder::set_codec_name(const String &p_name) {
     if (!p_name.is_empty()) {
-        codec_name = p_name;
+        encoder.get_config().codec_name = p_name.utf8().get_data();
     }
 }
 
 void FFmpegVideoEncoder::set_pixel_format(const String &p_name) {
     const AVPixelFormat fmt = pixel_format_from_string(p_name);
     if (fmt != AV_PIX_FMT_NONE) {
-        target_pix_fmt = fmt;
+        encoder.get_config().pix_fmt = fmt;
     }
 }
 
 void FFmpegVideoEncoder::set_frame_rate(int p_rate) {
     if (p_rate > 0) {
-        frame_rate = p_rate;
+        encoder.get_config().frame_rate = p_rate;
     }
 }
 
 void FFmpegVideoEncoder::set_resolution(int p_width, int p_height) {
     if (p_width > 0 && p_height > 0) {
-        width = p_width;
-        height = p_height;
+        encoder.get_config().width = p_width;
+        encoder.get_config().height = p_height;
     }
 }
 
 void FFmpegVideoEncoder::set_bit_rate(int64_t p_bit_rate) {
     if (p_bit_rate > 0) {
-        bit_rate = p_bit_rate;
+        encoder.get_config().bit_rate = p_bit_rate;
     }
 }
 
 void FFmpegVideoEncoder::set_rate_control_mode(const String &p_mode) {
     const String lower = p_mode.to_lower();
     if (lower == "cbr" || lower == "vbr") {
-        rate_control_mode = lower;
+        encoder.get_config().rate_control_mode = lower.utf8().get_data();
     }
 }
 
 void FFmpegVideoEncoder::set_quality(int p_quality) {
     if (p_quality >= 0) {
-        quality = p_quality;
+        encoder.get_config().quality = p_quality;
     }
 }
 
 void FFmpegVideoEncoder::set_preset(const String &p_preset) {
     if (!p_preset.is_empty()) {
-        preset = p_preset;
+        encoder.get_config().preset = p_preset.utf8().get_data();
     }
 }
 
 void FFmpegVideoEncoder::set_profile(const String &p_profile) {
     if (!p_profile.is_empty()) {
-        profile = p_profile;
+        encoder.get_config().profile = p_profile.utf8().get_data();
     }
 }
 
 void FFmpegVideoEncoder::set_keyframe_interval(int p_interval) {
     if (p_interval > 0) {
-        keyframe_interval = p_interval;
+        encoder.get_config().keyframe_interval = p_interval;
     }
 }
 
@@ -215,391 +233,277 @@ String FFmpegVideoEncoder::pixel_format_to_string(AVPixelFormat p_fmt) {
     return "unknown";
 }
 
-void FFmpegVideoEncoder::reset_state() {
-    if (sws_ctx) {
-        sws_freeContext(sws_ctx);
-        sws_ctx = nullptr;
-    }
-    if (frame) {
-        av_frame_free(&frame);
-        frame = nullptr;
-    }
-    if (pkt) {
-        av_packet_free(&pkt);
-        pkt = nullptr;
-    }
-    if (codec_ctx) {
-        avcodec_free_context(&codec_ctx);
-        codec_ctx = nullptr;
-    }
-    if (custom_io) {
-        av_freep(&custom_io->buffer);
-        avio_context_free(&custom_io);
-    }
-    custom_io_buffer = nullptr;
-    stream = nullptr;
-    header_written = false;
-    pts_counter = 0;
+PackedByteArray FFmpegVideoEncoder::encode_frame_internal(const PackedByteArray &p_bytes, int p_width, int p_height, AVPixelFormat p_src_format, const PackedInt32Array &p_linesizes) {
+    output.pending_output.clear();
 
-    if (format_ctx) {
-        if (format_ctx->pb && !output_path.is_empty()) {
-            avio_closep(&format_ctx->pb);
+    if (!worker.is_running()) {
+        if (encoder.encode_frame(p_bytes.ptr(), p_bytes.size(), p_width, p_height, p_src_format, p_linesizes.ptr(), p_linesizes.size()) != 0) {
+            return PackedByteArray();
         }
-        format_ctx->pb = nullptr;
-        avformat_free_context(format_ctx);
-        format_ctx = nullptr;
+        return chunked_buffer_to_packed(output.pending_output);
     }
 
-    pending_output.clear();
-    full_output.clear();
-    buffered_packets.clear();
-    collecting_output = false;
-    output_stream_peer = Ref<StreamPeer>();
-    output_file_access = Ref<FileAccess>();
-    output_path = String();
-}
-
-int FFmpegVideoEncoder::write_callback(void *p_opaque, uint8_t *p_buf, int p_buf_size) {
-    FFmpegVideoEncoder *encoder = reinterpret_cast<FFmpegVideoEncoder *>(p_opaque);
-    if (!encoder || p_buf_size <= 0) {
-        return 0;
+    // The worker reads the pixels in place; the heap copy only holds a
+    // reference so the buffer survives until the frame has been scaled.
+    PackedByteArray *held = memnew(PackedByteArray(p_bytes));
+    gdffmpeg::EncoderFrame frame;
+    frame.data = held->ptr();
+    frame.size = static_cast<int>(held->size());
+    frame.width = p_width;
+    frame.height = p_height;
+    frame.format = p_src_format;
+    frame.linesize_count = std::min(static_cast<int>(p_linesizes.size()), AV_NUM_DATA_POINTERS);
+    for (int i = 0; i < frame.linesize_count; i++) {
+        frame.linesizes[i] = p_linesizes[i];
     }
+    frame.release = [held]() {
+        memdelete(held);
+    };
 
-    PackedByteArray chunk;
-    chunk.resize(p_buf_size);
-    memcpy(chunk.ptrw(), p_buf, p_buf_size);
+    if (!worker.submit(std::move(frame))) {
+        log_video_encoder("Frame rejected; the encode worker stopped after an error");
+        return PackedByteArray();
+    }
+    flush_async_output();
+    return chunked_buffer_to_packed(output.pending_output);
+}
 
-    const int old_size = encoder->pending_output.size();
-    encoder->pending_output.resize(old_size + p_buf_size);
-    memcpy(encoder->pending_output.ptrw() + old_size, p_buf, p_buf_size);
+void FFmpegVideoEncoder::flush_async_output() {
+    output.flush_backlog();
 
-    if (encoder->collecting_output) {
-        const int base = encoder->full_output.size();
-        encoder->full_output.resize(base + p_buf_size);
-        memcpy(encoder->full_output.ptrw() + base, p_buf, p_buf_size);
+    std::vector<PendingPacket> ready;
+    {
+        std::lock_guard<std::mutex> lock(async_packets_mutex);
+        ready.swap(async_packets);
     }
-
-    if (encoder->output_stream_peer.is_valid()) {
-        encoder->output_stream_peer->put_data(chunk);
+    for (const PendingPacket &packet : ready) {
+        deliver_packet(packet.packet.get(), packet.info);
     }
+}
 
-    if (encoder->output_file_access.is_valid()) {
-        encoder->output_file_access->store_buffer(chunk);
+void FFmpegVideoEncoder::drain_worker() {
+    if (!worker.is_running()) {
+        return;
+    }
+    const int err = worker.finish();
+    if (err != 0) {
+        log_video_encoder("Encode worker stopped with error " + String::num_int64(err));
     }
-
-    return p_buf_size;
 }
 
-int FFmpegVideoEncoder::initialize_encoder(int p_width, int p_height, AVPixelFormat p_src_format) {
-    if (format_ctx) {
-        return 0;
+void FFmpegVideoEncoder::set_io_buffer_size(int p_bytes) {
+    if (p_bytes > 0) {
+        encoder.get_config().io_buffer_size = p_bytes;
     }
+}
 
-    const int target_width = width > 0 ? width : p_width;
-    const int target_height = height > 0 ? height : p_height;
-    if (target_width <= 0 || target_height <= 0) {
-        log_video_encoder("Invalid dimensions for encoder initialization");
-        return 1;
-    }
+int FFmpegVideoEncoder::get_io_buffer_size() const {
+    return encoder.get_config().io_buffer_size;
+}
 
-    const CharString codec_utf8 = codec_name.utf8();
-    const AVCodec *codec = avcodec_find_encoder_by_name(codec_utf8.get_data());
-    if (!codec) {
-        codec = avcodec_find_encoder(AV_CODEC_ID_H264);
-    }
-    if (!codec) {
-        log_video_encoder("Encoder not found");
-        return 2;
+void FFmpegVideoEncoder::set_container_format(const String &p_name) {
+    if (p_name.is_empty()) {
+        log_video_encoder("Container format cannot be empty");
+        return;
     }
+    encoder.get_config().muxer_name = p_name.to_lower().utf8().get_data();
+}
 
-    const bool use_custom_io = output_stream_peer.is_valid() || output_file_access.is_valid() || output_path.is_empty();
-    AVOutputFormat *output_format = nullptr;
-    if (!use_custom_io) {
-        if (avformat_alloc_output_context2(&format_ctx, nullptr, nullptr, output_path.utf8().get_data()) < 0) {
-            log_video_encoder("Failed to allocate output context from path");
-            return 3;
-        }
-    } else {
-        const CharString muxer_utf8 = muxer_name.utf8();
-        output_format = av_guess_format(muxer_utf8.get_data(), nullptr, nullptr);
-        if (!output_format) {
-            log_video_encoder("Could not guess muxer format: " + muxer_name);
-            return 4;
-        }
-        format_ctx = avformat_alloc_context();
-        format_ctx->oformat = output_format;
-    }
+String FFmpegVideoEncoder::get_container_format() const {
+    return String::utf8(encoder.get_config().muxer_name.c_str());
+}
 
-    if (!format_ctx) {
-        log_video_encoder("Failed to create format context");
-        return 5;
-    }
+void FFmpegVideoEncoder::set_live_output(bool p_enabled) {
+    encoder.get_config().live_output = p_enabled;
+}
 
-    stream = avformat_new_stream(format_ctx, nullptr);
-    if (!stream) {
-        log_video_encoder("Failed to create stream");
-        return 6;
-    }
+bool FFmpegVideoEncoder::is_live_output() const {
+    return encoder.get_config().live_output;
+}
 
-    codec_ctx = avcodec_alloc_context3(codec);
-    if (!codec_ctx) {
-        log_video_encoder("Failed to allocate codec context");
-        return 7;
-    }
+void FFmpegVideoEncoder::set_fragment_duration(int p_msec) {
+    encoder.get_config().fragment_duration_ms = p_msec > 0 ? p_msec : 0;
+}
 
-    codec_ctx->codec_id = codec->id;
-    codec_ctx->width = target_width;
-    codec_ctx->height = target_height;
-    codec_ctx->pix_fmt = target_pix_fmt;
-    codec_ctx->time_base = AVRational{1, frame_rate};
-    codec_ctx->framerate = AVRational{frame_rate, 1};
-    codec_ctx->gop_size = keyframe_interval;
+int FFmpegVideoEncoder::get_fragment_duration() const {
+    return encoder.get_config().fragment_duration_ms;
+}
 
-    if (rate_control_mode == "cbr") {
-        codec_ctx->bit_rate = bit_rate;
-    } else {
-        codec_ctx->bit_rate = 0;
-        apply_video_option(codec_ctx, "crf", quality);
-    }
+void FFmpegVideoEncoder::set_parallel_encoding(bool p_enabled) {
+    parallel_encoding = p_enabled;
+}
 
-    apply_video_option(codec_ctx, "preset", preset);
-    if (!profile.is_empty()) {
-        apply_video_option(codec_ctx, "profile", profile);
-    }
+bool FFmpegVideoEncoder::is_parallel_encoding() const {
+    return parallel_encoding;
+}
 
-    if (format_ctx->oformat->flags & AVFMT_GLOBALHEADER) {
-        codec_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
-    }
+void FFmpegVideoEncoder::set_parallel_thread_count(int p_threads) {
+    parallel_thread_count = p_threads > 0 ? p_threads : 0;
+}
 
-    if (avcodec_open2(codec_ctx, codec, nullptr) < 0) {
-        log_video_encoder("Failed to open codec");
-        return 8;
-    }
+int FFmpegVideoEncoder::get_parallel_thread_count() const {
+    return parallel_thread_count;
+}
 
-    if (avcodec_parameters_from_context(stream->codecpar, codec_ctx) < 0) {
-        log_video_encoder("Failed to copy codec parameters");
-        return 9;
-    }
-    stream->time_base = codec_ctx->time_base;
+void FFmpegVideoEncoder::set_async_enabled(bool p_enabled) {
+    async_enabled = p_enabled;
+}
 
-    if (!use_custom_io) {
-        if (!(format_ctx->oformat->flags & AVFMT_NOFILE)) {
-            if (avio_open(&format_ctx->pb, output_path.utf8().get_data(), AVIO_FLAG_WRITE) < 0) {
-                log_video_encoder("Could not open output file");
-                return 10;
-            }
-        }
-    } else {
-        const int buffer_size = 4 * 1024;
-        custom_io_buffer = static_cast<uint8_t *>(av_malloc(buffer_size));
-        if (!custom_io_buffer) {
-            log_video_encoder("Failed to allocate custom IO buffer");
-            return 11;
-        }
-        custom_io = avio_alloc_context(custom_io_buffer, buffer_size, 1, this, nullptr, &FFmpegVideoEncoder::write_callback, nullptr);
-        if (!custom_io) {
-            log_video_encoder("Failed to allocate custom IO context");
-            return 12;
-        }
-        format_ctx->pb = custom_io;
-        format_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
-        collecting_output = output_path.is_empty() && output_stream_peer.is_null() && output_file_access.is_null();
-    }
+bool FFmpegVideoEncoder::is_async_enabled() const {
+    return async_enabled;
+}
 
-    if (avformat_write_header(format_ctx, nullptr) < 0) {
-        log_video_encoder("Failed to write header");
-        return 13;
+void FFmpegVideoEncoder::set_max_queued_frames(int p_frames) {
+    if (p_frames > 0) {
+        worker.set_max_queued_frames(p_frames);
     }
-    header_written = true;
+}
 
-    frame = av_frame_alloc();
-    pkt = av_packet_alloc();
-    if (!frame || !pkt) {
-        log_video_encoder("Failed to allocate frame/packet");
-        return 14;
-    }
+int FFmpegVideoEncoder::get_max_queued_frames() const {
+    return worker.get_max_queued_frames();
+}
 
-    frame->format = codec_ctx->pix_fmt;
-    frame->width = codec_ctx->width;
-    frame->height = codec_ctx->height;
+int FFmpegVideoEncoder::get_queue_depth() const {
+    return worker.is_running() ? worker.get_queue_depth() : 0;
+}
 
-    if (av_frame_get_buffer(frame, 32) < 0) {
-        log_video_encoder("Failed to allocate frame buffer");
-        return 15;
+void FFmpegVideoEncoder::reset_session() {
+    // A session left open is abandoned, matching the synchronous behaviour.
+    worker.stop();
+    output.clear();
+    buffered_packets.clear();
+    packet_codec_parameters.reset();
+    {
+        std::lock_guard<std::mutex> lock(async_packets_mutex);
+        async_packets.clear();
     }
+    replay_active = false;
+    replay.clear();
+}
 
-    sws_ctx = sws_getCachedContext(
-        nullptr,
-        p_width,
-        p_height,
-        p_src_format,
-        codec_ctx->width,
-        codec_ctx->height,
-        codec_ctx->pix_fmt,
-        SWS_BILINEAR,
-        nullptr,
-        nullptr,
-        nullptr
-    );
+int FFmpegVideoEncoder::begin(const String &p_path, const Ref<StreamPeer> &p_stream_peer, const Ref<FileAccess> &p_file_access) {
+    reset_session();
+    output.stream_peer = p_stream_peer;
+    output.file_access = p_file_access;
+    output.collecting_output = p_path.is_empty() && p_stream_peer.is_null() && p_file_access.is_null();
+    output.deferred = async_enabled;
 
-    if (!sws_ctx && (p_src_format != codec_ctx->pix_fmt || p_width != codec_ctx->width || p_height != codec_ctx->height)) {
-        log_video_encoder("Failed to create scale context");
-        return 16;
+    const bool use_sink = p_path.is_empty() || p_stream_peer.is_valid() || p_file_access.is_valid();
+    encoder.begin(p_path.utf8().get_data(), use_sink ? &output : nullptr);
+    if (async_enabled) {
+        worker.start(&encoder);
     }
-
     return 0;
 }
 
-PackedByteArray FFmpegVideoEncoder::encode_frame_internal(const uint8_t *p_src, int p_src_size, int p_width, int p_height, AVPixelFormat p_src_format, const int *p_linesizes, int p_linesize_count) {
-    PackedByteArray output;
-    pending_output.clear();
-
-    const int final_width = p_width > 0 ? p_width : width;
-    const int final_height = p_height > 0 ? p_height : height;
-
-    if (!p_src || final_width <= 0 || final_height <= 0) {
-        log_video_encoder("Invalid frame payload");
-        return output;
+int FFmpegVideoEncoder::begin_segmented(const String &p_directory, double p_segment_seconds, const String &p_format, int p_playlist_size) {
+    gdffmpeg::StreamingOutputOptions options;
+    const String format = p_format.to_lower();
+    if (format == "hls") {
+        options.format = gdffmpeg::StreamingOutputOptions::FORMAT_HLS;
+    } else if (format == "hls_fmp4") {
+        options.format = gdffmpeg::StreamingOutputOptions::FORMAT_HLS;
+        options.hls_segment_type = "fmp4";
+    } else if (format == "dash") {
+        options.format = gdffmpeg::StreamingOutputOptions::FORMAT_DASH;
+    } else {
+        log_video_encoder("Unknown segmented format: " + p_format);
+        return 1;
     }
-
-    const int init_status = initialize_encoder(final_width, final_height, p_src_format);
-    if (init_status != 0) {
-        return output;
+    if (p_directory.is_empty() || p_segment_seconds <= 0.0) {
+        log_video_encoder("Segmented output needs a directory and a positive segment length");
+        return 2;
     }
+    options.segment_seconds = p_segment_seconds;
+    options.playlist_size = p_playlist_size > 0 ? p_playlist_size : 0;
 
-    AVFrame src_frame;
-    memset(&src_frame, 0, sizeof(src_frame));
-    src_frame.format = p_src_format;
-    src_frame.width = final_width;
-    src_frame.height = final_height;
+    reset_session();
+    output.deferred = async_enabled;
 
-    int linesizes[AV_NUM_DATA_POINTERS] = {0};
-    const bool custom_linesizes = p_linesizes && p_linesize_count > 0;
-    if (custom_linesizes) {
-        const int to_copy = p_linesize_count < AV_NUM_DATA_POINTERS ? p_linesize_count : AV_NUM_DATA_POINTERS;
-        for (int i = 0; i < to_copy; i++) {
-            linesizes[i] = p_linesizes[i];
-        }
-    } else {
-        if (av_image_fill_linesizes(linesizes, p_src_format, final_width) < 0) {
-            log_video_encoder("Could not compute line sizes for frame");
-            return output;
-        }
-    }
-
-    uint8_t *temp_data[AV_NUM_DATA_POINTERS] = {nullptr};
-    const int required_size = av_image_fill_pointers(temp_data, p_src_format, final_height, const_cast<uint8_t *>(p_src), linesizes);
-    if (required_size < 0 || required_size > p_src_size) {
-        log_video_encoder("Invalid buffer/stride combination for frame");
-        return output;
+    const CharString directory = ProjectSettings::get_singleton()->globalize_path(p_directory).utf8();
+    encoder.begin_segmented(directory.get_data(), options);
+    if (async_enabled) {
+        worker.start(&encoder);
     }
+    return 0;
+}
 
-    for (int i = 0; i < AV_NUM_DATA_POINTERS; i++) {
-        src_frame.data[i] = temp_data[i];
-        src_frame.linesize[i] = linesizes[i];
+int FFmpegVideoEncoder::begin_packets(bool p_global_header) {
+    reset_session();
+    output.deferred = async_enabled;
+    encoder.begin_packets(p_global_header);
+    if (async_enabled) {
+        worker.start(&encoder);
     }
+    return 0;
+}
 
-    SwsContext *active_sws = sws_ctx;
-    if (p_src_format != codec_ctx->pix_fmt || p_width != codec_ctx->width || p_height != codec_ctx->height) {
-        active_sws = sws_getCachedContext(
-            sws_ctx,
-            final_width,
-            final_height,
-            p_src_format,
-            codec_ctx->width,
-            codec_ctx->height,
-            codec_ctx->pix_fmt,
-            SWS_BILINEAR,
-            nullptr,
-            nullptr,
-            nullptr
-        );
-        sws_ctx = active_sws;
+int FFmpegVideoEncoder::begin_replay(double p_seconds, int64_t p_max_memory_bytes) {
+    if (p_seconds <= 0.0) {
+        log_video_encoder("Replay duration must be positive");
+        return 1;
     }
+    reset_session();
+    output.deferred = async_enabled;
+    replay.configure(p_seconds, p_max_memory_bytes);
+    replay_active = true;
 
-    if (av_frame_make_writable(frame) < 0) {
-        log_video_encoder("Frame not writable");
-        return output;
+    // Saved files are MP4/Matroska-style containers that keep the codec
+    // headers out of band.
+    encoder.begin_packets(true);
+    if (async_enabled) {
+        worker.start(&encoder);
     }
+    return 0;
+}
 
-    if (active_sws) {
-        sws_scale(
-            active_sws,
-            src_frame.data,
-            src_frame.linesize,
-            0,
-            final_height,
-            frame->data,
-            frame->linesize
-        );
-    } else {
-        av_image_copy(frame->data, frame->linesize, (const uint8_t **)src_frame.data, src_frame.linesize, codec_ctx->pix_fmt, codec_ctx->width, codec_ctx->height);
+int FFmpegVideoEncoder::save_replay(const String &p_path) {
+    const CharString path = ProjectSettings::get_singleton()->globalize_path(p_path).utf8();
+    const int result = replay.save(path.get_data());
+    if (result != 0) {
+        log_video_encoder("Saving the replay failed with code " + String::num_int64(result));
     }
+    return result;
+}
 
-    frame->pts = pts_counter++;
+double FFmpegVideoEncoder::get_replay_duration() const {
+    return replay.get_buffered_seconds();
+}
 
-    if (avcodec_send_frame(codec_ctx, frame) < 0) {
-        log_video_encoder("Failed to send frame to encoder");
-        return output;
-    }
+int64_t FFmpegVideoEncoder::get_replay_memory() const {
+    return replay.get_buffered_bytes();
+}
 
-    while (true) {
-        const int receive_ret = avcodec_receive_packet(codec_ctx, pkt);
-        if (receive_ret == AVERROR(EAGAIN) || receive_ret == AVERROR_EOF) {
-            break;
-        }
-        if (receive_ret < 0) {
-            log_video_encoder("Failed to receive packet");
-            break;
-        }
-        dispatch_packet(pkt);
-        pkt->stream_index = stream->index;
-        av_packet_rescale_ts(pkt, codec_ctx->time_base, stream->time_base);
-        if (av_interleaved_write_frame(format_ctx, pkt) < 0) {
-            log_video_encoder("Failed to write frame");
-            av_packet_unref(pkt);
-            break;
-        }
-        av_packet_unref(pkt);
+AVPixelFormat FFmpegVideoEncoder::pixel_format_from_image(Image::Format p_format) {
+    // Only layouts whose level-0 bytes match an FFmpeg format exactly; the
+    // rest (single/two-channel red formats, packed 16-bit) go through convert().
+    switch (p_format) {
+        case Image::FORMAT_L8: return AV_PIX_FMT_GRAY8;
+        case Image::FORMAT_LA8: return AV_PIX_FMT_YA8;
+        case Image::FORMAT_RGB8: return AV_PIX_FMT_RGB24;
+        case Image::FORMAT_RGBA8: return AV_PIX_FMT_RGBA;
+        case Image::FORMAT_RGBF: return AV_PIX_FMT_RGBF32LE;
+        case Image::FORMAT_RGBAF: return AV_PIX_FMT_RGBAF32LE;
+        case Image::FORMAT_RGBH: return AV_PIX_FMT_RGBF16LE;
+        case Image::FORMAT_RGBAH: return AV_PIX_FMT_RGBAF16LE;
+        default: break;
     }
-
-    output = pending_output;
-    return output;
+    return AV_PIX_FMT_NONE;
 }
 
-int FFmpegVideoEncoder::flush_internal(PackedByteArray &r_output) {
-    pending_output.clear();
-    if (!codec_ctx || !pkt) {
-        return 0;
+Ref<Image> FFmpegVideoEncoder::encodable_image(const Ref<Image> &p_image, AVPixelFormat &r_format) {
+    r_format = pixel_format_from_image(p_image->get_format());
+    if (!p_image->is_compressed() && gdffmpeg::VideoEncoder::is_supported_source_format(r_format)) {
+        return p_image;
     }
 
-    avcodec_send_frame(codec_ctx, nullptr);
-    while (true) {
-        const int receive_ret = avcodec_receive_packet(codec_ctx, pkt);
-        if (receive_ret == AVERROR(EAGAIN) || receive_ret == AVERROR_EOF) {
-            break;
-        }
-        if (receive_ret < 0) {
-            break;
-        }
-        dispatch_packet(pkt);
-        pkt->stream_index = stream->index;
-        av_packet_rescale_ts(pkt, codec_ctx->time_base, stream->time_base);
-        av_interleaved_write_frame(format_ctx, pkt);
-        av_packet_unref(pkt);
+    Ref<Image> converted = p_image->duplicate();
+    if (converted->is_compressed() && converted->decompress() != OK) {
+        return Ref<Image>();
     }
-
-    av_write_trailer(format_ctx);
-    r_output = pending_output;
-    return 0;
-}
-
-int FFmpegVideoEncoder::begin(const String &p_path, const Ref<StreamPeer> &p_stream_peer, const Ref<FileAccess> &p_file_access) {
-    reset_state();
-    output_path = p_path;
-    output_stream_peer = p_stream_peer;
-    output_file_access = p_file_access;
-    return 0;
+    converted->convert(Image::FORMAT_RGBA8);
+    r_format = AV_PIX_FMT_RGBA;
+    return converted;
 }
 
 PackedByteArray FFmpegVideoEncoder::push_image(const Ref<Image> &p_image) {
@@ -609,16 +513,49 @@ PackedByteArray FFmpegVideoEncoder::push_image(const Ref<Image> &p_image) {
         return output;
     }
 
-    Ref<Image> img = p_image;
-    if (width > 0 && height > 0 && (p_image->get_width() != width || p_image->get_height() != height)) {
-        img = p_image->duplicate();
-        img->resize(width, height, Image::INTERPOLATE_LANCZOS);
+    // get_data() shares the Image's buffer, and any size mismatch with the
+    // configured resolution is handled by the encoder's sws pass.
+    AVPixelFormat src_fmt = AV_PIX_FMT_NONE;
+    const Ref<Image> img = encodable_image(p_image, src_fmt);
+    if (img.is_null()) {
+        log_video_encoder("push_image could not decompress image");
+        return output;
+    }
+    return encode_frame_internal(img->get_data(), img->get_width(), img->get_height(), src_fmt);
+}
+
+PackedByteArray FFmpegVideoEncoder::push_frame(const Ref<FFmpegFrame> &p_frame) {
+    if (p_frame.is_null() || !p_frame->is_video()) {
+        log_video_encoder("push_frame expects a video FFmpegFrame");
+        return PackedByteArray();
     }
+    output.pending_output.clear();
 
-    Ref<Image> converted = img->duplicate();
-    converted->convert(Image::FORMAT_RGBA8);
-    PackedByteArray rgba = converted->get_data();
-    return encode_frame_internal(rgba.ptr(), rgba.size(), converted->get_width(), converted->get_height(), AV_PIX_FMT_RGBA);
+    if (!worker.is_running()) {
+        if (encoder.encode_avframe(p_frame->get_frame()) != 0) {
+            return PackedByteArray();
+        }
+        return chunked_buffer_to_packed(output.pending_output);
+    }
+
+    // The worker gets its own reference to the buffers, so no Godot object
+    // is released off the main thread.
+    AVFrame *held = av_frame_clone(p_frame->get_frame());
+    if (!held) {
+        return PackedByteArray();
+    }
+    gdffmpeg::EncoderFrame frame;
+    frame.av_frame = held;
+    frame.release = [held]() mutable {
+        av_frame_free(&held);
+    };
+
+    if (!worker.submit(std::move(frame))) {
+        log_video_encoder("Frame rejected; the encode worker stopped after an error");
+        return PackedByteArray();
+    }
+    flush_async_output();
+    return chunked_buffer_to_packed(output.pending_output);
 }
 
 PackedByteArray FFmpegVideoEncoder::push_frame_bytes(const PackedByteArray &p_bytes, int p_width, int p_height, const String &p_format) {
@@ -631,7 +568,7 @@ PackedByteArray FFmpegVideoEncoder::push_frame_bytes(const PackedByteArray &p_by
         log_video_encoder("Unknown pixel format: " + p_format);
         return output;
     }
-    return encode_frame_internal(p_bytes.ptr(), p_bytes.size(), p_width, p_height, src_fmt);
+    return encode_frame_internal(p_bytes, p_width, p_height, src_fmt);
 }
 
 PackedByteArray FFmpegVideoEncoder::push_frame_bytes_strided(const PackedByteArray &p_bytes, int p_width, int p_height, const PackedInt32Array &p_line_sizes, const String &p_format) {
@@ -646,7 +583,7 @@ PackedByteArray FFmpegVideoEncoder::push_frame_bytes_strided(const PackedByteArr
         return output;
     }
 
-    return encode_frame_internal(p_bytes.ptr(), p_bytes.size(), p_width, p_height, src_fmt, p_line_sizes.ptr(), p_line_sizes.size());
+    return encode_frame_internal(p_bytes, p_width, p_height, src_fmt, p_line_sizes);
 }
 
 PackedByteArray FFmpegVideoEncoder::push_frame_stream_peer(const Ref<StreamPeer> &p_stream_peer, int p_bytes, int p_width, int p_height, const String &p_format) {
@@ -669,18 +606,20 @@ PackedByteArray FFmpegVideoEncoder::push_frame_stream_peer(const Ref<StreamPeer>
 }
 
 PackedByteArray FFmpegVideoEncoder::end() {
-    PackedByteArray output;
-    if (!format_ctx) {
-        return output;
+    output.pending_output.clear();
+    drain_worker();
+    if (!encoder.is_initialized()) {
+        output.clear();
+        return PackedByteArray();
     }
 
-    flush_internal(output);
-    if (collecting_output) {
-        output = full_output;
-    }
+    encoder.finish();
+    flush_async_output();
+    const PackedByteArray result = chunked_buffer_to_packed(output.collecting_output ? output.full_output : output.pending_output);
 
-    reset_state();
-    return output;
+    encoder.reset();
+    output.clear();
+    return result;
 }
 
 int FFmpegVideoEncoder::encode_images_to_file(const Array &p_frames, const String &p_path) {
@@ -699,16 +638,21 @@ int FFmpegVideoEncoder::encode_internal(const Vector<Ref<Image>> &p_frames, cons
         log_video_encoder("No frames provided");
         return 1;
     }
+    if (parallel_encoding) {
+        return encode_parallel(p_frames, p_path, r_bytes);
+    }
 
     begin(p_path);
     for (int i = 0; i < p_frames.size(); i++) {
         const PackedByteArray chunk = push_image(p_frames[i]);
-        if (chunk.is_empty() && header_written == false) {
+        // Async output lags behind submission, so only the final state counts.
+        if (!worker.is_running() && chunk.is_empty() && !encoder.is_header_written()) {
             return 1;
         }
     }
 
-    const bool started = header_written || format_ctx != nullptr;
+    drain_worker();
+    const bool started = encoder.is_initialized();
     PackedByteArray final = end();
     if (r_bytes) {
         *r_bytes = final;
@@ -725,58 +669,256 @@ int FFmpegVideoEncoder::encode_internal(const Array &p_frames, const String &p_p
     return encode_internal(frames, p_path, r_bytes);
 }
 
+int FFmpegVideoEncoder::encode_parallel(const Vector<Ref<Image>> &p_frames, const String &p_path, PackedByteArray *r_bytes) {
+    // Pixel buffers are pinned here on the calling thread; the segment
+    // threads only read them.
+    std::vector<PackedByteArray> pixels(p_frames.size());
+    std::vector<gdffmpeg::EncoderFrame> frames(p_frames.size());
+    for (int i = 0; i < p_frames.size(); i++) {
+        if (p_frames[i].is_null()) {
+            log_video_encoder("Frame " + String::num_int64(i) + " is not an image");
+            return 1;
+        }
+        AVPixelFormat src_fmt = AV_PIX_FMT_NONE;
+        const Ref<Image> img = encodable_image(p_frames[i], src_fmt);
+        if (img.is_null()) {
+            log_video_encoder("Frame " + String::num_int64(i) + " could not be decompressed");
+            return 1;
+        }
+        pixels[i] = img->get_data();
+        frames[i].data = pixels[i].ptr();
+        frames[i].size = static_cast<int>(pixels[i].size());
+        frames[i].width = img->get_width();
+        frames[i].height = img->get_height();
+        frames[i].format = src_fmt;
+    }
+
+    worker.stop();
+    encoder.reset();
+    output.clear();
+    buffered_packets.clear();
+    packet_codec_parameters.reset();
+    // There are no per-call results here, so pending_output holds the whole
+    // container without a second copy in full_output.
+    output.collecting_output = false;
+
+    gdffmpeg::SegmentedEncoder segmented;
+    segmented.get_config() = encoder.get_config();
+    segmented.set_thread_count(parallel_thread_count);
+    if (packets_wanted) {
+        const AVRational time_base = segmented.get_time_base();
+        segmented.set_packet_sink([this, time_base, &segmented](const AVPacket *p_packet) {
+            if (packet_objects && !packet_codec_parameters) {
+                packet_codec_parameters = FFmpegPacket::make_codec_parameters(segmented.get_codec_context());
+            }
+            deliver_packet(p_packet, make_packet_info(p_packet, time_base, 0));
+        });
+    }
+
+    const int err = segmented.encode(frames, p_path.utf8().get_data(), p_path.is_empty() ? &output : nullptr);
+    if (r_bytes) {
+        *r_bytes = err == 0 ? chunked_buffer_to_packed(output.pending_output) : PackedByteArray();
+    }
+    output.clear();
+    return err == 0 ? 0 : 1;
+}
+
+void FFmpegVideoEncoder::PacketBuffer::append(const uint8_t *p_data, size_t p_size, const PacketInfo &p_info) {
+    offsets.push_back(static_cast<int64_t>(data.size()));
+    if (p_data && p_size > 0) {
+        data.insert(data.end(), p_data, p_data + p_size);
+    }
+    pts.push_back(p_info.pts);
+    dts.push_back(p_info.dts);
+    durations.push_back(p_info.duration);
+    flags.push_back(p_info.is_key ? AV_PKT_FLAG_KEY : 0);
+    time_base = p_info.time_base;
+    stream_index = p_info.stream_index;
+}
+
+void FFmpegVideoEncoder::PacketBuffer::clear() {
+    data.clear();
+    offsets.clear();
+    pts.clear();
+    dts.clear();
+    durations.clear();
+    flags.clear();
+}
+
+static PackedInt64Array to_packed_int64(const std::vector<int64_t> &p_values) {
+    PackedInt64Array out;
+    out.resize(static_cast<int64_t>(p_values.size()));
+    if (!p_values.empty()) {
+        memcpy(out.ptrw(), p_values.data(), p_values.size() * sizeof(int64_t));
+    }
+    return out;
+}
+
+FFmpegVideoEncoder::PacketInfo FFmpegVideoEncoder::make_packet_info(const AVPacket *p_packet, AVRational p_time_base, int p_stream_index) {
+    PacketInfo info;
+    info.pts = p_packet->pts;
+    info.dts = p_packet->dts;
+    info.duration = p_packet->duration;
+    info.is_key = (p_packet->flags & AV_PKT_FLAG_KEY) != 0;
+    info.time_base = p_time_base;
+    info.stream_index = p_stream_index;
+    return info;
+}
+
+void FFmpegVideoEncoder::update_packets_wanted() {
+    packets_wanted = packet_buffering || packet_callback.is_valid();
+}
+
 void FFmpegVideoEncoder::dispatch_packet(const AVPacket *p_packet) {
-    if (!p_packet) {
+    if (!p_packet || !packets_wanted) {
+        return;
+    }
+
+    const PacketInfo info = make_packet_info(p_packet, encoder.get_time_base(), encoder.get_stream_index());
+    if (output.deferred) {
+        // A reference, not a copy: encoder packets are ref-counted.
+        PendingPacket packet;
+        packet.info = info;
+        packet.packet.reset(av_packet_clone(p_packet));
+        if (!packet.packet) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(async_packets_mutex);
+        async_packets.push_back(std::move(packet));
+        return;
+    }
+    deliver_packet(p_packet, info);
+}
+
+void FFmpegVideoEncoder::deliver_packet(const AVPacket *p_packet, const PacketInfo &p_info) {
+    if (!packet_callback.is_valid()) {
+        if (packet_buffering) {
+            buffered_packets.append(p_packet->data, static_cast<size_t>(std::max(0, p_packet->size)), p_info);
+        }
+        return;
+    }
+
+    if (packet_objects) {
+        if (!packet_codec_parameters) {
+            packet_codec_parameters = FFmpegPacket::make_codec_parameters(encoder.get_codec_context());
+        }
+        Ref<FFmpegPacket> wrapped = FFmpegPacket::create(p_packet, p_info.time_base, p_info.stream_index, packet_codec_parameters);
+        if (wrapped.is_valid()) {
+            packet_callback.call(wrapped);
+        }
         return;
     }
 
     Dictionary payload;
     PackedByteArray data;
-    if (p_packet->size > 0 && p_packet->data) {
+    if (p_packet->data && p_packet->size > 0) {
         data.resize(p_packet->size);
-        memcpy(data.ptrw(), p_packet->data, p_packet->size);
+        memcpy(data.ptrw(), p_packet->data, static_cast<size_t>(p_packet->size));
     }
 
     payload["data"] = data;
-    payload["pts"] = p_packet->pts;
-    payload["dts"] = p_packet->dts;
-    payload["duration"] = p_packet->duration;
-    payload["is_key"] = (p_packet->flags & AV_PKT_FLAG_KEY) != 0;
-    payload["time_base_num"] = codec_ctx ? codec_ctx->time_base.num : 0;
-    payload["time_base_den"] = codec_ctx ? codec_ctx->time_base.den : 0;
-    payload["stream_index"] = stream ? stream->index : -1;
-
-    if (packet_callback.is_valid()) {
-        packet_callback.call(payload);
-    } else {
-        buffered_packets.append(payload);
-    }
+    payload["pts"] = p_info.pts;
+    payload["dts"] = p_info.dts;
+    payload["duration"] = p_info.duration;
+    payload["is_key"] = p_info.is_key;
+    payload["time_base_num"] = p_info.time_base.num;
+    payload["time_base_den"] = p_info.time_base.den;
+    payload["stream_index"] = p_info.stream_index;
+    packet_callback.call(payload);
 }
 
 void FFmpegVideoEncoder::set_packet_callback(const Callable &p_callable) {
     packet_callback = p_callable;
+    update_packets_wanted();
 }
 
 Callable FFmpegVideoEncoder::get_packet_callback() const {
     return packet_callback;
 }
 
+void FFmpegVideoEncoder::set_packet_objects_enabled(bool p_enabled) {
+    packet_objects = p_enabled;
+}
+
+bool FFmpegVideoEncoder::is_packet_objects_enabled() const {
+    return packet_objects;
+}
+
+void FFmpegVideoEncoder::set_packet_buffering(bool p_enabled) {
+    packet_buffering = p_enabled;
+    if (!p_enabled) {
+        buffered_packets.clear();
+    }
+    update_packets_wanted();
+}
+
+bool FFmpegVideoEncoder::is_packet_buffering() const {
+    return packet_buffering;
+}
+
 Array FFmpegVideoEncoder::drain_packets() {
-    Array out = buffered_packets;
+    flush_async_output();
+
+    Array out;
+    const size_t count = buffered_packets.count();
+    for (size_t i = 0; i < count; i++) {
+        const int64_t start = buffered_packets.offsets[i];
+        const int64_t end = i + 1 < count ? buffered_packets.offsets[i + 1] : static_cast<int64_t>(buffered_packets.data.size());
+        PackedByteArray data;
+        if (end > start) {
+            data.resize(end - start);
+            memcpy(data.ptrw(), buffered_packets.data.data() + start, static_cast<size_t>(end - start));
+        }
+
+        Dictionary payload;
+        payload["data"] = data;
+        payload["pts"] = buffered_packets.pts[i];
+        payload["dts"] = buffered_packets.dts[i];
+        payload["duration"] = buffered_packets.durations[i];
+        payload["is_key"] = (buffered_packets.flags[i] & AV_PKT_FLAG_KEY) != 0;
+        payload["time_base_num"] = buffered_packets.time_base.num;
+        payload["time_base_den"] = buffered_packets.time_base.den;
+        payload["stream_index"] = buffered_packets.stream_index;
+        out.append(payload);
+    }
+    buffered_packets.clear();
+    return out;
+}
+
+Dictionary FFmpegVideoEncoder::drain_packets_packed() {
+    flush_async_output();
+
+    PackedByteArray data;
+    data.resize(static_cast<int64_t>(buffered_packets.data.size()));
+    if (!buffered_packets.data.empty()) {
+        memcpy(data.ptrw(), buffered_packets.data.data(), buffered_packets.data.size());
+    }
+    buffered_packets.offsets.push_back(static_cast<int64_t>(buffered_packets.data.size()));
+
+    Dictionary out;
+    out["data"] = data;
+    out["offsets"] = to_packed_int64(buffered_packets.offsets);
+    out["pts"] = to_packed_int64(buffered_packets.pts);
+    out["dts"] = to_packed_int64(buffered_packets.dts);
+    out["duration"] = to_packed_int64(buffered_packets.durations);
+    out["flags"] = to_packed_int64(buffered_packets.flags);
+    out["time_base_num"] = buffered_packets.time_base.num;
+    out["time_base_den"] = buffered_packets.time_base.den;
+    out["stream_index"] = buffered_packets.stream_index;
     buffered_packets.clear();
     return out;
 }
 
 String FFmpegVideoEncoder::get_codec_name() const {
-    return codec_name;
+    return String::utf8(encoder.get_config().codec_name.c_str());
 }
 
 String FFmpegVideoEncoder::get_pixel_format() const {
-    return pixel_format_to_string(target_pix_fmt);
+    return pixel_format_to_string(encoder.get_config().pix_fmt);
 }
 
 int FFmpegVideoEncoder::get_frame_rate() const {
-    return frame_rate;
+    return encoder.get_config().frame_rate;
 }
 
 void FFmpegVideoEncoder::set_resolution_vec(const Vector2i &p_size) {
@@ -784,31 +926,31 @@ void FFmpegVideoEncoder::set_resolution_vec(const Vector2i &p_size) {
 }
 
 Vector2i FFmpegVideoEncoder::get_resolution() const {
-    return Vector2i(width, height);
+    return Vector2i(encoder.get_config().width, encoder.get_config().height);
 }
 
 int64_t FFmpegVideoEncoder::get_bit_rate() const {
-    return bit_rate;
+    return encoder.get_config().bit_rate;
 }
 
 String FFmpegVideoEncoder::get_rate_control_mode() const {
-    return rate_control_mode;
+    return String::utf8(encoder.get_config().rate_control_mode.c_str());
 }
 
 int FFmpegVideoEncoder::get_quality() const {
-    return quality;
+    return encoder.get_config().quality;
 }
 
 String FFmpegVideoEncoder::get_preset() const {
-    return preset;
+    return String::utf8(encoder.get_config().preset.c_str());
 }
 
 String FFmpegVideoEncoder::get_profile() const {
-    return profile;
+    return String::utf8(encoder.get_config().profile.c_str());
 }
 
 int FFmpegVideoEncoder::get_keyframe_interval() const {
-    return keyframe_interval;
+    return encoder.get_config().keyframe_interval;
 }
 
 } // namespace godot
@@ -8,17 +8,24 @@
 #include <godot_cpp/classes/ref_counted.hpp>
 #include <godot_cpp/core/class_db.hpp>
 #include <godot_cpp/variant/callable.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
 #include <godot_cpp/variant/packed_byte_array.hpp>
 #include <godot_cpp/variant/packed_int32_array.hpp>
+#include <godot_cpp/variant/packed_int64_array.hpp>
 
-extern "C" {
-    #include <libavcodec/avcodec.h>
-    #include <libavformat/avformat.h>
-    #include <libavutil/error.h>
-    #include <libavutil/opt.h>
-    #include <libavutil/imgutils.h>
-    #include <libswscale/swscale.h>
-}
+#include "ffmpeg_buffers.h"
+#include "ffmpeg_frame.h"
+#include "ffmpeg_packet.h"
+
+#include "core/encode_worker.h"
+#include "core/replay_buffer.h"
+#include "core/segmented_encoder.h"
+#include "core/video_encoder.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace godot {
 
@@ -26,48 +33,87 @@ class FFmpegVideoEncoder : public RefCounted {
     GDCLASS(FFmpegVideoEncoder, RefCounted);
 
 private:
-    String codec_name = "libx264";
-    AVPixelFormat target_pix_fmt = AV_PIX_FMT_YUV420P;
-    int frame_rate = 30;
-    int width = 0;
-    int height = 0;
-    int64_t bit_rate = 4000000;
-    int quality = 23;
-    String rate_control_mode = "vbr";
-    String preset = "medium";
-    String profile;
-    int keyframe_interval = 12;
-
-    // Streaming state
-    AVFormatContext *format_ctx = nullptr;
-    AVCodecContext *codec_ctx = nullptr;
-    AVStream *stream = nullptr;
-    AVFrame *frame = nullptr;
-    AVPacket *pkt = nullptr;
-    SwsContext *sws_ctx = nullptr;
-    AVIOContext *custom_io = nullptr;
-    uint8_t *custom_io_buffer = nullptr;
-    int64_t pts_counter = 0;
-    bool collecting_output = false;
-    bool header_written = false;
-    PackedByteArray pending_output;
-    PackedByteArray full_output;
-    Array buffered_packets;
+    // Everything about a packet except its payload.
+    struct PacketInfo {
+        int64_t pts = 0;
+        int64_t dts = 0;
+        int64_t duration = 0;
+        bool is_key = false;
+        AVRational time_base = AVRational{0, 1};
+        int stream_index = -1;
+    };
+
+    struct PacketFree {
+        void operator()(AVPacket *p_packet) const { av_packet_free(&p_packet); }
+    };
+
+    // Packet referenced on the worker thread, delivered once back on the
+    // caller's thread.
+    struct PendingPacket {
+        PacketInfo info;
+        std::unique_ptr<AVPacket, PacketFree> packet;
+    };
+
+    // Packets waiting for drain_packets()/drain_packets_packed(), stored as
+    // one payload buffer plus parallel metadata arrays.
+    struct PacketBuffer {
+        std::vector<uint8_t> data;
+        std::vector<int64_t> offsets;
+        std::vector<int64_t> pts;
+        std::vector<int64_t> dts;
+        std::vector<int64_t> durations;
+        std::vector<int64_t> flags;
+        AVRational time_base = AVRational{0, 1};
+        int stream_index = -1;
+
+        void append(const uint8_t *p_data, size_t p_size, const PacketInfo &p_info);
+        size_t count() const { return offsets.size(); }
+        void clear();
+    };
+
+    gdffmpeg::VideoEncoder encoder;
+    GodotOutputSink output;
+    PacketBuffer buffered_packets;
+    bool packet_buffering = false;
+    bool packet_objects = false;
     Callable packet_callback;
-    Ref<StreamPeer> output_stream_peer;
-    Ref<FileAccess> output_file_access;
-    String output_path;
-    String muxer_name = "mp4";
-
-    int initialize_encoder(int p_width, int p_height, AVPixelFormat p_src_format);
-    void reset_state();
-    PackedByteArray encode_frame_internal(const uint8_t *p_src, int p_src_size, int p_width, int p_height, AVPixelFormat p_src_format, const int *p_linesizes = nullptr, int p_linesize_count = 0);
-    int flush_internal(PackedByteArray &r_output);
+    // Built from the codec context on the first packet of each session and
+    // shared by every FFmpegPacket handed out.
+    SharedCodecParameters packet_codec_parameters;
+    // Read by dispatch_packet() on the worker thread; true while a callback
+    // or packet buffering wants packets.
+    std::atomic<bool> packets_wanted{ false };
+
+    // Filled from the packet sink during begin_replay() sessions; read by
+    // save_replay() on the caller's thread.
+    gdffmpeg::ReplayBuffer replay;
+    std::atomic<bool> replay_active{ false };
+
+    bool parallel_encoding = false;
+    int parallel_thread_count = 0;
+
+    bool async_enabled = false;
+    std::mutex async_packets_mutex;
+    std::vector<PendingPacket> async_packets;
+    // Declared last so it is joined before the encoder and sink go away.
+    gdffmpeg::EncodeWorker worker;
+
+    static PacketInfo make_packet_info(const AVPacket *p_packet, AVRational p_time_base, int p_stream_index);
+    void update_packets_wanted();
     void dispatch_packet(const AVPacket *p_packet);
-    static int write_callback(void *p_opaque, uint8_t *p_buf, int p_buf_size);
+    void deliver_packet(const AVPacket *p_packet, const PacketInfo &p_info);
+    void flush_async_output();
+    // Abandons the current session before begin()/begin_segmented().
+    void reset_session();
+    void drain_worker();
+    PackedByteArray encode_frame_internal(const PackedByteArray &p_bytes, int p_width, int p_height, AVPixelFormat p_src_format, const PackedInt32Array &p_linesizes = PackedInt32Array());
 
     int encode_internal(const Vector<Ref<Image>> &p_frames, const String &p_path, PackedByteArray *r_bytes);
     int encode_internal(const Array &p_frames, const String &p_path, PackedByteArray *r_bytes);
+    int encode_parallel(const Vector<Ref<Image>> &p_frames, const String &p_path, PackedByteArray *r_bytes);
+    // p_image itself when its buffer can be fed as-is, otherwise an RGBA8
+    // copy. r_format receives the matching AVPixelFormat.
+    static Ref<Image> encodable_image(const Ref<Image> &p_image, AVPixelFormat &r_format);
     static Ref<Image> image_from_any(const Variant &p_value);
     static AVPixelFormat pixel_format_from_string(const String &p_name);
     static String pixel_format_to_string(AVPixelFormat p_fmt);
@@ -76,7 +122,11 @@ protected:
     static void _bind_methods();
 
 public:
-    ~FFmpegVideoEncoder();
+    FFmpegVideoEncoder();
+
+    // AVPixelFormat sharing the level-0 byte layout of p_format, or
+    // AV_PIX_FMT_NONE when the Image has to be converted first.
+    static AVPixelFormat pixel_format_from_image(Image::Format p_format);
 
     void set_codec_name(const String &p_name);
     String get_codec_name() const;
@@ -109,8 +159,73 @@ public:
     void set_keyframe_interval(int p_interval);
     int get_keyframe_interval() const;
 
+    // Parallel mode only affects encode_images()/encode_images_to_file(): the
+    // sequence is cut at keyframe_interval boundaries and the segments are
+    // encoded concurrently, then joined into one container.
+    void set_parallel_encoding(bool p_enabled);
+    bool is_parallel_encoding() const;
+    // Segments encoded at once; 0 (default) uses every core.
+    void set_parallel_thread_count(int p_threads);
+    int get_parallel_thread_count() const;
+
+    // Async mode moves scaling, encoding and muxing to a worker thread. The
+    // push_* calls only queue the frame (blocking once max_queued_frames are
+    // waiting) and return whatever output the worker has produced so far.
+    // Takes effect on the next begin().
+    void set_async_enabled(bool p_enabled);
+    bool is_async_enabled() const;
+    void set_max_queued_frames(int p_frames);
+    int get_max_queued_frames() const;
+    // Frames queued or being encoded by the worker; 0 in synchronous mode.
+    int get_queue_depth() const;
+
+    // Size of the AVIO buffer used when muxing into memory or a
+    // StreamPeer/FileAccess (default 64 KiB). Larger buffers mean fewer
+    // write callbacks per frame.
+    void set_io_buffer_size(int p_bytes);
+    int get_io_buffer_size() const;
+
+    // Container used for memory and StreamPeer/FileAccess output (default
+    // "mp4"); file paths pick theirs from the extension.
+    void set_container_format(const String &p_name);
+    String get_container_format() const;
+    // Streaming-friendly output that can be played while it arrives:
+    // fragmented MP4 or live Matroska/WebM clusters, flushed one fragment at
+    // a time. MP4 output to memory or a StreamPeer is always fragmented.
+    // Takes effect on the next begin().
+    void set_live_output(bool p_enabled);
+    bool is_live_output() const;
+    // Longest fragment in milliseconds; 0 (default) cuts only at keyframes.
+    void set_fragment_duration(int p_msec);
+    int get_fragment_duration() const;
+
     int begin(const String &p_path = String(), const Ref<StreamPeer> &p_stream_peer = Ref<StreamPeer>(), const Ref<FileAccess> &p_file_access = Ref<FileAccess>());
+    // HLS ("hls" with MPEG-TS segments, "hls_fmp4") or DASH ("dash")
+    // presentation in p_directory: stream.m3u8/stream.mpd plus segments cut
+    // at keyframes every p_segment_seconds. Only the last p_playlist_size
+    // segments are kept (0 keeps all). segment_written fires for every file
+    // written; push_* and end() return no bytes. Returns 0 on success.
+    int begin_segmented(const String &p_directory, double p_segment_seconds = 4.0, const String &p_format = "hls", int p_playlist_size = 6);
+    // Packets only, no container: frames reach the packet callback (or the
+    // packet buffer) and push_* and end() return no bytes. Used to feed an
+    // FFmpegMuxer; p_global_header should match its needs_global_header().
+    int begin_packets(bool p_global_header = true);
+    // Instant-replay mode: frames are encoded continuously but only the last
+    // p_seconds of packets are kept in memory, as whole GOPs and within
+    // p_max_memory_bytes (0 = no cap). push_* and end() return no bytes.
+    // The window stays available after end() until the next begin*().
+    int begin_replay(double p_seconds = 30.0, int64_t p_max_memory_bytes = 0);
+    // Muxes the current window into p_path (container from the extension)
+    // without re-encoding. Safe while frames are still being pushed.
+    // Returns 0 on success.
+    int save_replay(const String &p_path);
+    double get_replay_duration() const;
+    int64_t get_replay_memory() const;
+
     PackedByteArray push_image(const Ref<Image> &p_image);
+    // Encodes a decoded frame in its native format. Frames already in the
+    // encoder's size and pixel format are passed by reference.
+    PackedByteArray push_frame(const Ref<FFmpegFrame> &p_frame);
     PackedByteArray push_frame_bytes(const PackedByteArray &p_bytes, int p_width, int p_height, const String &p_format = "rgba");
     PackedByteArray push_frame_bytes_strided(const PackedByteArray &p_bytes, int p_width, int p_height, const PackedInt32Array &p_line_sizes, const String &p_format = "rgba");
     PackedByteArray push_frame_stream_peer(const Ref<StreamPeer> &p_stream_peer, int p_bytes, int p_width, int p_height, const String &p_format = "rgba");
@@ -118,7 +233,22 @@ public:
 
     void set_packet_callback(const Callable &p_callable);
     Callable get_packet_callback() const;
+    // When enabled the packet callback receives an FFmpegPacket sharing the
+    // encoder's buffer instead of a Dictionary with a copied payload.
+    void set_packet_objects_enabled(bool p_enabled);
+    bool is_packet_objects_enabled() const;
+    // Packets are only copied out of the encoder when a callback is set or
+    // buffering is enabled. Buffered packets are read with drain_packets()
+    // or drain_packets_packed().
+    void set_packet_buffering(bool p_enabled);
+    bool is_packet_buffering() const;
     Array drain_packets();
+    // All buffered payloads in one PackedByteArray ("data") with parallel
+    // PackedInt64Arrays "offsets", "pts", "dts", "duration" and "flags".
+    // Packet i spans [offsets[i], offsets[i + 1]); offsets has one trailing
+    // entry equal to data.size(). flags uses AV_PKT_FLAG_KEY (1) for
+    // keyframes.
+    Dictionary drain_packets_packed();
 
     // Encode an array of Image or ImageTexture frames into a video file.
     // Returns 0 on success.
@@ -0,0 +1,121 @@
+#include "ffmpeg_video_transcoder.h"
+
+#include <godot_cpp/classes/project_settings.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
+
+#include "core/trace.h"
+
+extern "C" {
+    #include <libavutil/pixdesc.h>
+}
+
+namespace godot {
+
+static void log_video_transcoder(const String &p_msg) {
+    UtilityFunctions::print("[FFmpegVideoTranscoder] ", p_msg);
+}
+
+void FFmpegVideoTranscoder::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("set_input_codec", "codec_name"), &FFmpegVideoTranscoder::set_input_codec);
+    ClassDB::bind_method(D_METHOD("set_codec_name", "name"), &FFmpegVideoTranscoder::set_codec_name);
+    ClassDB::bind_method(D_METHOD("set_pixel_format", "fmt"), &FFmpegVideoTranscoder::set_pixel_format);
+    ClassDB::bind_method(D_METHOD("set_frame_rate", "fps"), &FFmpegVideoTranscoder::set_frame_rate);
+    ClassDB::bind_method(D_METHOD("set_resolution", "width", "height"), &FFmpegVideoTranscoder::set_resolution);
+    ClassDB::bind_method(D_METHOD("set_bit_rate", "bps"), &FFmpegVideoTranscoder::set_bit_rate);
+    ClassDB::bind_method(D_METHOD("set_rate_control_mode", "mode"), &FFmpegVideoTranscoder::set_rate_control_mode);
+    ClassDB::bind_method(D_METHOD("set_quality", "value"), &FFmpegVideoTranscoder::set_quality);
+    ClassDB::bind_method(D_METHOD("set_preset", "preset"), &FFmpegVideoTranscoder::set_preset);
+    ClassDB::bind_method(D_METHOD("set_keyframe_interval", "interval"), &FFmpegVideoTranscoder::set_keyframe_interval);
+
+    ClassDB::bind_method(D_METHOD("set_threaded", "enabled"), &FFmpegVideoTranscoder::set_threaded);
+    ClassDB::bind_method(D_METHOD("is_threaded"), &FFmpegVideoTranscoder::is_threaded);
+    ClassDB::bind_method(D_METHOD("set_max_queued_frames", "frames"), &FFmpegVideoTranscoder::set_max_queued_frames);
+    ClassDB::bind_method(D_METHOD("get_max_queued_frames"), &FFmpegVideoTranscoder::get_max_queued_frames);
+
+    ClassDB::bind_method(D_METHOD("transcode_file", "input_path", "output_path"), &FFmpegVideoTranscoder::transcode_file);
+    ClassDB::bind_method(D_METHOD("get_frames_transcoded"), &FFmpegVideoTranscoder::get_frames_transcoded);
+}
+
+void FFmpegVideoTranscoder::set_input_codec(const String &p_codec_name) {
+    transcoder.set_preferred_decoder(p_codec_name.utf8().get_data());
+}
+
+void FFmpegVideoTranscoder::set_codec_name(const String &p_name) {
+    transcoder.get_config().codec_name = p_name.utf8().get_data();
+}
+
+void FFmpegVideoTranscoder::set_pixel_format(const String &p_name) {
+    const AVPixelFormat fmt = av_get_pix_fmt(p_name.to_lower().utf8().get_data());
+    if (fmt == AV_PIX_FMT_NONE) {
+        log_video_transcoder("Unknown pixel format: " + p_name);
+        return;
+    }
+    transcoder.get_config().pix_fmt = fmt;
+}
+
+void FFmpegVideoTranscoder::set_frame_rate(int p_fps) {
+    transcoder.set_frame_rate(p_fps);
+}
+
+void FFmpegVideoTranscoder::set_resolution(int p_width, int p_height) {
+    if (p_width >= 0 && p_height >= 0) {
+        transcoder.get_config().width = p_width;
+        transcoder.get_config().height = p_height;
+    }
+}
+
+void FFmpegVideoTranscoder::set_bit_rate(int64_t p_bit_rate) {
+    if (p_bit_rate > 0) {
+        transcoder.get_config().bit_rate = p_bit_rate;
+    }
+}
+
+void FFmpegVideoTranscoder::set_rate_control_mode(const String &p_mode) {
+    transcoder.get_config().rate_control_mode = p_mode.to_lower().utf8().get_data();
+}
+
+void FFmpegVideoTranscoder::set_quality(int p_quality) {
+    transcoder.get_config().quality = p_quality;
+}
+
+void FFmpegVideoTranscoder::set_preset(const String &p_preset) {
+    transcoder.get_config().preset = p_preset.utf8().get_data();
+}
+
+void FFmpegVideoTranscoder::set_keyframe_interval(int p_interval) {
+    if (p_interval > 0) {
+        transcoder.get_config().keyframe_interval = p_interval;
+    }
+}
+
+void FFmpegVideoTranscoder::set_threaded(bool p_enabled) {
+    threaded = p_enabled;
+    transcoder.set_threaded(p_enabled);
+}
+
+bool FFmpegVideoTranscoder::is_threaded() const {
+    return threaded;
+}
+
+void FFmpegVideoTranscoder::set_max_queued_frames(int p_frames) {
+    max_queued_frames = p_frames > 0 ? p_frames : 1;
+    transcoder.set_max_queued_frames(max_queued_frames);
+}
+
+int FFmpegVideoTranscoder::get_max_queued_frames() const {
+    return max_queued_frames;
+}
+
+int FFmpegVideoTranscoder::transcode_file(const String &p_input_path, const String &p_output_path) {
+    GDFFMPEG_TRACE_SCOPE("transcode_video_file");
+    ProjectSettings *settings = ProjectSettings::get_singleton();
+    const CharString input = settings->globalize_path(p_input_path).utf8();
+    const CharString output = settings->globalize_path(p_output_path).utf8();
+    return transcoder.transcode(input.get_data(), output.get_data());
+}
+
+int64_t FFmpegVideoTranscoder::get_frames_transcoded() const {
+    return transcoder.get_frames_transcoded();
+}
+
+} // namespace godot
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/class_db.hpp>
+
+#include "core/video_transcoder.h"
+
+namespace godot {
+
+// Streams a video file through decode -> (scale) -> encode -> mux without
+// holding the clip in memory. Only the first video stream is transcoded.
+class FFmpegVideoTranscoder : public RefCounted {
+    GDCLASS(FFmpegVideoTranscoder, RefCounted);
+
+private:
+    gdffmpeg::VideoTranscoder transcoder;
+    bool threaded = true;
+    int max_queued_frames = gdffmpeg::EncodeWorker::DEFAULT_MAX_QUEUED_FRAMES;
+
+protected:
+    static void _bind_methods();
+
+public:
+    // Decoder to prefer over FFmpeg's default for the input codec.
+    void set_input_codec(const String &p_codec_name);
+
+    void set_codec_name(const String &p_name);
+    // Any FFmpeg pixel format name, e.g. "yuv420p".
+    void set_pixel_format(const String &p_name);
+    // 0 keeps the source frame rate; other rates drop or repeat frames so
+    // the duration is unchanged.
+    void set_frame_rate(int p_fps);
+    // 0x0 keeps the source size; frames are only scaled when it changes.
+    void set_resolution(int p_width, int p_height);
+    void set_bit_rate(int64_t p_bit_rate);
+    void set_rate_control_mode(const String &p_mode);
+    void set_quality(int p_quality);
+    void set_preset(const String &p_preset);
+    void set_keyframe_interval(int p_interval);
+
+    // Decode and encode on separate threads (default on).
+    void set_threaded(bool p_enabled);
+    bool is_threaded() const;
+    void set_max_queued_frames(int p_frames);
+    int get_max_queued_frames() const;
+
+    // Returns 0 on success.
+    int transcode_file(const String &p_input_path, const String &p_output_path);
+    int64_t get_frames_transcoded() const;
+};
+
+} // namespace godot
@@ -0,0 +1,182 @@
+#include "movie_writer_ffmpeg.h"
+
+#include "ffmpeg_video_encoder.h"
+
+#include <godot_cpp/classes/project_settings.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
+
+#include <vector>
+
+namespace godot {
+
+static const char *SETTING_VIDEO_CODEC = "editor/movie_writer/ffmpeg/video_codec";
+static const char *SETTING_AUDIO_CODEC = "editor/movie_writer/ffmpeg/audio_codec";
+static const char *SETTING_VIDEO_QUALITY = "editor/movie_writer/ffmpeg/video_quality";
+static const char *SETTING_VIDEO_PRESET = "editor/movie_writer/ffmpeg/video_preset";
+static const char *SETTING_AUDIO_BIT_RATE = "editor/movie_writer/ffmpeg/audio_bit_rate";
+static const char *SETTING_MAX_QUEUED_FRAMES = "editor/movie_writer/ffmpeg/max_queued_frames";
+// Shared with Godot's built-in writers.
+static const char *SETTING_MIX_RATE = "editor/movie_writer/mix_rate";
+
+MovieWriterFFmpeg *MovieWriterFFmpeg::singleton = nullptr;
+
+static void log_movie_writer(const String &p_msg) {
+    UtilityFunctions::print("[MovieWriterFFmpeg] ", p_msg);
+}
+
+static void define_setting(const String &p_name, const Variant &p_default, Variant::Type p_type) {
+    ProjectSettings *settings = ProjectSettings::get_singleton();
+    if (!settings->has_setting(p_name)) {
+        settings->set_setting(p_name, p_default);
+    }
+    settings->set_initial_value(p_name, p_default);
+
+    Dictionary info;
+    info["name"] = p_name;
+    info["type"] = p_type;
+    settings->add_property_info(info);
+}
+
+static Variant get_setting(const String &p_name, const Variant &p_default) {
+    return ProjectSettings::get_singleton()->get_setting(p_name, p_default);
+}
+
+void MovieWriterFFmpeg::_bind_methods() {
+}
+
+void MovieWriterFFmpeg::register_writer() {
+    define_setting(SETTING_VIDEO_CODEC, String(), Variant::STRING);
+    define_setting(SETTING_AUDIO_CODEC, String(), Variant::STRING);
+    define_setting(SETTING_VIDEO_QUALITY, 20, Variant::INT);
+    define_setting(SETTING_VIDEO_PRESET, "veryfast", Variant::STRING);
+    define_setting(SETTING_AUDIO_BIT_RATE, 192000, Variant::INT);
+    define_setting(SETTING_MAX_QUEUED_FRAMES, gdffmpeg::EncodeWorker::DEFAULT_MAX_QUEUED_FRAMES, Variant::INT);
+
+    // A repeated initialization in the same process must not hand the
+    // engine a second writer.
+    if (!singleton) {
+        singleton = memnew(MovieWriterFFmpeg);
+        MovieWriter::add_writer(singleton);
+    }
+}
+
+void MovieWriterFFmpeg::unregister_writer() {
+    // MovieWriter has no remove_writer(): the engine's list keeps pointing at
+    // the writer after SCENE deinit, and it is walked again whenever a movie
+    // path is resolved (another extension reloading, the editor probing
+    // writers). Like the engine's own writers it stays alive for the rest
+    // of the process; only an unfinished recording is closed here.
+    if (singleton && singleton->encoder.is_active()) {
+        singleton->encoder.abort();
+    }
+}
+
+uint32_t MovieWriterFFmpeg::_get_audio_mix_rate() const {
+    return static_cast<int>(get_setting(SETTING_MIX_RATE, 48000));
+}
+
+AudioServer::SpeakerMode MovieWriterFFmpeg::_get_audio_speaker_mode() const {
+    // The audio encoder only lays out mono and stereo.
+    return AudioServer::SPEAKER_MODE_STEREO;
+}
+
+bool MovieWriterFFmpeg::_handles_file(const String &p_path) const {
+    const String ext = p_path.get_extension().to_lower();
+    return ext == "mp4" || ext == "mkv" || ext == "mov" || ext == "webm";
+}
+
+Error MovieWriterFFmpeg::_write_begin(const Vector2i &p_movie_size, uint32_t p_fps, const String &p_base_path) {
+    const bool webm = p_base_path.get_extension().to_lower() == "webm";
+    String video_codec = get_setting(SETTING_VIDEO_CODEC, String());
+    String audio_codec = get_setting(SETTING_AUDIO_CODEC, String());
+    if (video_codec.is_empty()) {
+        video_codec = webm ? "libvpx-vp9" : "libx264";
+    }
+    if (audio_codec.is_empty()) {
+        audio_codec = webm ? "libopus" : "aac";
+    }
+
+    gdffmpeg::VideoEncoderConfig &video = encoder.get_video_config();
+    video.codec_name = video_codec.utf8().get_data();
+    video.pix_fmt = AV_PIX_FMT_YUV420P;
+    video.frame_rate = static_cast<int>(p_fps);
+    video.width = p_movie_size.x;
+    video.height = p_movie_size.y;
+    video.rate_control_mode = "vbr";
+    video.quality = static_cast<int>(get_setting(SETTING_VIDEO_QUALITY, 20));
+    video.preset = String(get_setting(SETTING_VIDEO_PRESET, "veryfast")).utf8().get_data();
+    video.keyframe_interval = static_cast<int>(p_fps) * 2;
+
+    mix_rate = _get_audio_mix_rate();
+    samples_per_frame = p_fps > 0 ? mix_rate / p_fps : 0;
+
+    gdffmpeg::AudioEncoderOptions &audio = encoder.get_audio_options();
+    audio.codec_name = audio_codec.utf8().get_data();
+    audio.sample_rate = static_cast<int>(mix_rate);
+    audio.channels = 2;
+    audio.bit_rate = static_cast<int>(get_setting(SETTING_AUDIO_BIT_RATE, 192000));
+
+    encoder.set_max_queued_frames(static_cast<int>(get_setting(SETTING_MAX_QUEUED_FRAMES, gdffmpeg::EncodeWorker::DEFAULT_MAX_QUEUED_FRAMES)));
+
+    failed = false;
+    const String path = ProjectSettings::get_singleton()->globalize_path(p_base_path);
+    if (encoder.begin(path.utf8().get_data()) != 0) {
+        log_movie_writer("Could not start recording to " + path);
+        return ERR_CANT_CREATE;
+    }
+    log_movie_writer("Recording " + video_codec + "/" + audio_codec + " to " + path);
+    return OK;
+}
+
+Error MovieWriterFFmpeg::_write_frame(const Ref<Image> &p_frame_image, const void *p_audio_frame_block) {
+    if (failed || p_frame_image.is_null()) {
+        return FAILED;
+    }
+
+    Ref<Image> image = p_frame_image;
+    AVPixelFormat src_fmt = FFmpegVideoEncoder::pixel_format_from_image(image->get_format());
+    if (image->is_compressed() || !gdffmpeg::VideoEncoder::is_supported_source_format(src_fmt)) {
+        image = p_frame_image->duplicate();
+        image->convert(Image::FORMAT_RGBA8);
+        src_fmt = AV_PIX_FMT_RGBA;
+    }
+
+    // Shares the Image's buffer; the worker drops the reference once scaled.
+    PackedByteArray *held = memnew(PackedByteArray(image->get_data()));
+    gdffmpeg::EncoderFrame frame;
+    frame.data = held->ptr();
+    frame.size = static_cast<int>(held->size());
+    frame.width = image->get_width();
+    frame.height = image->get_height();
+    frame.format = src_fmt;
+    frame.release = [held]() {
+        memdelete(held);
+    };
+
+    // Godot mixes signed 32-bit stereo, mix_rate / fps frames per video frame.
+    std::vector<float> pcm;
+    if (p_audio_frame_block && samples_per_frame > 0) {
+        const int32_t *src = static_cast<const int32_t *>(p_audio_frame_block);
+        pcm.resize(static_cast<size_t>(samples_per_frame) * 2);
+        for (size_t i = 0; i < pcm.size(); i++) {
+            pcm[i] = static_cast<float>(src[i]) / 2147483648.0f;
+        }
+    }
+
+    if (!encoder.submit(std::move(frame), std::move(pcm))) {
+        log_movie_writer("Encoding failed; the rest of the movie is dropped");
+        failed = true;
+        return FAILED;
+    }
+    return OK;
+}
+
+void MovieWriterFFmpeg::_write_end() {
+    const int err = encoder.finish();
+    if (err != 0) {
+        log_movie_writer("Recording finished with error " + String::num_int64(err));
+    }
+}
+
+} // namespace godot
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <godot_cpp/classes/audio_server.hpp>
+#include <godot_cpp/classes/image.hpp>
+#include <godot_cpp/classes/movie_writer.hpp>
+#include <godot_cpp/core/class_db.hpp>
+
+#include "core/movie_encoder.h"
+
+namespace godot {
+
+// Handles `--write-movie` for .mp4, .mkv, .mov and .webm paths. Frames and
+// the engine's audio mix are encoded on a worker thread so the fixed-FPS
+// capture loop only pays for queueing the frame.
+//
+// Codecs and quality come from the editor/movie_writer/ffmpeg/* project
+// settings; empty codec names pick H.264/AAC (VP9/Opus for .webm).
+class MovieWriterFFmpeg : public MovieWriter {
+    GDCLASS(MovieWriterFFmpeg, MovieWriter);
+
+private:
+    gdffmpeg::MovieEncoder encoder;
+    uint32_t mix_rate = 48000;
+    uint32_t samples_per_frame = 0;
+    bool failed = false;
+
+    static MovieWriterFFmpeg *singleton;
+
+protected:
+    static void _bind_methods();
+
+public:
+    static void register_writer();
+    static void unregister_writer();
+
+    uint32_t _get_audio_mix_rate() const override;
+    AudioServer::SpeakerMode _get_audio_speaker_mode() const override;
+    bool _handles_file(const String &p_path) const override;
+    Error _write_begin(const Vector2i &p_movie_size, uint32_t p_fps, const String &p_base_path) override;
+    Error _write_frame(const Ref<Image> &p_frame_image, const void *p_audio_frame_block) override;
+    void _write_end() override;
+};
+
+} // namespace godot
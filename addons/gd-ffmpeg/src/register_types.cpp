@@ -3,31 +3,75 @@
 #include <gdextension_interface.h>
 #include <godot_cpp/core/class_db.hpp>
 #include <godot_cpp/godot.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
 
 #include "ffmpeg_audio_encoder.h"
 #include "ffmpeg_audio_decoder.h"
+#include "ffmpeg_batch_transcoder.h"
 #include "ffmpeg_video_encoder.h"
 #include "ffmpeg_video_decoder.h"
+#include "ffmpeg_video_transcoder.h"
+#include "ffmpeg_concat.h"
+#include "ffmpeg_frame.h"
+#include "ffmpeg_monitors.h"
+#include "ffmpeg_muxer.h"
+#include "ffmpeg_packet.h"
+#include "ffmpeg_remuxer.h"
+#include "ffmpeg_thread_budget.h"
+#include "ffmpeg_trace.h"
+#include "movie_writer_ffmpeg.h"
+#include "core/log.h"
+#include "core/thread_budget.h"
+#include "core/trace.h"
 
 using namespace godot;
 
+static void print_core_message(const char *p_component, const std::string &p_message, bool p_is_error) {
+    const String line = "[" + String(p_component) + "] " + String::utf8(p_message.c_str());
+    if (p_is_error) {
+        UtilityFunctions::printerr(line);
+    } else {
+        UtilityFunctions::print(line);
+    }
+}
+
 void initialize_ffmpeg_module(ModuleInitializationLevel p_level) {
     if (p_level != MODULE_INITIALIZATION_LEVEL_SCENE) {
         return;
     }
 
+    gdffmpeg::set_log_handler(&print_core_message);
+
+    ClassDB::register_class<FFmpegPacket>();
+    ClassDB::register_class<FFmpegFrame>();
     ClassDB::register_class<FFmpegAudioEncoder>();
     ClassDB::register_class<FFmpegAudioDecoder>();
     ClassDB::register_class<FFmpegAudioTranscoder>();
     ClassDB::register_class<FFmpegVideoEncoder>();
     ClassDB::register_class<FFmpegVideoDecoder>();
+    ClassDB::register_class<FFmpegVideoTranscoder>();
+    ClassDB::register_class<FFmpegRemuxer>();
+    ClassDB::register_class<FFmpegMuxer>();
+    ClassDB::register_class<FFmpegConcat>();
+    ClassDB::register_class<FFmpegBatchTranscoder>();
+    ClassDB::register_class<FFmpegTracer>();
+    ClassDB::register_class<FFmpegThreadBudget>();
+    ClassDB::register_class<MovieWriterFFmpeg>();
+
+    FFmpegMonitors::register_monitors();
+    MovieWriterFFmpeg::register_writer();
 }
 
 void uninitialize_ffmpeg_module(ModuleInitializationLevel p_level) {
     if (p_level != MODULE_INITIALIZATION_LEVEL_SCENE) {
         return;
     }
-    // Nothing to do for now
+
+    MovieWriterFFmpeg::unregister_writer();
+    FFmpegMonitors::unregister_monitors();
+    gdffmpeg::ThreadBudget::shutdown();
+    gdffmpeg::Trace::shutdown();
+    gdffmpeg::set_log_handler(nullptr);
 }
 
 extern "C" {
@@ -0,0 +1,205 @@
+extends Node
+
+# Headless throughput benchmark for gd-ffmpeg.
+#
+#   godot --headless --path . res://benchmarks/benchmark.tscn -- --output=user://bench.json [--quick] [--frames=N]
+#
+# Test media is synthesised deterministically with FFmpegVideoEncoder and
+# FFmpegAudioEncoder into user://benchmark_media/, then decoded back. Results
+# are written as JSON so runs can be diffed between releases.
+
+const MEDIA_DIR := "user://benchmark_media"
+
+const DECODE_CASES := [
+	{ "codec": "libx264", "container": "mp4", "width": 640, "height": 360 },
+	{ "codec": "libx264", "container": "mp4", "width": 1280, "height": 720 },
+	{ "codec": "libx264", "container": "mp4", "width": 1920, "height": 1080 },
+	{ "codec": "mpeg4", "container": "mp4", "width": 1280, "height": 720 },
+	{ "codec": "libvpx-vp9", "container": "webm", "width": 1280, "height": 720 },
+]
+
+const ENCODE_PRESETS := ["ultrafast", "veryfast", "medium"]
+
+var frame_count := 60
+var quick := false
+var output_path := "user://benchmark_results.json"
+
+
+func _ready() -> void:
+	parse_args()
+	DirAccess.make_dir_recursive_absolute(MEDIA_DIR)
+
+	var results := {
+		"engine_version": Engine.get_version_info().get("string", ""),
+		"os": OS.get_name(),
+		"processor_count": OS.get_processor_count(),
+		"timestamp": Time.get_datetime_string_from_system(true),
+		"frame_count": frame_count,
+		"encode": bench_encode_presets(),
+		"decode": bench_decode_cases(),
+		"pcm_decode": bench_pcm_decode(),
+	}
+	results["peak_rss_bytes"] = peak_rss_bytes()
+
+	var file := FileAccess.open(output_path, FileAccess.WRITE)
+	if file == null:
+		push_error("Could not write benchmark results to %s" % output_path)
+		get_tree().quit(1)
+		return
+	file.store_string(JSON.stringify(results, "  "))
+	file.close()
+	print("Benchmark results written to ", ProjectSettings.globalize_path(output_path))
+	get_tree().quit(0)
+
+
+func parse_args() -> void:
+	for arg in OS.get_cmdline_user_args():
+		if arg == "--quick":
+			quick = true
+		elif arg.begins_with("--frames="):
+			frame_count = maxi(1, arg.get_slice("=", 1).to_int())
+		elif arg.begins_with("--output="):
+			output_path = arg.get_slice("=", 1)
+	if quick:
+		frame_count = mini(frame_count, 15)
+
+
+# Deterministic content: a fixed gradient with a box that moves every frame,
+# so inter-frame prediction has real motion to work on.
+func make_base_image(width: int, height: int) -> Image:
+	var row := PackedByteArray()
+	row.resize(width * 4)
+	for x in width:
+		row[x * 4] = (x * 255) / maxi(1, width - 1)
+		row[x * 4 + 1] = 128
+		row[x * 4 + 2] = 255 - row[x * 4]
+		row[x * 4 + 3] = 255
+	var data := PackedByteArray()
+	for y in height:
+		data.append_array(row)
+	return Image.create_from_data(width, height, false, Image.FORMAT_RGBA8, data)
+
+
+func make_frame(base: Image, index: int) -> Image:
+	var img := base.duplicate() as Image
+	var box := Vector2i(base.get_width() / 8, base.get_height() / 8)
+	var pos := Vector2i((index * 13) % (base.get_width() - box.x), (index * 7) % (base.get_height() - box.y))
+	img.fill_rect(Rect2i(pos, box), Color(float(index % 16) / 15.0, 0.2, 0.8))
+	return img
+
+
+func encode_clip(path: String, codec: String, preset: String, width: int, height: int) -> Dictionary:
+	var encoder := FFmpegVideoEncoder.new()
+	encoder.set_codec_name(codec)
+	encoder.set_resolution(width, height)
+	encoder.set_frame_rate(30)
+	encoder.set_preset(preset)
+	encoder.set_keyframe_interval(30)
+
+	var base := make_base_image(width, height)
+	if encoder.begin(path) != 0:
+		return { "ok": false }
+
+	# Frame synthesis stays outside the timed region.
+	var elapsed := 0
+	for i in frame_count:
+		var img := make_frame(base, i)
+		var start := Time.get_ticks_usec()
+		encoder.push_image(img)
+		elapsed += Time.get_ticks_usec() - start
+	var end_start := Time.get_ticks_usec()
+	encoder.end()
+	elapsed += Time.get_ticks_usec() - end_start
+
+	var ok := FileAccess.file_exists(path) and FileAccess.open(path, FileAccess.READ).get_length() > 0
+	return { "ok": ok, "usec": elapsed }
+
+
+func bench_encode_presets() -> Array:
+	var out := []
+	var presets := ["ultrafast"] if quick else ENCODE_PRESETS
+	for preset in presets:
+		var path := MEDIA_DIR.path_join("encode_%s.mp4" % preset)
+		var run := encode_clip(path, "libx264", preset, 1280, 720)
+		var entry := { "codec": "libx264", "preset": preset, "width": 1280, "height": 720 }
+		if run.ok:
+			entry["fps"] = frame_count * 1000000.0 / maxf(1.0, run.usec)
+			entry["total_usec"] = run.usec
+		else:
+			entry["skipped"] = "encoder unavailable"
+		out.append(entry)
+	return out
+
+
+func bench_decode_cases() -> Array:
+	var out := []
+	var cases := DECODE_CASES.slice(0, 2) if quick else DECODE_CASES
+	for c in cases:
+		var entry: Dictionary = c.duplicate()
+		var path := MEDIA_DIR.path_join("decode_%s_%dx%d.%s" % [c.codec, c.width, c.height, c.container])
+		if not encode_clip(path, c.codec, "veryfast", c.width, c.height).ok:
+			entry["skipped"] = "encoder unavailable"
+			out.append(entry)
+			continue
+
+		var decoder := FFmpegVideoDecoder.new()
+		decoder.set_stats_enabled(true)
+		var start := Time.get_ticks_usec()
+		var frames := decoder.decode_frames_from_file(path)
+		var elapsed := Time.get_ticks_usec() - start
+
+		var stats := decoder.get_stats()
+		var scale: Dictionary = stats.get("sws_scale", {})
+		entry["frames"] = frames.size()
+		entry["fps"] = frames.size() * 1000000.0 / maxf(1.0, elapsed)
+		entry["total_usec"] = elapsed
+		entry["sws_scale_usec_per_frame"] = float(scale.get("total_usec", 0)) / maxf(1.0, scale.get("count", 0))
+		entry["sws_scale_p99_usec"] = scale.get("p99_usec", 0)
+		entry["stages"] = stats
+		out.append(entry)
+	return out
+
+
+func bench_pcm_decode() -> Dictionary:
+	var sample_rate := 48000
+	var seconds := 10 if quick else 60
+	var pcm := PackedFloat32Array()
+	pcm.resize(sample_rate * seconds * 2)
+	for i in sample_rate * seconds:
+		var v := sin(TAU * 440.0 * i / sample_rate) * 0.5
+		pcm[i * 2] = v
+		pcm[i * 2 + 1] = -v
+
+	# Raw MP3 frames are self-delimiting, so the encoder output can be decoded
+	# without a container.
+	var path := MEDIA_DIR.path_join("pcm_bench.mp3")
+	var encoder := FFmpegAudioEncoder.new()
+	if encoder.setup_encoder("libmp3lame", sample_rate, 2, 192000) != 0 or encoder.encode_pcm_to_file(pcm, path) != 0:
+		return { "skipped": "libmp3lame unavailable" }
+
+	var decoder := FFmpegAudioDecoder.new()
+	decoder.set_stats_enabled(true)
+	var start := Time.get_ticks_usec()
+	var decoded := decoder.decode_pcm_from_file(path)
+	var elapsed := Time.get_ticks_usec() - start
+
+	var bytes := decoded.size() * 4
+	return {
+		"codec": "mp3",
+		"seconds": seconds,
+		"output_bytes": bytes,
+		"mb_per_sec": bytes / 1048576.0 / maxf(0.000001, elapsed / 1000000.0),
+		"total_usec": elapsed,
+		"stages": decoder.get_stats(),
+	}
+
+
+func peak_rss_bytes() -> int:
+	# VmHWM is the resident-set high-water mark of the whole process.
+	if OS.get_name() == "Linux":
+		var status := FileAccess.open("/proc/self/status", FileAccess.READ)
+		if status:
+			for line in status.get_as_text().split("\n"):
+				if line.begins_with("VmHWM:"):
+					return line.get_slice(":", 1).strip_edges().get_slice(" ", 0).to_int() * 1024
+	return OS.get_static_memory_peak_usage()
@@ -0,0 +1,14 @@
+#!/usr/bin/env sh
+# Runs the gd-ffmpeg benchmark scene headless and writes JSON results.
+#
+#   GODOT=/path/to/godot ./benchmarks/run_benchmarks.sh [output.json] [extra args...]
+#
+# Extra args are forwarded to the scene (e.g. --quick, --frames=120).
+set -e
+
+GODOT="${GODOT:-godot}"
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+OUTPUT="${1:-$PROJECT_DIR/bench_output.json}"
+[ $# -gt 0 ] && shift
+
+exec "$GODOT" --headless --path "$PROJECT_DIR" res://benchmarks/benchmark.tscn -- --output="$OUTPUT" "$@"